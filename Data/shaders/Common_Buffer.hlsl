@@ -100,6 +100,16 @@ cbuffer BufferObject : register(b3)
     matrix g_object_transform;
     matrix g_object_wvp_current;
     matrix g_object_wvp_previous;
+    float g_object_instanced;
+    float3 g_object_padding;
+};
+
+// High frequency - Updates per instanced draw
+static const uint g_max_instances = 64;
+cbuffer BufferInstance : register(b5)
+{
+    matrix g_instance_transform[g_max_instances];
+    matrix g_instance_wvp_previous[g_max_instances];
 };
 
 // High frequency - Updates per light
@@ -112,3 +122,29 @@ cbuffer LightBuffer : register(b4)
     float4 position;
     float4 direction;
 };
+
+// Low frequency - Updates once per frame, the lights which are shaded by the clustered lighting pass
+static const uint g_cluster_tile_count_x    = 16;
+static const uint g_cluster_tile_count_y    = 8;
+static const uint g_cluster_slice_count     = 24;
+static const uint g_cluster_count           = g_cluster_tile_count_x * g_cluster_tile_count_y * g_cluster_slice_count;
+static const uint g_cluster_light_max       = 256;
+static const uint g_cluster_index_max       = 32768;
+cbuffer BufferLights : register(b6)
+{
+    float4 g_lights_position_range[g_cluster_light_max];
+    float4 g_lights_color_type[g_cluster_light_max];
+    float4 g_lights_direction_angle[g_cluster_light_max];
+
+    float g_cluster_slice_scale;
+    float g_cluster_slice_bias;
+    float g_lights_count;
+    float g_lights_padding;
+};
+
+// Low frequency - Updates once per frame, the light lists of every cluster
+cbuffer BufferClusters : register(b7)
+{
+    uint4 g_clusters[g_cluster_count / 4];              // index offset (low 16 bits) and light count (high 16 bits)
+    uint4 g_cluster_indices[g_cluster_index_max / 16];  // light indices, packed as bytes
+};
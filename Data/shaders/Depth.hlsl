@@ -23,19 +23,41 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Common.hlsl"
 //====================
 
-Pixel_PosUv mainVS(Vertex_PosUv input)
+Pixel_PosUv mainVS(Vertex_PosUv input, uint instance_id : SV_InstanceID)
 {
     Pixel_PosUv output;
 
+    // Instanced draws get their transforms from the instance buffer
+    matrix transform = g_object_instanced != 0.0f ? g_instance_transform[instance_id] : g_object_transform;
+
     input.position.w    = 1.0f; 
-    output.position     = mul(input.position, g_object_transform);
+    output.position     = mul(input.position, transform);
     output.uv           = input.uv;
 
     return output;
 }
 
+#if DEPTH_COPY
+struct PixelOutputType
+{
+    float4 color    : SV_Target0;
+    float depth     : SV_Depth;
+};
+
+// Copies a cached depth into the bound depth target, the color target is left white (no transparent shadows)
+PixelOutputType mainPS(Pixel_PosUv input)
+{
+    PixelOutputType output;
+
+    output.color    = 1.0f;
+    output.depth    = tex.Load(int3(input.position.xy, 0)).r;
+
+    return output;
+}
+#else
 float4 mainPS(Pixel_PosUv input) : SV_TARGET
 {
     float2 uv = float2(input.uv.x * g_mat_tiling.x + g_mat_offset.x, input.uv.y * g_mat_offset.y + g_mat_tiling.y);
     return degamma(tex.Sample(sampler_anisotropic_wrap, uv)) * g_mat_color;
 }
+#endif
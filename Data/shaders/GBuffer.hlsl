@@ -42,17 +42,21 @@ struct PixelOutputType
     float2 velocity : SV_Target3;
 };
 
-PixelInputType mainVS(Vertex_PosUvNorTan input)
+PixelInputType mainVS(Vertex_PosUvNorTan input, uint instance_id : SV_InstanceID)
 {
     PixelInputType output;
+
+    // Instanced draws get their transforms from the instance buffer
+    matrix transform    = g_object_instanced != 0.0f ? g_instance_transform[instance_id]    : g_object_transform;
+    matrix wvp_previous = g_object_instanced != 0.0f ? g_instance_wvp_previous[instance_id] : g_object_wvp_previous;
     
     input.position.w            = 1.0f;     
-    output.position_ss_previous = mul(input.position, g_object_wvp_previous);
-    output.position             = mul(input.position, g_object_transform);
+    output.position_ss_previous = mul(input.position, wvp_previous);
+    output.position             = mul(input.position, transform);
     output.position             = mul(output.position, g_viewProjection);
     output.position_ss_current  = output.position;
-    output.normal               = normalize(mul(input.normal, (float3x3)g_object_transform)).xyz;   
-    output.tangent              = normalize(mul(input.tangent, (float3x3)g_object_transform)).xyz;
+    output.normal               = normalize(mul(input.normal, (float3x3)transform)).xyz;   
+    output.tangent              = normalize(mul(input.tangent, (float3x3)transform)).xyz;
     output.uv                   = input.uv;
     
     return output;
@@ -39,15 +39,84 @@ float attunation_distance(const Light light)
     return attenuation * attenuation;
 }
 
-float attunation_angle(const Light light)
+float attunation_angle(const Light light, const float3 light_forward)
 {
     float cutoffAngle       = 1.0f - light.angle;
-    float light_dot_pixel   = dot(direction.xyz, light.direction);
+    float light_dot_pixel   = dot(light_forward, light.direction);
     float epsilon           = cutoffAngle - cutoffAngle * 0.9f;
     float attenuation       = saturate((light_dot_pixel - cutoffAngle) / epsilon); // attenuate when approaching the outer cone
     return attenuation * attenuation;
 }
 
+// Reflectance equation, light.color is expected to be attenuated and shadowed already
+void reflectance(Surface surface, Material material, Light light, inout float3 diffuse_out, inout float3 specular_out, out float3 reflective_energy)
+{
+    // Compute some vectors and dot products
+    float3 l        = -light.direction;
+    float3 v        = -surface.camera_to_pixel;
+    float3 h        = normalize(v + l);
+    float l_dot_h   = saturate(dot(l, h));
+    float v_dot_h   = saturate(dot(v, h));
+    float n_dot_v   = saturate(dot(surface.normal, v));
+    float n_dot_l   = saturate(dot(surface.normal, l));
+    float n_dot_h   = saturate(dot(surface.normal, h));
+
+    float3 diffuse_energy   = 1.0f;
+    reflective_energy       = 1.0f;
+    
+    // Specular
+    float3 specular = 0.0f;
+    if (material.anisotropic == 0.0f)
+    {
+        specular = BRDF_Specular_Isotropic(material, n_dot_v, n_dot_l, n_dot_h, v_dot_h, diffuse_energy, reflective_energy);
+    }
+    else
+    {
+        specular = BRDF_Specular_Anisotropic(material, surface, v, l, h, n_dot_v, n_dot_l, n_dot_h, l_dot_h, diffuse_energy, reflective_energy);
+    }
+
+    // Specular clearcoat
+    float3 specular_clearcoat = 0.0f;
+    if (material.clearcoat != 0.0f)
+    {
+        specular_clearcoat = BRDF_Specular_Clearcoat(material, n_dot_h, v_dot_h, diffuse_energy, reflective_energy);
+    }
+
+    // Sheen
+    float3 specular_sheen = 0.0f;
+    if (material.sheen != 0.0f)
+    {
+        specular_sheen = BRDF_Specular_Sheen(material, n_dot_v, n_dot_l, n_dot_h, diffuse_energy, reflective_energy);
+    }
+    
+    // Diffuse
+    float3 diffuse = BRDF_Diffuse(material, n_dot_v, n_dot_l, v_dot_h);
+
+    // Tone down diffuse such as that only non metals have it
+    diffuse *= diffuse_energy;
+
+    float3 radiance = light.color * n_dot_l;
+    diffuse_out     += diffuse * radiance;
+    specular_out    += (specular + specular_clearcoat + specular_sheen) * radiance;
+}
+
+float3 screen_space_reflection(float2 uv, Material material, float3 reflective_energy)
+{
+    float3 light_reflection = 0.0f;
+    #if SCREEN_SPACE_REFLECTIONS
+    float2 sample_ssr = tex_ssr.Sample(sampler_point_clamp, uv).xy;
+    [branch]
+    if (sample_ssr.x * sample_ssr.y != 0.0f)
+    {
+        // saturate as reflections will accumulate int tex_frame overtime, causing more light to go out that it comes in.
+        light_reflection = saturate(tex_frame.Sample(sampler_bilinear_clamp, sample_ssr.xy).rgb);
+        light_reflection *= reflective_energy;
+        light_reflection *= 1.0f - material.roughness; // fade with roughness as we don't have blurry screen space reflections yet
+    }
+    #endif
+    return light_reflection;
+}
+
 PixelOutputType mainPS(Pixel_PosUv input)
 {
     PixelOutputType light_out;
@@ -93,6 +162,68 @@ PixelOutputType mainPS(Pixel_PosUv input)
         material.is_sky                 = mat_id == 0;
     }
 
+    // Compute multi-bounce ambient occlusion
+    float3 multi_bounce_ao = MultiBounceAO(material.occlusion, sample_albedo.rgb);
+
+    #if CLUSTERED
+    // Every point and spot light which has been binned into this pixel's cluster, none of them casts shadows
+    [branch]
+    if (!material.is_sky)
+    {
+        // Locate the cluster
+        float depth_view        = max(mul(float4(surface.position, 1.0f), g_view).z, g_camera_near);
+        uint slice              = (uint)clamp(log(depth_view) * g_cluster_slice_scale - g_cluster_slice_bias, 0.0f, g_cluster_slice_count - 1.0f);
+        uint2 tile              = min((uint2)(input.uv * float2(g_cluster_tile_count_x, g_cluster_tile_count_y)), uint2(g_cluster_tile_count_x - 1, g_cluster_tile_count_y - 1));
+        uint cluster_index      = tile.x + tile.y * g_cluster_tile_count_x + slice * g_cluster_tile_count_x * g_cluster_tile_count_y;
+        uint cluster            = g_clusters[cluster_index / 4][cluster_index % 4];
+        uint index_offset       = cluster & 0xFFFF;
+        uint light_count        = cluster >> 16;
+
+        float3 diffuse              = 0.0f;
+        float3 specular             = 0.0f;
+        float3 reflective_energy    = 0.0f;
+
+        for (uint i = 0; i < light_count; i++)
+        {
+            uint index_position = index_offset + i;
+            uint light_index    = (g_cluster_indices[index_position / 16][(index_position % 16) / 4] >> ((index_position % 4) * 8)) & 0xFF;
+
+            Light light;
+            light.color             = g_lights_color_type[light_index].rgb;
+            light.position          = g_lights_position_range[light_index].xyz;
+            light.range             = g_lights_position_range[light_index].w;
+            light.angle             = g_lights_direction_angle[light_index].w;
+            light.bias              = 0.0f;
+            light.normal_bias       = 0.0f;
+            light.array_size        = 1;
+            light.distance_to_pixel = length(surface.position - light.position);
+            light.direction         = normalize(surface.position - light.position);
+            light.color             *= attunation_distance(light);
+
+            // Spot
+            if (g_lights_color_type[light_index].w != 0.0f)
+            {
+                light.color *= attunation_angle(light, g_lights_direction_angle[light_index].xyz);
+            }
+
+            light.color *= multi_bounce_ao;
+
+            [branch]
+            if (any(light.color))
+            {
+                float3 light_reflective_energy;
+                reflectance(surface, material, light, diffuse, specular, light_reflective_energy);
+                reflective_energy = max(reflective_energy, light_reflective_energy);
+            }
+        }
+
+        // Reflections are added once, by whichever pass the renderer tells to
+        float3 light_reflection = light_count != 0 ? screen_space_reflection(input.uv, material, reflective_energy) : 0.0f;
+
+        light_out.diffuse.rgb   = saturate_16(diffuse);
+        light_out.specular.rgb  = saturate_16(specular + light_reflection);
+    }
+    #else
     // Fill light struct
     Light light;
     light.color             = color.xyz;
@@ -115,7 +246,7 @@ PixelOutputType mainPS(Pixel_PosUv input)
     light.array_size    = 1;
     light.direction     = normalize(surface.position - light.position);
     light.color         *= intensity_range_angle_bias.x;
-    light.color         *= attunation_distance(light) * attunation_angle(light); // attenuate
+    light.color         *= attunation_distance(light) * attunation_angle(light, direction.xyz); // attenuate
     #endif
     
     // Compute shadows and volumetric fog/light
@@ -144,9 +275,6 @@ PixelOutputType mainPS(Pixel_PosUv input)
         #endif
     }
 
-    // Compute multi-bounce ambient occlusion
-    float3 multi_bounce_ao = MultiBounceAO(material.occlusion, sample_albedo.rgb);
-
     // Modulate light with shadow color, visibility and ambient occlusion
     light.color *= shadow.rgb * shadow.a * multi_bounce_ao;
 
@@ -154,72 +282,19 @@ PixelOutputType mainPS(Pixel_PosUv input)
     [branch]
     if (any(light.color) && !material.is_sky)
     {
-        // Compute some vectors and dot products
-        float3 l        = -light.direction;
-        float3 v        = -surface.camera_to_pixel;
-        float3 h        = normalize(v + l);
-        float l_dot_h   = saturate(dot(l, h));
-        float v_dot_h   = saturate(dot(v, h));
-        float n_dot_v   = saturate(dot(surface.normal, v));
-        float n_dot_l   = saturate(dot(surface.normal, l));
-        float n_dot_h   = saturate(dot(surface.normal, h));
-
-        float3 diffuse_energy       = 1.0f;
+        float3 diffuse              = 0.0f;
+        float3 specular             = 0.0f;
         float3 reflective_energy    = 1.0f;
-        
-        // Specular
-        float3 specular = 0.0f;
-        if (material.anisotropic == 0.0f)
-        {
-            specular = BRDF_Specular_Isotropic(material, n_dot_v, n_dot_l, n_dot_h, v_dot_h, diffuse_energy, reflective_energy);
-        }
-        else
-        {
-            specular = BRDF_Specular_Anisotropic(material, surface, v, l, h, n_dot_v, n_dot_l, n_dot_h, l_dot_h, diffuse_energy, reflective_energy);
-        }
+        reflectance(surface, material, light, diffuse, specular, reflective_energy);
 
-        // Specular clearcoat
-        float3 specular_clearcoat = 0.0f;
-        if (material.clearcoat != 0.0f)
-        {
-            specular_clearcoat = BRDF_Specular_Clearcoat(material, n_dot_h, v_dot_h, diffuse_energy, reflective_energy);
-        }
-
-        // Sheen
-        float3 specular_sheen = 0.0f;
-        if (material.sheen != 0.0f)
-        {
-            specular_sheen = BRDF_Specular_Sheen(material, n_dot_v, n_dot_l, n_dot_h, diffuse_energy, reflective_energy);
-        }
-        
-        // Diffuse
-        float3 diffuse = BRDF_Diffuse(material, n_dot_v, n_dot_l, v_dot_h);
-
-        // Tone down diffuse such as that only non metals have it
-        diffuse *= diffuse_energy;
-
-        // SSR
-        float3 light_reflection = 0.0f;
-        #if SCREEN_SPACE_REFLECTIONS
-        float2 sample_ssr = tex_ssr.Sample(sampler_point_clamp, input.uv).xy;
-        [branch]
-        if (sample_ssr.x * sample_ssr.y != 0.0f)
-        {
-            // saturate as reflections will accumulate int tex_frame overtime, causing more light to go out that it comes in.
-            light_reflection = saturate(tex_frame.Sample(sampler_bilinear_clamp, sample_ssr.xy).rgb);
-            light_reflection *= reflective_energy;
-            light_reflection *= 1.0f - material.roughness; // fade with roughness as we don't have blurry screen space reflections yet
-        }
-        #endif
+        float3 light_reflection = screen_space_reflection(input.uv, material, reflective_energy);
 
-        float3 radiance = light.color * n_dot_l;
-        
-        light_out.diffuse.rgb  = saturate_16(diffuse * radiance);
-        light_out.specular.rgb = saturate_16((specular + specular_clearcoat + specular_sheen) * radiance + light_reflection);
-        
+        light_out.diffuse.rgb  = saturate_16(diffuse);
+        light_out.specular.rgb = saturate_16(specular + light_reflection);
     }
 
     light_out.volumetric.rgb = saturate_16(volumetric);
+    #endif
 
     return light_out;
 }
@@ -319,11 +319,12 @@ void Widget_RenderOptions::Tick()
         // Reflect from engine
         auto do_depth_prepass   = m_renderer->GetOption(Render_DepthPrepass);
         auto do_reverse_z       = m_renderer->GetOption(Render_ReverseZ);
+        auto do_occlusion       = m_renderer->GetOption(Render_OcclusionCulling);
 
         {
             // Buffer
             {
-                static array<string, 22> render_target_debug =
+                static array<string, 24> render_target_debug =
                 {
                     "None",
                     "Gbuffer_Albedo",
@@ -346,7 +347,9 @@ void Widget_RenderOptions::Tick()
                     "Hbao_Noisy",
                     "Hbao",
                     "Ssr",
-                    "TaaHistory"
+                    "Ssgi",
+                    "TaaHistory",
+                    "Occlusion"
                 };
                 static int selection_int = 0;
                 static string selection_str = render_target_debug[0];
@@ -379,10 +382,14 @@ void Widget_RenderOptions::Tick()
 
             // Reverse-Z
             ImGui::Checkbox("Reverse-Z", &do_reverse_z);
+
+            // Occlusion culling
+            ImGui::Checkbox("Occlusion Culling", &do_occlusion);
         }
 
         // Map back to engine
         m_renderer->SetOption(Render_DepthPrepass, do_depth_prepass);
         m_renderer->SetOption(Render_ReverseZ, do_reverse_z);
+        m_renderer->SetOption(Render_OcclusionCulling, do_occlusion);
     }
 }
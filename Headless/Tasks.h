@@ -0,0 +1,64 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+namespace Spartan
+{
+    class Context;
+}
+
+// Verifications and benchmarks, they only go through the public interface of the engine and return false when they fail
+namespace Tasks
+{
+    // Culling, checks the SSE path of Frustum::CullAabbs() against the scalar one and Frustum::IsInside() from random views,
+    // with box counts which don't fill a group of four and ranges which don't start at a multiple of four, then checks that all three keep boxes which are within directional light cascades
+    bool FrustumCullingVerify(Spartan::Context* context);
+    // Culling, logs what a box costs with Frustum::CullAabbs(), its scalar path and Frustum::IsInside()
+    bool FrustumCullingBenchmark(Spartan::Context* context);
+    // Culling, builds a BVH for growing amounts of entities, checks its frustum and ray queries against testing every box and logs what both cost,
+    // the cascades of a directional light (with and without reverse-z) also have to find every box which is known to be within them
+    bool BvhBenchmark(Spartan::Context* context);
+
+    // Entities, fills the world with entities and logs what creating, looking up, saving, loading and removing them costs, then restores the default world
+    bool EntitiesBenchmark(Spartan::Context* context);
+    // Ticking, fills the world with entities whose components don't need ticking and logs what a tick costs, then restores the default world
+    bool TickBenchmark(Spartan::Context* context);
+
+    // Rendering, records a known amount of passes and draws and checks that exactly those reached the command stream of the null device
+    bool NullDeviceVerify(Spartan::Context* context);
+    // Occlusion culling, rasterizes random occluders from random views (with and without reverse-z), checks that they don't hide themselves and still hide what is behind them
+    bool OcclusionVerify(Spartan::Context* context);
+    // Levels of detail, simplifies a few generated meshes and checks the error and the triangle count of every level against the surface they came from
+    bool LodsVerify(Spartan::Context* context);
+    // Light clusters, bins random lights from random views and checks, at random points, that every light which reaches a point is in the list of its cluster
+    bool LightClustersVerify(Spartan::Context* context);
+    // Light clusters, logs how long binning takes for a growing amount of lights
+    bool LightClustersBenchmark(Spartan::Context* context);
+    // Render graph, compiles the passes of a few configurations at 4K, checks them and logs what they allocate and how many barriers they need
+    bool RenderGraphVerify(Spartan::Context* context);
+    // Pipelines, logs what binding the pipeline of a full screen pass costs when its state changes between binds and when it doesn't
+    bool PipelinesBenchmark(Spartan::Context* context);
+
+    // Threading, runs batches of small tasks, submitted from the calling thread and from the workers, and logs how long they take
+    // compared to a single queue which is guarded by one mutex and allocates every task, which is what the job system replaced
+    bool ThreadingBenchmark(Spartan::Context* context);
+}
@@ -0,0 +1,459 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES ===========================
+#include <random>
+#include <algorithm>
+#include <functional>
+#include "Tasks.h"
+#include "Core/Stopwatch.h"
+#include "Logging/Log.h"
+#include "Math/Matrix.h"
+#include "Math/Frustum.h"
+#include "Math/BoundingBox.h"
+#include "Math/Ray.h"
+#include "World/Entity.h"
+#include "World/BoundingVolumeHierarchy.h"
+//======================================
+
+//= NAMESPACES ================
+using namespace std;
+using namespace Spartan;
+using namespace Spartan::Math;
+//=============================
+
+namespace Tasks
+{
+    bool FrustumCullingVerify(Context* context)
+    {
+        const uint32_t view_count = 256;
+
+        // The same views and boxes every run, so that a failure can be reproduced
+        mt19937 generator(0);
+        uniform_real_distribution<float> random(0.0f, 1.0f);
+        auto random_range = [&generator, &random](const float from, const float to) { return from + (to - from) * random(generator); };
+
+        // Everything up to two groups of four and a few larger ones, each of them starting at any offset
+        const uint32_t counts[]     = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 13, 61, 1023 };
+        const uint32_t count_max    = 1023 + 3;
+        const uint8_t untouched     = 0xCD;
+
+        vector<BoundingBox> boxes(count_max);
+        vector<float> center_x(count_max), center_y(count_max), center_z(count_max);
+        vector<float> extent_x(count_max), extent_y(count_max), extent_z(count_max);
+        vector<uint8_t> visible(count_max + 4), visible_scalar(count_max + 4);
+
+        uint32_t tested             = 0;
+        uint32_t visible_count      = 0;
+        uint32_t mismatch_scalar    = 0; // CullAabbs() and CullAabbsScalar() disagree
+        uint32_t mismatch_exact     = 0; // CullAabbsScalar() and IsInside() disagree
+        uint32_t out_of_range       = 0; // a result was written past the end of the range, or isn't 0 or 1
+        for (uint32_t view_index = 0; view_index < view_count; view_index++)
+        {
+            // A perspective or orthographic view, with and without reverse-z, from somewhere in a 200m cube
+            const bool reverse_z        = (view_index & 1) != 0;
+            const bool orthographic     = (view_index & 2) != 0;
+            const float plane_near      = random_range(0.1f, 1.0f);
+            const float plane_far       = random_range(50.0f, 500.0f);
+            const float width           = random_range(10.0f, 100.0f);
+            const Matrix projection     = orthographic ?
+                Matrix::CreateOrthographicLH(width, width * random_range(0.5f, 1.0f), reverse_z ? plane_far : plane_near, reverse_z ? plane_near : plane_far) :
+                Matrix::CreatePerspectiveFieldOfViewLH(random_range(30.0f, 120.0f) * Helper::DEG_TO_RAD, random_range(0.5f, 2.5f), reverse_z ? plane_far : plane_near, reverse_z ? plane_near : plane_far);
+            const Vector3 camera        = Vector3(random_range(-100.0f, 100.0f), random_range(-100.0f, 100.0f), random_range(-100.0f, 100.0f));
+            const Vector3 direction     = Vector3(random_range(-1.0f, 1.0f), random_range(-1.0f, 1.0f), random_range(-1.0f, 1.0f)).Normalized();
+            const Vector3 up            = Helper::Abs(direction.y) > 0.99f ? Vector3::Forward : Vector3::Up;
+            const Frustum frustum       = Frustum(Matrix::CreateLookAtLH(camera, camera + direction, up), projection);
+
+            // Boxes around the camera, from tiny to large, some of them straddling the near plane
+            for (uint32_t i = 0; i < count_max; i++)
+            {
+                const Vector3 center    = camera + Vector3(random_range(-1.0f, 1.0f), random_range(-1.0f, 1.0f), random_range(-1.0f, 1.0f)) * plane_far;
+                const Vector3 extent    = Vector3(random_range(0.01f, 1.0f), random_range(0.01f, 1.0f), random_range(0.01f, 1.0f)) * random_range(0.1f, 20.0f);
+                boxes[i]                = BoundingBox(center - extent, center + extent);
+
+                // From the box itself, so that both tests see the exact same numbers
+                center_x[i] = boxes[i].GetCenter().x;
+                center_y[i] = boxes[i].GetCenter().y;
+                center_z[i] = boxes[i].GetCenter().z;
+                extent_x[i] = boxes[i].GetExtents().x;
+                extent_y[i] = boxes[i].GetExtents().y;
+                extent_z[i] = boxes[i].GetExtents().z;
+            }
+
+            for (const bool ignore_near_plane : { false, true })
+            {
+                for (const uint32_t count : counts)
+                {
+                    const uint32_t offset = (view_index + count) % 4;
+
+                    fill(visible.begin(), visible.end(), untouched);
+                    fill(visible_scalar.begin(), visible_scalar.end(), untouched);
+                    frustum.CullAabbs(&center_x[offset], &center_y[offset], &center_z[offset], &extent_x[offset], &extent_y[offset], &extent_z[offset], count, visible.data(), ignore_near_plane);
+                    frustum.CullAabbsScalar(&center_x[offset], &center_y[offset], &center_z[offset], &extent_x[offset], &extent_y[offset], &extent_z[offset], count, visible_scalar.data(), ignore_near_plane);
+
+                    for (uint32_t i = 0; i < count; i++)
+                    {
+                        const bool visible_exact = frustum.IsInside(boxes[offset + i], ignore_near_plane) != Outside;
+
+                        mismatch_scalar += visible[i] != visible_scalar[i] ? 1 : 0;
+                        mismatch_exact  += (visible_scalar[i] != 0) != visible_exact ? 1 : 0;
+                        out_of_range    += visible[i] > 1 || visible_scalar[i] > 1 ? 1 : 0;
+                        visible_count   += visible_exact ? 1 : 0;
+                    }
+
+                    for (uint32_t i = count; i < count + 4; i++)
+                    {
+                        out_of_range += visible[i] != untouched || visible_scalar[i] != untouched ? 1 : 0;
+                    }
+
+                    tested += count;
+                }
+            }
+        }
+
+        // Also catches views which see everything or nothing, which would make the comparison meaningless
+        if (mismatch_scalar != 0 || mismatch_exact != 0 || out_of_range != 0 || visible_count == 0 || visible_count == tested)
+        {
+            LOG_ERROR("Of %u boxes (%u visible), %u differ between the SSE and the scalar path, %u between the scalar path and IsInside() and %u results are out of range",
+                tested, visible_count, mismatch_scalar, mismatch_exact, out_of_range);
+            return false;
+        }
+
+        // The paths agreeing doesn't mean that the planes are right, so boxes which are known to be within the cascade of a directional light,
+        // or behind it when the near plane is ignored like lights do, have to be visible to all of them, with and without reverse-z
+        const uint32_t cascade_box_count    = 64;
+        uint32_t cascade_tested             = 0;
+        uint32_t cascade_hidden             = 0;
+        for (uint32_t cascade_index = 0; cascade_index < view_count; cascade_index++)
+        {
+            const bool reverse_z            = (cascade_index & 1) != 0;
+            const bool ignore_near_plane    = (cascade_index & 2) != 0;
+            const float cascade_extent      = random_range(5.0f, 100.0f);
+            const float cascade_depth       = random_range(10.0f, 1000.0f);
+            const Matrix projection         = Matrix::CreateOrthoOffCenterLH(-cascade_extent, cascade_extent, -cascade_extent, cascade_extent, reverse_z ? cascade_depth : 0.0f, reverse_z ? 0.0f : cascade_depth);
+            const Vector3 light             = Vector3(random_range(-100.0f, 100.0f), random_range(-100.0f, 100.0f), random_range(-100.0f, 100.0f));
+            const Vector3 direction         = Vector3(random_range(-1.0f, 1.0f), random_range(-1.0f, 1.0f), random_range(-1.0f, 1.0f)).Normalized();
+            const Vector3 up                = Helper::Abs(direction.y) > 0.99f ? Vector3::Forward : Vector3::Up;
+            const Matrix view               = Matrix::CreateLookAtLH(light, light + direction, up);
+            const Matrix view_inverted      = view.Inverted();
+            const Frustum frustum           = Frustum(view, projection);
+
+            // Placed in the space of the light, where the cascade is a box, with room for the extent of the box whichever way it is rotated
+            for (uint32_t i = 0; i < cascade_box_count; i++)
+            {
+                const Vector3 extent    = Vector3(random_range(0.01f, 1.0f), random_range(0.01f, 1.0f), random_range(0.01f, 1.0f)) * random_range(0.1f, 2.0f);
+                const float radius      = extent.Length();
+                const float x           = random_range(-cascade_extent + radius, cascade_extent - radius);
+                const float y           = random_range(-cascade_extent + radius, cascade_extent - radius);
+                const float z           = random_range(ignore_near_plane ? -cascade_depth : radius, cascade_depth - radius);
+                const Vector3 center    = Vector3(x, y, z) * view_inverted;
+                boxes[i]                = BoundingBox(center - extent, center + extent);
+                center_x[i]             = boxes[i].GetCenter().x;
+                center_y[i]             = boxes[i].GetCenter().y;
+                center_z[i]             = boxes[i].GetCenter().z;
+                extent_x[i]             = boxes[i].GetExtents().x;
+                extent_y[i]             = boxes[i].GetExtents().y;
+                extent_z[i]             = boxes[i].GetExtents().z;
+            }
+
+            frustum.CullAabbs(center_x.data(), center_y.data(), center_z.data(), extent_x.data(), extent_y.data(), extent_z.data(), cascade_box_count, visible.data(), ignore_near_plane);
+            frustum.CullAabbsScalar(center_x.data(), center_y.data(), center_z.data(), extent_x.data(), extent_y.data(), extent_z.data(), cascade_box_count, visible_scalar.data(), ignore_near_plane);
+
+            for (uint32_t i = 0; i < cascade_box_count; i++)
+            {
+                const bool visible_exact = frustum.IsInside(boxes[i], ignore_near_plane) != Outside;
+                cascade_hidden += (visible[i] == 0 || visible_scalar[i] == 0 || !visible_exact) ? 1 : 0;
+            }
+
+            cascade_tested += cascade_box_count;
+        }
+
+        if (cascade_hidden != 0)
+        {
+            LOG_ERROR("Of %u boxes within directional light cascades, %u were culled", cascade_tested, cascade_hidden);
+            return false;
+        }
+
+        LOG_INFO("%u boxes from %u views (%u visible), the SSE path, the scalar path and IsInside() agree on all of them and keep the %u boxes within cascades", tested, view_count, visible_count, cascade_tested);
+
+        return true;
+    }
+
+    bool FrustumCullingBenchmark(Context* context)
+    {
+        const uint32_t box_count  = 100000;
+        const uint32_t iterations = 100;
+
+        mt19937 generator(0);
+        uniform_real_distribution<float> random(0.0f, 1.0f);
+        auto random_range = [&generator, &random](const float from, const float to) { return from + (to - from) * random(generator); };
+
+        // A typical camera, with boxes all around it so that roughly a fifth of them are visible
+        const Frustum frustum = Frustum(Matrix::CreateLookAtLH(Vector3::Zero, Vector3::Forward, Vector3::Up), Matrix::CreatePerspectiveFieldOfViewLH(90.0f * Helper::DEG_TO_RAD, 16.0f / 9.0f, 0.3f, 1000.0f));
+
+        vector<BoundingBox> boxes(box_count);
+        vector<float> center_x(box_count), center_y(box_count), center_z(box_count);
+        vector<float> extent_x(box_count), extent_y(box_count), extent_z(box_count);
+        vector<uint8_t> visible(box_count);
+        for (uint32_t i = 0; i < box_count; i++)
+        {
+            const Vector3 center    = Vector3(random_range(-500.0f, 500.0f), random_range(-500.0f, 500.0f), random_range(-500.0f, 500.0f));
+            const Vector3 extent    = Vector3(random_range(0.5f, 10.0f), random_range(0.5f, 10.0f), random_range(0.5f, 10.0f));
+            boxes[i]                = BoundingBox(center - extent, center + extent);
+            center_x[i]             = center.x;
+            center_y[i]             = center.y;
+            center_z[i]             = center.z;
+            extent_x[i]             = extent.x;
+            extent_y[i]             = extent.y;
+            extent_z[i]             = extent.z;
+        }
+
+        // Returns the time per box in nanoseconds
+        auto measure = [iterations, box_count](const function<void()>& cull)
+        {
+            const Stopwatch timer;
+            for (uint32_t i = 0; i < iterations; i++)
+            {
+                cull();
+            }
+
+            return static_cast<float>(timer.GetElapsedTimeMs() * 1000000.0 / (static_cast<double>(iterations) * box_count));
+        };
+
+        const float time_sse = measure([&]()
+        {
+            frustum.CullAabbs(center_x.data(), center_y.data(), center_z.data(), extent_x.data(), extent_y.data(), extent_z.data(), box_count, visible.data());
+        });
+
+        const float time_scalar = measure([&]()
+        {
+            frustum.CullAabbsScalar(center_x.data(), center_y.data(), center_z.data(), extent_x.data(), extent_y.data(), extent_z.data(), box_count, visible.data());
+        });
+
+        const float time_exact = measure([&]()
+        {
+            for (uint32_t i = 0; i < box_count; i++)
+            {
+                visible[i] = frustum.IsInside(boxes[i]) != Outside ? 1 : 0;
+            }
+        });
+
+        // Every path wrote the same results, count them so that the work can't be skipped
+        uint32_t visible_total = 0;
+        for (const uint8_t is_visible : visible)
+        {
+            visible_total += is_visible;
+        }
+
+        LOG_INFO("Frustum culling of %u boxes (%u visible): %.2f ns per box with CullAabbs(), %.2f ns with its scalar path and %.2f ns with IsInside() (%u iterations)",
+            box_count, visible_total, time_sse, time_scalar, time_exact, iterations);
+
+        return true;
+    }
+
+    bool BvhBenchmark(Context* context)
+    {
+        const uint32_t entity_count_max   = 100000;
+        const uint32_t query_count        = 64;
+
+        mt19937 generator(0);
+        uniform_real_distribution<float> random(0.0f, 1.0f);
+        auto random_range = [&generator, &random](const float from, const float to) { return from + (to - from) * random(generator); };
+
+        // The queries only need something to return, so the entities are not added to the world
+        vector<shared_ptr<Entity>> entities(entity_count_max);
+        for (auto& entity : entities)
+        {
+            entity = make_shared<Entity>(context);
+        }
+
+        // Returns the time in milliseconds
+        auto measure = [](const function<void()>& work)
+        {
+            const Stopwatch timer;
+            work();
+            return static_cast<float>(timer.GetElapsedTimeMs());
+        };
+
+        // Both ways must find the same entities, in whatever order
+        auto same = [](vector<Entity*>& a, vector<Entity*>& b)
+        {
+            sort(a.begin(), a.end());
+            sort(b.begin(), b.end());
+            return a == b;
+        };
+
+        const Matrix projection_camera  = Matrix::CreatePerspectiveFieldOfViewLH(90.0f * Helper::DEG_TO_RAD, 16.0f / 9.0f, 0.3f, 200.0f);
+        const Matrix projection_light   = Matrix::CreatePerspectiveFieldOfViewLH(90.0f * Helper::DEG_TO_RAD, 1.0f, 0.1f, 20.0f);
+        for (uint32_t entity_count = 1000; entity_count <= entity_count_max; entity_count *= 10)
+        {
+            // The scene grows along with the entity count so that the density stays the same, like a bigger level would
+            const float size = 10.0f * pow(static_cast<float>(entity_count), 1.0f / 3.0f);
+            vector<BoundingBox> boxes(entity_count);
+            for (BoundingBox& box : boxes)
+            {
+                const Vector3 center    = Vector3(random_range(-0.5f, 0.5f), random_range(-0.5f, 0.5f), random_range(-0.5f, 0.5f)) * size;
+                const Vector3 extent    = Vector3(random_range(0.25f, 2.0f), random_range(0.25f, 2.0f), random_range(0.25f, 2.0f));
+                box                     = BoundingBox(center - extent, center + extent);
+            }
+
+            BoundingVolumeHierarchy bvh;
+            const float time_build = measure([&]()
+            {
+                for (uint32_t i = 0; i < entity_count; i++)
+                {
+                    bvh.Insert(entities[i].get(), boxes[i]);
+                }
+            });
+
+            // A camera in the middle of the scene and the face of a point light somewhere in it, looking in random directions, and rays from the middle
+            vector<Frustum> frustums_camera(query_count);
+            vector<Frustum> frustums_light(query_count);
+            vector<Ray> rays(query_count);
+            for (uint32_t i = 0; i < query_count; i++)
+            {
+                const Vector3 direction = Vector3(random_range(-1.0f, 1.0f), random_range(-1.0f, 1.0f), random_range(-1.0f, 1.0f)).Normalized();
+                const Vector3 up        = Helper::Abs(direction.y) > 0.99f ? Vector3::Forward : Vector3::Up;
+                const Vector3 light     = Vector3(random_range(-0.5f, 0.5f), random_range(-0.5f, 0.5f), random_range(-0.5f, 0.5f)) * size;
+                frustums_camera[i]      = Frustum(Matrix::CreateLookAtLH(Vector3::Zero, direction, up), projection_camera);
+                frustums_light[i]       = Frustum(Matrix::CreateLookAtLH(light, light + direction, up), projection_light);
+                rays[i]                 = Ray(Vector3::Zero, direction * size);
+            }
+
+            // Cascades of a directional light, built the way the light builds them, with and without reverse-z, from the edge of the scene towards its middle
+            const float cascade_extent  = size * 0.25f;
+            const float cascade_depth   = size * 0.75f;
+            vector<Matrix> cascades_view(query_count);
+            vector<Frustum> frustums_cascade(query_count);
+            for (uint32_t i = 0; i < query_count; i++)
+            {
+                const bool reverse_z    = (i & 1) != 0;
+                const Vector3 direction = Vector3(random_range(-1.0f, 1.0f), random_range(-1.0f, 1.0f), random_range(-1.0f, 1.0f)).Normalized();
+                const Vector3 up        = Helper::Abs(direction.y) > 0.99f ? Vector3::Forward : Vector3::Up;
+                const Vector3 light     = direction * (size * -0.5f);
+                const Matrix projection = Matrix::CreateOrthoOffCenterLH(-cascade_extent, cascade_extent, -cascade_extent, cascade_extent, reverse_z ? cascade_depth : 0.0f, reverse_z ? 0.0f : cascade_depth);
+                cascades_view[i]        = Matrix::CreateLookAtLH(light, light + direction, up);
+                frustums_cascade[i]     = Frustum(cascades_view[i], projection);
+            }
+
+            float time_camera           = 0.0f;
+            float time_camera_linear    = 0.0f;
+            float time_light            = 0.0f;
+            float time_light_linear     = 0.0f;
+            float time_cascade          = 0.0f;
+            float time_cascade_linear   = 0.0f;
+            float time_ray              = 0.0f;
+            float time_ray_linear       = 0.0f;
+            uint64_t visible_camera     = 0;
+            uint64_t visible_light      = 0;
+            uint64_t visible_cascade    = 0;
+            uint64_t hit_count          = 0;
+            vector<Entity*> results;
+            vector<Entity*> results_linear;
+            auto query_frustum = [&](const Frustum& frustum, float& time, float& time_linear, uint64_t& visible, const bool ignore_near_plane)
+            {
+                results.clear();
+                results_linear.clear();
+                time        += measure([&]() { bvh.QueryFrustum(frustum, results, ignore_near_plane); });
+                time_linear += measure([&]()
+                {
+                    for (uint32_t j = 0; j < entity_count; j++)
+                    {
+                        if (frustum.IsInside(boxes[j], ignore_near_plane) != Outside)
+                        {
+                            results_linear.emplace_back(entities[j].get());
+                        }
+                    }
+                });
+
+                visible += results.size();
+                if (!same(results, results_linear))
+                {
+                    LOG_ERROR("%u entities: the BVH found %u entities in a frustum, testing every box found %u", entity_count, static_cast<uint32_t>(results.size()), static_cast<uint32_t>(results_linear.size()));
+                    return false;
+                }
+
+                return true;
+            };
+
+            for (uint32_t i = 0; i < query_count; i++)
+            {
+                if (!query_frustum(frustums_camera[i], time_camera, time_camera_linear, visible_camera, false) || !query_frustum(frustums_light[i], time_light, time_light_linear, visible_light, false))
+                    return false;
+
+                // The cascade keeps what is behind the light, as it still casts shadows, so agreeing with IsInside() is not enough,
+                // every box which is within the sides and the far end of the cascade, from the view of the light, has to be found
+                if (!query_frustum(frustums_cascade[i], time_cascade, time_cascade_linear, visible_cascade, true))
+                    return false;
+
+                uint32_t missed = 0;
+                sort(results.begin(), results.end());
+                for (uint32_t j = 0; j < entity_count; j++)
+                {
+                    const Vector3 center    = boxes[j].GetCenter() * cascades_view[i];
+                    const float radius      = boxes[j].GetExtents().Length();
+                    const bool inside       = Helper::Abs(center.x) + radius < cascade_extent && Helper::Abs(center.y) + radius < cascade_extent && center.z + radius < cascade_depth;
+
+                    if (inside && !binary_search(results.begin(), results.end(), entities[j].get()))
+                    {
+                        missed++;
+                    }
+                }
+
+                if (missed != 0)
+                {
+                    LOG_ERROR("%u entities: a %s cascade missed %u entities which are within it", entity_count, (i & 1) != 0 ? "reverse-z" : "forward-z", missed);
+                    return false;
+                }
+
+                results.clear();
+                results_linear.clear();
+                time_ray        += measure([&]() { bvh.QueryRay(rays[i], results); });
+                time_ray_linear += measure([&]()
+                {
+                    for (uint32_t j = 0; j < entity_count; j++)
+                    {
+                        if (rays[i].HitDistance(boxes[j]) != INFINITY)
+                        {
+                            results_linear.emplace_back(entities[j].get());
+                        }
+                    }
+                });
+
+                hit_count += results.size();
+                if (!same(results, results_linear))
+                {
+                    LOG_ERROR("%u entities: the BVH found %u entities along a ray, testing every box found %u", entity_count, static_cast<uint32_t>(results.size()), static_cast<uint32_t>(results_linear.size()));
+                    return false;
+                }
+            }
+
+            LOG_INFO("%u entities, built in %.2f ms with a height of %u: camera %.3f ms (%.3f ms testing every box, %u visible), point light face %.3f ms (%.3f ms, %u visible), cascade %.3f ms (%.3f ms, %u visible), ray %.3f ms (%.3f ms, %u hit)",
+                entity_count, time_build, bvh.GetHeight(),
+                time_camera / query_count, time_camera_linear / query_count, static_cast<uint32_t>(visible_camera / query_count),
+                time_light / query_count, time_light_linear / query_count, static_cast<uint32_t>(visible_light / query_count),
+                time_cascade / query_count, time_cascade_linear / query_count, static_cast<uint32_t>(visible_cascade / query_count),
+                time_ray / query_count, time_ray_linear / query_count, static_cast<uint32_t>(hit_count / query_count));
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,911 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES =========================
+#include <random>
+#include <algorithm>
+#include <functional>
+#include "Tasks.h"
+#include "Core/Context.h"
+#include "Core/Stopwatch.h"
+#include "Logging/Log.h"
+#include "Profiling/Profiler.h"
+#include "Rendering/Renderer.h"
+#include "Rendering/RenderGraph.h"
+#include "Rendering/Model.h"
+#include "Rendering/Mesh.h"
+#include "Rendering/LightClusters.h"
+#include "Rendering/OcclusionBuffer.h"
+#include "Utilities/Geometry.h"
+#include "RHI/RHI_Device.h"
+#include "RHI/RHI_Shader.h"
+#include "RHI/RHI_Texture.h"
+#include "RHI/RHI_CommandList.h"
+#include "RHI/RHI_PipelineState.h"
+#include "RHI/RHI_PipelineCache.h"
+#include "RHI/RHI_BlendState.h"
+#include "RHI/RHI_RasterizerState.h"
+#include "RHI/RHI_DepthStencilState.h"
+#include "RHI/RHI_VertexBuffer.h"
+#if defined(API_GRAPHICS_NULL)
+#include "RHI/RHI_Implementation.h"
+#endif
+//====================================
+
+//= NAMESPACES ================
+using namespace std;
+using namespace Spartan;
+using namespace Spartan::Math;
+//=============================
+
+namespace _Tasks_Rendering
+{
+    // A typical full screen pass, it owns its states so that it doesn't depend on how the renderer sets up its own
+    struct FullScreenPass
+    {
+        bool Create(Renderer* renderer)
+        {
+            const shared_ptr<RHI_Device>& rhi_device = renderer->GetRhiDevice();
+            const auto& shaders = renderer->GetShaders();
+
+            shader_v            = shaders.at(Shader_Quad_V);
+            shader_p            = shaders.at(Shader_Texture_P);
+            rasterizer_state    = make_shared<RHI_RasterizerState>(rhi_device, RHI_Cull_Back, RHI_Fill_Solid, true, false, false, false);
+            blend_disabled      = make_shared<RHI_BlendState>(rhi_device, false);
+            blend_alpha         = make_shared<RHI_BlendState>(rhi_device, true);
+            depth_stencil_state = make_shared<RHI_DepthStencilState>(rhi_device, false, false, renderer->GetComparisonFunction(), false, false);
+
+            RHI_Texture* tex_out = renderer->GetFrameTexture();
+            quad = Math::Rectangle(0, 0, static_cast<float>(tex_out->GetWidth()), static_cast<float>(tex_out->GetHeight()));
+            if (!quad.CreateBuffers(renderer))
+            {
+                LOG_ERROR("Failed to create the quad");
+                return false;
+            }
+
+            shader_v->WaitForCompilation();
+            shader_p->WaitForCompilation();
+
+            pipeline_state.shader_vertex                    = shader_v.get();
+            pipeline_state.shader_pixel                     = shader_p.get();
+            pipeline_state.rasterizer_state                 = rasterizer_state.get();
+            pipeline_state.blend_state                      = blend_disabled.get();
+            pipeline_state.depth_stencil_state              = depth_stencil_state.get();
+            pipeline_state.vertex_buffer_stride             = quad.GetVertexBuffer()->GetStride();
+            pipeline_state.render_target_color_textures[0]  = tex_out;
+            pipeline_state.clear_color[0]                   = state_color_dont_care;
+            pipeline_state.viewport                         = tex_out->GetViewport();
+            pipeline_state.primitive_topology               = RHI_PrimitiveTopology_TriangleList;
+
+            return true;
+        }
+
+        shared_ptr<RHI_Shader> shader_v;
+        shared_ptr<RHI_Shader> shader_p;
+        shared_ptr<RHI_RasterizerState> rasterizer_state;
+        shared_ptr<RHI_BlendState> blend_disabled;
+        shared_ptr<RHI_BlendState> blend_alpha;
+        shared_ptr<RHI_DepthStencilState> depth_stencil_state;
+        Math::Rectangle quad;
+        RHI_PipelineState pipeline_state;
+    };
+
+    // Distance of a point to the closest point of a triangle, found by the region of the triangle the point projects to
+    float distance_point_triangle(const Vector3& p, const Vector3& a, const Vector3& b, const Vector3& c)
+    {
+        const Vector3 ab = b - a;
+        const Vector3 ac = c - a;
+
+        const Vector3 ap = p - a;
+        const float d1   = Vector3::Dot(ab, ap);
+        const float d2   = Vector3::Dot(ac, ap);
+        if (d1 <= 0.0f && d2 <= 0.0f)
+            return Vector3::Distance(p, a);
+
+        const Vector3 bp = p - b;
+        const float d3   = Vector3::Dot(ab, bp);
+        const float d4   = Vector3::Dot(ac, bp);
+        if (d3 >= 0.0f && d4 <= d3)
+            return Vector3::Distance(p, b);
+
+        const float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+            return Vector3::Distance(p, a + ab * (d1 / (d1 - d3)));
+
+        const Vector3 cp = p - c;
+        const float d5   = Vector3::Dot(ab, cp);
+        const float d6   = Vector3::Dot(ac, cp);
+        if (d6 >= 0.0f && d5 <= d6)
+            return Vector3::Distance(p, c);
+
+        const float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+            return Vector3::Distance(p, a + ac * (d2 / (d2 - d6)));
+
+        const float va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && d4 >= d3 && d5 >= d6)
+            return Vector3::Distance(p, b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))));
+
+        const float denominator = 1.0f / (va + vb + vc);
+        return Vector3::Distance(p, a + ab * (vb * denominator) + ac * (vc * denominator));
+    }
+
+    // Largest distance from any of the points to the surface of the triangles
+    float distance_points_surface(const vector<Vector3>& points, const vector<Vector3>& positions, const vector<uint32_t>& indices)
+    {
+        float distance_max = 0.0f;
+        for (const Vector3& point : points)
+        {
+            float distance = numeric_limits<float>::max();
+            for (uint32_t i = 0; i < static_cast<uint32_t>(indices.size()) && distance > distance_max; i += 3)
+            {
+                distance = Helper::Min(distance, distance_point_triangle(point, positions[indices[i]], positions[indices[i + 1]], positions[indices[i + 2]]));
+            }
+
+            distance_max = Helper::Max(distance_max, distance);
+        }
+
+        return distance_max;
+    }
+}
+
+namespace Tasks
+{
+    bool NullDeviceVerify(Context* context)
+    {
+    #if defined(API_GRAPHICS_NULL)
+        const uint32_t pass_count = 4;
+        const uint32_t draw_count = 8;
+
+        Renderer* renderer  = context->GetSubsystem<Renderer>();
+        Profiler* profiler  = context->GetSubsystem<Profiler>();
+
+        _Tasks_Rendering::FullScreenPass pass;
+        if (!pass.Create(renderer))
+            return false;
+
+        RHI_Null_CommandStream& command_stream = renderer->GetRhiDevice()->GetContextRhi()->command_stream;
+
+        // Anything submitted so far belongs to another frame
+        command_stream.Present();
+
+        const uint32_t draw_calls_start         = profiler->m_rhi_draw_calls;
+        const uint32_t instances_start          = profiler->m_rhi_instances;
+        const uint32_t pipelines_start          = profiler->m_rhi_bindings_pipeline;
+        const uint32_t vertex_buffers_start     = profiler->m_rhi_bindings_buffer_vertex;
+        const uint32_t index_buffers_start      = profiler->m_rhi_bindings_buffer_index;
+        const uint32_t descriptor_sets_start    = profiler->m_rhi_bindings_descriptor_set;
+
+        RHI_CommandList cmd_list(0, nullptr, context);
+        if (!cmd_list.Begin())
+        {
+            LOG_ERROR("Failed to begin command list");
+            return false;
+        }
+
+        for (uint32_t pass_index = 0; pass_index < pass_count; pass_index++)
+        {
+            if (!cmd_list.BeginRenderPass(pass.pipeline_state))
+            {
+                LOG_ERROR("Failed to begin render pass");
+                return false;
+            }
+
+            // The buffers are set before every draw, like the passes do, only the first ones of a pass should be bound
+            for (uint32_t draw_index = 0; draw_index < draw_count; draw_index++)
+            {
+                cmd_list.SetBufferVertex(pass.quad.GetVertexBuffer());
+                cmd_list.SetBufferIndex(pass.quad.GetIndexBuffer());
+                cmd_list.DrawIndexed(Math::Rectangle::GetIndexCount());
+            }
+
+            cmd_list.EndRenderPass();
+        }
+
+        if (!cmd_list.Submit() || !cmd_list.Wait())
+        {
+            LOG_ERROR("Failed to submit command list");
+            return false;
+        }
+
+        command_stream.Present();
+
+        uint32_t instances = 0;
+        for (const RHI_Null_Command& command : command_stream.GetCommands())
+        {
+            instances += command.type == RHI_Null_Command_DrawIndexed ? command.args[3] : 0;
+        }
+
+        struct Count
+        {
+            const char* name;
+            uint32_t recorded;
+            uint32_t expected;
+        };
+
+        const Count counts[] =
+        {
+            // What was recorded against what was asked for
+            { "Render passes begun",              command_stream.GetCommandCount(RHI_Null_Command_BeginRenderPass),                 pass_count },
+            { "Render passes ended",              command_stream.GetCommandCount(RHI_Null_Command_EndRenderPass),                   pass_count },
+            { "Draw calls",                       command_stream.GetCommandCount(RHI_Null_Command_DrawIndexed),                     pass_count * draw_count },
+            { "Instances",                        instances,                                                                        pass_count * draw_count },
+            { "Pipeline bindings",                command_stream.GetCommandCount(RHI_Null_Command_BindPipeline),                    pass_count },
+            { "Vertex buffer bindings",           command_stream.GetCommandCount(RHI_Null_Command_BindVertexBuffer),                pass_count },
+            { "Index buffer bindings",            command_stream.GetCommandCount(RHI_Null_Command_BindIndexBuffer),                 pass_count },
+
+            // What the profiler counted against what was recorded
+            { "Profiler draw calls",              profiler->m_rhi_draw_calls - draw_calls_start,                                    pass_count * draw_count },
+            { "Profiler instances",               profiler->m_rhi_instances - instances_start,                                      pass_count * draw_count },
+            { "Profiler pipeline bindings",       profiler->m_rhi_bindings_pipeline - pipelines_start,                              pass_count },
+            { "Profiler vertex buffer bindings",  profiler->m_rhi_bindings_buffer_vertex - vertex_buffers_start,                    pass_count },
+            { "Profiler index buffer bindings",   profiler->m_rhi_bindings_buffer_index - index_buffers_start,                      pass_count },
+            { "Profiler descriptor set bindings", profiler->m_rhi_bindings_descriptor_set - descriptor_sets_start,                  command_stream.GetCommandCount(RHI_Null_Command_BindDescriptorSet) }
+        };
+
+        bool verified = true;
+        for (const Count& count : counts)
+        {
+            if (count.recorded != count.expected)
+            {
+                LOG_ERROR("%s: %u instead of %u", count.name, count.recorded, count.expected);
+                verified = false;
+            }
+        }
+
+        LOG_INFO("%u render passes with %u draws each recorded %u commands", pass_count, draw_count, static_cast<uint32_t>(command_stream.GetCommands().size()));
+
+        return verified;
+    #else
+        LOG_ERROR("Only the null device records what is submitted to it");
+        return false;
+    #endif
+    }
+
+    bool LightClustersVerify(Context* context)
+    {
+        const uint32_t view_count   = 256;
+        const uint32_t point_count  = 4096;
+
+        // The same views and lights every run, so that a failure can be reproduced
+        mt19937 generator(0);
+        uniform_real_distribution<float> random(0.0f, 1.0f);
+        auto random_range = [&generator, &random](const float from, const float to) { return from + (to - from) * random(generator); };
+
+        LightClusters clusters;
+        vector<LightClusters::Light> lights;
+        uint32_t tested             = 0; // (point, light) pairs where the light reaches the point
+        uint32_t missed             = 0; // of those, the ones where the light is not in the list of the point's cluster
+        uint32_t malformed          = 0; // clusters whose list is out of bounds, unsorted or references a light which doesn't exist
+        uint32_t overflowing        = 0;
+        uint64_t references         = 0;
+        for (uint32_t view_index = 0; view_index < view_count; view_index++)
+        {
+            // A perspective or orthographic camera somewhere, looking somewhere
+            LightClusters::View view;
+            const Vector3 camera    = Vector3(random_range(-100.0f, 100.0f), random_range(-10.0f, 10.0f), random_range(-100.0f, 100.0f));
+            const Vector3 direction = Vector3(random_range(-1.0f, 1.0f), random_range(-0.5f, 0.5f), random_range(-1.0f, 1.0f)).Normalized();
+            const float aspect      = random_range(1.0f, 2.5f);
+            view.near_plane         = random_range(0.05f, 1.0f);
+            view.far_plane          = random_range(100.0f, 1000.0f);
+            view.orthographic       = (view_index % 4) == 3;
+            view.view               = Matrix::CreateLookAtLH(camera, camera + direction, Vector3::Up);
+            const Matrix projection = view.orthographic ?
+                Matrix::CreateOrthographicLH(random_range(20.0f, 100.0f) * aspect, random_range(20.0f, 100.0f), view.near_plane, view.far_plane) :
+                Matrix::CreatePerspectiveFieldOfViewLH(random_range(40.0f, 100.0f) * Helper::DEG_TO_RAD, aspect, view.near_plane, view.far_plane);
+            view.projection_x       = projection.m00;
+            view.projection_y       = projection.m11;
+
+            // Returns a view space point at the given depth, somewhere on the screen
+            auto random_point = [&](const float depth)
+            {
+                const float scale = view.orthographic ? 1.0f : depth;
+                return Vector3(random_range(-1.0f, 1.0f) * scale / view.projection_x, random_range(-1.0f, 1.0f) * scale / view.projection_y, depth);
+            };
+
+            // Point and spot lights in front of the camera, mostly close to it, some of them partly behind it or beyond the far plane
+            const Matrix view_inverse = view.view.Inverted();
+            lights.resize(static_cast<uint32_t>(random_range(1.0f, 48.0f)));
+            for (LightClusters::Light& light : lights)
+            {
+                const float depth   = view.near_plane + (view.far_plane - view.near_plane) * random_range(-0.01f, 1.01f) * random_range(0.0f, 0.2f);
+                light.position      = view_inverse * random_point(depth);
+                light.direction     = Vector3(random_range(-1.0f, 1.0f), random_range(-1.0f, 1.0f), random_range(-1.0f, 1.0f)).Normalized();
+                light.range         = random_range(0.5f, 30.0f);
+                light.cos_angle     = random(generator) < 0.5f ? -1.0f : cos(random_range(5.0f, 80.0f) * Helper::DEG_TO_RAD);
+            }
+
+            clusters.Build(view, lights);
+            if (clusters.IsOverflowing())
+            {
+                overflowing++;
+                continue;
+            }
+
+            // The lists, within the index list, sorted and referencing lights which exist
+            const auto& cluster_data    = clusters.GetClusters();
+            const auto& indices         = clusters.GetIndices();
+            for (uint32_t cluster_index = 0; cluster_index < LightClusters::cluster_count; cluster_index++)
+            {
+                const uint32_t offset   = cluster_data[cluster_index] & 0xFFFF;
+                const uint32_t count    = cluster_data[cluster_index] >> 16;
+                bool valid              = offset + count <= clusters.GetIndexCount();
+                for (uint32_t i = 0; valid && i < count; i++)
+                {
+                    valid = indices[offset + i] < lights.size() && (i == 0 || indices[offset + i - 1] < indices[offset + i]);
+                }
+
+                malformed   += valid ? 0 : 1;
+                references  += count;
+            }
+
+            // Random points, located the way the shader locates a pixel's cluster, each light that reaches one of them must be in its cluster's list
+            for (uint32_t point_index = 0; point_index < point_count; point_index++)
+            {
+                const float depth   = view.near_plane * pow(view.far_plane / view.near_plane, random(generator));
+                const Vector3 point = random_point(depth);
+                const float uv_x    = (view.orthographic ? point.x : point.x / depth) * view.projection_x * 0.5f + 0.5f;
+                const float uv_y    = 0.5f - (view.orthographic ? point.y : point.y / depth) * view.projection_y * 0.5f;
+                const uint32_t x    = Helper::Min(static_cast<uint32_t>(uv_x * LightClusters::tile_count_x), LightClusters::tile_count_x - 1);
+                const uint32_t y    = Helper::Min(static_cast<uint32_t>(uv_y * LightClusters::tile_count_y), LightClusters::tile_count_y - 1);
+                const uint32_t cluster_index = LightClusters::ComputeClusterIndex(x, y, clusters.ComputeSlice(depth));
+                const uint32_t offset   = cluster_data[cluster_index] & 0xFFFF;
+                const uint32_t count    = cluster_data[cluster_index] >> 16;
+
+                for (uint32_t light_index = 0; light_index < static_cast<uint32_t>(lights.size()); light_index++)
+                {
+                    const LightClusters::Light& light   = lights[light_index];
+                    const Vector3 light_position        = view.view * light.position;
+                    const Vector4 light_direction       = view.view * Vector4(light.direction.x, light.direction.y, light.direction.z, 0.0f);
+                    const Vector3 to_point              = point - light_position;
+                    const float distance                = to_point.Length();
+
+                    // Lights which only just reach a point are left out, the point could be on the edge of a cluster
+                    const bool in_range = distance < light.range * 0.999f;
+                    const bool in_cone  = light.cos_angle <= -1.0f || Vector3::Dot(to_point / distance, Vector3(light_direction.x, light_direction.y, light_direction.z)) > light.cos_angle + 0.001f;
+                    if (!in_range || !in_cone)
+                        continue;
+
+                    tested++;
+                    missed += binary_search(indices.begin() + offset, indices.begin() + offset + count, static_cast<uint8_t>(light_index)) ? 0 : 1;
+                }
+            }
+        }
+
+        // Also catches scenes where no light ever reaches a point, which would make the check meaningless
+        if (missed != 0 || malformed != 0 || overflowing == view_count || tested == 0)
+        {
+            LOG_ERROR("Of %u points reached by a light, %u were not in the light's cluster, %u clusters had a malformed list and %u of %u views overflowed",
+                tested, missed, malformed, overflowing, view_count);
+            return false;
+        }
+
+        LOG_INFO("%u views (%u overflowed), every one of the %u points reached by a light was in that light's cluster, %.1f lights per cluster on average",
+            view_count, overflowing, tested, static_cast<float>(references) / ((view_count - overflowing) * LightClusters::cluster_count));
+
+        return true;
+    }
+
+    bool LightClustersBenchmark(Context* context)
+    {
+        const uint32_t iterations = 100;
+
+        mt19937 generator(0);
+        uniform_real_distribution<float> random(0.0f, 1.0f);
+        auto random_range = [&generator, &random](const float from, const float to) { return from + (to - from) * random(generator); };
+
+        // A typical camera, the lights are spread in front of it
+        LightClusters::View view;
+        const Matrix projection = Matrix::CreatePerspectiveFieldOfViewLH(90.0f * Helper::DEG_TO_RAD, 16.0f / 9.0f, view.near_plane, view.far_plane);
+        view.projection_x       = projection.m00;
+        view.projection_y       = projection.m11;
+
+        LightClusters clusters;
+        vector<LightClusters::Light> lights;
+        for (const uint32_t light_count : { 16u, 64u, 256u })
+        {
+            lights.resize(light_count);
+            for (LightClusters::Light& light : lights)
+            {
+                light.position  = Vector3(random_range(-100.0f, 100.0f), random_range(-10.0f, 10.0f), random_range(0.0f, 200.0f));
+                light.direction = Vector3(random_range(-1.0f, 1.0f), random_range(-1.0f, 1.0f), random_range(-1.0f, 1.0f)).Normalized();
+                light.range     = random_range(2.0f, 20.0f);
+                light.cos_angle = random(generator) < 0.5f ? -1.0f : cos(random_range(10.0f, 60.0f) * Helper::DEG_TO_RAD);
+            }
+
+            const Stopwatch timer;
+            for (uint32_t i = 0; i < iterations; i++)
+            {
+                clusters.Build(view, lights);
+            }
+
+            LOG_INFO("Binning %u lights: %.3f ms, %u light references%s (%u iterations)",
+                light_count, timer.GetElapsedTimeMs() / iterations, clusters.GetIndexCount(), clusters.IsOverflowing() ? ", some were dropped" : "", iterations);
+        }
+
+        return true;
+    }
+
+    bool OcclusionVerify(Context* context)
+    {
+        const uint32_t view_count = 2048;
+
+        vector<RHI_Vertex_PosTexNorTan> vertices;
+        vector<uint32_t> indices;
+        Utility::Geometry::CreateCube(&vertices, &indices);
+        const uint32_t index_count  = static_cast<uint32_t>(indices.size());
+        const BoundingBox cube      = BoundingBox(vertices.data(), static_cast<uint32_t>(vertices.size()));
+
+        const float fov         = 90.0f * Helper::DEG_TO_RAD;
+        const float aspect      = static_cast<float>(OcclusionBuffer::width) / static_cast<float>(OcclusionBuffer::height);
+        const float plane_near  = 0.3f;
+        const float plane_far   = 1000.0f;
+
+        // The same views every run, so that a failure can be reproduced
+        mt19937 generator(0);
+        uniform_real_distribution<float> random(0.0f, 1.0f);
+        auto random_range = [&generator, &random](const float from, const float to) { return from + (to - from) * random(generator); };
+
+        OcclusionBuffer buffer;
+        bool verified = true;
+        for (const bool reverse_z : { false, true })
+        {
+            const Matrix projection = Matrix::CreatePerspectiveFieldOfViewLH(fov, aspect, reverse_z ? plane_far : plane_near, reverse_z ? plane_near : plane_far);
+
+            uint32_t self_occluded      = 0; // an occluder hid its own bounding box
+            uint32_t behind_visible     = 0; // a box behind a wall which covers the screen was not hidden
+            uint32_t in_front_hidden    = 0; // a box in front of that wall was hidden
+            for (uint32_t view_index = 0; view_index < view_count; view_index++)
+            {
+                // An occluder of random size and position, half of them axis aligned so that the closest corner of the box is on the mesh
+                const Vector3 scale         = Vector3(random_range(0.5f, 20.0f), random_range(0.5f, 20.0f), random_range(0.5f, 20.0f));
+                const Quaternion rotation   = (view_index & 1) ? Quaternion::FromEulerAngles(random_range(0.0f, 360.0f), random_range(0.0f, 360.0f), random_range(0.0f, 360.0f)) : Quaternion::Identity;
+                const Vector3 position      = Vector3(random_range(-50.0f, 50.0f), random_range(-50.0f, 50.0f), random_range(-50.0f, 50.0f));
+                const Matrix transform      = Matrix(position, rotation, scale);
+                const BoundingBox box       = cube.Transform(transform);
+
+                // Seen from a random direction and distance, aiming somewhere inside of it
+                const Vector3 direction = Vector3(random_range(-1.0f, 1.0f), random_range(-1.0f, 1.0f), random_range(-1.0f, 1.0f)).Normalized();
+                const Vector3 camera    = box.GetCenter() + direction * box.GetExtents().Length() * random_range(1.5f, 20.0f);
+                const Vector3 target    = box.GetCenter() + box.GetExtents() * Vector3(random_range(-0.5f, 0.5f), random_range(-0.5f, 0.5f), random_range(-0.5f, 0.5f));
+                const Vector3 up        = Helper::Abs(direction.y) > 0.99f ? Vector3::Forward : Vector3::Up;
+
+                buffer.Begin(Matrix::CreateLookAtLH(camera, target, up) * projection, reverse_z, 1);
+                buffer.SetOccluder(0, transform, vertices.data(), indices.data(), index_count);
+                for (uint32_t band_index = 0; band_index < OcclusionBuffer::band_count; band_index++)
+                {
+                    buffer.RasterizeBand(band_index);
+                }
+
+                self_occluded += buffer.IsVisible(box) ? 0 : 1;
+
+                // A wall which covers the screen, looking straight at it, with one box behind it and one in front of it
+                const float distance        = random_range(5.0f, 100.0f);
+                const Matrix wall           = Matrix(camera + Vector3(0.0f, 0.0f, distance), Quaternion::Identity, Vector3(4.0f * distance * aspect, 4.0f * distance, 0.01f * distance));
+                const Vector3 offset        = Vector3(random_range(-0.4f, 0.4f), random_range(-0.4f, 0.4f), 0.0f) * distance;
+                const Vector3 extents       = Vector3::One * random_range(0.001f, 0.05f) * distance;
+                const Vector3 behind        = camera + offset + Vector3(0.0f, 0.0f, distance * random_range(1.1f, 4.0f));
+                const Vector3 in_front      = camera + offset * 0.5f + Vector3(0.0f, 0.0f, distance * 0.5f);
+
+                buffer.Begin(Matrix::CreateLookAtLH(camera, camera + Vector3::Forward, Vector3::Up) * projection, reverse_z, 1);
+                buffer.SetOccluder(0, wall, vertices.data(), indices.data(), index_count);
+                for (uint32_t band_index = 0; band_index < OcclusionBuffer::band_count; band_index++)
+                {
+                    buffer.RasterizeBand(band_index);
+                }
+
+                // Every pixel of the wall is as close as the closest corner of its box, which is where the lack of a bias used to show
+                self_occluded   += buffer.IsVisible(cube.Transform(wall))                                   ? 0 : 1;
+                behind_visible  += buffer.IsVisible(BoundingBox(behind - extents, behind + extents))        ? 1 : 0;
+                in_front_hidden += buffer.IsVisible(BoundingBox(in_front - extents, in_front + extents))    ? 0 : 1;
+            }
+
+            if (self_occluded != 0 || behind_visible != 0 || in_front_hidden != 0)
+            {
+                LOG_ERROR("%s: Of %u views, %u occluders hid themselves, %u boxes behind a wall were visible and %u in front of it were hidden",
+                    reverse_z ? "Reverse-z" : "Forward-z", view_count, self_occluded, behind_visible, in_front_hidden);
+                verified = false;
+            }
+            else
+            {
+                LOG_INFO("%s: %u views, no occluder hid itself and every box behind a wall was hidden", reverse_z ? "Reverse-z" : "Forward-z", view_count);
+            }
+        }
+
+        return verified;
+    }
+
+    bool LodsVerify(Context* context)
+    {
+        // A smooth closed mesh with a uv seam, a tube with hard edged caps, and an open bumpy patch whose border has to stay where it is
+        struct TestMesh
+        {
+            const char* name;
+            vector<RHI_Vertex_PosTexNorTan> vertices;
+            vector<uint32_t> indices;
+        };
+        TestMesh meshes[3] = { { "Sphere" }, { "Cylinder" }, { "Patch" } };
+        Utility::Geometry::CreateSphere(&meshes[0].vertices, &meshes[0].indices, 1.0f, 48, 48);
+        Utility::Geometry::CreateCylinder(&meshes[1].vertices, &meshes[1].indices, 1.0f, 1.0f, 2.0f, 48, 48);
+        {
+            const uint32_t resolution   = 48;
+            const float amplitude       = 0.05f;
+            for (uint32_t z = 0; z <= resolution; z++)
+            {
+                for (uint32_t x = 0; x <= resolution; x++)
+                {
+                    const float u       = static_cast<float>(x) / resolution;
+                    const float v       = static_cast<float>(z) / resolution;
+                    const float height  = amplitude * sin(u * 9.0f) * cos(v * 7.0f);
+                    const Vector3 normal = Vector3(-amplitude * 9.0f * cos(u * 9.0f) * cos(v * 7.0f), 1.0f, amplitude * 7.0f * sin(u * 9.0f) * sin(v * 7.0f)).Normalized();
+                    meshes[2].vertices.emplace_back(Vector3(u, height, v), Vector2(u, v), normal, Vector3::Right);
+                }
+            }
+
+            for (uint32_t z = 0; z < resolution; z++)
+            {
+                for (uint32_t x = 0; x < resolution; x++)
+                {
+                    const uint32_t i = z * (resolution + 1) + x;
+                    meshes[2].indices.insert(meshes[2].indices.end(), { i, i + resolution + 1, i + 1, i + 1, i + resolution + 1, i + resolution + 2 });
+                }
+            }
+        }
+
+        // Simplification only ever measures how far vertices move from the planes around them, on average, so the surfaces themselves
+        // are allowed to drift apart a bit further than the error a level is given.
+        const float distance_tolerance = 1.5f;
+
+        uint32_t level_count    = 0;
+        uint32_t failures       = 0;
+        vector<uint32_t> indices;
+        vector<Vector3> centroids;
+        for (const TestMesh& mesh : meshes)
+        {
+            const uint32_t vertex_count = static_cast<uint32_t>(mesh.vertices.size());
+
+            // Generate the levels the way imported models get them
+            const shared_ptr<Model> model = make_shared<Model>(context);
+            uint32_t index_offset = 0;
+            model->AppendGeometry(mesh.indices, mesh.vertices, &index_offset);
+            model->GeometryGenerateLods(mesh.indices, mesh.vertices, index_offset);
+
+            const vector<ModelLod>* lods = model->GetLods(index_offset);
+            if (!lods)
+            {
+                LOG_ERROR("%s: no levels of detail were generated out of %u triangles", mesh.name, static_cast<uint32_t>(mesh.indices.size() / 3));
+                failures++;
+                continue;
+            }
+
+            // Errors are relative to the largest dimension of the mesh
+            vector<Vector3> positions(vertex_count);
+            {
+                const BoundingBox aabb(mesh.vertices.data(), vertex_count);
+                const Vector3 size      = aabb.GetSize();
+                const float scale_inv   = 1.0f / Helper::Max(size.x, Helper::Max(size.y, size.z));
+                for (uint32_t i = 0; i < vertex_count; i++)
+                {
+                    positions[i] = (Vector3(mesh.vertices[i].pos[0], mesh.vertices[i].pos[1], mesh.vertices[i].pos[2]) - aabb.GetMin()) * scale_inv;
+                }
+            }
+
+            // Cosine of the angle between a triangle and the normals of its vertices, over the full detail geometry it gives the winding order
+            auto facing = [&mesh, &positions](const uint32_t* triangle)
+            {
+                Vector3 vertex_normal = Vector3::Zero;
+                for (uint32_t corner = 0; corner < 3; corner++)
+                {
+                    vertex_normal += Vector3(mesh.vertices[triangle[corner]].nor[0], mesh.vertices[triangle[corner]].nor[1], mesh.vertices[triangle[corner]].nor[2]);
+                }
+
+                return Vector3::Dot(Vector3::Cross(positions[triangle[1]] - positions[triangle[0]], positions[triangle[2]] - positions[triangle[0]]).Normalized(), vertex_normal.Normalized());
+            };
+            float winding = 0.0f;
+            for (uint32_t i = 0; i < static_cast<uint32_t>(mesh.indices.size()); i += 3)
+            {
+                winding += facing(&mesh.indices[i]);
+            }
+            winding = winding < 0.0f ? -1.0f : 1.0f;
+
+            // Slivers along seams can stand sideways, only the triangles which clearly face away have flipped
+            const vector<uint32_t>& mesh_indices = model->GetMesh()->Indices_Get();
+            for (uint32_t lod_index = 1; lod_index < static_cast<uint32_t>(lods->size()); lod_index++)
+            {
+                const ModelLod& lod             = (*lods)[lod_index];
+                const ModelLod& lod_previous    = (*lods)[lod_index - 1];
+                const float error_allowed       = model->GetLodErrorAllowed(lod_index);
+                indices.assign(mesh_indices.begin() + lod.index_offset, mesh_indices.begin() + lod.index_offset + lod.index_count);
+                level_count++;
+
+                // Every level has to be well formed (no triangles which are out of range, degenerate or flipped), within its error and worth switching to
+                uint32_t triangles_invalid = lod.index_count % 3;
+                for (uint32_t i = 0; i + 2 < lod.index_count; i += 3)
+                {
+                    if (indices[i] >= vertex_count || indices[i + 1] >= vertex_count || indices[i + 2] >= vertex_count)
+                    {
+                        triangles_invalid++;
+                        continue;
+                    }
+
+                    const Vector3& p0 = positions[indices[i]];
+                    const Vector3& p1 = positions[indices[i + 1]];
+                    const Vector3& p2 = positions[indices[i + 2]];
+                    triangles_invalid += p0 == p1 || p1 == p2 || p2 == p0 || facing(&indices[i]) * winding < -0.01f;
+                }
+
+                if (triangles_invalid != 0 || lod.error > error_allowed || lod.index_count > lod_previous.index_count * 4 / 5)
+                {
+                    LOG_ERROR("%s, level %u: %u triangles (%u before), %u of them invalid, error %.4f (%.4f allowed)",
+                        mesh.name, lod_index, lod.index_count / 3, lod_previous.index_count / 3, triangles_invalid, lod.error, error_allowed);
+                    failures++;
+                    continue;
+                }
+
+                // Measure how far apart the two surfaces actually are, both ways, since a level can both cut into and bulge out of the original
+                centroids.clear();
+                for (uint32_t i = 0; i < lod.index_count; i += 3)
+                {
+                    centroids.emplace_back((positions[indices[i]] + positions[indices[i + 1]] + positions[indices[i + 2]]) / 3.0f);
+                }
+                const float distance = Helper::Max(_Tasks_Rendering::distance_points_surface(positions, positions, indices), _Tasks_Rendering::distance_points_surface(centroids, positions, mesh.indices));
+
+                LOG_INFO("%s, level %u: %u triangles, %.1f%% of the full detail, error %.4f (%.4f allowed), surfaces at most %.4f apart",
+                    mesh.name, lod_index, lod.index_count / 3, 100.0f * lod.index_count / mesh.indices.size(), lod.error, error_allowed, distance);
+
+                if (distance > error_allowed * distance_tolerance)
+                {
+                    LOG_ERROR("%s, level %u: the surface moved by %.4f, more than %.4f", mesh.name, lod_index, distance, error_allowed * distance_tolerance);
+                    failures++;
+                }
+            }
+        }
+
+        if (failures != 0)
+        {
+            LOG_ERROR("%u out of %u levels of detail failed", failures, level_count);
+            return false;
+        }
+
+        LOG_INFO("%u levels of detail, out of %u meshes, are within their error", level_count, static_cast<uint32_t>(size(meshes)));
+        return true;
+    }
+
+    bool PipelinesBenchmark(Context* context)
+    {
+        const uint32_t iterations = 1000000;
+
+        Renderer* renderer                  = context->GetSubsystem<Renderer>();
+        RHI_PipelineCache* pipeline_cache   = renderer->GetPipelineCache();
+
+        // A typical full screen pass
+        _Tasks_Rendering::FullScreenPass pass;
+        if (!pass.Create(renderer))
+            return false;
+
+        RHI_PipelineState& pipeline_state = pass.pipeline_state;
+
+        // Create both pipelines which the benchmark alternates between
+        for (RHI_BlendState* blend_state : { pass.blend_disabled.get(), pass.blend_alpha.get() })
+        {
+            pipeline_state.blend_state = blend_state;
+            if (!pipeline_cache->WarmUp(pipeline_state))
+            {
+                LOG_ERROR("Failed to create the pipelines to benchmark");
+                return false;
+            }
+        }
+
+        auto measure = [&pass, &pipeline_state, pipeline_cache, iterations](const bool change_state)
+        {
+            const Stopwatch timer;
+            for (uint32_t i = 0; i < iterations; i++)
+            {
+                // Changing the state is what every bind used to cost, a hash and a locked lookup
+                if (change_state)
+                {
+                    pipeline_state.blend_state = (i & 1) ? pass.blend_alpha.get() : pass.blend_disabled.get();
+                }
+
+                pipeline_cache->GetPipeline(pipeline_state, nullptr);
+            }
+
+            return static_cast<float>(timer.GetElapsedTimeMs() * 1000000.0 / iterations);
+        };
+
+        const float time_changed    = measure(true);
+        const float time_unchanged  = measure(false);
+
+        LOG_INFO("Pipeline binding: %.1f ns when the state changes, %.1f ns when it doesn't (%u iterations)", time_changed, time_unchanged, iterations);
+
+        return true;
+    }
+
+    bool RenderGraphVerify(Context* context)
+    {
+        Renderer* renderer          = context->GetSubsystem<Renderer>();
+        Profiler* profiler          = context->GetSubsystem<Profiler>();
+        RenderGraph* render_graph   = renderer->GetRenderGraph();
+
+        const uint32_t width_previous       = static_cast<uint32_t>(renderer->GetResolution().x);
+        const uint32_t height_previous      = static_cast<uint32_t>(renderer->GetResolution().y);
+        const uint64_t options_previous     = renderer->GetOptions();
+        const uint64_t render_target_debug  = renderer->GetRenderTargetDebug();
+
+        // Render targets cost the most at 4K, and since they are created again the graph renders the BRDF LUT, which is what the expectations below are for
+        if (width_previous == 3840 && height_previous == 2160)
+        {
+            renderer->SetResolution(1920, 1080);
+        }
+        renderer->SetResolution(3840, 2160);
+
+        // No debug or editor overlays reading from the graph either
+        renderer->SetRenderTargetDebug(0);
+
+        // The passes are not executed, only the barriers the graph puts in front of them are recorded
+        RHI_CommandList cmd_list(0, nullptr, context);
+        if (!cmd_list.Begin())
+        {
+            LOG_ERROR("Failed to begin command list");
+            return false;
+        }
+
+        struct Configuration
+        {
+            const char* name;
+            uint64_t options;
+            bool transparent_objects;
+
+            // What the graph has to come up with
+            uint32_t pass_count;
+            uint32_t pass_culled_count;
+            uint32_t texture_count;
+            uint32_t texture_allocated_count;
+            uint32_t barrier_count;
+            vector<pair<uint64_t, uint64_t>> shared; // the only textures which share an allocation
+        };
+
+        // Only the options which change the passes or what they read and write, the rest don't matter to the graph
+        const uint64_t effects = Render_Hbao | Render_ScreenSpaceReflections | Render_AntiAliasing_Taa | Render_MotionBlur | Render_DepthOfField;
+        const Configuration configurations[] =
+        {
+            // HBAO is done with its noisy texture before the composition writes the HDR texture, while the HDR texture
+            // which the lighting reads carries over from the previous frame, so it can't share
+            { "Default",                effects,                            false, 15, 0, 19, 18, 24, { { RenderTarget_Hdr, RenderTarget_Hbao_Noisy } } },
+            // The transparent passes keep everything alive until the alpha blend
+            { "Default, transparent",   effects,                            true,  21, 0, 19, 19, 44, { } },
+            { "Indirect bounce",        effects | Render_IndirectBounce,    false, 15, 0, 19, 18, 24, { { RenderTarget_Hdr, RenderTarget_Hbao_Noisy } } },
+            { "Depth prepass",          effects | Render_DepthPrepass,      false, 16, 0, 19, 18, 24, { { RenderTarget_Hdr, RenderTarget_Hbao_Noisy } } },
+            // Nothing reads HBAO and SSR, so their passes are culled and their textures are never created
+            { "No effects",             0,                                  false, 15, 2, 13, 13, 18, { } }
+        };
+
+        const uint64_t render_targets[] =
+        {
+            RenderTarget_Gbuffer_Albedo, RenderTarget_Gbuffer_Normal, RenderTarget_Gbuffer_Material, RenderTarget_Gbuffer_Velocity, RenderTarget_Gbuffer_Depth,
+            RenderTarget_Light_Diffuse, RenderTarget_Light_Specular, RenderTarget_Light_Volumetric, RenderTarget_Brdf_Specular_Lut,
+            RenderTarget_Hdr, RenderTarget_Ldr, RenderTarget_Hdr_2, RenderTarget_Ldr_2, RenderTarget_Dof_Half, RenderTarget_Dof_Half_2,
+            RenderTarget_TaaHistory, RenderTarget_Hbao_Noisy, RenderTarget_Hbao, RenderTarget_Ssr
+        };
+
+        // D3D11 has no barriers, so there is nothing which could be recorded
+        #if defined(API_GRAPHICS_D3D11)
+        const bool records_barriers = false;
+        #else
+        const bool records_barriers = true;
+        #endif
+
+        bool verified = true;
+        for (const Configuration& configuration : configurations)
+        {
+            renderer->SetOptions((options_previous & ~(effects | Render_IndirectBounce | Render_DepthPrepass | Render_Debug_SelectionOutline)) | configuration.options);
+            renderer->RenderGraphBuild(configuration.transparent_objects);
+            render_graph->Compile();
+
+            // Also checks that the textures of an allocation match it in size and format
+            if (!render_graph->Validate())
+            {
+                LOG_ERROR("%s: The compiled graph is invalid", configuration.name);
+                verified = false;
+            }
+
+            // The first execution brings the layouts to where every frame leaves them, the second is what a frame costs
+            render_graph->Execute(&cmd_list, false);
+            const uint32_t barriers_recorded_start = profiler->m_rhi_pipeline_barriers;
+            render_graph->Execute(&cmd_list, false);
+            const uint32_t barriers_recorded = profiler->m_rhi_pipeline_barriers - barriers_recorded_start;
+
+            struct Count
+            {
+                const char* name;
+                uint32_t actual;
+                uint32_t expected;
+            };
+
+            const Count counts[] =
+            {
+                { "passes",                 render_graph->GetPassCount(),             configuration.pass_count },
+                { "culled passes",          render_graph->GetPassCulledCount(),       configuration.pass_culled_count },
+                { "textures",               render_graph->GetTextureCount(),          configuration.texture_count },
+                { "allocated textures",     render_graph->GetTextureAllocatedCount(), configuration.texture_allocated_count },
+                { "expected barriers",      render_graph->GetBarrierCountExpected(),  configuration.barrier_count },
+                { "issued barriers",        render_graph->GetBarrierCount(),          configuration.barrier_count }
+            };
+
+            for (const Count& count : counts)
+            {
+                if (count.actual != count.expected)
+                {
+                    LOG_ERROR("%s: %u %s instead of %u", configuration.name, count.actual, count.name, count.expected);
+                    verified = false;
+                }
+            }
+
+            if (records_barriers && barriers_recorded != configuration.barrier_count)
+            {
+                LOG_ERROR("%s: %u recorded barriers instead of %u", configuration.name, barriers_recorded, configuration.barrier_count);
+                verified = false;
+            }
+
+            // Exactly the expected pairs share, every other pair of render targets has textures of its own
+            for (uint32_t i = 0; i < static_cast<uint32_t>(size(render_targets)); i++)
+            {
+                for (uint32_t j = i + 1; j < static_cast<uint32_t>(size(render_targets)); j++)
+                {
+                    const uint64_t a = render_targets[i];
+                    const uint64_t b = render_targets[j];
+
+                    bool shared_expected = false;
+                    for (const auto& pair : configuration.shared)
+                    {
+                        shared_expected |= (pair.first == a && pair.second == b) || (pair.first == b && pair.second == a);
+                    }
+
+                    if (render_graph->IsShared(a, b) != shared_expected)
+                    {
+                        LOG_ERROR("%s: %s and %s %s", configuration.name, render_graph->GetTextureName(a), render_graph->GetTextureName(b), shared_expected ? "were expected to share" : "share unexpectedly");
+                        verified = false;
+                    }
+                }
+            }
+
+            LOG_INFO("%s: %u of %u passes culled, %u textures in %u allocations, %.1f MB instead of %.1f MB, %u barriers per frame",
+                configuration.name,
+                render_graph->GetPassCulledCount(), render_graph->GetPassCount(),
+                render_graph->GetTextureCount(), render_graph->GetTextureAllocatedCount(),
+                static_cast<float>(render_graph->GetMemoryAllocated()) / 1048576.0f, static_cast<float>(render_graph->GetMemoryDeclared()) / 1048576.0f,
+                render_graph->GetBarrierCount()
+            );
+        }
+
+        if (!cmd_list.Submit() || !cmd_list.Wait())
+        {
+            LOG_ERROR("Failed to submit command list");
+            verified = false;
+        }
+
+        renderer->SetOptions(options_previous);
+        renderer->SetRenderTargetDebug(render_target_debug);
+        renderer->SetResolution(width_previous, height_previous);
+
+        return verified;
+    }
+}
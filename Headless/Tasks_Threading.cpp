@@ -0,0 +1,259 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES ==================
+#include <deque>
+#include <functional>
+#include <condition_variable>
+#include "Tasks.h"
+#include "Core/Context.h"
+#include "Core/Stopwatch.h"
+#include "Logging/Log.h"
+#include "Threading/Threading.h"
+//=============================
+
+//= NAMESPACES =========
+using namespace std;
+using namespace Spartan;
+//======================
+
+namespace _Tasks_Threading
+{
+    // The pool the threading subsystem used to be, one deque guarded by one mutex and an allocation per task, kept to benchmark against
+    class MutexPool
+    {
+    public:
+        MutexPool(const uint32_t thread_count)
+        {
+            for (uint32_t i = 0; i < thread_count; i++)
+            {
+                m_threads.emplace_back(thread(&MutexPool::ThreadLoop, this));
+            }
+        }
+
+        ~MutexPool()
+        {
+            {
+                lock_guard<mutex> lock(m_mutex_tasks);
+                m_stopping = true;
+            }
+            m_condition_var.notify_all();
+
+            for (auto& thread : m_threads)
+            {
+                thread.join();
+            }
+        }
+
+        template <typename Function>
+        void AddTask(Function&& task)
+        {
+            unique_lock<mutex> lock(m_mutex_tasks);
+            m_tasks.push_back(make_shared<function<void()>>(forward<Function>(task)));
+            lock.unlock();
+
+            m_condition_var.notify_one();
+        }
+
+    private:
+        void ThreadLoop()
+        {
+            while (true)
+            {
+                unique_lock<mutex> lock(m_mutex_tasks);
+                m_condition_var.wait(lock, [this] { return !m_tasks.empty() || m_stopping; });
+
+                if (m_stopping && m_tasks.empty())
+                    return;
+
+                shared_ptr<function<void()>> task = m_tasks.front();
+                m_tasks.pop_front();
+                lock.unlock();
+
+                (*task)();
+            }
+        }
+
+        vector<thread> m_threads;
+        deque<shared_ptr<function<void()>>> m_tasks;
+        mutex m_mutex_tasks;
+        condition_variable m_condition_var;
+        bool m_stopping = false;
+    };
+
+    // A bit of work which the compiler can't skip, so that the benchmark isn't only measuring the queues
+    uint32_t work(const uint32_t seed)
+    {
+        uint32_t value = seed;
+        for (uint32_t i = 0; i < 64; i++)
+        {
+            value = value * 1664525u + 1013904223u;
+        }
+
+        return value;
+    }
+}
+
+namespace Tasks
+{
+    bool ThreadingBenchmark(Context* context)
+    {
+        const uint32_t task_count = 100000;
+
+        Threading* threading        = context->GetSubsystem<Threading>();
+        const uint32_t thread_count = threading->GetThreadCount();
+        if (thread_count == 0)
+        {
+            LOG_ERROR("There are no worker threads to benchmark");
+            return false;
+        }
+
+        // Every task writes its own result, they are added up afterwards to check that each one ran exactly once
+        vector<uint32_t> results(task_count);
+        uint64_t expected = 0;
+        for (uint32_t i = 0; i < task_count; i++)
+        {
+            expected += _Tasks_Threading::work(i);
+        }
+
+        auto check = [&results, expected](const char* name)
+        {
+            uint64_t sum = 0;
+            for (const uint32_t result : results)
+            {
+                sum += result;
+            }
+
+            if (sum != expected)
+            {
+                LOG_ERROR("%s: the results don't add up, a task was lost or ran more than once", name);
+                return false;
+            }
+
+            return true;
+        };
+
+        // Spawned from the workers, a hundred tasks each submit an equal share of the rest
+        const uint32_t spawner_count    = 100;
+        const uint32_t spawn_count      = task_count / spawner_count;
+        const uint32_t submitted_count  = spawner_count * spawn_count;
+
+        // The threading subsystem, waiting through a counter
+        float time_submitted    = 0.0f;
+        float time_spawned      = 0.0f;
+        {
+            fill(results.begin(), results.end(), 0);
+            TaskCounter counter;
+            const Stopwatch timer;
+            for (uint32_t i = 0; i < task_count; i++)
+            {
+                threading->AddTask([&results, i]() { results[i] = _Tasks_Threading::work(i); }, &counter);
+            }
+            threading->Wait(counter);
+            time_submitted = static_cast<float>(timer.GetElapsedTimeMs());
+
+            if (!check("Submitted"))
+                return false;
+        }
+        {
+            fill(results.begin(), results.end(), 0);
+            TaskCounter counter;
+            const Stopwatch timer;
+            for (uint32_t i = 0; i < spawner_count; i++)
+            {
+                threading->AddTask([threading, &results, &counter, i, spawn_count]()
+                {
+                    for (uint32_t j = i * spawn_count; j < (i + 1) * spawn_count; j++)
+                    {
+                        threading->AddTask([&results, j]() { results[j] = _Tasks_Threading::work(j); }, &counter);
+                    }
+                }, &counter);
+            }
+            threading->Wait(counter);
+            time_spawned = static_cast<float>(timer.GetElapsedTimeMs());
+
+            // Only the spawned ones are checked, tasks past the last full share were never submitted
+            fill(results.begin() + submitted_count, results.end(), 0);
+            for (uint32_t i = submitted_count; i < task_count; i++)
+            {
+                results[i] = _Tasks_Threading::work(i);
+            }
+
+            if (!check("Spawned"))
+                return false;
+        }
+
+        // The mutex pool, with as many threads, waiting on a count of completed tasks
+        float time_submitted_mutex  = 0.0f;
+        float time_spawned_mutex    = 0.0f;
+        {
+            _Tasks_Threading::MutexPool pool(thread_count);
+            atomic<uint32_t> done = 0;
+
+            fill(results.begin(), results.end(), 0);
+            const Stopwatch timer_submitted;
+            for (uint32_t i = 0; i < task_count; i++)
+            {
+                pool.AddTask([&results, &done, i]() { results[i] = _Tasks_Threading::work(i); done.fetch_add(1); });
+            }
+            while (done.load() != task_count)
+            {
+                this_thread::yield();
+            }
+            time_submitted_mutex = static_cast<float>(timer_submitted.GetElapsedTimeMs());
+
+            if (!check("Submitted to the mutex pool"))
+                return false;
+
+            done = 0;
+            fill(results.begin(), results.end(), 0);
+            const Stopwatch timer_spawned;
+            for (uint32_t i = 0; i < spawner_count; i++)
+            {
+                pool.AddTask([&pool, &results, &done, i, spawn_count]()
+                {
+                    for (uint32_t j = i * spawn_count; j < (i + 1) * spawn_count; j++)
+                    {
+                        pool.AddTask([&results, &done, j]() { results[j] = _Tasks_Threading::work(j); done.fetch_add(1); });
+                    }
+                });
+            }
+            while (done.load() != submitted_count)
+            {
+                this_thread::yield();
+            }
+            time_spawned_mutex = static_cast<float>(timer_spawned.GetElapsedTimeMs());
+
+            for (uint32_t i = submitted_count; i < task_count; i++)
+            {
+                results[i] = _Tasks_Threading::work(i);
+            }
+
+            if (!check("Spawned in the mutex pool"))
+                return false;
+        }
+
+        LOG_INFO("%u tasks on %u threads, submitted from one thread: %.2f ms (%.2f ms with a single mutex), spawned from the workers: %.2f ms (%.2f ms with a single mutex)",
+            task_count, thread_count, time_submitted, time_submitted_mutex, time_spawned, time_spawned_mutex);
+
+        return true;
+    }
+}
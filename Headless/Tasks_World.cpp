@@ -0,0 +1,242 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES ==========================
+#include <thread>
+#include <algorithm>
+#include <functional>
+#include "Tasks.h"
+#include "Core/Context.h"
+#include "Core/Stopwatch.h"
+#include "Core/FileSystem.h"
+#include "Logging/Log.h"
+#include "Rendering/Renderer.h"
+#include "Resource/ProgressReport.h"
+#include "Threading/Threading.h"
+#include "World/World.h"
+#include "World/Entity.h"
+#include "World/Components/Transform.h"
+#include "World/Components/Renderable.h"
+//=====================================
+
+//= NAMESPACES ================
+using namespace std;
+using namespace Spartan;
+using namespace Spartan::Math;
+//=============================
+
+namespace Tasks
+{
+    bool EntitiesBenchmark(Context* context)
+    {
+        const uint32_t entity_count = 100000;
+
+        World* world            = context->GetSubsystem<World>();
+        Renderer* renderer      = context->GetSubsystem<Renderer>();
+        Threading* threading    = context->GetSubsystem<Threading>();
+        const auto& entities    = world->EntityGetAll();
+        world->Unload();
+
+        // Returns the time in milliseconds
+        auto measure = [](const function<void()>& work)
+        {
+            const Stopwatch timer;
+            work();
+            return static_cast<float>(timer.GetElapsedTimeMs());
+        };
+
+        // Named one by one, in chains of eight so that loading has parents to resolve
+        const float time_create = measure([world, &entities, entity_count]()
+        {
+            for (uint32_t i = 0; i < entity_count; i++)
+            {
+                Entity* entity = world->EntityCreate().get();
+                entity->SetName("Entity_" + to_string(i));
+                if (i % 8 != 0)
+                {
+                    entity->GetTransform()->SetParent(entities[i - 1]->GetTransform());
+                }
+            }
+        });
+
+        vector<uint32_t> ids;
+        vector<string> names;
+        for (const auto& entity : entities)
+        {
+            ids.emplace_back(entity->GetId());
+            names.emplace_back(entity->GetName());
+        }
+
+        // Every entity by ID and by name, and a thousand of them by walking the list, which is how lookups used to work
+        uint32_t missing = 0;
+        const float time_by_id      = measure([world, &ids, &missing]()     { for (const uint32_t id : ids)        { missing += world->EntityGetById(id) ? 0 : 1; } });
+        const float time_by_name    = measure([world, &names, &missing]()   { for (const string& name : names)     { missing += world->EntityGetByName(name) ? 0 : 1; } });
+        const uint32_t scan_count   = min(entity_count, 1000u);
+        const float time_by_scan    = measure([&entities, &ids, &missing, scan_count, entity_count]()
+        {
+            for (uint32_t i = 0; i < scan_count; i++)
+            {
+                const uint32_t id = ids[i * (entity_count / scan_count)];
+                missing += find_if(entities.begin(), entities.end(), [id](const shared_ptr<Entity>& entity) { return entity->GetId() == id; }) != entities.end() ? 0 : 1;
+            }
+        });
+
+        if (missing != 0)
+        {
+            LOG_ERROR("%u lookups didn't find their entity", missing);
+            return false;
+        }
+
+        // Save it and load it back, every entity which has a parent looks it up by ID while loading
+        const string file_path = "entities_benchmark" + string(EXTENSION_WORLD);
+        if (!world->SaveToFile(file_path))
+            return false;
+
+        // Loading waits for the world to stop ticking, so, like in the editor, it runs on a worker while this thread ticks the world until
+        // loading has started, the time includes that wait
+        bool loaded     = false;
+        float time_load = 0.0f;
+        TaskCounter counter;
+        threading->AddTask([world, &file_path, &loaded, &time_load, &measure]()
+        {
+            time_load = measure([world, &file_path, &loaded]() { loaded = world->LoadFromFile(file_path); });
+        }, &counter);
+
+        while (!counter.IsDone() && !ProgressReport::Get().GetIsLoading(g_progress_world))
+        {
+            world->Tick(0.0f);
+            this_thread::yield();
+        }
+        threading->Wait(counter);
+
+        // Loading recorded the pipelines of the world it replaced, which was the one saved above
+        FileSystem::Delete(file_path);
+        FileSystem::Delete(renderer->PipelinesGetFilePath(FileSystem::GetFileNameNoExtensionFromFilePath(file_path)));
+
+        if (!loaded || world->EntityGetCount() != entity_count)
+        {
+            LOG_ERROR("Loaded %u of the %u entities which were saved", world->EntityGetCount(), entity_count);
+            return false;
+        }
+
+        // Remove every other chain in one go, entities are removed when the world resolves, so that's measured through a tick
+        const vector<shared_ptr<Entity>> roots = world->EntityGetRoots();
+        vector<Transform*> descendants;
+        uint32_t removed_count = 0;
+        for (uint32_t i = 0; i < static_cast<uint32_t>(roots.size()); i += 2)
+        {
+            descendants.clear();
+            roots[i]->GetTransform()->GetDescendants(&descendants);
+            removed_count += 1 + static_cast<uint32_t>(descendants.size());
+            world->EntityRemove(roots[i]);
+        }
+        const float time_remove = measure([world]() { world->Tick(0.0f); });
+
+        if (world->EntityGetCount() != entity_count - removed_count)
+        {
+            LOG_ERROR("Removing %u entities left %u of %u", removed_count, world->EntityGetCount(), entity_count);
+            return false;
+        }
+
+        LOG_INFO("%u entities: created in %.2f ms, looked up by ID in %.1f ns, by name in %.1f ns, by walking the list in %.1f ns, loaded in %.2f ms and %u of them were removed by a tick of %.2f ms",
+            entity_count, time_create,
+            time_by_id * 1000000.0f / entity_count, time_by_name * 1000000.0f / entity_count, time_by_scan * 1000000.0f / scan_count,
+            time_load, removed_count, time_remove);
+
+        // Back to the default world
+        world->Unload();
+        world->Initialize();
+
+        return true;
+    }
+
+    bool TickBenchmark(Context* context)
+    {
+        const uint32_t entity_count = 100000;
+        const uint32_t iterations   = 100;
+
+        World* world            = context->GetSubsystem<World>();
+        const auto& entities    = world->EntityGetAll();
+        world->Unload();
+
+        // A transform and a renderable each, neither of which overrides OnTick(), in chains of eight so that there is a hierarchy to resolve
+        for (uint32_t i = 0; i < entity_count; i++)
+        {
+            Entity* entity = world->EntityCreate().get();
+            entity->AddComponent<Renderable>();
+            if (i % 8 != 0)
+            {
+                entity->GetTransform()->SetParent(entities[i - 1]->GetTransform());
+            }
+        }
+
+        // Let the world resolve before anything is measured
+        const float delta_time = 1.0f / 60.0f;
+        world->Tick(delta_time);
+
+        // Returns the time per tick in milliseconds
+        auto measure = [iterations](const function<void()>& tick)
+        {
+            const Stopwatch timer;
+            for (uint32_t i = 0; i < iterations; i++)
+            {
+                tick();
+            }
+
+            return static_cast<float>(timer.GetElapsedTimeMs() / iterations);
+        };
+
+        // How components used to be ticked, every component of every entity
+        const float time_components_all = measure([&entities, delta_time]()
+        {
+            for (const auto& entity : entities)
+            {
+                for (const auto& component : entity->GetAllComponents())
+                {
+                    component->OnTick(delta_time);
+                }
+            }
+        });
+
+        // The whole tick, which only ticks the components that override OnTick(), when nothing moves and when every chain moves
+        const float time_tick_static = measure([world, delta_time]() { world->Tick(delta_time); });
+        float offset = 0.0f;
+        const float time_tick_moving = measure([world, &entities, delta_time, entity_count, &offset]()
+        {
+            offset += 1.0f;
+            for (uint32_t i = 0; i < entity_count; i += 8)
+            {
+                entities[i]->GetTransform()->SetPositionLocal(Vector3(offset, 0.0f, 0.0f));
+            }
+
+            world->Tick(delta_time);
+        });
+
+        LOG_INFO("Ticking %u entities: %.3f ms for every component, %.3f ms for a world tick, %.3f ms when every root moves (%u iterations)",
+            entity_count, time_components_all, time_tick_static, time_tick_moving, iterations);
+
+        // Back to the default world
+        world->Unload();
+        world->Initialize();
+
+        return true;
+    }
+}
@@ -0,0 +1,198 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES =====================
+#include <iostream>
+#include <sstream>
+#include "Tasks.h"
+#include "Logging/ILogger.h"
+#include "Logging/Log.h"
+#include "Core/Engine.h"
+#include "Core/Context.h"
+#include "Rendering/Renderer.h"
+#if !defined(API_GRAPHICS_NULL)
+#include "Window.h"
+#endif
+//================================
+
+//= NAMESPACES =========
+using namespace std;
+using namespace Spartan;
+//======================
+
+namespace _Headless
+{
+    struct Task
+    {
+        const char* flag;
+        bool (*run)(Context* context);
+    };
+
+    // In the order they run
+    const Task tasks[] =
+    {
+        // Compiles every shader permutation and logs how long each one took
+        { "-compile_shaders",           [](Context* context) { Renderer* renderer = context->GetSubsystem<Renderer>(); return renderer->ShaderPermutationsCompile(renderer->ShaderPermutationsAll(), nullptr, true); } },
+        // Measures what binding a pipeline state costs
+        { "-benchmark_pipelines",       Tasks::PipelinesBenchmark },
+        // Compiles the render graph of a few configurations and checks what it allocates and the barriers it issues
+        { "-verify_render_graph",       Tasks::RenderGraphVerify },
+        // Checks the exact amount of draws and binds which reach the null device
+        { "-verify_null_device",        Tasks::NullDeviceVerify },
+        // Checks that occluders don't hide themselves and still hide what's behind them
+        { "-verify_occlusion",          Tasks::OcclusionVerify },
+        // Checks the error and the triangle count of every level of detail against the surface it was simplified from
+        { "-verify_lods",               Tasks::LodsVerify },
+        // Checks that light binning never leaves out a light which reaches a pixel of a cluster
+        { "-verify_light_clusters",     Tasks::LightClustersVerify },
+        // Measures how long binning lights into clusters takes
+        { "-benchmark_light_clusters",  Tasks::LightClustersBenchmark },
+        // Checks that the SSE path of frustum culling gives the same results as the scalar one, whatever the box count
+        { "-verify_frustum_culling",    Tasks::FrustumCullingVerify },
+        // Measures what frustum culling a box costs
+        { "-benchmark_frustum_culling", Tasks::FrustumCullingBenchmark },
+        // Measures what querying the BVH costs as the amount of entities grows, compared to testing every one of them
+        { "-benchmark_bvh",             Tasks::BvhBenchmark },
+        // Measures what creating, looking up, loading and removing 100k entities costs
+        { "-benchmark_entities",        Tasks::EntitiesBenchmark },
+        // Measures what ticking a world of 100k entities costs
+        { "-benchmark_world_tick",      Tasks::TickBenchmark },
+        // Measures how long batches of small tasks take compared to the single mutex pool the job system replaced
+        { "-benchmark_threading",       Tasks::ThreadingBenchmark }
+    };
+
+    bool has_flag(const string& command_line, const char* flag)
+    {
+        istringstream stream(command_line);
+        string argument;
+        while (stream >> argument)
+        {
+            if (argument == flag)
+                return true;
+        }
+
+        return false;
+    }
+
+    bool has_task(const string& command_line)
+    {
+        for (const Task& task : tasks)
+        {
+            if (has_flag(command_line, task.flag))
+                return true;
+        }
+
+        return false;
+    }
+
+    string get_flags()
+    {
+        string flags;
+        for (const Task& task : tasks)
+        {
+            flags += (flags.empty() ? "" : " ") + string(task.flag);
+        }
+
+        return flags;
+    }
+
+    // Creates an engine, runs the tasks the command line asks for and returns the exit code of the process
+    int run(const string& command_line, const WindowData& window_data)
+    {
+        Engine engine(window_data);
+        Context* context = engine.GetContext();
+        if (!context->GetSubsystem<Renderer>()->IsInitialized())
+        {
+            LOG_ERROR("Failed to initialize the renderer");
+            return 1;
+        }
+
+        uint32_t failed_count = 0;
+        for (const Task& task : tasks)
+        {
+            if (!has_flag(command_line, task.flag))
+                continue;
+
+            if (task.run(context))
+            {
+                LOG_INFO("%s passed", task.flag);
+            }
+            else
+            {
+                LOG_ERROR("%s failed", task.flag);
+                failed_count++;
+            }
+        }
+
+        return failed_count == 0 ? 0 : 1;
+    }
+}
+
+// Prints what the engine logs, so that it ends up in the output of whoever runs the tasks
+class ConsoleLogger : public ILogger
+{
+public:
+    void Log(const string& log, const uint32_t type) override
+    {
+        (type == static_cast<uint32_t>(LogType::Error) ? cerr : cout) << log << endl;
+    }
+};
+
+// Runs the verifications and benchmarks which the command line asks for, several can run at once
+int main(int argc, char* argv[])
+{
+    string command_line;
+    for (int i = 1; i < argc; i++)
+    {
+        command_line += string(argv[i]) + " ";
+    }
+
+    if (!_Headless::has_task(command_line))
+    {
+        cerr << "Usage: " << argv[0] << " <one or more of: " << _Headless::get_flags() << ">" << endl;
+        return 1;
+    }
+
+    const shared_ptr<ConsoleLogger> logger = make_shared<ConsoleLogger>();
+    Log::SetLogger(logger);
+
+#if defined(API_GRAPHICS_NULL)
+    // Nothing is presented, the resolution only sizes the render targets
+    WindowData window_data;
+    window_data.width   = 1920;
+    window_data.height  = 1080;
+
+    return _Headless::run(command_line, window_data);
+#else
+    // The other backends need a window to create a device with, so make one but keep it hidden
+    if (!Window::Create(GetModuleHandle(nullptr), "Spartan " + string(engine_version)))
+        return 1;
+
+    WindowData window_data;
+    window_data.handle      = static_cast<void*>(Window::g_handle);
+    window_data.instance    = static_cast<void*>(Window::g_instance);
+    Window::GetWindowSize(&window_data.width, &window_data.height);
+
+    const int result = _Headless::run(command_line, window_data);
+    Window::Destroy();
+    return result;
+#endif
+}
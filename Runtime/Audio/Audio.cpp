@@ -37,7 +37,7 @@ namespace Spartan
 {
     Audio::Audio(Context* context) : ISubsystem(context)
     {
-
+        SetTickDependencies(Subsystem_Data_Time, Subsystem_Data_Audio, false);
     }
 
 	Audio::~Audio()
@@ -154,10 +154,10 @@ namespace Spartan
 
 		if (m_listener)
 		{
-			auto position = m_listener->GetPosition();
+			auto position = m_listener_position;
 			auto velocity = Math::Vector3::Zero;
-			auto forward = m_listener->GetForward();
-			auto up = m_listener->GetUp();
+			auto forward = m_listener_forward;
+			auto up = m_listener_up;
 
 			// Set 3D attributes
 			m_result_fmod = m_system_fmod->set3DListenerAttributes(
@@ -178,6 +178,13 @@ namespace Spartan
     void Audio::SetListenerTransform(Transform* transform)
 	{
 		m_listener = transform;
+
+        if (m_listener)
+        {
+            m_listener_position = m_listener->GetPosition();
+            m_listener_forward  = m_listener->GetForward();
+            m_listener_up       = m_listener->GetUp();
+        }
 	}
 
 	void Audio::LogErrorFmod(int error) const
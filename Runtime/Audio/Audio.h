@@ -23,6 +23,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //= INCLUDES ==================
 #include "../Core/ISubsystem.h"
+#include "../Math/Vector3.h"
 //=============================
 
 //= FORWARD DECLARATIONS =
@@ -59,6 +60,10 @@ namespace Spartan
 		float m_distance_entity		= 1.0f;
 		bool m_initialized			= false;
 		Transform* m_listener		= nullptr;
+        // Listener attributes, latched when the listener is set so that Tick() doesn't read transforms
+        Math::Vector3 m_listener_position;
+        Math::Vector3 m_listener_forward;
+        Math::Vector3 m_listener_up;
 		Profiler* m_profiler		= nullptr;
 		FMOD::System* m_system_fmod = nullptr;
 	};
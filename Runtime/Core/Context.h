@@ -22,7 +22,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #pragma once
 
 //= INCLUDES ===================
+#include <array>
 #include "ISubsystem.h"
+#include "SubsystemGraph.h"
 #include "../Logging/Log.h"
 #include "Spartan_Definitions.h"
 //==============================
@@ -30,6 +32,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 namespace Spartan
 {
     class Engine;
+    class Threading;
 
     enum class TickType
     {
@@ -72,6 +75,7 @@ namespace Spartan
             validate_subsystem_type<T>();
 
             m_subsystems.emplace_back(std::make_shared<T>(this), tick_group);
+            m_graphs_dirty = true;
 		}
 
 		// Initialize subsystems
@@ -93,15 +97,17 @@ namespace Spartan
         // Tick
 		void Tick(TickType tick_group, float delta_time = 0.0f)
 		{
-            for (const auto& subsystem : m_subsystems)
+            if (m_graphs_dirty)
             {
-                if (subsystem.tick_group != tick_group)
-                    continue;
-
-                subsystem.ptr->Tick(delta_time);
+                BuildGraphs();
             }
+
+            m_graphs[static_cast<uint32_t>(tick_group)].Tick(delta_time, m_threading);
 		}
 
+        // Get the dependency graph a tick group is ticked with
+        const SubsystemGraph& GetGraph(TickType tick_group) const { return m_graphs[static_cast<uint32_t>(tick_group)]; }
+
 		// Get a subsystem
 		template <class T> 
         T* GetSubsystem() const
@@ -120,6 +126,11 @@ namespace Spartan
         Engine* m_engine = nullptr;
 
 	private:
+        void BuildGraphs();
+
 		std::vector<_subystem> m_subsystems;
+        std::array<SubsystemGraph, 2> m_graphs;
+        Threading* m_threading  = nullptr;
+        bool m_graphs_dirty     = true;
 	};
 }
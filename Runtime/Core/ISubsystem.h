@@ -24,6 +24,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //= INCLUDES ===================
 #include <type_traits>
 #include <memory>
+#include <cstdint>
 #include "Spartan_Definitions.h"
 //==============================
 
@@ -31,6 +32,22 @@ namespace Spartan
 {
 	class Context;
 
+    // Data a subsystem touches during Tick(), subsystems which don't conflict can tick in parallel
+    enum Subsystem_Data : uint32_t
+    {
+        Subsystem_Data_None         = 0,
+        Subsystem_Data_Time         = 1UL << 0,
+        Subsystem_Data_Input        = 1UL << 1,
+        Subsystem_Data_Resources    = 1UL << 2,
+        Subsystem_Data_Audio        = 1UL << 3,
+        Subsystem_Data_Physics      = 1UL << 4,
+        Subsystem_Data_Transforms   = 1UL << 5,
+        Subsystem_Data_World        = 1UL << 6,
+        Subsystem_Data_Render       = 1UL << 7,
+        Subsystem_Data_Profiling    = 1UL << 8,
+        Subsystem_Data_All          = 0xFFFFFFFF
+    };
+
 	class SPARTAN_CLASS ISubsystem : public std::enable_shared_from_this<ISubsystem>
 	{		
 	public:
@@ -42,8 +59,26 @@ namespace Spartan
         template <typename T>
         std::shared_ptr<T> GetPtrShared() { return dynamic_pointer_cast<T>(shared_from_this()); }
 
+        // Tick dependencies
+        uint32_t GetTickDataRead()  const { return m_tick_data_read; }
+        uint32_t GetTickDataWrite() const { return m_tick_data_write; }
+        bool GetTickOnMainThread()  const { return m_tick_on_main_thread; }
+
 	protected:
+        // Subsystems which don't declare their dependencies are assumed to touch everything
+        void SetTickDependencies(const uint32_t data_read, const uint32_t data_write, const bool main_thread)
+        {
+            m_tick_data_read        = data_read;
+            m_tick_data_write       = data_write;
+            m_tick_on_main_thread   = main_thread;
+        }
+
 		Context* m_context;
+
+    private:
+        uint32_t m_tick_data_read   = Subsystem_Data_All;
+        uint32_t m_tick_data_write  = Subsystem_Data_All;
+        bool m_tick_on_main_thread  = true;
 	};
 
     template<typename T>
@@ -64,6 +64,7 @@ namespace Spartan
 {
     Settings::Settings(Context* context) : ISubsystem(context)
     {
+        SetTickDependencies(Subsystem_Data_None, Subsystem_Data_None, true);
         m_context = context;
 
         // Register pugixml
@@ -34,7 +34,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //#define API_GRAPHICS_D3D11    -> Defined by solution generation script
 //#define API_GRAPHICS_D3D12    -> Defined by solution generation script
 //#define API_GRAPHICS_VULKAN   -> Defined by solution generation script
-#define API_INPUT_WINDOWS //    -> Explicitly defined for now
+//#define API_GRAPHICS_NULL     -> Defined by solution generation script
+//#define API_INPUT_WINDOWS     -> Defined by solution generation script
+//#define API_INPUT_NULL        -> Defined by solution generation script
 
 //= WINDOWS ===============
 #ifndef WIN32_LEAN_AND_MEAN
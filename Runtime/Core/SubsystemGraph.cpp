@@ -0,0 +1,194 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES ======================
+#include "Spartan.h"
+#include "SubsystemGraph.h"
+#include "ISubsystem.h"
+#include "../Threading/Threading.h"
+//=================================
+
+//= NAMESPACES =====
+using namespace std;
+//==================
+
+namespace Spartan
+{
+    void SubsystemGraph::Build(const vector<ISubsystem*>& subsystems)
+    {
+        m_nodes.clear();
+        m_nodes.resize(subsystems.size());
+        m_dependencies_remaining = make_unique<atomic<uint32_t>[]>(subsystems.size());
+
+        for (uint32_t i = 0; i < static_cast<uint32_t>(subsystems.size()); i++)
+        {
+            Node& node          = m_nodes[i];
+            node.subsystem      = subsystems[i];
+            node.main_thread    = node.subsystem->GetTickOnMainThread();
+
+            // "class Spartan::Physics" -> "Physics"
+            node.name = typeid(*node.subsystem).name();
+            node.name = node.name.substr(node.name.find_last_of(": ") + 1);
+
+            // A subsystem depends on every subsystem registered before it which it conflicts with,
+            // this keeps the registration order for anything that touches the same data.
+            const uint32_t read     = node.subsystem->GetTickDataRead();
+            const uint32_t write    = node.subsystem->GetTickDataWrite();
+            for (uint32_t j = 0; j < i; j++)
+            {
+                const uint32_t read_other   = m_nodes[j].subsystem->GetTickDataRead();
+                const uint32_t write_other  = m_nodes[j].subsystem->GetTickDataWrite();
+
+                if ((write & (read_other | write_other)) || (read & write_other))
+                {
+                    node.predecessors.emplace_back(j);
+                    m_nodes[j].successors.emplace_back(i);
+                }
+            }
+        }
+    }
+
+    void SubsystemGraph::Tick(const float delta_time, Threading* threading)
+    {
+        if (m_nodes.empty())
+            return;
+
+        const auto time_start = chrono::steady_clock::now();
+
+        m_delta_time        = delta_time;
+        m_threading         = (threading && threading->GetThreadCount() != 0) ? threading : nullptr;
+        m_nodes_remaining   = static_cast<uint32_t>(m_nodes.size());
+
+        for (uint32_t i = 0; i < static_cast<uint32_t>(m_nodes.size()); i++)
+        {
+            m_dependencies_remaining[i].store(static_cast<uint32_t>(m_nodes[i].predecessors.size()));
+        }
+
+        // Kick off the roots
+        for (uint32_t i = 0; i < static_cast<uint32_t>(m_nodes.size()); i++)
+        {
+            if (m_nodes[i].predecessors.empty())
+            {
+                Schedule(i);
+            }
+        }
+
+        // Execute the nodes which have to run on this thread, until the whole graph is done
+        while (true)
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_condition_var.wait(lock, [this] { return !m_nodes_ready_main.empty() || m_nodes_remaining == 0; });
+
+            if (m_nodes_remaining == 0)
+                break;
+
+            const uint32_t node_index = m_nodes_ready_main.front();
+            m_nodes_ready_main.pop_front();
+            lock.unlock();
+
+            Execute(node_index);
+        }
+
+        m_time_total_ms = static_cast<float>(chrono::duration<double, milli>(chrono::steady_clock::now() - time_start).count());
+        ComputeCriticalPath();
+    }
+
+    void SubsystemGraph::Schedule(const uint32_t node_index)
+    {
+        if (!m_nodes[node_index].main_thread && m_threading)
+        {
+            m_threading->AddTask([this, node_index]() { Execute(node_index); });
+            return;
+        }
+
+        {
+            lock_guard<mutex> lock(m_mutex);
+            m_nodes_ready_main.emplace_back(node_index);
+        }
+        m_condition_var.notify_one();
+    }
+
+    void SubsystemGraph::Execute(const uint32_t node_index)
+    {
+        Node& node = m_nodes[node_index];
+
+        const auto time_start = chrono::steady_clock::now();
+        node.subsystem->Tick(m_delta_time);
+        node.duration_ms = static_cast<float>(chrono::duration<double, milli>(chrono::steady_clock::now() - time_start).count());
+
+        // Release the nodes that were waiting on this one
+        for (const uint32_t successor : node.successors)
+        {
+            if (m_dependencies_remaining[successor].fetch_sub(1) == 1)
+            {
+                Schedule(successor);
+            }
+        }
+
+        bool done = false;
+        {
+            lock_guard<mutex> lock(m_mutex);
+            done = --m_nodes_remaining == 0;
+        }
+
+        if (done)
+        {
+            m_condition_var.notify_one();
+        }
+    }
+
+    void SubsystemGraph::ComputeCriticalPath()
+    {
+        // Registration order is a topological order, so a single pass finds the longest path
+        vector<float> path_ms(m_nodes.size(), 0.0f);
+        vector<int32_t> path_previous(m_nodes.size(), -1);
+        uint32_t path_end   = 0;
+        m_time_serial_ms    = 0.0f;
+
+        for (uint32_t i = 0; i < static_cast<uint32_t>(m_nodes.size()); i++)
+        {
+            for (const uint32_t predecessor : m_nodes[i].predecessors)
+            {
+                if (path_previous[i] == -1 || path_ms[predecessor] > path_ms[path_previous[i]])
+                {
+                    path_previous[i] = static_cast<int32_t>(predecessor);
+                }
+            }
+
+            path_ms[i]          = m_nodes[i].duration_ms + (path_previous[i] != -1 ? path_ms[path_previous[i]] : 0.0f);
+            m_time_serial_ms    += m_nodes[i].duration_ms;
+
+            if (path_ms[i] > path_ms[path_end])
+            {
+                path_end = i;
+            }
+        }
+
+        m_time_critical_path_ms = path_ms[path_end];
+
+        // Walk back from the end of the path
+        m_critical_path.clear();
+        for (int32_t i = static_cast<int32_t>(path_end); i != -1; i = path_previous[i])
+        {
+            m_critical_path = m_critical_path.empty() ? m_nodes[i].name : m_nodes[i].name + " > " + m_critical_path;
+        }
+    }
+}
@@ -0,0 +1,89 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+//= INCLUDES ==================
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <condition_variable>
+#include "Spartan_Definitions.h"
+//=============================
+
+namespace Spartan
+{
+    class ISubsystem;
+    class Threading;
+
+    // Ticks a group of subsystems as a dependency graph, subsystems whose declared
+    // data access doesn't conflict are ticked in parallel on the worker threads.
+    class SPARTAN_CLASS SubsystemGraph
+    {
+    public:
+        SubsystemGraph() = default;
+        ~SubsystemGraph() = default;
+
+        void Build(const std::vector<ISubsystem*>& subsystems);
+        void Tick(float delta_time, Threading* threading);
+
+        // Timings of the last tick
+        float GetTimeCriticalPathMs()               const { return m_time_critical_path_ms; }
+        float GetTimeSerialMs()                     const { return m_time_serial_ms; }
+        float GetTimeTotalMs()                      const { return m_time_total_ms; }
+        const std::string& GetCriticalPath()        const { return m_critical_path; }
+
+    private:
+        struct Node
+        {
+            ISubsystem* subsystem = nullptr;
+            std::string name;
+            std::vector<uint32_t> predecessors;
+            std::vector<uint32_t> successors;
+            bool main_thread    = true;
+            float duration_ms   = 0.0f;
+        };
+
+        void Schedule(uint32_t node_index);
+        void Execute(uint32_t node_index);
+        void ComputeCriticalPath();
+
+        std::vector<Node> m_nodes;
+        std::unique_ptr<std::atomic<uint32_t>[]> m_dependencies_remaining;
+
+        // Per tick state
+        float m_delta_time              = 0.0f;
+        Threading* m_threading          = nullptr;
+        uint32_t m_nodes_remaining      = 0;
+        std::deque<uint32_t> m_nodes_ready_main;
+        std::mutex m_mutex;
+        std::condition_variable m_condition_var;
+
+        // Timings
+        float m_time_critical_path_ms   = 0.0f;
+        float m_time_serial_ms          = 0.0f;
+        float m_time_total_ms           = 0.0f;
+        std::string m_critical_path;
+    };
+}
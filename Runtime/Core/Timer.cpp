@@ -33,6 +33,7 @@ namespace Spartan
 {
 	Timer::Timer(Context* context) : ISubsystem(context)
 	{
+        SetTickDependencies(Subsystem_Data_None, Subsystem_Data_Time, true);
         m_time_start        = chrono::high_resolution_clock::now();
 		m_time_frame_start  = chrono::high_resolution_clock::now();
 		m_time_frame_end    = chrono::high_resolution_clock::now();
@@ -0,0 +1,59 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+//= INCLUDES ==========
+#include "Spartan.h"
+#include "../Input.h"
+//=====================
+
+//= NAMESPACES ===============
+using namespace std;
+using namespace Spartan::Math;
+//============================
+
+namespace Spartan
+{
+    // There are no devices to read from, every key stays released and the window handle is never touched
+	Input::Input(Context* context) : ISubsystem(context)
+	{
+        SetTickDependencies(Subsystem_Data_None, Subsystem_Data_Input, true);
+
+        m_keys.fill(false);
+        m_keys_previous_frame.fill(false);
+	}
+
+    void Input::OnWindowData()
+    {
+
+    }
+
+	void Input::Tick(float delta_time)
+	{
+        m_mouse_delta           = Vector2::Zero;
+        m_keys_previous_frame   = m_keys;
+	}
+
+	bool Input::GamepadVibrate(const float left_motor_speed, const float right_motor_speed) const
+	{
+		return false;
+	}
+}
@@ -42,6 +42,8 @@ namespace Spartan
 
 	Input::Input(Context* context) : ISubsystem(context)
 	{
+        SetTickDependencies(Subsystem_Data_None, Subsystem_Data_Input, true);
+
         const WindowData& window_data   = context->m_engine->GetWindowData();
 		const auto window_handle	    = static_cast<HWND>(window_data.handle);
 
@@ -23,36 +23,32 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Spartan.h"
 //==================
 
+#if defined(_M_X64) || defined(__SSE2__)
+#define SPARTAN_FRUSTUM_SSE
+#include <emmintrin.h>
+#endif
+
 //= NAMESPACES =====
 using namespace std;
 //==================
 
 namespace Spartan::Math
 {
-    Frustum::Frustum(const Matrix& view, const Matrix& projection, float screen_depth)
+    Frustum::Frustum(const Matrix& view, const Matrix& projection)
 	{
-		// Calculate the minimum Z distance in the frustum.
-        const float z_min           = -projection.m32 / projection.m22;
-        const float r               = screen_depth / (screen_depth - z_min);
-		Matrix projection_updated   = projection;
-		projection_updated.m22      = r;
-		projection_updated.m32      = -r * z_min;
-
-		// Create the frustum matrix from the view matrix and updated projection matrix.
-        const Matrix view_projection = view * projection_updated;
-
-		// Calculate near plane of frustum.
-		m_planes[0].normal.x = view_projection.m03 + view_projection.m02;
-		m_planes[0].normal.y = view_projection.m13 + view_projection.m12;
-		m_planes[0].normal.z = view_projection.m23 + view_projection.m22;
-		m_planes[0].d = view_projection.m33 + view_projection.m32;
+        const Matrix view_projection = view * projection;
+
+        // Depth goes from 0 to w in clip space, 0 is the near end unless the projection is reverse-z
+        const bool reverse_z        = projection.m22 < 0.0f;
+        const Plane plane_depth_min = Plane(Vector3(view_projection.m02, view_projection.m12, view_projection.m22), view_projection.m32);
+        const Plane plane_depth_max = Plane(Vector3(view_projection.m03 - view_projection.m02, view_projection.m13 - view_projection.m12, view_projection.m23 - view_projection.m22), view_projection.m33 - view_projection.m32);
+
+		// Calculate near plane of frustum, it's always the first one so that lights can skip it
+		m_planes[0] = reverse_z ? plane_depth_max : plane_depth_min;
 		m_planes[0].Normalize();
 
 		// Calculate far plane of frustum.
-		m_planes[1].normal.x = view_projection.m03 - view_projection.m02;
-		m_planes[1].normal.y = view_projection.m13 - view_projection.m12;
-		m_planes[1].normal.z = view_projection.m23 - view_projection.m22;
-		m_planes[1].d = view_projection.m33 - view_projection.m32;
+		m_planes[1] = reverse_z ? plane_depth_min : plane_depth_max;
 		m_planes[1].Normalize();
 
 		// Calculate left plane of frustum.
@@ -86,37 +82,143 @@ namespace Spartan::Math
 
     bool Frustum::IsVisible(const Vector3& center, const Vector3& extent, bool ignore_near_plane /*= false*/) const
     {
-        float radius = 0.0f;
+        // The near plane is the first one
+        const uint32_t plane_first  = ignore_near_plane ? 1 : 0;
+        const float radius          = Helper::Max3(extent.x, extent.y, extent.z);
+
+        // Check sphere first as it's cheaper
+        if (CheckSphere(center, radius, plane_first) != Outside)
+            return true;
+
+        if (CheckCube(center, radius, plane_first) != Outside)
+            return true;
 
-        if (!ignore_near_plane)
+        return false;
+    }
+
+    Intersection Frustum::IsInside(const BoundingBox& box, bool ignore_near_plane /*= false*/) const
+    {
+        const Vector3 center    = box.GetCenter();
+        const Vector3 extent    = box.GetExtents();
+        Intersection result     = Inside;
+
+        // The near plane is the first one, whichever way the projection maps depth
+        for (uint32_t i = ignore_near_plane ? 1 : 0; i < 6; i++)
         {
-            radius = Helper::Max3(extent.x, extent.y, extent.z);
+            const Plane& plane  = m_planes[i];
+            const float d       = Vector3::Dot(plane.normal, center) + plane.d;
+            const float r       = Vector3::Dot(extent, plane.normal.Abs());
+
+            if (d + r < 0.0f)
+                return Outside;
+
+            if (d - r < 0.0f)
+            {
+                result = Intersects;
+            }
         }
-        else
+
+        return result;
+    }
+
+    void Frustum::CullAabbs(
+        const float* center_x, const float* center_y, const float* center_z,
+        const float* extent_x, const float* extent_y, const float* extent_z,
+        const uint32_t count,
+        uint8_t* out_visible,
+        const bool ignore_near_plane /*= false*/
+    ) const
+    {
+        // The near plane is the first one, whichever way the projection maps depth
+        const uint32_t plane_first = ignore_near_plane ? 1 : 0;
+        uint32_t i = 0;
+
+#ifdef SPARTAN_FRUSTUM_SSE
+        // Four boxes per iteration, a box is outside if it's fully behind any of the planes
+        for (; i + 4 <= count; i += 4)
         {
-            constexpr float z = numeric_limits<float>::infinity(); // reverse-z only (but I must read form Renderer)
-            radius = Helper::Max3(extent.x, extent.y, z);
+            const __m128 cx = _mm_loadu_ps(center_x + i);
+            const __m128 cy = _mm_loadu_ps(center_y + i);
+            const __m128 cz = _mm_loadu_ps(center_z + i);
+            const __m128 ex = _mm_loadu_ps(extent_x + i);
+            const __m128 ey = _mm_loadu_ps(extent_y + i);
+            const __m128 ez = _mm_loadu_ps(extent_z + i);
+            __m128 outside  = _mm_setzero_ps();
+
+            for (uint32_t p = plane_first; p < 6; p++)
+            {
+                const Plane& plane  = m_planes[p];
+                const __m128 nx     = _mm_set1_ps(plane.normal.x);
+                const __m128 ny     = _mm_set1_ps(plane.normal.y);
+                const __m128 nz     = _mm_set1_ps(plane.normal.z);
+                const __m128 nx_abs = _mm_set1_ps(Helper::Abs(plane.normal.x));
+                const __m128 ny_abs = _mm_set1_ps(Helper::Abs(plane.normal.y));
+                const __m128 nz_abs = _mm_set1_ps(Helper::Abs(plane.normal.z));
+
+                // d = dot(n, center) + plane.d, r = dot(|n|, extent), added up in the same order as the scalar path so that the results are identical
+                const __m128 d = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)), _mm_mul_ps(nz, cz)), _mm_set1_ps(plane.d));
+                const __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx_abs, ex), _mm_mul_ps(ny_abs, ey)), _mm_mul_ps(nz_abs, ez));
+
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), _mm_setzero_ps()));
+            }
+
+            const int mask = _mm_movemask_ps(outside);
+            out_visible[i + 0] = (mask & 1) ? 0 : 1;
+            out_visible[i + 1] = (mask & 2) ? 0 : 1;
+            out_visible[i + 2] = (mask & 4) ? 0 : 1;
+            out_visible[i + 3] = (mask & 8) ? 0 : 1;
         }
+#endif
 
-        // Check sphere first as it's cheaper
-        if (CheckSphere(center, radius) != Outside)
-            return true;
+        // The remainder
+        if (i < count)
+        {
+            CullAabbsScalar(center_x + i, center_y + i, center_z + i, extent_x + i, extent_y + i, extent_z + i, count - i, out_visible + i, ignore_near_plane);
+        }
+    }
 
-        if (CheckCube(center, radius) != Outside)
-            return true;
+    void Frustum::CullAabbsScalar(
+        const float* center_x, const float* center_y, const float* center_z,
+        const float* extent_x, const float* extent_y, const float* extent_z,
+        const uint32_t count,
+        uint8_t* out_visible,
+        const bool ignore_near_plane /*= false*/
+    ) const
+    {
+        // The near plane is the first one, whichever way the projection maps depth
+        const uint32_t plane_first = ignore_near_plane ? 1 : 0;
 
-        return false;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            bool outside = false;
+
+            for (uint32_t p = plane_first; p < 6; p++)
+            {
+                const Plane& plane  = m_planes[p];
+                const float d       = plane.normal.x * center_x[i] + plane.normal.y * center_y[i] + plane.normal.z * center_z[i] + plane.d;
+                const float r       = Helper::Abs(plane.normal.x) * extent_x[i] + Helper::Abs(plane.normal.y) * extent_y[i] + Helper::Abs(plane.normal.z) * extent_z[i];
+
+                if (d + r < 0.0f)
+                {
+                    outside = true;
+                    break;
+                }
+            }
+
+            out_visible[i] = outside ? 0 : 1;
+        }
     }
 
-	Intersection Frustum::CheckCube(const Vector3& center, const Vector3& extent) const
+	Intersection Frustum::CheckCube(const Vector3& center, const Vector3& extent, const uint32_t plane_first) const
 	{
         Intersection result = Inside;
         Plane plane_abs;
 
 		// Check if any one point of the cube is in the view frustum.
 		
-		for (const Plane& plane : m_planes)
+		for (uint32_t i = plane_first; i < 6; i++)
 		{
+            const Plane& plane  = m_planes[i];
             plane_abs.normal    = plane.normal.Abs();
             plane_abs.d         = plane.d;
 
@@ -141,11 +243,12 @@ namespace Spartan::Math
 		return result;
 	}
 
-	Intersection Frustum::CheckSphere(const Vector3& center, float radius) const
+	Intersection Frustum::CheckSphere(const Vector3& center, float radius, const uint32_t plane_first) const
 	{
 		// calculate our distances to each of the planes
-		for (const auto& plane : m_planes)
+		for (uint32_t i = plane_first; i < 6; i++)
 		{
+            const Plane& plane = m_planes[i];
 			// find the distance to this plane
             const float distance = Vector3::Dot(plane.normal, center) + plane.d;
 
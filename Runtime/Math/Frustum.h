@@ -25,6 +25,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../Math/Plane.h"
 #include "Matrix.h"
 #include "Vector3.h"
+#include "BoundingBox.h"
 //========================
 
 namespace Spartan::Math
@@ -33,14 +34,39 @@ namespace Spartan::Math
 	{
 	public:
         Frustum() = default;
-        Frustum(const Matrix& mView, const Matrix& mProjection, float screenDepth);
+        Frustum(const Matrix& mView, const Matrix& mProjection);
 		~Frustum() = default;
 
+        // Lights ignore the near plane so that what is behind them still casts shadows
         bool IsVisible(const Vector3& center, const Vector3& extent, bool ignore_near_plane = false) const;
 
+        // Exact box test, suitable for hierarchical culling as a box can't be visible if its parent isn't
+        Intersection IsInside(const BoundingBox& box, bool ignore_near_plane = false) const;
+
+        // Exact box test for many boxes at once, boxes are given as separate center/extent arrays (SoA)
+        // and out_visible[i] is set to 1 if box i is not outside the frustum, 0 otherwise. Ignoring the near plane keeps
+        // boxes which are behind it, with and without reverse-z, which is what the cascades of directional lights need.
+        void CullAabbs(
+            const float* center_x, const float* center_y, const float* center_z,
+            const float* extent_x, const float* extent_y, const float* extent_z,
+            uint32_t count,
+            uint8_t* out_visible,
+            bool ignore_near_plane = false
+        ) const;
+
+        // The same test, a box at a time, it's what CullAabbs() falls back to for the boxes which don't fill a group of four
+        // and what it's verified against, the results are identical as the math is done in the same order
+        void CullAabbsScalar(
+            const float* center_x, const float* center_y, const float* center_z,
+            const float* extent_x, const float* extent_y, const float* extent_z,
+            uint32_t count,
+            uint8_t* out_visible,
+            bool ignore_near_plane = false
+        ) const;
+
 	private:
-        Intersection CheckCube(const Vector3& center, const Vector3& extent) const;
-        Intersection CheckSphere(const Vector3& center, float radius) const;
+        Intersection CheckCube(const Vector3& center, const Vector3& extent, uint32_t plane_first) const;
+        Intersection CheckSphere(const Vector3& center, float radius, uint32_t plane_first) const;
 
 		Plane m_planes[6];
 	};
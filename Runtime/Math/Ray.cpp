@@ -44,17 +44,15 @@ namespace Spartan::Math
 
 	vector<RayHit> Ray::Trace(Context* context) const
 	{
-		// Find all the entities that the ray hits
+		// Find all the entities that the ray hits, the world's bvh only contains entities with a renderable
+		vector<Entity*> entities;
+		context->GetSubsystem<World>()->GetBvh().QueryRay(*this, entities);
+
 		vector<RayHit> hits;
-		const auto& entities = context->GetSubsystem<World>()->EntityGetAll();
-		for (const auto& entity : entities)
+		for (Entity* entity : entities)
 		{
-			// Make sure there entity has a renderable
-			if (!entity->HasComponent<Renderable>())
-				continue;
-
 			// Get object oriented bounding box
-			const auto& aabb = entity->GetComponent<Renderable>()->GetAabb();
+			const auto& aabb = entity->GetRenderable()->GetAabb();
 
 			// Compute hit distance
 			auto distance = HitDistance(aabb);
@@ -64,7 +62,7 @@ namespace Spartan::Math
 				continue;
 
 			hits.emplace_back(
-                entity,                             // Entity
+                entity->GetPtrShared(),             // Entity
                 m_start + distance * m_direction,   // Position
                 distance,                           // Distance
                 distance == 0.0f                    // Inside
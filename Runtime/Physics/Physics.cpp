@@ -39,6 +39,9 @@ namespace Spartan
 
 	Physics::Physics(Context* context) : ISubsystem(context)
 	{
+        // Debug drawing writes lines to the renderer
+        SetTickDependencies(Subsystem_Data_Time | Subsystem_Data_Physics, Subsystem_Data_Physics | Subsystem_Data_Transforms | Subsystem_Data_Render, false);
+
         m_broadphase        = new btDbvtBroadphase();
         m_constraint_solver = new btSequentialImpulseConstraintSolver();
 
@@ -37,6 +37,10 @@ namespace Spartan
 {
 	Profiler::Profiler(Context* context) : ISubsystem(context)
 	{
+        // Observes everything, so it ticks after anything it shares a tick group with
+        SetTickDependencies(Subsystem_Data_All, Subsystem_Data_Profiling, true);
+        m_thread_id = this_thread::get_id();
+
         m_time_blocks_read.reserve(m_time_block_capacity);
         m_time_blocks_read.resize(m_time_block_capacity);
 		m_time_blocks_write.reserve(m_time_block_capacity);
@@ -109,6 +113,7 @@ namespace Spartan
         if (m_profile)
         {
             AcquireGpuData();
+            AcquireSubsystemData();
 
             // Create a string version of the rhi metrics
             if (m_renderer->GetOptions() & Render_Debug_PerformanceMetrics)
@@ -202,7 +207,7 @@ namespace Spartan
 
     void Profiler::TimeBlockStart(const char* func_name, TimeBlock_Type type, RHI_CommandList* cmd_list /*= nullptr*/)
 	{
-		if (!m_profile)
+		if (!m_profile || this_thread::get_id() != m_thread_id)
 			return;
 
         const bool can_profile_cpu = (type == TimeBlock_Cpu) && m_profile_cpu_enabled;
@@ -223,7 +228,7 @@ namespace Spartan
 	void Profiler::TimeBlockEnd()
 	{
         // If the capacity 
-        if (m_increase_capacity)
+        if (m_increase_capacity || this_thread::get_id() != m_thread_id)
             return;
 
 		if (TimeBlock* time_block = GetLastIncompleteTimeBlock())
@@ -303,11 +308,31 @@ namespace Spartan
         }
     }
 
+    void Profiler::AcquireSubsystemData()
+    {
+        // The variable tick group is still ticking (this is part of it), so its timings are from the previous frame
+        const SubsystemGraph& graph_variable = m_context->GetGraph(TickType::Variable);
+        const SubsystemGraph& graph_smoothed = m_context->GetGraph(TickType::Smoothed);
+
+        m_time_subsystems_critical_path = graph_variable.GetTimeCriticalPathMs() + graph_smoothed.GetTimeCriticalPathMs();
+        m_time_subsystems_serial        = graph_variable.GetTimeSerialMs() + graph_smoothed.GetTimeSerialMs();
+        m_subsystems_critical_path      = graph_variable.GetCriticalPath() + " | " + graph_smoothed.GetCriticalPath();
+    }
+
     void Profiler::UpdateRhiMetricsString()
 	{
 		const auto texture_count	= m_resource_manager->GetResourceCount(ResourceType::Texture) + m_resource_manager->GetResourceCount(ResourceType::Texture2d) + m_resource_manager->GetResourceCount(ResourceType::TextureCube);
 		const auto material_count	= m_resource_manager->GetResourceCount(ResourceType::Material);
 
+        // One entry per recording thread
+        string time_cmd_recording = m_time_cmd_recording.empty() ? "N/A" : "";
+        for (uint32_t i = 0; i < static_cast<uint32_t>(m_time_cmd_recording.size()); i++)
+        {
+            char entry[32];
+            sprintf_s(entry, "%s%.2f ms", i == 0 ? "" : ", ", m_time_cmd_recording[i]);
+            time_cmd_recording += entry;
+        }
+
         static const char* text =
             // Times
             "FPS:\t\t%.2f\n"
@@ -320,6 +345,10 @@ namespace Spartan
             "CPU:\t\t%.2f\t\t%.2f\t\t%.2f\t\t%.2f\n"
             "GPU:\t%.2f\t\t%.2f\t\t%.2f\t\t%.2f\n"
             "\n"
+            // Subsystems
+            "Subsystems:\t%.2f ms critical path, %.2f ms serial\n"
+            "Critical path:\t%s\n"
+            "\n"
             // GPU
             "API:\t\t%s\n"
             "GPU:\t%s\n"
@@ -329,11 +358,15 @@ namespace Spartan
             // Renderer
             "Resolution:\t\t%dx%d\n"
             "Meshes rendered:\t%d\n"
+            "Clustered lights:\t%d (%.2f ms binning)\n"
+            "Occlusion culled:\t%d (%d occluders)\n"
+            "Shadow slices:\t\t%d rendered, %d reused\n"
             "Textures:\t\t\t%d\n"
             "Materials:\t\t%d\n"
             "\n"
             // RHI
             "Draw calls:\t\t\t\t%d\n"
+            "Instances per draw:\t\t%.2f\n"
             "Index buffer bindings:\t\t%d\n"
             "Vertex buffer bindings:\t\t%d\n"
             "Constant buffer bindings:\t%d\n"
@@ -344,10 +377,14 @@ namespace Spartan
             "Compute shader bindings:\t%d\n"
             "Render target bindings:\t%d\n"
             "Pipeline bindings:\t\t\t%d\n"
+            "Pipelines created:\t\t\t%d (%.2f ms, worst %.2f ms)\n"
             "Descriptor set bindings:\t%d\n"
-            "Pipeline barriers:\t\t\t%d";
+            "Descriptor set cache:\t\t%d hits, %d misses\n"
+            "Pipeline barriers:\t\t\t%d\n"
+            "Dynamic buffer peak:\t%d kb\n"
+            "Parallel recording:\t%s";
 
-        static char buffer[2048];
+        static char buffer[4096];
 		sprintf_s
 		(
 			buffer, text,
@@ -359,6 +396,8 @@ namespace Spartan
 			m_time_frame_avg,   m_time_frame_min,   m_time_frame_max,   m_time_frame_last,
             m_time_cpu_avg,     m_time_cpu_min,     m_time_cpu_max,     m_time_cpu_last,
             m_time_gpu_avg,     m_time_gpu_min,     m_time_gpu_max,     m_time_gpu_last,
+            m_time_subsystems_critical_path, m_time_subsystems_serial,
+            m_subsystems_critical_path.c_str(),
             m_gpu_api.c_str(),
             m_gpu_name.c_str(),
             m_gpu_memory_used, m_gpu_memory_available,
@@ -367,23 +406,31 @@ namespace Spartan
 			// Renderer
 			static_cast<int>(m_renderer->GetResolution().x), static_cast<int>(m_renderer->GetResolution().y),
 			m_renderer_meshes_rendered,
+            m_renderer_lights_clustered, m_time_light_binning,
+            m_renderer_objects_occluded, m_renderer_occluders,
+            m_renderer_shadow_slices_rendered, m_renderer_shadow_slices_reused,
 			texture_count,
 			material_count,
 
 			// RHI
-			m_rhi_draw_calls,
-			m_rhi_bindings_buffer_index,
-			m_rhi_bindings_buffer_vertex,
-			m_rhi_bindings_buffer_constant,
-			m_rhi_bindings_sampler,
-			m_rhi_bindings_texture,
-			m_rhi_bindings_shader_vertex,
-			m_rhi_bindings_shader_pixel,
-            m_rhi_bindings_shader_compute,
-			m_rhi_bindings_render_target,
-            m_rhi_bindings_pipeline,
-            m_rhi_bindings_descriptor_set,
-            m_rhi_pipeline_barriers
+			m_rhi_draw_calls.load(),
+            m_rhi_draw_calls != 0 ? static_cast<float>(m_rhi_instances) / static_cast<float>(m_rhi_draw_calls) : 0.0f,
+			m_rhi_bindings_buffer_index.load(),
+			m_rhi_bindings_buffer_vertex.load(),
+			m_rhi_bindings_buffer_constant.load(),
+			m_rhi_bindings_sampler.load(),
+			m_rhi_bindings_texture.load(),
+			m_rhi_bindings_shader_vertex.load(),
+			m_rhi_bindings_shader_pixel.load(),
+            m_rhi_bindings_shader_compute.load(),
+			m_rhi_bindings_render_target.load(),
+            m_rhi_bindings_pipeline.load(),
+            m_rhi_pipelines_created, m_time_pipeline_creation, m_time_pipeline_creation_max,
+            m_rhi_bindings_descriptor_set.load(),
+            m_rhi_descriptor_set_hits.load(), m_rhi_descriptor_set_misses.load(),
+            m_rhi_pipeline_barriers.load(),
+            m_rhi_dynamic_buffer_high_water / 1000,
+            time_cmd_recording.c_str()
 		);
 
 		m_metrics = string(buffer);
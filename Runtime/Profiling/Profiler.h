@@ -24,6 +24,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //= INCLUDES ===========================
 #include <string>
 #include <vector>
+#include <thread>
+#include <atomic>
 #include "TimeBlock.h"
 #include "../Core/ISubsystem.h"
 #include "../Core/Stopwatch.h"
@@ -76,23 +78,39 @@ namespace Spartan
         bool IsCpuStuttering()                          const { return m_is_stuttering_cpu; }
         bool IsGpuStuttering()                          const { return m_is_stuttering_gpu; }
 		
-		// Metrics - RHI
-		uint32_t m_rhi_draw_calls				= 0;
-		uint32_t m_rhi_bindings_buffer_index	= 0;
-		uint32_t m_rhi_bindings_buffer_vertex	= 0;
-		uint32_t m_rhi_bindings_buffer_constant = 0;
-		uint32_t m_rhi_bindings_sampler			= 0;
-		uint32_t m_rhi_bindings_texture			= 0;
-		uint32_t m_rhi_bindings_shader_vertex	= 0;
-		uint32_t m_rhi_bindings_shader_pixel	= 0;
-        uint32_t m_rhi_bindings_shader_compute  = 0;
-		uint32_t m_rhi_bindings_render_target	= 0;
-        uint32_t m_rhi_bindings_descriptor_set  = 0;     
-        uint32_t m_rhi_bindings_pipeline        = 0;
-        uint32_t m_rhi_pipeline_barriers        = 0;
+		// Metrics - RHI (atomic as command lists can be recorded on multiple threads)
+		std::atomic<uint32_t> m_rhi_draw_calls				    = 0;
+		std::atomic<uint32_t> m_rhi_bindings_buffer_index	    = 0;
+		std::atomic<uint32_t> m_rhi_bindings_buffer_vertex	    = 0;
+		std::atomic<uint32_t> m_rhi_bindings_buffer_constant    = 0;
+		std::atomic<uint32_t> m_rhi_bindings_sampler		    = 0;
+		std::atomic<uint32_t> m_rhi_bindings_texture		    = 0;
+		std::atomic<uint32_t> m_rhi_bindings_shader_vertex	    = 0;
+		std::atomic<uint32_t> m_rhi_bindings_shader_pixel	    = 0;
+        std::atomic<uint32_t> m_rhi_bindings_shader_compute     = 0;
+		std::atomic<uint32_t> m_rhi_bindings_render_target	    = 0;
+        std::atomic<uint32_t> m_rhi_bindings_descriptor_set     = 0;
+        std::atomic<uint32_t> m_rhi_descriptor_set_hits         = 0; // bound descriptor sets which were found in the cache
+        std::atomic<uint32_t> m_rhi_descriptor_set_misses       = 0; // bound descriptor sets which had to be allocated and written
+        std::atomic<uint32_t> m_rhi_bindings_pipeline           = 0;
+        std::atomic<uint32_t> m_rhi_pipeline_barriers           = 0;
+        std::atomic<uint32_t> m_rhi_instances                   = 0; // drawn by all draw calls, divided by them it gives the average batch size
+        uint32_t m_rhi_dynamic_buffer_high_water = 0; // bytes, not cleared every frame
+        uint32_t m_rhi_pipelines_created = 0; // the first time a pipeline state is seen, its pipeline is created on the spot
+        float m_time_pipeline_creation = 0.0f; // ms, CPU time the frame stalled on pipeline creation
+        float m_time_pipeline_creation_max = 0.0f; // ms, worst frame so far, not cleared every frame
+
+        // Metrics - Command recording, CPU time (ms) which every thread spent recording the passes that are recorded in parallel
+        std::vector<float> m_time_cmd_recording;
 
 		// Metrics - Renderer
 		uint32_t m_renderer_meshes_rendered = 0;
+        uint32_t m_renderer_lights_clustered = 0;
+        float m_time_light_binning = 0.0f; // ms, CPU time of the job which bins the lights into clusters
+        uint32_t m_renderer_occluders = 0;
+        uint32_t m_renderer_objects_occluded = 0; // visible to the camera's frustum, but hidden behind the occluders
+        uint32_t m_renderer_shadow_slices_rendered = 0;
+        uint32_t m_renderer_shadow_slices_reused = 0; // unchanged since they were last rendered, or far cascades waiting for their turn
 
 		// Metrics - Time
 		float m_time_frame_avg  = 0.0f;
@@ -123,14 +141,18 @@ namespace Spartan
             m_rhi_bindings_shader_compute   = 0;
             m_rhi_bindings_render_target    = 0;
             m_rhi_bindings_descriptor_set   = 0;
+            m_rhi_descriptor_set_hits       = 0;
+            m_rhi_descriptor_set_misses     = 0;
             m_rhi_bindings_pipeline         = 0;
             m_rhi_pipeline_barriers         = 0;
+            m_rhi_instances                 = 0;
         }
 
 		TimeBlock* GetNewTimeBlock();
 		TimeBlock* GetLastIncompleteTimeBlock(TimeBlock_Type type = TimeBlock_Undefined);
 		void ComputeFps(float delta_time);
         void AcquireGpuData();
+        void AcquireSubsystemData();
 		void UpdateRhiMetricsString();
 
 		// Profiling options
@@ -163,6 +185,15 @@ namespace Spartan
         bool m_is_stuttering_cpu    = false;
         bool m_is_stuttering_gpu    = false;
 
+        // Subsystem tick graph
+        std::string m_subsystems_critical_path  = "N/A";
+        float m_time_subsystems_critical_path   = 0.0f;
+        float m_time_subsystems_serial          = 0.0f;
+
+        // Time blocks can only be recorded by the thread which created the profiler,
+        // subsystems ticking on worker threads are timed by the subsystem graph instead.
+        std::thread::id m_thread_id;
+
 		// Misc
 		std::string m_metrics = "N/A";
 		bool m_profile = true;
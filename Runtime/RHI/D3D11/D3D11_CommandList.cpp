@@ -58,7 +58,7 @@ namespace Spartan
         m_profiler          = context->GetSubsystem<Profiler>();
         m_rhi_device        = m_renderer->GetRhiDevice().get();
         m_pipeline_cache    = m_renderer->GetPipelineCache();
-        m_descriptor_cache  = m_renderer->GetDescriptorCache();
+        m_descriptor_cache  = make_shared<RHI_DescriptorCache>(m_rhi_device, m_profiler);
         m_timestamps.fill(0);
 	}
 
@@ -395,20 +395,36 @@ namespace Spartan
     {
         m_rhi_device->GetContextRhi()->device_context->Draw(static_cast<UINT>(vertex_count), 0);
         m_profiler->m_rhi_draw_calls++;
+        m_profiler->m_rhi_instances++;
 
         return true;
 	}
 
-    bool RHI_CommandList::DrawIndexed(const uint32_t index_count, const uint32_t index_offset, const uint32_t vertex_offset)
+    bool RHI_CommandList::DrawIndexed(const uint32_t index_count, const uint32_t index_offset, const uint32_t vertex_offset, const uint32_t instance_count)
     {
-        m_rhi_device->GetContextRhi()->device_context->DrawIndexed
-        (
-            static_cast<UINT>(index_count),
-            static_cast<UINT>(index_offset),
-            static_cast<INT>(vertex_offset)
-        );
+        if (instance_count == 1)
+        {
+            m_rhi_device->GetContextRhi()->device_context->DrawIndexed
+            (
+                static_cast<UINT>(index_count),
+                static_cast<UINT>(index_offset),
+                static_cast<INT>(vertex_offset)
+            );
+        }
+        else
+        {
+            m_rhi_device->GetContextRhi()->device_context->DrawIndexedInstanced
+            (
+                static_cast<UINT>(index_count),
+                static_cast<UINT>(instance_count),
+                static_cast<UINT>(index_offset),
+                static_cast<INT>(vertex_offset),
+                0
+            );
+        }
 
         m_profiler->m_rhi_draw_calls++;
+        m_profiler->m_rhi_instances += instance_count;
 
         return true;
 	}
@@ -39,6 +39,17 @@ namespace Spartan
         d3d11_utility::release(*reinterpret_cast<ID3D11VertexShader**>(&m_resource));
 	}
 
+    const string& RHI_Shader::GetCompilerVersion()
+    {
+        #ifdef DEBUG
+        static const string version = "d3dcompiler " + to_string(D3D_COMPILER_VERSION) + " debug";
+        #else
+        static const string version = "d3dcompiler " + to_string(D3D_COMPILER_VERSION);
+        #endif
+
+        return version;
+    }
+
 	void* RHI_Shader::_Compile(const string& shader)
 	{
 		if (!m_rhi_device)
@@ -54,6 +65,11 @@ namespace Spartan
 			return nullptr;
 		}
 
+        // Load the blob from the cache, if this exact compilation has been done before
+        vector<std::byte> blob_cached;
+        if (_CacheLoad(&blob_cached))
+            return _CreateResource(blob_cached.data(), blob_cached.size(), shader);
+
 		// Compile flags
         uint32_t compile_flags = 0;
 		#ifdef DEBUG
@@ -153,40 +169,64 @@ namespace Spartan
 			}
 		}
 
-		// Create shader
+		// Create shader, saving the blob to the cache
 		void* shader_view = nullptr;
 		if (shader_blob)
 		{
-			if (m_shader_type == RHI_Shader_Vertex)
-			{
-				if (FAILED(d3d11_device->CreateVertexShader(shader_blob->GetBufferPointer(), shader_blob->GetBufferSize(), nullptr, reinterpret_cast<ID3D11VertexShader**>(&shader_view))))
-				{
-                    LOG_ERROR("Failed to create vertex shader, %s", d3d11_utility::dxgi_error_to_string(result));
-				}
-
-				// Create input layout
-                if (!m_input_layout->Create(m_vertex_type, shader_blob))
-                {
-                    LOG_ERROR("Failed to create input layout for %s", FileSystem::GetFileNameFromFilePath(m_file_path).c_str());
-                }
-			}
-			else if (m_shader_type == RHI_Shader_Pixel)
-			{
-				if (FAILED(d3d11_device->CreatePixelShader(shader_blob->GetBufferPointer(), shader_blob->GetBufferSize(), nullptr, reinterpret_cast<ID3D11PixelShader**>(&shader_view))))
-				{
-					LOG_ERROR("Failed to create pixel shader, %s", d3d11_utility::dxgi_error_to_string(result));
-				}
-			}
-            else if (m_shader_type == RHI_Shader_Compute)
-            {
-                if (FAILED(d3d11_device->CreateComputeShader(shader_blob->GetBufferPointer(), shader_blob->GetBufferSize(), nullptr, reinterpret_cast<ID3D11ComputeShader**>(&shader_view))))
-                {
-                    LOG_ERROR("Failed to create compute shader, %s", d3d11_utility::dxgi_error_to_string(result));
-                }
-            }
+            _CacheSave(shader_blob->GetBufferPointer(), static_cast<uint64_t>(shader_blob->GetBufferSize()));
+            shader_view = _CreateResource(shader_blob->GetBufferPointer(), shader_blob->GetBufferSize(), shader);
 		}
 
         d3d11_utility::release(shader_blob);
 		return shader_view;
 	}
+
+    void* RHI_Shader::_CreateResource(const void* blob, const size_t blob_size, const string& shader)
+    {
+        auto d3d11_device = m_rhi_device->GetContextRhi()->device;
+
+        // The input layout is validated against the vertex shader, which it wants as a blob
+        ID3DBlob* shader_blob = nullptr;
+        if (FAILED(D3DCreateBlob(blob_size, &shader_blob)))
+        {
+            LOG_ERROR("Failed to create shader blob");
+            return nullptr;
+        }
+        memcpy(shader_blob->GetBufferPointer(), blob, blob_size);
+
+        void* shader_view = nullptr;
+        if (m_shader_type == RHI_Shader_Vertex)
+        {
+            const auto result = d3d11_device->CreateVertexShader(blob, blob_size, nullptr, reinterpret_cast<ID3D11VertexShader**>(&shader_view));
+            if (FAILED(result))
+            {
+                LOG_ERROR("Failed to create vertex shader, %s", d3d11_utility::dxgi_error_to_string(result));
+            }
+
+            // Create input layout
+            if (!m_input_layout->Create(m_vertex_type, shader_blob))
+            {
+                LOG_ERROR("Failed to create input layout for %s", FileSystem::GetFileNameFromFilePath(shader).c_str());
+            }
+        }
+        else if (m_shader_type == RHI_Shader_Pixel)
+        {
+            const auto result = d3d11_device->CreatePixelShader(blob, blob_size, nullptr, reinterpret_cast<ID3D11PixelShader**>(&shader_view));
+            if (FAILED(result))
+            {
+                LOG_ERROR("Failed to create pixel shader, %s", d3d11_utility::dxgi_error_to_string(result));
+            }
+        }
+        else if (m_shader_type == RHI_Shader_Compute)
+        {
+            const auto result = d3d11_device->CreateComputeShader(blob, blob_size, nullptr, reinterpret_cast<ID3D11ComputeShader**>(&shader_view));
+            if (FAILED(result))
+            {
+                LOG_ERROR("Failed to create compute shader, %s", d3d11_utility::dxgi_error_to_string(result));
+            }
+        }
+
+        d3d11_utility::release(shader_blob);
+        return shader_view;
+    }
 }
@@ -36,11 +36,6 @@ namespace Spartan
 
     }
 
-    void* RHI_DescriptorSetLayout::CreateDescriptorSet(const size_t hash, const RHI_DescriptorCache* descriptor_cache)
-    {
-        return nullptr;
-    }
-
     void RHI_DescriptorSetLayout::UpdateDescriptorSet(void* descriptor_set, const vector<RHI_Descriptor>& descriptors)
     {
         
@@ -31,7 +31,7 @@ using namespace std;
 
 namespace Spartan
 {
-    RHI_Pipeline::RHI_Pipeline(const RHI_Device* rhi_device, RHI_PipelineState& pipeline_state, void* descriptor_set_layout)
+    RHI_Pipeline::RHI_Pipeline(const RHI_Device* rhi_device, RHI_PipelineState& pipeline_state, void* descriptor_set_layout, void* pipeline_cache /*= nullptr*/)
     {
 		m_rhi_device	= rhi_device;
 		m_state			= pipeline_state;
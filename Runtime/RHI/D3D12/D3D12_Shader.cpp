@@ -39,6 +39,12 @@ namespace Spartan
 		
 	}
 
+    const string& RHI_Shader::GetCompilerVersion()
+    {
+        static const string version = "d3d12";
+        return version;
+    }
+
 	void* RHI_Shader::_Compile(const string& shader)
 	{
         return nullptr;
@@ -0,0 +1,124 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+//= INCLUDES ==============
+#include <vector>
+#include <array>
+#include <mutex>
+#include "../RHI_Definition.h"
+//=========================
+
+namespace Spartan
+{
+    // Everything that would reach the GPU, the null backend records it instead of executing it
+    enum RHI_Null_Command_Type : uint32_t
+    {
+        RHI_Null_Command_BeginRenderPass,       // resource: pipeline state,    args: width, height
+        RHI_Null_Command_EndRenderPass,         // resource: pipeline state
+        RHI_Null_Command_Clear,                 // resource: pipeline state
+        RHI_Null_Command_Draw,                  // args: vertex count
+        RHI_Null_Command_DrawIndexed,           // args: index count, index offset, vertex offset, instance count
+        RHI_Null_Command_Dispatch,              // args: x, y, z
+        RHI_Null_Command_SetViewport,           // args: width, height
+        RHI_Null_Command_SetScissor,            // args: width, height
+        RHI_Null_Command_BindPipeline,          // resource: pipeline
+        RHI_Null_Command_BindDescriptorSet,     // resource: descriptor set,    args: dynamic offset count
+        RHI_Null_Command_BindVertexBuffer,      // resource: vertex buffer,     offset
+        RHI_Null_Command_BindIndexBuffer,       // resource: index buffer,      offset
+        RHI_Null_Command_BindConstantBuffer,    // resource: constant buffer,   args: slot, scope,  offset
+        RHI_Null_Command_BindSampler,           // resource: sampler,           args: slot
+        RHI_Null_Command_BindTexture,           // resource: texture,           args: slot, scope
+        RHI_Null_Command_Barrier,               // resource: texture/swapchain, args: layout old, layout new
+        RHI_Null_Command_BufferUpdate,          // resource: buffer,            args: size,         offset
+        RHI_Null_Command_Undefined
+    };
+
+    struct RHI_Null_Command
+    {
+        RHI_Null_Command() = default;
+        RHI_Null_Command(const RHI_Null_Command_Type type, const void* resource = nullptr, const uint32_t arg_0 = 0, const uint32_t arg_1 = 0, const uint32_t arg_2 = 0, const uint64_t offset = 0, const uint32_t arg_3 = 0)
+        {
+            this->type      = type;
+            this->resource  = resource;
+            this->args      = { arg_0, arg_1, arg_2, arg_3 };
+            this->offset    = offset;
+        }
+
+        RHI_Null_Command_Type type      = RHI_Null_Command_Undefined;
+        const void* resource            = nullptr;
+        std::array<uint32_t, 4> args    = { 0, 0, 0, 0 };
+        uint64_t offset                 = 0;
+    };
+
+    // What a command list records into, it stands in for the native command buffer
+    using RHI_Null_CommandBuffer = std::vector<RHI_Null_Command>;
+
+    // Accumulates the command buffers which are submitted during a frame, once the frame is presented
+    // it can be inspected (e.g. to assert the exact amount of draws and binds a scene produces)
+    class RHI_Null_CommandStream
+    {
+    public:
+        void Submit(const RHI_Null_CommandBuffer& cmd_buffer)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_commands.insert(m_commands.end(), cmd_buffer.begin(), cmd_buffer.end());
+        }
+
+        // For commands which don't go through a command list, like buffer updates
+        void Record(const RHI_Null_Command& command)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_commands.emplace_back(command);
+        }
+
+        void Present()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_commands_presented.swap(m_commands);
+            m_commands.clear();
+            m_frame_count++;
+        }
+
+        // The commands of the last presented frame
+        const std::vector<RHI_Null_Command>& GetCommands() const { return m_commands_presented; }
+
+        uint32_t GetCommandCount(const RHI_Null_Command_Type type) const
+        {
+            uint32_t count = 0;
+            for (const RHI_Null_Command& command : m_commands_presented)
+            {
+                count += command.type == type ? 1 : 0;
+            }
+
+            return count;
+        }
+
+        uint64_t GetFrameCount() const { return m_frame_count; }
+
+    private:
+        std::vector<RHI_Null_Command> m_commands;
+        std::vector<RHI_Null_Command> m_commands_presented;
+        uint64_t m_frame_count = 0;
+        std::mutex m_mutex;
+    };
+}
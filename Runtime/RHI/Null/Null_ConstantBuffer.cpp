@@ -0,0 +1,102 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES =====================
+#include "Spartan.h"
+#include "../RHI_Implementation.h"
+#include "../RHI_ConstantBuffer.h"
+#include "../RHI_Device.h"
+//================================
+
+//= NAMESPACES =====
+using namespace std;
+//==================
+
+namespace Spartan
+{
+    void RHI_ConstantBuffer::_destroy()
+    {
+        m_mapped = nullptr;
+
+        if (m_buffer)
+        {
+            delete[] static_cast<uint8_t*>(m_buffer);
+            m_buffer = nullptr;
+        }
+    }
+
+    RHI_ConstantBuffer::RHI_ConstantBuffer(const std::shared_ptr<RHI_Device>& rhi_device, const string& name, bool is_dynamic /*= false*/)
+    {
+        m_rhi_device    = rhi_device;
+        m_name          = name;
+        m_is_dynamic    = is_dynamic;
+    }
+
+	bool RHI_ConstantBuffer::_create()
+	{
+		if (!m_rhi_device || !m_rhi_device->IsInitialized())
+		{
+			LOG_ERROR_INVALID_PARAMETER();
+			return false;
+		}
+
+        // Destroy previous buffer
+        _destroy();
+
+        // System memory stands in for device memory
+        m_buffer = static_cast<void*>(new uint8_t[m_size_gpu]);
+
+		return true;
+	}
+
+	void* RHI_ConstantBuffer::Map()
+    {
+        if (!m_buffer)
+        {
+            LOG_ERROR("Invalid buffer");
+            return nullptr;
+        }
+
+        m_mapped = m_buffer;
+
+        return m_mapped;
+	}
+
+	bool RHI_ConstantBuffer::Unmap(const uint64_t offset /*= 0*/, const uint64_t size /*= 0*/)
+	{
+        if (!m_buffer)
+        {
+            LOG_ERROR("Invalid buffer");
+            return false;
+        }
+
+        // Record the update, this is where the other APIs flush (or unmap) the memory
+        const uint64_t size_updated = size != 0 ? size : m_size_gpu;
+        m_rhi_device->GetContextRhi()->command_stream.Record(RHI_Null_Command(RHI_Null_Command_BufferUpdate, this, static_cast<uint32_t>(size_updated), 0, 0, offset));
+
+        if (!m_persistent_mapping)
+        {
+            m_mapped = nullptr;
+        }
+
+		return true;
+	}
+}
@@ -0,0 +1,86 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES ======================
+#include "Spartan.h"
+#include "../RHI_Implementation.h"
+#include "../RHI_DescriptorCache.h"
+#include "../RHI_Device.h"
+//=================================
+
+namespace Spartan
+{
+    // A pool only keeps count, a descriptor set is nothing but an identity
+    struct RHI_Null_DescriptorPool
+    {
+        uint32_t capacity   = 0;
+        uint32_t allocated  = 0;
+    };
+
+    RHI_DescriptorCache::~RHI_DescriptorCache()
+    {
+        for (const DescriptorSet& descriptor_set : m_descriptor_sets)
+        {
+            delete static_cast<uint8_t*>(descriptor_set.resource);
+        }
+        m_descriptor_sets.clear();
+        m_descriptor_set_lookup.clear();
+
+        for (void*& descriptor_pool : m_descriptor_pools)
+        {
+            delete static_cast<RHI_Null_DescriptorPool*>(descriptor_pool);
+        }
+        m_descriptor_pools.clear();
+    }
+
+    bool RHI_DescriptorCache::CreateDescriptorPool(uint32_t descriptor_set_capacity)
+    {
+        if (!m_rhi_device || !m_rhi_device->GetContextRhi())
+        {
+            LOG_ERROR_INVALID_INTERNALS();
+            return false;
+        }
+
+        RHI_Null_DescriptorPool* descriptor_pool = new RHI_Null_DescriptorPool();
+        descriptor_pool->capacity = descriptor_set_capacity;
+
+        m_descriptor_pools.emplace_back(static_cast<void*>(descriptor_pool));
+        m_descriptor_set_capacity += descriptor_set_capacity;
+
+        return true;
+    }
+
+    void* RHI_DescriptorCache::AllocateDescriptorSet(void* descriptor_pool, void* descriptor_set_layout)
+    {
+        RHI_Null_DescriptorPool* pool = static_cast<RHI_Null_DescriptorPool*>(descriptor_pool);
+        if (pool->allocated == pool->capacity)
+            return nullptr;
+
+        pool->allocated++;
+        return static_cast<void*>(new uint8_t());
+    }
+
+    void RHI_DescriptorCache::FreeDescriptorSet(void* descriptor_pool, void* descriptor_set)
+    {
+        static_cast<RHI_Null_DescriptorPool*>(descriptor_pool)->allocated--;
+        delete static_cast<uint8_t*>(descriptor_set);
+    }
+}
@@ -0,0 +1,66 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES =====================
+#include "Spartan.h"
+#include "../RHI_Implementation.h"
+#include "../RHI_PipelineState.h"
+#include "../RHI_SwapChain.h"
+//================================
+
+namespace Spartan
+{
+    void* RHI_PipelineState::GetFrameBuffer() const
+    {
+        // If this is a swapchain, return the appropriate buffer
+        if (render_target_swapchain)
+        {
+            if (render_target_swapchain->GetImageIndex() >= state_max_render_target_count)
+            {
+                LOG_ERROR("Invalid image index, %d", render_target_swapchain->GetImageIndex());
+                return nullptr;
+            }
+
+            return m_frame_buffers[render_target_swapchain->GetImageIndex()];
+        }
+
+        // If this is a render texture, return the first buffer 
+        return m_frame_buffers[0];
+    }
+
+    bool RHI_PipelineState::CreateFrameResources(const RHI_Device* rhi_device)
+    {
+        m_rhi_device = rhi_device;
+
+        // There are no render passes or frame buffers to create, but the command list
+        // validates them before beginning a render pass, so give them a unique handle.
+        m_render_pass = static_cast<void*>(this);
+        m_frame_buffers.fill(static_cast<void*>(this));
+
+        return true;
+    }
+
+    void RHI_PipelineState::DestroyFrameResources()
+    {
+        m_render_pass = nullptr;
+        m_frame_buffers.fill(nullptr);
+    }
+}
@@ -0,0 +1,173 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES ========================
+#include "Spartan.h"
+#include "../RHI_Implementation.h"
+#include "../RHI_SwapChain.h"
+#include "../RHI_Device.h"
+#include "../RHI_CommandList.h"
+//===================================
+
+//= NAMESPACES ================
+using namespace std;
+using namespace Spartan::Math;
+//=============================
+
+namespace Spartan
+{
+	RHI_SwapChain::RHI_SwapChain(
+		void* window_handle,
+        const shared_ptr<RHI_Device>& rhi_device,
+		const uint32_t width,
+		const uint32_t height,
+		const RHI_Format format	    /*= Format_R8G8B8A8_UNORM*/,	
+		const uint32_t buffer_count	/*= 2 */,
+        const uint32_t flags	    /*= Present_Immediate */
+	)
+	{
+        // Validate device
+        if (!rhi_device || !rhi_device->IsInitialized())
+        {
+            LOG_ERROR("Invalid device.");
+            return;
+        }
+
+        // Validate resolution
+        if (!rhi_device->ValidateResolution(width, height))
+        {
+            LOG_WARNING("%dx%d is an invalid resolution", width, height);
+            return;
+        }
+
+        // Validate buffer count
+        if (buffer_count == 0 || buffer_count > state_max_render_target_count)
+        {
+            LOG_ERROR_INVALID_PARAMETER();
+            return;
+        }
+
+        // Copy parameters, the window handle is optional since nothing is ever displayed
+        m_format        = format;
+        m_rhi_device    = rhi_device.get();
+        m_buffer_count  = buffer_count;
+        m_width         = width;
+        m_height        = height;
+        m_window_handle = window_handle;
+        m_flags         = flags;
+
+        // The images only have to be unique
+        m_swap_chain_view = static_cast<void*>(this);
+        for (uint32_t i = 0; i < m_buffer_count; i++)
+        {
+            m_resource[i]       = static_cast<void*>(&m_resource[i]);
+            m_resource_view[i]  = m_resource[i];
+        }
+
+        // Create command lists
+        for (uint32_t i = 0; i < m_buffer_count; i++)
+        {
+            m_cmd_lists.emplace_back(make_shared<RHI_CommandList>(i, this, rhi_device->GetContext()));
+        }
+
+        m_initialized = true;
+
+        AcquireNextImage();
+	}
+
+	RHI_SwapChain::~RHI_SwapChain()
+	{
+        // Command buffers
+		m_cmd_lists.clear();
+	}
+
+	bool RHI_SwapChain::Resize(const uint32_t width, const uint32_t height, const bool force /*= false*/)
+	{
+        // Validate resolution
+        m_present = m_rhi_device->ValidateResolution(width, height);
+        if (!m_present)
+        {
+            // Return true as when minimizing, a resolution
+            // of 0,0 can be passed in, and this is fine.
+            return true;
+        }
+
+        // There are no images to re-create, only the dimensions change
+        m_width     = width;
+        m_height    = height;
+
+		return true;
+	}
+
+    bool RHI_SwapChain::AcquireNextImage()
+    {
+        if (!m_present)
+            return true;
+
+        // Images are handed out in order, like a swap chain which never blocks would
+        bool first_run      = !m_image_acquired;
+        m_image_index       = first_run ? 0 : (m_image_index + 1) % m_buffer_count;
+        m_cmd_index         = m_image_index;
+        m_image_acquired    = true;
+
+        return true;
+    }
+
+	bool RHI_SwapChain::Present()
+    {
+        if (!m_present)
+            return true;
+
+        if (!m_image_acquired)
+        {
+            LOG_ERROR("Image has not been acquired");
+            return false;
+        }
+
+        if (!m_rhi_device->Queue_Present(m_swap_chain_view, &m_image_index, GetCmdList()->GetProcessedSemaphore()))
+        {
+            LOG_ERROR("Failed to present");
+            return false;
+        }
+
+        if (!AcquireNextImage())
+            return false;
+
+		return true;
+	}
+
+    void RHI_SwapChain::SetLayout(RHI_Image_Layout layout, RHI_CommandList* command_list /*= nullptr*/)
+    {
+        if (m_layout == layout)
+            return;
+
+        if (command_list)
+        {
+            RHI_Null_CommandBuffer* cmd_buffer = static_cast<RHI_Null_CommandBuffer*>(command_list->GetResource_CommandBuffer());
+            for (uint32_t i = 0; i < m_buffer_count; i++)
+            {
+                cmd_buffer->emplace_back(RHI_Null_Command_Barrier, m_resource[i], static_cast<uint32_t>(m_layout), static_cast<uint32_t>(layout));
+            }
+        }
+
+        m_layout = layout;
+    }
+}
@@ -0,0 +1,132 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES =====================
+#include "Spartan.h"
+#include "../RHI_Implementation.h"
+#include "../RHI_Texture2D.h"
+#include "../RHI_TextureCube.h"
+#include "../RHI_CommandList.h"
+#include "../../Profiling/Profiler.h"
+//================================
+
+//= NAMESPACES ===============
+using namespace std;
+using namespace Spartan::Math;
+//============================
+
+namespace Spartan
+{
+    // There is no image memory, the resource and its views point back to the texture, which
+    // keeps them unique and lets recorded commands be traced back to the texture they refer to.
+    inline void create_views(RHI_Texture* texture, void*& resource, void* (&resource_view)[2], array<void*, state_max_render_target_count>& views_render_target, array<void*, state_max_render_target_count>& views_depth_stencil)
+    {
+        resource = static_cast<void*>(texture);
+
+        if (texture->IsSampled())
+        {
+            resource_view[0] = resource;
+
+            if (texture->IsStencilFormat())
+            {
+                resource_view[1] = resource;
+            }
+        }
+
+        for (uint32_t i = 0; i < texture->GetArraySize(); i++)
+        {
+            if (texture->IsRenderTargetColor())
+            {
+                views_render_target[i] = resource;
+            }
+
+            if (texture->IsRenderTargetDepthStencil())
+            {
+                views_depth_stencil[i] = resource;
+            }
+        }
+    }
+
+    inline RHI_Image_Layout get_initial_layout(const RHI_Texture* texture)
+    {
+        RHI_Image_Layout layout = RHI_Image_Preinitialized;
+
+        if (texture->IsSampled() && texture->IsColorFormat())
+            layout = RHI_Image_Shader_Read_Only_Optimal;
+
+        if (texture->IsRenderTargetColor())
+            layout = RHI_Image_Color_Attachment_Optimal;
+
+        if (texture->IsRenderTargetDepthStencil())
+            layout = RHI_Image_Depth_Stencil_Attachment_Optimal;
+
+        return layout;
+    }
+
+    RHI_Texture2D::~RHI_Texture2D()
+    {
+        m_data.clear();
+    }
+
+    void RHI_Texture::SetLayout(const RHI_Image_Layout new_layout, RHI_CommandList* command_list /*= nullptr*/)
+    {
+        // The texture is most likely still initialising
+        if (m_layout == RHI_Image_Undefined)
+            return;
+
+        if (m_layout == new_layout)
+            return;
+
+        // If a command list is provided, this means we should insert a pipeline barrier
+        if (command_list)
+        {
+            RHI_Null_CommandBuffer* cmd_buffer = static_cast<RHI_Null_CommandBuffer*>(command_list->GetResource_CommandBuffer());
+            cmd_buffer->emplace_back(RHI_Null_Command_Barrier, this, static_cast<uint32_t>(m_layout), static_cast<uint32_t>(new_layout));
+
+            m_context->GetSubsystem<Profiler>()->m_rhi_pipeline_barriers++;
+        }
+
+        m_layout = new_layout;
+    }
+
+	bool RHI_Texture2D::CreateResourceGpu()
+	{
+        create_views(this, m_resource, m_resource_view, m_resource_view_renderTarget, m_resource_view_depthStencil);
+        m_layout = get_initial_layout(this);
+
+        return true;
+	}
+
+	// TEXTURE CUBE
+
+    RHI_TextureCube::~RHI_TextureCube()
+    {
+        m_data.clear();
+    }
+
+	bool RHI_TextureCube::CreateResourceGpu()
+	{
+        create_views(this, m_resource, m_resource_view, m_resource_view_renderTarget, m_resource_view_depthStencil);
+        m_layout = get_initial_layout(this);
+
+        return true;
+	}
+}
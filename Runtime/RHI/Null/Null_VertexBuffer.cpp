@@ -0,0 +1,118 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES =====================
+#include "Spartan.h"
+#include "../RHI_Implementation.h"
+#include "../RHI_Device.h"
+#include "../RHI_VertexBuffer.h"
+//================================
+
+//= NAMESPACES =====
+using namespace std;
+//==================
+
+namespace Spartan
+{
+    void RHI_VertexBuffer::_destroy()
+    {
+        m_mapped = nullptr;
+
+        if (m_buffer)
+        {
+            delete[] static_cast<uint8_t*>(m_buffer);
+            m_buffer = nullptr;
+        }
+    }
+
+	bool RHI_VertexBuffer::_create(const void* vertices)
+	{
+		if (!m_rhi_device || !m_rhi_device->IsInitialized())
+		{
+			LOG_ERROR_INVALID_INTERNALS();
+			return false;
+		}
+
+        // Destroy previous buffer
+        _destroy();
+
+        // System memory stands in for device memory
+        m_buffer = static_cast<void*>(new uint8_t[m_size_gpu]);
+
+        // Like the other APIs, a buffer which is created with initial data lives in device
+        // local memory and can't be mapped, this way the same usage errors surface here.
+        if (vertices)
+        {
+            memcpy(m_buffer, vertices, m_size_gpu);
+            m_is_mappable = false;
+        }
+        else
+        {
+            m_is_mappable = true;
+        }
+
+		return true;
+	}
+
+	void* RHI_VertexBuffer::Map()
+	{
+        if (!m_is_mappable)
+        {
+            LOG_ERROR("Not mappable, can only be updated via staging");
+            return nullptr;
+        }
+
+        if (!m_buffer)
+        {
+            LOG_ERROR("Invalid buffer");
+            return nullptr;
+        }
+
+        m_mapped = m_buffer;
+
+        return m_mapped;
+	}
+
+	bool RHI_VertexBuffer::Unmap()
+	{
+        if (!m_is_mappable)
+        {
+            LOG_ERROR("Not mappable, can only be updated via staging");
+            return false;
+        }
+
+        if (!m_buffer)
+        {
+            LOG_ERROR("Invalid buffer");
+            return false;
+        }
+
+        // Record the update, this is where the other APIs flush (or unmap) the memory
+        m_rhi_device->GetContextRhi()->command_stream.Record(RHI_Null_Command(RHI_Null_Command_BufferUpdate, this, static_cast<uint32_t>(m_size_gpu)));
+
+        if (!m_persistent_mapping)
+        {
+            m_mapped = nullptr;
+        }
+
+		return true;
+	}
+}
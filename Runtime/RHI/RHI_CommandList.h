@@ -47,6 +47,8 @@ namespace Spartan
         RHI_Cmd_List_Pending
     };
 
+    // Every command list owns its command pool and descriptor cache, so different command lists can be recorded on different threads
+    // (where the API allows it, see RHI_Context::parallel_recording). Command lists without a swapchain don't emit profiler time blocks.
 	class SPARTAN_CLASS RHI_CommandList : public Spartan_Object
 	{
 	public:
@@ -99,7 +101,7 @@ namespace Spartan
 
 		// Draw/Dispatch
         bool Draw(uint32_t vertex_count);
-		bool DrawIndexed(uint32_t index_count, uint32_t index_offset = 0, uint32_t vertex_offset = 0);
+		bool DrawIndexed(uint32_t index_count, uint32_t index_offset = 0, uint32_t vertex_offset = 0, uint32_t instance_count = 1);
         void Dispatch(uint32_t x, uint32_t y, uint32_t z = 1) const;
 
 		// Viewport
@@ -156,10 +158,11 @@ namespace Spartan
         RHI_SwapChain* m_swap_chain                 = nullptr;
         Renderer* m_renderer                        = nullptr;
         RHI_PipelineCache* m_pipeline_cache         = nullptr;
-        RHI_DescriptorCache* m_descriptor_cache     = nullptr;
+        std::shared_ptr<RHI_DescriptorCache> m_descriptor_cache;
         RHI_PipelineState* m_pipeline_state         = nullptr;
         RHI_Device* m_rhi_device                    = nullptr;
         Profiler* m_profiler                        = nullptr;
+        void* m_cmd_pool                            = nullptr;
         void* m_cmd_buffer                          = nullptr;
         void* m_processed_fence                     = nullptr;
         void* m_processed_semaphore                 = nullptr;
@@ -167,6 +170,7 @@ namespace Spartan
         bool m_render_pass_active                   = false;
         bool m_pipeline_active                      = false;
         bool m_flushed                              = false;
+        uint64_t m_frame_index_submitted            = 0; // the device frame during which the last submission was made
         static bool memory_query_support;
         std::mutex m_mutex_reset;
 
@@ -0,0 +1,77 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES =====================
+#include "Spartan.h"
+#include "RHI_ConstantBuffer.h"
+//================================
+
+//= NAMESPACES =====
+using namespace std;
+//==================
+
+namespace Spartan
+{
+    void RHI_ConstantBuffer::BeginFrame(const uint32_t frame_index)
+    {
+        m_frame_index           = frame_index % m_frame_count;
+        m_frame_offset_index    = 0;
+    }
+
+    void* RHI_ConstantBuffer::Allocate()
+    {
+        if (!m_is_dynamic)
+        {
+            LOG_ERROR("%s is not a dynamic buffer", m_name.c_str());
+            return nullptr;
+        }
+
+        // If the region of this frame is exhausted, grow instead of flushing. Commands which were already recorded
+        // reference the current buffer, the backend defers its release until they have completed (see _destroy()).
+        if (m_frame_offset_index >= m_offset_count)
+        {
+            m_offset_count  = Math::Helper::NextPowerOfTwo(m_offset_count + 1);
+            m_size_gpu      = static_cast<uint64_t>(m_stride) * m_offset_count * m_frame_count;
+
+            if (!_create())
+            {
+                LOG_ERROR("Failed to re-allocate %s buffer with %d offsets", m_name.c_str(), m_offset_count);
+                return nullptr;
+            }
+
+            LOG_INFO("Increased %s buffer size to %d offsets per frame, that's %d kb", m_name.c_str(), m_offset_count, static_cast<uint32_t>(m_size_gpu / 1000));
+        }
+
+        // Persistently mapped, so this only maps once
+        std::byte* mapped = static_cast<std::byte*>(Map());
+        if (!mapped)
+        {
+            LOG_ERROR("Failed to map buffer");
+            return nullptr;
+        }
+
+        m_offset_dynamic_index  = m_frame_index * m_offset_count + m_frame_offset_index;
+        m_frame_offset_index++;
+        m_high_water_mark       = Math::Helper::Max(m_high_water_mark, m_frame_offset_index);
+
+        return mapped + GetOffsetDynamic();
+    }
+}
@@ -35,11 +35,12 @@ namespace Spartan
         ~RHI_ConstantBuffer() { _destroy(); }
 
 		template<typename T>
-		bool Create(const uint32_t offset_count = 1)
+		bool Create(const uint32_t offset_count = 1, const uint32_t frame_count = 1)
 		{
             m_stride        = static_cast<uint32_t>(sizeof(T));
             m_offset_count  = offset_count;
-            m_size_gpu      = static_cast<uint64_t>(m_stride * m_offset_count);
+            m_frame_count   = frame_count;
+            m_size_gpu      = static_cast<uint64_t>(m_stride * m_offset_count * m_frame_count);
 
             return _create();
 		}
@@ -47,9 +48,17 @@ namespace Spartan
 		void* Map();  
 		bool Unmap(const uint64_t offset = 0, const uint64_t size = 0);
 
+        // Ring allocation - Dynamic buffers are split into one region per frame in flight, and every region is a linear allocator.
+        // When a region runs out, the buffer grows into a new allocation and the old one is released once the frames in flight are done with it.
+        void BeginFrame(const uint32_t frame_index);
+        void* Allocate();
+        uint32_t GetAllocationCount()   const { return m_frame_offset_index; }
+        uint32_t GetHighWaterMark()     const { return m_high_water_mark; } // most allocations made in a single frame
+
 		void* GetResource()         const { return m_buffer; }
         uint32_t GetStride()        const { return m_stride; }
-        uint32_t GetOffsetCount()   const { return m_offset_count; }
+        uint32_t GetOffsetCount()   const { return m_offset_count; } // per frame
+        uint32_t GetFrameCount()    const { return m_frame_count; }
 
         // Static offset - The kind of offset that is used when updating the buffer.
         uint32_t GetOffset()                                const { return m_offset_index * m_stride; }
@@ -74,6 +83,12 @@ namespace Spartan
         uint32_t m_offset_index         = 0;
         uint32_t m_offset_dynamic_index = 0;
 
+        // Ring allocation
+        uint32_t m_frame_count          = 1;
+        uint32_t m_frame_index          = 0;
+        uint32_t m_frame_offset_index   = 0;
+        uint32_t m_high_water_mark      = 0;
+
 		// API
 		void* m_buffer      = nullptr;
         void* m_allocation  = nullptr;
@@ -34,6 +34,7 @@ namespace Spartan
 	class RHI_CommandList;
 	class RHI_PipelineState;
 	class RHI_PipelineCache;
+	class RHI_ShaderCache;
 	class RHI_Pipeline;
     class RHI_DescriptorSetLayout;
     class RHI_DescriptorCache;
@@ -70,7 +71,8 @@ namespace Spartan
     {
         RHI_Api_D3d11,
         RHI_Api_D3d12,
-        RHI_Api_Vulkan
+        RHI_Api_Vulkan,
+        RHI_Api_Null
     };
 
 	enum RHI_Present_Mode : uint32_t
@@ -275,6 +277,7 @@ namespace Spartan
         RHI_Descriptor_Type type    = RHI_Descriptor_Undefined;
         RHI_Image_Layout layout     = RHI_Image_Undefined;
         void* resource              = nullptr;
+        uint32_t id                 = 0; // of the object which owns the resource, unlike API handles ids are never reused
     };
 
     inline const char* rhi_format_to_string(const RHI_Format result)
@@ -30,6 +30,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "RHI_Implementation.h"
 #include "RHI_DescriptorSetLayout.h"
 #include "..\Utilities\Hash.h"
+#include "..\Profiling\Profiler.h"
 //==================================
 
 //= NAMESPACES =====
@@ -38,12 +39,13 @@ using namespace std;
 
 namespace Spartan
 {
-    RHI_DescriptorCache::RHI_DescriptorCache(const RHI_Device* rhi_device)
+    RHI_DescriptorCache::RHI_DescriptorCache(const RHI_Device* rhi_device, Profiler* profiler /*= nullptr*/)
     {
-        m_rhi_device = rhi_device;
+        m_rhi_device    = rhi_device;
+        m_profiler      = profiler;
 
-        // Set the descriptor set capacity to an initial value
-        SetDescriptorSetCapacity(m_descriptor_set_capacity);
+        // Start with a small pool, more are added as needed
+        CreateDescriptorPool(16);
     }
 
     void RHI_DescriptorCache::SetPipelineState(RHI_PipelineState& pipeline_state)
@@ -140,40 +142,89 @@ namespace Spartan
         if (!m_descriptor_layout_current)
         {
             LOG_ERROR("Invalid descriptor set layout");
-            return nullptr;
+            return false;
         }
 
         return m_descriptor_layout_current->GetResource_DescriptorSet(this, descriptor_set);
     }
 
-    bool RHI_DescriptorCache::HasEnoughCapacity() const
+    void* RHI_DescriptorCache::GetDescriptorSet(const size_t hash)
     {
-        return m_descriptor_set_capacity > GetDescriptorSetCount();
-    }
+        auto it = m_descriptor_set_lookup.find(hash);
+        if (it == m_descriptor_set_lookup.end())
+        {
+            if (m_profiler)
+            {
+                m_profiler->m_rhi_descriptor_set_misses++;
+            }
 
-    void RHI_DescriptorCache::GrowIfNeeded()
-    {
-        // If there is room for at least one more descriptor set (hence +1), we don't need to re-allocate yet
-        const uint32_t required_capacity = GetDescriptorSetCount() + 1;
+            return nullptr;
+        }
 
-        // If we are over-budget, re-allocate the descriptor pool with double size
-        if (required_capacity > m_descriptor_set_capacity)
+        // Mark as the most recently used
+        it->second->recording_index = m_recording_index;
+        m_descriptor_sets.splice(m_descriptor_sets.begin(), m_descriptor_sets, it->second);
+
+        if (m_profiler)
         {
-            m_descriptor_set_capacity *= 2;
-            SetDescriptorSetCapacity(m_descriptor_set_capacity);
-            LOG_INFO("Capacity has been increased to %d elements", m_descriptor_set_capacity);
+            m_profiler->m_rhi_descriptor_set_hits++;
         }
+
+        return it->second->resource;
     }
 
-    uint32_t RHI_DescriptorCache::GetDescriptorSetCount() const
+    void* RHI_DescriptorCache::CreateDescriptorSet(const size_t hash, void* descriptor_set_layout)
     {
-        uint32_t descriptor_set_count = 0;
-        for (const auto& it : m_descriptor_set_layouts)
+        // When full, make room by evicting
+        if (m_descriptor_sets.size() >= m_descriptor_set_capacity)
+        {
+            EvictDescriptorSet();
+        }
+
+        // Allocate from any pool with room left, the newest is the most likely to have it
+        void* descriptor_set  = nullptr;
+        void* descriptor_pool = nullptr;
+        for (auto it = m_descriptor_pools.rbegin(); it != m_descriptor_pools.rend() && !descriptor_set; it++)
         {
-            descriptor_set_count += it.second->GetDescriptorSetCount();
+            descriptor_pool = *it;
+            descriptor_set  = AllocateDescriptorSet(descriptor_pool, descriptor_set_layout);
+        }
+
+        // Every descriptor set is referenced by the current recording (or the pools are fragmented), so add a pool instead of waiting for the GPU
+        if (!descriptor_set)
+        {
+            if (!CreateDescriptorPool(m_descriptor_set_capacity))
+                return nullptr;
+
+            descriptor_pool = m_descriptor_pools.back();
+            descriptor_set  = AllocateDescriptorSet(descriptor_pool, descriptor_set_layout);
+            if (!descriptor_set)
+                return nullptr;
+
+            LOG_INFO("Capacity has been increased to %d descriptor sets", m_descriptor_set_capacity);
         }
 
-        return descriptor_set_count;
+        m_descriptor_sets.push_front({ hash, descriptor_set, descriptor_pool, m_recording_index });
+        m_descriptor_set_lookup[hash] = m_descriptor_sets.begin();
+
+        return descriptor_set;
+    }
+
+    bool RHI_DescriptorCache::EvictDescriptorSet()
+    {
+        if (m_descriptor_sets.empty())
+            return false;
+
+        // The least recently used descriptor set can only be freed if the GPU is done with it, which is everything not used by the current recording
+        const DescriptorSet& descriptor_set = m_descriptor_sets.back();
+        if (descriptor_set.recording_index == m_recording_index)
+            return false;
+
+        FreeDescriptorSet(descriptor_set.pool, descriptor_set.resource);
+        m_descriptor_set_lookup.erase(descriptor_set.hash);
+        m_descriptor_sets.pop_back();
+
+        return true;
     }
 
     vector<RHI_Descriptor> RHI_DescriptorCache::GenerateDescriptors(RHI_PipelineState& pipeline_state)
@@ -225,31 +276,18 @@ namespace Spartan
         }
 
         // Change constant buffers to dynamic (if requested) - This is a hack and not flexible, must improve
+        for (const int dynamic_slot : { pipeline_state.dynamic_constant_buffer_slot, pipeline_state.dynamic_constant_buffer_slot_2, pipeline_state.dynamic_constant_buffer_slot_3 })
         {
-            if (pipeline_state.dynamic_constant_buffer_slot != -1)
-            {
-                for (RHI_Descriptor& descriptor : descriptors)
-                {
-                    if (descriptor.type == RHI_Descriptor_ConstantBuffer)
-                    {
-                        if (descriptor.slot == pipeline_state.dynamic_constant_buffer_slot + m_rhi_device->GetContextRhi()->shader_shift_buffer)
-                        {
-                            descriptor.type = RHI_Descriptor_ConstantBufferDynamic;
-                        }
-                    }
-                }
-            }
+            if (dynamic_slot == -1)
+                continue;
 
-            if (pipeline_state.dynamic_constant_buffer_slot_2 != -1)
+            for (RHI_Descriptor& descriptor : descriptors)
             {
-                for (RHI_Descriptor& descriptor : descriptors)
+                if (descriptor.type == RHI_Descriptor_ConstantBuffer)
                 {
-                    if (descriptor.type == RHI_Descriptor_ConstantBuffer)
+                    if (descriptor.slot == dynamic_slot + m_rhi_device->GetContextRhi()->shader_shift_buffer)
                     {
-                        if (descriptor.slot == pipeline_state.dynamic_constant_buffer_slot_2 + m_rhi_device->GetContextRhi()->shader_shift_buffer)
-                        {
-                            descriptor.type = RHI_Descriptor_ConstantBufferDynamic;
-                        }
+                        descriptor.type = RHI_Descriptor_ConstantBufferDynamic;
                     }
                 }
             }
@@ -27,14 +27,20 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <unordered_map>
 #include <vector>
 #include <memory>
+#include <list>
 //=================================
 
 namespace Spartan
 {
+    class Profiler;
+
+    // Descriptor sets are cached by a hash of their layout and the bound resources (ids included), so the combinations which
+    // repeat every frame are allocated and written once. When the pools are full, the least recently used descriptor set which
+    // the current recording doesn't reference is evicted, only if every one of them is referenced does another pool get added.
     class SPARTAN_CLASS RHI_DescriptorCache : public Spartan_Object
     {
     public:
-        RHI_DescriptorCache(const RHI_Device* rhi_device);
+        RHI_DescriptorCache(const RHI_Device* rhi_device, Profiler* profiler = nullptr);
         ~RHI_DescriptorCache();
 
         void SetPipelineState(RHI_PipelineState& pipeline_state);
@@ -46,29 +52,47 @@ namespace Spartan
         void SetTexture(const uint32_t slot, RHI_Texture* texture);
 
         // Properties
-        void* GetResource_DescriptorSetPool() const { return m_descriptor_pool; }
         void* GetResource_DescriptorSetLayout() const;
         bool GetResource_DescriptorSet(void*& descriptor_set);
 
-        // Capacity
-        bool HasEnoughCapacity() const;
-        void GrowIfNeeded();
+        // Descriptor sets
+        void* GetDescriptorSet(const std::size_t hash);
+        void* CreateDescriptorSet(const std::size_t hash, void* descriptor_set_layout);
+
+        // Has to be called once the GPU is done with everything the owning command list submitted
+        void OnCommandListCompleted() { m_recording_index++; }
 
     private:
-        uint32_t GetDescriptorSetCount() const;
-        void SetDescriptorSetCapacity(uint32_t descriptor_capacity);
+        bool EvictDescriptorSet();
+
+        // Implemented by the underlying API
         bool CreateDescriptorPool(uint32_t descriptor_set_capacity);
+        void* AllocateDescriptorSet(void* descriptor_pool, void* descriptor_set_layout);
+        void FreeDescriptorSet(void* descriptor_pool, void* descriptor_set);
         std::vector<RHI_Descriptor> GenerateDescriptors(RHI_PipelineState& pipeline_state);
 
         // Descriptor set layouts 
         std::unordered_map<std::size_t, std::shared_ptr<RHI_DescriptorSetLayout>> m_descriptor_set_layouts;
         RHI_DescriptorSetLayout* m_descriptor_layout_current = nullptr;
 
-        // Descriptor pool
-        uint32_t m_descriptor_set_capacity = 16;
-        void* m_descriptor_pool = nullptr;
+        // Descriptor sets, most recently used first
+        struct DescriptorSet
+        {
+            std::size_t hash;
+            void* resource;
+            void* pool;
+            uint64_t recording_index; // the recording which last used it
+        };
+        std::list<DescriptorSet> m_descriptor_sets;
+        std::unordered_map<std::size_t, std::list<DescriptorSet>::iterator> m_descriptor_set_lookup;
+        uint64_t m_recording_index = 0;
+
+        // Descriptor pools, every one added doubles the capacity
+        uint32_t m_descriptor_set_capacity = 0;
+        std::vector<void*> m_descriptor_pools;
 
         // Dependencies
         const RHI_Device* m_rhi_device;
+        Profiler* m_profiler;
     };
 }
@@ -70,6 +70,7 @@ namespace Spartan
                 descriptor.resource = constant_buffer->GetResource();
                 descriptor.offset   = constant_buffer->GetOffset();
                 descriptor.range    = constant_buffer->GetStride();
+                descriptor.id       = constant_buffer->GetId();
 
                 return true;
             }
@@ -89,6 +90,7 @@ namespace Spartan
 
                 // Update
                 descriptor.resource = sampler->GetResource();
+                descriptor.id       = sampler->GetId();
 
                 break;
             }
@@ -119,6 +121,7 @@ namespace Spartan
                 // Update
                 descriptor.resource = texture->Get_Resource_View();
                 descriptor.layout   = texture->GetLayout();
+                descriptor.id       = texture->GetId();
 
                 break;
             }
@@ -127,32 +130,26 @@ namespace Spartan
 
     bool RHI_DescriptorSetLayout::GetResource_DescriptorSet(RHI_DescriptorCache* descriptor_cache, void*& descriptor_set)
     {
+        // Nothing changed since the descriptor set was bound
+        if (!m_needs_to_bind)
+            return true;
+
         // Get the hash of the current state of the descriptors
         const size_t hash = ComputeDescriptorSetHash(m_descriptors);
 
-        // If we don't have a descriptor set to match that state, create one
-        auto it = m_descriptor_sets.find(hash);
-        if (it == m_descriptor_sets.end())
+        // If there is no descriptor set to match that state, create one
+        descriptor_set = descriptor_cache->GetDescriptorSet(hash);
+        if (!descriptor_set)
         {
-            // Only allocate if the descriptor set cache hash enough capacity
-            if (descriptor_cache->HasEnoughCapacity())
-            {
-                descriptor_set = CreateDescriptorSet(hash, descriptor_cache);
-            }
-            else
-            {
+            descriptor_set = descriptor_cache->CreateDescriptorSet(hash, m_descriptor_set_layout);
+            if (!descriptor_set)
                 return false;
-            }
-        }
-        else // retrieve the existing one
-        {
-            if (m_needs_to_bind)
-            {
-                descriptor_set  = it->second;
-                m_needs_to_bind = false;
-            }
+
+            UpdateDescriptorSet(descriptor_set, m_descriptors);
         }
 
+        m_needs_to_bind = false;
+
         return true;
     }
 
@@ -190,7 +187,9 @@ namespace Spartan
 
     size_t RHI_DescriptorSetLayout::ComputeDescriptorSetHash(const vector<RHI_Descriptor>& descriptors)
     {
+        // Descriptor sets of all layouts share a cache
         size_t hash = 0;
+        Utility::Hash::hash_combine(hash, GetId());
 
         for (const RHI_Descriptor& descriptor : descriptors)
         {
@@ -199,6 +198,7 @@ namespace Spartan
             Utility::Hash::hash_combine(hash, descriptor.offset);
             Utility::Hash::hash_combine(hash, descriptor.range);
             Utility::Hash::hash_combine(hash, descriptor.resource);
+            Utility::Hash::hash_combine(hash, descriptor.id);
             Utility::Hash::hash_combine(hash, static_cast<uint32_t>(descriptor.type));
             Utility::Hash::hash_combine(hash, static_cast<uint32_t>(descriptor.layout));
         }
@@ -24,7 +24,6 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //= INCLUDES ======================
 #include "../Core/Spartan_Object.h"
 #include "RHI_Definition.h"
-#include <unordered_map>
 #include <vector>
 #include <array>
 //=================================
@@ -46,12 +45,10 @@ namespace Spartan
         const std::array<uint32_t, state_max_constant_buffer_count> GetDynamicOffsets() const;
         uint32_t GetDynamicOffsetCount() const;
         void* GetResource_DescriptorSetLayout() const { return m_descriptor_set_layout; }      
-        uint32_t GetDescriptorSetCount()        const { return static_cast<uint32_t>(m_descriptor_sets.size()); }
         void NeedsToBind()                            { m_needs_to_bind = true; }
 
     private:
         std::size_t ComputeDescriptorSetHash(const std::vector<RHI_Descriptor>& descriptors);
-        void* CreateDescriptorSet(const std::size_t hash, const RHI_DescriptorCache* descriptor_cache);
         void UpdateDescriptorSet(void* descriptor_set, const std::vector<RHI_Descriptor>& descriptors);
         void* CreateDescriptorSetLayout(const std::vector<RHI_Descriptor>& descriptors);
 
@@ -72,9 +69,6 @@ namespace Spartan
         // Descriptors
         std::vector<RHI_Descriptor> m_descriptors;
 
-        // Descriptor sets
-        std::unordered_map<std::size_t, void*> m_descriptor_sets;
-
         // Descriptor set layout
         void* m_descriptor_set_layout = nullptr;
 
@@ -153,4 +153,34 @@ namespace Spartan
 
         return 0;
     }
+
+    void RHI_Device::Release(function<void()>&& release)
+    {
+        lock_guard<mutex> lock(m_release_mutex);
+        m_release_queue.emplace_back(m_frame_index.load(), move(release));
+    }
+
+    void RHI_Device::Release_Completed(const uint64_t frame_index)
+    {
+        lock_guard<mutex> lock(m_release_mutex);
+
+        // A submission of frame_index has completed, and queues complete in order, so anything
+        // released during an earlier frame can't be referenced by the GPU anymore.
+        while (!m_release_queue.empty() && m_release_queue.front().first < frame_index)
+        {
+            m_release_queue.front().second();
+            m_release_queue.pop_front();
+        }
+    }
+
+    void RHI_Device::Release_All()
+    {
+        lock_guard<mutex> lock(m_release_mutex);
+
+        for (auto& release : m_release_queue)
+        {
+            release.second();
+        }
+        m_release_queue.clear();
+    }
 }
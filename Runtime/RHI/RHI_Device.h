@@ -25,6 +25,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../Core/Spartan_Object.h"
 #include <mutex>
 #include <memory>
+#include <deque>
+#include <atomic>
+#include <functional>
 #include "RHI_DisplayMode.h"
 #include "RHI_PhysicalDevice.h"
 //=================================
@@ -58,6 +61,14 @@ namespace Spartan
         void* Queue_Get(const RHI_Queue_Type type) const;
         uint32_t Queue_Index(const RHI_Queue_Type type) const;
 
+        // Frames in flight - Resources which the GPU might still be using are released once every frame that could reference them has completed.
+        // A command list reports the frame it submitted once its fence has been waited on, only explicit APIs (Vulkan) defer releases.
+        void Release(std::function<void()>&& release);
+        void Release_Completed(const uint64_t frame_index);
+        void Release_All();
+        void Frame_Advance()                    { m_frame_index++; }
+        uint64_t GetFrameIndex()          const { return m_frame_index; }
+
         // Misc
 		auto IsInitialized()                const { return m_initialized; }
         RHI_Context* GetContextRhi()	    const { return m_rhi_context.get(); }
@@ -72,6 +83,9 @@ namespace Spartan
         uint32_t m_enabled_graphics_shader_stages   = 0;
         bool m_initialized                          = false;
         mutable std::mutex m_queue_mutex;
+        std::atomic<uint64_t> m_frame_index = 0;
+        std::deque<std::pair<uint64_t, std::function<void()>>> m_release_queue;
+        std::mutex m_release_mutex;
         std::shared_ptr<RHI_Context> m_rhi_context;
 	};
 }
@@ -314,6 +314,8 @@ static const VkImageLayout vulkan_image_layout[] =
     #include "Vulkan/vk_mem_alloc.h"
     #include <vector>
     #include <unordered_map>
+#elif defined (API_GRAPHICS_NULL)
+    #include "Null/Null_CommandStream.h"
 #endif
 
 // RHI_Context
@@ -377,6 +379,19 @@ namespace Spartan
                 void destroy_allocator();
         #endif
 
+        #if defined(API_GRAPHICS_NULL)
+            RHI_Api_Type api_type = RHI_Api_Null;
+            void* device          = nullptr;
+            RHI_Null_CommandStream command_stream; // everything that was submitted, inspectable once a frame is presented
+        #endif
+
+        // Whether command lists can be recorded on multiple threads at once (D3D11 records straight into its one immediate context)
+        #if defined(API_GRAPHICS_VULKAN) || defined(API_GRAPHICS_NULL)
+            bool parallel_recording = true;
+        #else
+            bool parallel_recording = false;
+        #endif
+
         // Debugging
         #ifdef DEBUG
             bool debug    = true;
@@ -421,6 +436,8 @@ namespace Spartan
     #include "D3D12/D3D12_Utility.h"
 #elif defined (API_GRAPHICS_VULKAN)
     #include "Vulkan/Vulkan_Utility.h"
+#elif defined (API_GRAPHICS_NULL)
+    #include "Null/Null_Utility.h"
 #endif
 
 #endif // RUNTIME
@@ -22,9 +22,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //= INCLUDES ===================
 #include "Spartan.h"
 #include "RHI_PipelineCache.h"
-#include "RHI_Texture.h"
 #include "RHI_Pipeline.h"
-#include "RHI_SwapChain.h"
 #include "RHI_DescriptorCache.h"
 //==============================
 
@@ -34,7 +32,27 @@ using namespace std;
 
 namespace Spartan
 {
-    RHI_Pipeline* RHI_PipelineCache::GetPipeline(RHI_CommandList* cmd_list, RHI_PipelineState& pipeline_state, void* descriptor_set_layout)
+    // Unique across pipeline cache instances, so that a state never picks up a pipeline from a cache which is gone
+    static atomic<uint32_t> epoch_count = 0;
+
+    RHI_PipelineCache::RHI_PipelineCache(const RHI_Device* rhi_device, const string& file_path /*= ""*/)
+    {
+        m_rhi_device        = rhi_device;
+        m_file_path         = file_path;
+        m_epoch             = ++epoch_count;
+        m_descriptor_cache  = make_shared<RHI_DescriptorCache>(rhi_device);
+
+        _Create();
+    }
+
+    RHI_PipelineCache::~RHI_PipelineCache()
+    {
+        Save();
+        m_cache.clear();
+        _Destroy();
+    }
+
+    RHI_Pipeline* RHI_PipelineCache::GetPipeline(RHI_PipelineState& pipeline_state, void* descriptor_set_layout)
     {
         // Validate it
         if (!pipeline_state.IsValid())
@@ -43,51 +61,97 @@ namespace Spartan
             return nullptr;
         }
 
-        // Render target layout transitions
-        {
-            // Color
-            {
-                // Swapchain
-                if (RHI_SwapChain* swapchain = pipeline_state.render_target_swapchain)
-                {
-                    swapchain->SetLayout(RHI_Image_Present_Src, cmd_list);
-                    pipeline_state.render_target_color_layout_initial   = RHI_Image_Present_Src;
-                    pipeline_state.render_target_color_layout_final     = RHI_Image_Present_Src;
-                }
-
-                // Texture
-                for (auto i = 0; i < state_max_render_target_count; i++)
-                {
-                    if (RHI_Texture* texture = pipeline_state.render_target_color_textures[i])
-                    {
-                        texture->SetLayout(RHI_Image_Color_Attachment_Optimal, cmd_list);
-                        pipeline_state.render_target_color_layout_initial   = RHI_Image_Color_Attachment_Optimal;
-                        pipeline_state.render_target_color_layout_final     = RHI_Image_Color_Attachment_Optimal;
-                    }
-                }
-            }
+        // Compute a hash for it, this is a no-op unless the state changed since it was last bound
+        pipeline_state.ComputeHash();
 
-            // Depth
-            if (RHI_Texture* texture = pipeline_state.render_target_depth_texture)
-            {
-                texture->SetLayout(RHI_Image_Depth_Stencil_Attachment_Optimal, cmd_list);
-                pipeline_state.render_target_depth_layout_initial   = RHI_Image_Depth_Stencil_Attachment_Optimal;
-                pipeline_state.render_target_depth_layout_final     = RHI_Image_Depth_Stencil_Attachment_Optimal;
-            }
-        }
+        // If the state already resolved to a pipeline, there is nothing to look up
+        const uint32_t epoch = m_epoch;
+        if (RHI_Pipeline* pipeline = pipeline_state.GetPipeline(epoch))
+            return pipeline;
 
-        // Compute a hash for it
-        pipeline_state.ComputeHash();
-        size_t hash = pipeline_state.GetHash();
+        const size_t hash = pipeline_state.GetHash();
 
         // If no pipeline exists for this state, create one
+        lock_guard<mutex> lock(m_mutex);
+        m_used.insert(hash);
         auto it = m_cache.find(hash);
-        if (it == m_cache.end())
+        RHI_Pipeline* pipeline = it != m_cache.end() ? it->second.get() : CreatePipeline(hash, pipeline_state, descriptor_set_layout);
+        pipeline_state.SetPipeline(pipeline, epoch);
+
+        return pipeline;
+    }
+
+    bool RHI_PipelineCache::WarmUp(RHI_PipelineState& pipeline_state)
+    {
+        if (!pipeline_state.IsValid())
+            return false;
+
+        pipeline_state.ComputeHash();
+        const size_t hash = pipeline_state.GetHash();
+
         {
-            // Cache a new pipeline
-            it = m_cache.emplace(make_pair(hash, move(make_shared<RHI_Pipeline>(m_rhi_device, pipeline_state, descriptor_set_layout)))).first;
+            lock_guard<mutex> lock(m_mutex);
+            if (m_cache.find(hash) != m_cache.end())
+                return true;
         }
 
-        return it->second.get();
+        // The layout only has to be compatible with the ones the command lists create, which it is since it's made from the same shaders
+        void* descriptor_set_layout = nullptr;
+        {
+            lock_guard<mutex> lock(m_mutex_warm_up);
+            m_descriptor_cache->SetPipelineState(pipeline_state);
+            descriptor_set_layout = m_descriptor_cache->GetResource_DescriptorSetLayout();
+        }
+
+        if (!descriptor_set_layout)
+            return false;
+
+        // Created outside of the lock so that several threads can warm up at once, it's not counted as it doesn't stall a frame
+        shared_ptr<RHI_Pipeline> pipeline = make_shared<RHI_Pipeline>(m_rhi_device, pipeline_state, descriptor_set_layout, m_resource);
+        if (!pipeline->GetPipeline())
+            return false;
+
+        lock_guard<mutex> lock(m_mutex);
+        m_cache.emplace(make_pair(hash, move(pipeline)));
+
+        return true;
+    }
+
+    vector<const RHI_PipelineState*> RHI_PipelineCache::GetUsedPipelineStates()
+    {
+        lock_guard<mutex> lock(m_mutex);
+
+        vector<const RHI_PipelineState*> pipeline_states;
+        pipeline_states.reserve(m_used.size());
+        for (const size_t hash : m_used)
+        {
+            const auto it = m_cache.find(hash);
+            if (it != m_cache.end())
+            {
+                pipeline_states.emplace_back(it->second->GetPipelineState());
+            }
+        }
+
+        return pipeline_states;
+    }
+
+    void RHI_PipelineCache::ResetUsage()
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_used.clear();
+
+        // Pipelines which states remember have to be looked up again, so that their use is recorded
+        m_epoch = ++epoch_count;
+    }
+
+    RHI_Pipeline* RHI_PipelineCache::CreatePipeline(const size_t hash, RHI_PipelineState& pipeline_state, void* descriptor_set_layout)
+    {
+        const Stopwatch timer;
+        RHI_Pipeline* pipeline = m_cache.emplace(make_pair(hash, make_shared<RHI_Pipeline>(m_rhi_device, pipeline_state, descriptor_set_layout, m_resource))).first->second.get();
+
+        m_created_count++;
+        m_creation_time_us += static_cast<uint64_t>(timer.GetElapsedTimeMs() * 1000.0f);
+
+        return pipeline;
     }
 }
@@ -23,7 +23,12 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //= INCLUDES ======================
 #include <memory>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include "RHI_Definition.h"
 #include "../Core/Spartan_Object.h"
 //=================================
@@ -33,12 +38,51 @@ namespace Spartan
 	class RHI_PipelineCache : public Spartan_Object
 	{
 	public:
-        RHI_PipelineCache(const RHI_Device* rhi_device) { m_rhi_device = rhi_device; }
-        RHI_Pipeline* GetPipeline(RHI_CommandList* cmd_list, RHI_PipelineState& pipeline_state, void* descriptor_set_layout);
+        // The driver's compiled pipelines are loaded from file_path and saved back to it (if not empty)
+        RHI_PipelineCache(const RHI_Device* rhi_device, const std::string& file_path = "");
+        ~RHI_PipelineCache();
+
+        // The state remembers the pipeline it resolved to, so as long as it doesn't change, neither hashing nor a lookup takes place
+        RHI_Pipeline* GetPipeline(RHI_PipelineState& pipeline_state, void* descriptor_set_layout);
+
+        // Creates a pipeline ahead of its first use
+        bool WarmUp(RHI_PipelineState& pipeline_state);
+
+        // The states of the pipelines which were requested since the last call to ResetUsage()
+        std::vector<const RHI_PipelineState*> GetUsedPipelineStates();
+        void ResetUsage();
+
+        // Writes what the driver compiled to disk, implemented by the underlying API
+        bool Save() const;
+
+        // Pipeline creation since the last call, creation is what stalls the first frame a pipeline state is seen in
+        uint32_t ConsumeCreatedCount()      { return m_created_count.exchange(0); }
+        float ConsumeCreationTimeMs()       { return static_cast<float>(m_creation_time_us.exchange(0)) / 1000.0f; }
+        void* GetResource()           const { return m_resource; }
 
 	private:
+        RHI_Pipeline* CreatePipeline(const std::size_t hash, RHI_PipelineState& pipeline_state, void* descriptor_set_layout);
+
+        // Implemented by the underlying API
+        void _Create();
+        void _Destroy();
+
         // <hash of pipeline state, pipeline state object>
         std::unordered_map<std::size_t, std::shared_ptr<RHI_Pipeline>> m_cache;
+        std::unordered_set<std::size_t> m_used;
+        std::mutex m_mutex; // command lists can request pipelines from multiple threads
+        std::atomic<uint32_t> m_epoch = 0;
+
+        // Pipelines created ahead of a command list get their descriptor set layouts from here
+        std::shared_ptr<RHI_DescriptorCache> m_descriptor_cache;
+        std::mutex m_mutex_warm_up;
+
+        // Metrics
+        std::atomic<uint32_t> m_created_count       = 0;
+        std::atomic<uint64_t> m_creation_time_us    = 0;
+
+        std::string m_file_path;
+        void* m_resource = nullptr;
 
         // Dependencies
         const RHI_Device* m_rhi_device;
@@ -144,8 +144,90 @@ namespace Spartan
         clear_stencil = state_stencil_load;
 	}
 
-	void RHI_PipelineState::ComputeHash()
+    static uint32_t float_bits(const float value)
     {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    static uint32_t object_id(const Spartan_Object* object)
+    {
+        return object ? object->GetId() : 0;
+    }
+
+	bool RHI_PipelineState::ComputeHash()
+    {
+        // Gather everything the hash depends on, ids start at 1 so 0 stands for null
+        array<uint32_t, 40> inputs;
+        {
+            uint32_t i = 0;
+
+            inputs[i++] = object_id(shader_vertex);
+            inputs[i++] = object_id(shader_pixel);
+            inputs[i++] = object_id(shader_compute);
+            inputs[i++] = object_id(rasterizer_state);
+            inputs[i++] = object_id(blend_state);
+            inputs[i++] = object_id(depth_stencil_state);
+            inputs[i++] = render_target_swapchain != nullptr;
+            inputs[i++] = static_cast<uint32_t>(primitive_topology);
+            inputs[i++] = float_bits(viewport.x);
+            inputs[i++] = float_bits(viewport.y);
+            inputs[i++] = float_bits(viewport.width);
+            inputs[i++] = float_bits(viewport.height);
+            inputs[i++] = dynamic_scissor;
+            inputs[i++] = float_bits(scissor.left);
+            inputs[i++] = float_bits(scissor.top);
+            inputs[i++] = float_bits(scissor.right);
+            inputs[i++] = float_bits(scissor.bottom);
+            inputs[i++] = vertex_buffer_stride;
+            inputs[i++] = render_target_color_texture_array_index;
+            inputs[i++] = render_target_depth_stencil_texture_array_index;
+            inputs[i++] = object_id(render_target_depth_texture);
+            inputs[i++] = render_target_depth_texture_read_only;
+            inputs[i++] = clear_depth == state_depth_dont_care ? 0 : clear_depth == state_depth_load ? 1 : 2;
+            inputs[i++] = clear_stencil == state_stencil_dont_care ? 0 : clear_stencil == state_stencil_load ? 1 : 2;
+
+            for (uint32_t rt = 0; rt < state_max_render_target_count; rt++)
+            {
+                inputs[i++] = object_id(render_target_color_textures[rt]);
+                inputs[i++] = clear_color[rt] == state_color_dont_care ? 0 : clear_color[rt] == state_color_load ? 1 : 2;
+            }
+        }
+
+        // Most states are re-assigned the same values every frame
+        if (!m_hash_dirty && inputs == m_hash_inputs)
+            return false;
+
+        m_hash_inputs   = inputs;
+        m_hash_dirty    = false;
+        m_pipeline      = nullptr;
+
+        // The layouts the render pass expects follow from the render targets
+        {
+            if (render_target_swapchain)
+            {
+                render_target_color_layout_initial  = RHI_Image_Present_Src;
+                render_target_color_layout_final    = RHI_Image_Present_Src;
+            }
+
+            for (uint32_t i = 0; i < state_max_render_target_count; i++)
+            {
+                if (render_target_color_textures[i])
+                {
+                    render_target_color_layout_initial  = RHI_Image_Color_Attachment_Optimal;
+                    render_target_color_layout_final    = RHI_Image_Color_Attachment_Optimal;
+                }
+            }
+
+            // Read only depth can also be sampled while it's bound, so it stays in the layout the render graph leaves it in
+            if (render_target_depth_texture)
+            {
+                render_target_depth_layout_initial  = render_target_depth_texture_read_only ? RHI_Image_Depth_Stencil_Read_Only_Optimal : RHI_Image_Depth_Stencil_Attachment_Optimal;
+                render_target_depth_layout_final    = render_target_depth_layout_initial;
+            }
+        }
+
         m_hash = 0;
 
         Utility::Hash::hash_combine(m_hash, dynamic_scissor);
@@ -246,5 +328,30 @@ namespace Spartan
                 Utility::Hash::hash_combine(m_hash, render_target_depth_layout_final);
             }
         }
+
+        return true;
+    }
+
+    void RHI_PipelineState::TransitionRenderTargets(RHI_CommandList* cmd_list) const
+    {
+        // Color
+        if (render_target_swapchain)
+        {
+            render_target_swapchain->SetLayout(RHI_Image_Present_Src, cmd_list);
+        }
+
+        for (uint32_t i = 0; i < state_max_render_target_count; i++)
+        {
+            if (RHI_Texture* texture = render_target_color_textures[i])
+            {
+                texture->SetLayout(RHI_Image_Color_Attachment_Optimal, cmd_list);
+            }
+        }
+
+        // Depth
+        if (render_target_depth_texture)
+        {
+            render_target_depth_texture->SetLayout(render_target_depth_layout_initial, cmd_list);
+        }
     }
 }
@@ -40,7 +40,8 @@ namespace Spartan
         bool IsValid();   
         bool CreateFrameResources(const RHI_Device* rhi_device);
         void* GetFrameBuffer() const;
-        void ComputeHash();
+        bool ComputeHash();
+        void TransitionRenderTargets(RHI_CommandList* cmd_list) const;
         uint32_t GetWidth() const;
         uint32_t GetHeight() const;
         void ResetClearValues();
@@ -48,6 +49,10 @@ namespace Spartan
         void* GetRenderPass()                           const { return m_render_pass; }
         bool operator==(const RHI_PipelineState& rhs)   const { return m_hash == rhs.GetHash(); }
 
+        // The pipeline the current hash resolved to, the epoch lets the pipeline cache invalidate it
+        RHI_Pipeline* GetPipeline(const uint32_t epoch)                 const { return m_pipeline_epoch == epoch ? m_pipeline : nullptr; }
+        void SetPipeline(RHI_Pipeline* pipeline, const uint32_t epoch)        { m_pipeline = pipeline; m_pipeline_epoch = epoch; }
+
         //= Static, modification can potentially generate a new pipeline ===========================================================
         RHI_Shader* shader_vertex                           = nullptr;
         RHI_Shader* shader_pixel                            = nullptr;
@@ -107,6 +112,7 @@ namespace Spartan
         // such a hack, must fix. Update: Came back to byte me in the ass
         int dynamic_constant_buffer_slot    = 2;
         int dynamic_constant_buffer_slot_2  = 3;
+        int dynamic_constant_buffer_slot_3  = 5;
 
         // Clear values
         
@@ -120,6 +126,12 @@ namespace Spartan
     private:
         void DestroyFrameResources();
 
+        // The static fields the hash was last computed from, comparing them is cheaper than hashing them
+        std::array<uint32_t, 40> m_hash_inputs  = {};
+        bool m_hash_dirty                       = true;
+        RHI_Pipeline* m_pipeline                = nullptr;
+        uint32_t m_pipeline_epoch               = 0;
+
         std::size_t m_hash  = 0;
         void* m_render_pass = nullptr;
         std::array<void*, state_max_render_target_count> m_frame_buffers =
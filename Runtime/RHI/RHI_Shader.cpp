@@ -23,6 +23,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Spartan.h"
 #include "RHI_Shader.h"
 #include "RHI_InputLayout.h"
+#include "RHI_ShaderCache.h"
 #include "../Threading/Threading.h"
 #include "../Rendering/Renderer.h"
 #pragma warning(push, 0) // Hide warnings belonging SPIRV-Cross 
@@ -39,7 +40,9 @@ namespace Spartan
 	RHI_Shader::RHI_Shader(Context* context) : Spartan_Object(context)
 	{
 		m_rhi_device	= context->GetSubsystem<Renderer>()->GetRhiDevice();
+		m_shader_cache	= context->GetSubsystem<Renderer>()->GetShaderCache();
 		m_input_layout	= make_shared<RHI_InputLayout>(m_rhi_device);
+		m_compile_task	= make_shared<TaskCounter>();
 	}
 
 	template <typename T>
@@ -63,9 +66,13 @@ namespace Spartan
 			m_file_path.clear();
 		}
 
-		// Compile
+		// Compile (or load from the cache)
         m_compilation_state = Shader_Compilation_Compiling;
+        m_cache_key         = m_shader_cache ? m_shader_cache->ComputeKey(this, shader) : 0;
+        m_cache_hit         = false;
+        const Stopwatch timer;
         m_resource          = _Compile(shader);
+        m_compile_time_ms   = timer.GetElapsedTimeMs();
         m_compilation_state = m_resource ? Shader_Compilation_Succeeded : Shader_Compilation_Failed;
 
 		// Log compilation result
@@ -84,7 +91,11 @@ namespace Spartan
                 defines += define.first + " = " + define.second;
             }
 
-            if (m_compilation_state == Shader_Compilation_Succeeded)
+            if (m_compilation_state == Shader_Compilation_Succeeded && m_cache_hit)
+            {
+                LOG_INFO("Loaded %s shader \"%s\" from the cache", type_str.c_str(), shader.c_str());
+            }
+            else if (m_compilation_state == Shader_Compilation_Succeeded)
             {
                 if (defines.empty())
                 {
@@ -115,12 +126,18 @@ namespace Spartan
 		m_context->GetSubsystem<Threading>()->AddTask([this, type, shader]()
 		{
 			Compile<T>(type, shader);
-		});
+		}, m_compile_task.get());
 	}
 
 	void RHI_Shader::WaitForCompilation()
 	{
-        // Wait
+        // Wait for a queued compilation, executing other tasks meanwhile so that it's safe to wait from a worker thread
+        if (m_compile_task && !m_compile_task->IsDone())
+        {
+            m_context->GetSubsystem<Threading>()->Wait(*m_compile_task);
+        }
+
+        // Wait for a compilation which is running on another thread
         while (m_compilation_state == Shader_Compilation_Compiling)
         {
             LOG_INFO("Waiting for shader \"%s\" to compile...", m_name.c_str());
@@ -134,6 +151,29 @@ namespace Spartan
         }
 	}
 
+    bool RHI_Shader::_CacheLoad(vector<std::byte>* blob)
+    {
+        if (!m_shader_cache)
+            return false;
+
+        vector<RHI_Descriptor> descriptors;
+        if (!m_shader_cache->Load(m_cache_key, blob, &descriptors))
+            return false;
+
+        m_descriptors   = move(descriptors);
+        m_cache_hit     = true;
+
+        return true;
+    }
+
+    void RHI_Shader::_CacheSave(const void* blob, const uint64_t blob_size) const
+    {
+        if (!m_shader_cache)
+            return;
+
+        m_shader_cache->Save(m_cache_key, blob, blob_size, m_descriptors);
+    }
+
 	const char* RHI_Shader::GetEntryPoint() const
     {
         static const char* entry_point_empty = nullptr;
@@ -165,6 +205,10 @@ namespace Spartan
         static const char* target_profile_vs = "vs_6_0";
         static const char* target_profile_ps = "ps_6_0";
         static const char* target_profile_cs = "cs_6_0";
+        #elif defined(API_GRAPHICS_NULL)
+        static const char* target_profile_vs = "vs_6_0";
+        static const char* target_profile_ps = "ps_6_0";
+        static const char* target_profile_cs = "cs_6_0";
         #endif
 
         if (m_shader_type == RHI_Shader_Vertex)     return target_profile_vs;
@@ -182,6 +226,8 @@ namespace Spartan
         static const char* shader_model = "6_0";
         #elif defined(API_GRAPHICS_VULKAN)
         static const char* shader_model = "6_0";
+        #elif defined(API_GRAPHICS_NULL)
+        static const char* shader_model = "6_0";
         #endif
 
         return shader_model;
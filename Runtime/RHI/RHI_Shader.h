@@ -35,6 +35,7 @@ namespace Spartan
 {
 	// Forward declarations
 	class Context;
+	class TaskCounter;
 
 	class SPARTAN_CLASS RHI_Shader : public Spartan_Object
 	{
@@ -77,6 +78,11 @@ namespace Spartan
         const char* GetEntryPoint()         const;
         const char* GetTargetProfile()      const;
         const char* GetShaderModel()        const;
+        bool IsFromCache()                  const                                   { return m_cache_hit; }
+        float GetCompileTimeMs()            const                                   { return m_compile_time_ms; } // includes cache loads
+
+        // Identifies the compiler and its options, implemented by the underlying API
+        static const std::string& GetCompilerVersion();
 
 	protected:
 		std::shared_ptr<RHI_Device> m_rhi_device;
@@ -86,6 +92,11 @@ namespace Spartan
 		void* _Compile(const std::string& shader);
 		void _Reflect(const RHI_Shader_Type shader_type, const uint32_t* ptr, uint32_t size);
 
+        // Shader cache, the underlying API loads a blob instead of compiling when possible, and saves what it compiles
+        bool _CacheLoad(std::vector<std::byte>* blob);
+        void _CacheSave(const void* blob, uint64_t blob_size) const;
+        void* _CreateResource(const void* blob, size_t blob_size, const std::string& shader);
+
 		std::string m_name;
 		std::string m_file_path;
 		std::unordered_map<std::string, std::string> m_defines;
@@ -94,6 +105,11 @@ namespace Spartan
 		Shader_Compilation_State m_compilation_state    = Shader_Compilation_Unknown;
         RHI_Shader_Type m_shader_type                   = RHI_Shader_Unknown;
         RHI_Vertex_Type m_vertex_type                   = RHI_Vertex_Type_Unknown;
+        RHI_ShaderCache* m_shader_cache                 = nullptr;
+        uint64_t m_cache_key                            = 0;
+        bool m_cache_hit                                = false;
+        float m_compile_time_ms                         = 0.0f;
+        std::shared_ptr<TaskCounter> m_compile_task;
 
 		// API 
 		void* m_resource = nullptr;
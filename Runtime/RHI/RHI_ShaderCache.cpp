@@ -0,0 +1,275 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES ===================
+#include "Spartan.h"
+#include "RHI_ShaderCache.h"
+#include "RHI_Shader.h"
+#include "../IO/FileStream.h"
+#include <fstream>
+#include <map>
+#include <sstream>
+//==============================
+
+//= NAMESPACES =====
+using namespace std;
+//==================
+
+namespace Spartan
+{
+    // Bumped whenever the layout of an entry changes
+    static const uint32_t cache_version = 1;
+    static const uint32_t cache_magic   = 0x43485053; // "SPHC", written last so that a truncated entry is rejected
+
+    // FNV-1a, unlike std::hash it's the same on every platform and in every build
+    static void hash_bytes(uint64_t& hash, const void* data, const size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= 0x100000001B3ull;
+        }
+    }
+
+    static void hash_string(uint64_t& hash, const string& str)
+    {
+        hash_bytes(hash, str.data(), str.size());
+        hash_bytes(hash, "\0", 1); // separator, so that "ab" + "c" and "a" + "bc" differ
+    }
+
+    static bool hash_file(uint64_t& hash, const string& file_path)
+    {
+        ifstream in(file_path, ios::binary);
+        if (!in)
+            return false;
+
+        stringstream buffer;
+        buffer << in.rdbuf();
+        hash_string(hash, buffer.str());
+
+        return true;
+    }
+
+    static const char* stage_to_string(const RHI_Shader_Type type)
+    {
+        if (type == RHI_Shader_Vertex)  return "vs";
+        if (type == RHI_Shader_Pixel)   return "ps";
+        if (type == RHI_Shader_Compute) return "cs";
+
+        return "unknown";
+    }
+
+    static RHI_Shader_Type string_to_stage(const string& stage)
+    {
+        if (stage == "vs") return RHI_Shader_Vertex;
+        if (stage == "ps") return RHI_Shader_Pixel;
+        if (stage == "cs") return RHI_Shader_Compute;
+
+        return RHI_Shader_Unknown;
+    }
+
+    RHI_ShaderCache::RHI_ShaderCache(Context* context, const string& directory) : Spartan_Object(context)
+    {
+        m_directory = directory + "/";
+
+        if (!FileSystem::Exists(m_directory))
+        {
+            FileSystem::CreateDirectory_(m_directory);
+        }
+    }
+
+    uint64_t RHI_ShaderCache::ComputeKey(const RHI_Shader* shader, const string& source)
+    {
+        uint64_t hash = 0xCBF29CE484222325ull;
+
+        // The compilation itself
+        hash_string(hash, RHI_Shader::GetCompilerVersion());
+        hash_string(hash, shader->GetEntryPoint() ? shader->GetEntryPoint() : "");
+        hash_string(hash, shader->GetTargetProfile() ? shader->GetTargetProfile() : "");
+
+        // The defines, in a stable order, make up the permutation along with the file and the stage
+        const map<string, string> defines(shader->GetDefines().begin(), shader->GetDefines().end());
+        const bool is_file = FileSystem::IsFile(source);
+        string permutation = (is_file ? source : string("<source>")) + " " + stage_to_string(shader->GetShaderStage());
+        for (const auto& define : defines)
+        {
+            permutation += " " + define.first + "=" + define.second;
+        }
+        hash_string(hash, permutation);
+
+        // The contents of the source and of everything it includes
+        if (is_file)
+        {
+            hash_file(hash, source);
+            for (const string& include : FileSystem::GetIncludedFiles(source))
+            {
+                hash_string(hash, include);
+                hash_file(hash, include);
+            }
+
+            lock_guard<mutex> lock(m_mutex);
+            m_permutations.insert(permutation);
+        }
+        else
+        {
+            hash_string(hash, source);
+        }
+
+        return hash;
+    }
+
+    bool RHI_ShaderCache::Load(const uint64_t key, vector<std::byte>* blob, vector<RHI_Descriptor>* descriptors)
+    {
+        lock_guard<mutex> lock(m_mutex);
+
+        const string file_path = GetEntryPath(key);
+        if (!FileSystem::IsFile(file_path))
+        {
+            m_miss_count++;
+            return false;
+        }
+
+        auto file = make_unique<FileStream>(file_path, FileStream_Read);
+        if (!file->IsOpen() || file->ReadAs<uint32_t>() != cache_version)
+        {
+            m_miss_count++;
+            return false;
+        }
+
+        file->Read(blob);
+
+        descriptors->resize(file->ReadAs<uint32_t>());
+        for (RHI_Descriptor& descriptor : *descriptors)
+        {
+            descriptor.type     = static_cast<RHI_Descriptor_Type>(file->ReadAs<uint32_t>());
+            descriptor.slot     = file->ReadAs<uint32_t>();
+            descriptor.stage    = file->ReadAs<uint32_t>();
+        }
+
+        if (blob->empty() || file->ReadAs<uint32_t>() != cache_magic)
+        {
+            LOG_WARNING("Ignoring corrupted shader cache entry \"%s\"", file_path.c_str());
+            blob->clear();
+            descriptors->clear();
+            m_miss_count++;
+            return false;
+        }
+
+        m_hit_count++;
+        return true;
+    }
+
+    void RHI_ShaderCache::Save(const uint64_t key, const void* blob, const uint64_t blob_size, const vector<RHI_Descriptor>& descriptors)
+    {
+        if (!blob || blob_size == 0)
+        {
+            LOG_ERROR_INVALID_PARAMETER();
+            return;
+        }
+
+        lock_guard<mutex> lock(m_mutex);
+
+        auto file = make_unique<FileStream>(GetEntryPath(key), FileStream_Write);
+        if (!file->IsOpen())
+            return;
+
+        file->Write(cache_version);
+        file->Write(vector<std::byte>(static_cast<const std::byte*>(blob), static_cast<const std::byte*>(blob) + blob_size));
+        file->Write(static_cast<uint32_t>(descriptors.size()));
+        for (const RHI_Descriptor& descriptor : descriptors)
+        {
+            file->Write(static_cast<uint32_t>(descriptor.type));
+            file->Write(descriptor.slot);
+            file->Write(descriptor.stage);
+        }
+        file->Write(cache_magic);
+
+        file->Close();
+    }
+
+    bool RHI_ShaderCache::SaveManifest(const string& file_path)
+    {
+        lock_guard<mutex> lock(m_mutex);
+
+        ofstream out(file_path);
+        if (!out)
+        {
+            LOG_ERROR("Failed to write shader manifest \"%s\"", file_path.c_str());
+            return false;
+        }
+
+        for (const string& permutation : m_permutations)
+        {
+            out << permutation << "\n";
+        }
+
+        return true;
+    }
+
+    uint32_t RHI_ShaderCache::Precompile(const string& manifest_path)
+    {
+        ifstream in(manifest_path);
+        if (!in)
+        {
+            LOG_ERROR("Failed to read shader manifest \"%s\"", manifest_path.c_str());
+            return 0;
+        }
+
+        uint32_t compiled_count = 0;
+        string line;
+        while (getline(in, line))
+        {
+            istringstream tokens(line);
+            string file_path;
+            string stage;
+            if (!(tokens >> file_path >> stage) || file_path[0] == '#')
+                continue;
+
+            const RHI_Shader_Type type = string_to_stage(stage);
+            if (type == RHI_Shader_Unknown)
+            {
+                LOG_WARNING("Skipping \"%s\", unknown shader stage", line.c_str());
+                continue;
+            }
+
+            auto shader = make_shared<RHI_Shader>(m_context);
+            string define;
+            while (tokens >> define)
+            {
+                const size_t separator = define.find('=');
+                shader->AddDefine(define.substr(0, separator), separator != string::npos ? define.substr(separator + 1) : "1");
+            }
+
+            shader->Compile(type, file_path);
+            compiled_count += shader->IsCompiled() ? 1 : 0;
+        }
+
+        return compiled_count;
+    }
+
+    string RHI_ShaderCache::GetEntryPath(const uint64_t key) const
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+        return m_directory + name;
+    }
+}
@@ -0,0 +1,68 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+//= INCLUDES ======================
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include "RHI_Definition.h"
+#include "../Core/Spartan_Object.h"
+//=================================
+
+namespace Spartan
+{
+    class RHI_Shader;
+
+    // A persistent cache of compiled shaders. Every compilation is keyed by the contents of its source and of everything the source
+    // includes, its defines, its entry point, its target profile and the compiler, so a change to any of them is a miss, and the
+    // blob is stored along with the descriptors which were reflected from it. Every permutation which goes through the cache is also
+    // recorded, so that a manifest of them can be saved and precompiled offline.
+    class SPARTAN_CLASS RHI_ShaderCache : public Spartan_Object
+    {
+    public:
+        RHI_ShaderCache(Context* context, const std::string& directory);
+        ~RHI_ShaderCache() = default;
+
+        uint64_t ComputeKey(const RHI_Shader* shader, const std::string& source);
+        bool Load(uint64_t key, std::vector<std::byte>* blob, std::vector<RHI_Descriptor>* descriptors);
+        void Save(uint64_t key, const void* blob, uint64_t blob_size, const std::vector<RHI_Descriptor>& descriptors);
+
+        // Manifest, one permutation per line: "<file path> <vs|ps|cs> [<define>=<value> ...]"
+        bool SaveManifest(const std::string& file_path);
+        uint32_t Precompile(const std::string& manifest_path);
+
+        const auto& GetDirectory()  const { return m_directory; }
+        uint32_t GetHitCount()      const { return m_hit_count; }
+        uint32_t GetMissCount()     const { return m_miss_count; }
+
+    private:
+        std::string GetEntryPath(uint64_t key) const;
+
+        std::string m_directory;
+        std::set<std::string> m_permutations;
+        std::mutex m_mutex; // shaders are compiled on multiple threads
+        uint32_t m_hit_count    = 0;
+        uint32_t m_miss_count   = 0;
+    };
+}
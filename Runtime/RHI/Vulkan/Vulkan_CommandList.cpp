@@ -47,12 +47,15 @@ namespace Spartan
         m_profiler          = context->GetSubsystem<Profiler>();
 		m_rhi_device	    = m_renderer->GetRhiDevice().get();
         m_pipeline_cache    = m_renderer->GetPipelineCache();
-        m_descriptor_cache  = m_renderer->GetDescriptorCache();
+        m_descriptor_cache  = make_shared<RHI_DescriptorCache>(m_rhi_device, m_profiler);
 
         RHI_Context* rhi_context = m_rhi_device->GetContextRhi();
 
+        // Command pool - Pools are externally synchronized, so a pool of our own lets this command list record on any thread
+        vulkan_utility::command_pool::create(m_cmd_pool, RHI_Queue_Graphics);
+
         // Command buffer
-        vulkan_utility::command_buffer::create(m_swap_chain->GetCmdPool(), m_cmd_buffer, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+        vulkan_utility::command_buffer::create(m_cmd_pool, m_cmd_buffer, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
         vulkan_utility::debug::set_name(static_cast<VkCommandBuffer>(m_cmd_buffer), "cmd_buffer");
 
         // Sync - Fence
@@ -90,7 +93,8 @@ namespace Spartan
         vulkan_utility::semaphore::destroy(m_processed_semaphore);
 
         // Command buffer
-        vulkan_utility::command_buffer::destroy(m_swap_chain->GetCmdPool(), m_cmd_buffer);
+        vulkan_utility::command_buffer::destroy(m_cmd_pool, m_cmd_buffer);
+        vulkan_utility::command_pool::destroy(m_cmd_pool);
 
         // Query pool
         if (m_query_pool)
@@ -191,12 +195,12 @@ namespace Spartan
             }
         }
 
-        RHI_PipelineState* state = m_pipeline->GetPipelineState();
+        RHI_PipelineState* state = m_pipeline ? m_pipeline->GetPipelineState() : nullptr;
 
         // Get wait and signal semaphores
         void* wait_semaphore    = nullptr;
         void* signal_semaphore  = nullptr;
-        if (state->render_target_swapchain)
+        if (state && state->render_target_swapchain)
         {
             // If the swapchain is not presenting (e.g. minimised window), don't submit and work
             if (!state->render_target_swapchain->IsPresenting())
@@ -221,7 +225,8 @@ namespace Spartan
         )
         return false;
 
-        m_cmd_state = RHI_Cmd_List_Pending;
+        m_frame_index_submitted = m_rhi_device->GetFrameIndex();
+        m_cmd_state             = RHI_Cmd_List_Pending;
 
         return true;
     }
@@ -233,7 +238,10 @@ namespace Spartan
             if (!vulkan_utility::fence::wait(m_processed_fence))
                 return false;
 
-            m_descriptor_cache->GrowIfNeeded();
+            // Release whatever the frames which have now completed were still referencing
+            m_rhi_device->Release_Completed(m_frame_index_submitted);
+
+            m_descriptor_cache->OnCommandListCompleted();
             m_cmd_state = RHI_Cmd_List_Idle;
         }
 
@@ -264,13 +272,16 @@ namespace Spartan
             m_descriptor_cache->SetPipelineState(pipeline_state);
 
             // Get a pipeline which matches the pipeline state
-            m_pipeline = m_pipeline_cache->GetPipeline(this, pipeline_state, m_descriptor_cache->GetResource_DescriptorSetLayout());
+            m_pipeline = m_pipeline_cache->GetPipeline(pipeline_state, m_descriptor_cache->GetResource_DescriptorSetLayout());
             if (!m_pipeline)
             {
                 LOG_ERROR("Failed to acquire appropriate pipeline");
                 return false;
             }
 
+            // Transition the render targets to the layouts the render pass expects
+            pipeline_state.TransitionRenderTargets(this);
+
             // Keep a local pointer for convenience
             m_pipeline_state = &pipeline_state;
         }
@@ -386,11 +397,12 @@ namespace Spartan
         );
 
         m_profiler->m_rhi_draw_calls++;
+        m_profiler->m_rhi_instances++;
 
         return true;
 	}
 
-    bool RHI_CommandList::DrawIndexed(const uint32_t index_count, const uint32_t index_offset, const uint32_t vertex_offset)
+    bool RHI_CommandList::DrawIndexed(const uint32_t index_count, const uint32_t index_offset, const uint32_t vertex_offset, const uint32_t instance_count)
 	{
         if (m_cmd_state != RHI_Cmd_List_Recording)
         {
@@ -405,13 +417,14 @@ namespace Spartan
 		vkCmdDrawIndexed(
             static_cast<VkCommandBuffer>(m_cmd_buffer), // commandBuffer
             index_count,                                // indexCount
-            1,                                          // instanceCount
+            instance_count,                             // instanceCount
             index_offset,                               // firstIndex
             vertex_offset,                              // vertexOffset
             0                                           // firstInstance
         );
 
         m_profiler->m_rhi_draw_calls++;
+        m_profiler->m_rhi_instances += instance_count;
 
         return true;
 	}
@@ -718,7 +731,8 @@ namespace Spartan
         // Allowed profiler ?
         if (m_rhi_device->GetContextRhi()->profiler)
         {
-            if (m_profiler && pipeline_state->profile)
+            // Only the swapchain's command lists are timed, the rest are recorded on other threads
+            if (m_profiler && m_swap_chain && pipeline_state->profile)
             {
                 m_profiler->TimeBlockStart(pipeline_state->pass_name, TimeBlock_Cpu, this);
                 m_profiler->TimeBlockStart(pipeline_state->pass_name, TimeBlock_Gpu, this);
@@ -746,7 +760,7 @@ namespace Spartan
         // Allowed profiler ?
         if (m_rhi_device->GetContextRhi()->profiler && pipeline_state->profile)
         {
-            if (m_profiler)
+            if (m_profiler && m_swap_chain)
             {
                 m_profiler->TimeBlockEnd(); // cpu
                 m_profiler->TimeBlockEnd(); // gpu
@@ -830,7 +844,7 @@ namespace Spartan
 
         // Descriptor set != null, result = true    -> the descriptor set must be bound
         // Descriptor set == null, result = true    -> the descriptor set is already bound
-        // Descriptor set == null, result = false   -> a new descriptor was needed but we are out of memory (allocates next frame)
+        // Descriptor set == null, result = false   -> a new descriptor set was needed but it couldn't be created
 
         void* descriptor_set = nullptr;
         bool result = m_descriptor_cache->GetResource_DescriptorSet(descriptor_set);
@@ -35,18 +35,8 @@ namespace Spartan
 {
     void RHI_ConstantBuffer::_destroy()
     {
-        // Wait in case the buffer is still in use
-        m_rhi_device->Queue_WaitAll();
-
-        // Unmap
-        if (m_mapped)
-        {
-            vmaUnmapMemory(m_rhi_device->GetContextRhi()->allocator, static_cast<VmaAllocation>(m_allocation));
-            m_mapped = nullptr;
-        }
-
-        // Destroy
-        vulkan_utility::buffer::destroy(m_buffer);
+        // The buffer might still be in use by frames in flight
+        vulkan_utility::buffer::destroy_deferred(m_buffer, m_allocation, m_mapped);
     }
 
     RHI_ConstantBuffer::RHI_ConstantBuffer(const std::shared_ptr<RHI_Device>& rhi_device, const string& name, bool is_dynamic /*= false*/)
@@ -73,11 +63,11 @@ namespace Spartan
         {
             m_stride = static_cast<uint32_t>((m_stride + min_ubo_alignment - 1) & ~(min_ubo_alignment - 1));
         }
-        m_size_gpu = m_offset_count * m_stride;
+        m_size_gpu = m_offset_count * m_frame_count * m_stride;
 
 		// Create buffer
         VkMemoryPropertyFlags flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
-        flags |= !m_persistent_mapping ? VK_MEMORY_PROPERTY_HOST_COHERENT_BIT : 0;
+        flags |= (!m_persistent_mapping || m_is_dynamic) ? VK_MEMORY_PROPERTY_HOST_COHERENT_BIT : 0; // dynamic buffers are sub-allocated and written without flushing
         VmaAllocation allocation = vulkan_utility::buffer::create(m_buffer, m_size_gpu, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, flags, true);
         if (!allocation)
         {
@@ -24,6 +24,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../RHI_Implementation.h"
 #include "../RHI_DescriptorCache.h"
 #include "../RHI_Shader.h"
+#include "../RHI_Device.h"
 //=================================
 
 //= NAMESPACES =====
@@ -34,68 +35,78 @@ namespace Spartan
 {
     RHI_DescriptorCache::~RHI_DescriptorCache()
     {
-        if (m_descriptor_pool)
-        {
-            // Wait in case the buffer is still in use
-            m_rhi_device->Queue_WaitAll();
-
-            vkDestroyDescriptorPool(m_rhi_device->GetContextRhi()->device, static_cast<VkDescriptorPool>(m_descriptor_pool), nullptr);
-            m_descriptor_pool = nullptr;
-        }
-    }
-
-    void RHI_DescriptorCache::SetDescriptorSetCapacity(uint32_t descriptor_set_capacity)
-    {
-        if (!m_rhi_device || !m_rhi_device->GetContextRhi())
-        {
-            LOG_ERROR_INVALID_INTERNALS();
+        if (m_descriptor_pools.empty())
             return;
-        }
 
-        // Wait in case the pool is being used
+        // Wait in case the descriptor sets are still in use
         m_rhi_device->Queue_WaitAll();
 
-        // Destroy layouts (and descriptor sets)
-        m_descriptor_set_layouts.clear();
-        m_descriptor_layout_current = nullptr;
-
-        // Destroy pool
-        if (m_descriptor_pool)
+        // Destroying a pool frees its descriptor sets
+        for (void*& descriptor_pool : m_descriptor_pools)
         {
-            vkDestroyDescriptorPool(m_rhi_device->GetContextRhi()->device, static_cast<VkDescriptorPool>(m_descriptor_pool), nullptr);
-            m_descriptor_pool = nullptr;
+            vkDestroyDescriptorPool(m_rhi_device->GetContextRhi()->device, static_cast<VkDescriptorPool>(descriptor_pool), nullptr);
         }
-
-        // Re-allocate everything with double size
-        CreateDescriptorPool(descriptor_set_capacity);
+        m_descriptor_pools.clear();
     }
 
     bool RHI_DescriptorCache::CreateDescriptorPool(uint32_t descriptor_set_capacity)
     {
-        // Pool sizes
+        if (!m_rhi_device || !m_rhi_device->GetContextRhi())
+        {
+            LOG_ERROR_INVALID_INTERNALS();
+            return false;
+        }
+
+        // Pool sizes, enough for every descriptor set to use the maximum of each type
         vector<VkDescriptorPoolSize> pool_sizes(4);
         pool_sizes[0].type              = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        pool_sizes[0].descriptorCount   = RHI_Context::descriptor_max_constant_buffers;
+        pool_sizes[0].descriptorCount   = RHI_Context::descriptor_max_constant_buffers * descriptor_set_capacity;
         pool_sizes[1].type              = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-        pool_sizes[1].descriptorCount   = RHI_Context::descriptor_max_constant_buffers_dynamic;
+        pool_sizes[1].descriptorCount   = RHI_Context::descriptor_max_constant_buffers_dynamic * descriptor_set_capacity;
         pool_sizes[2].type              = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-        pool_sizes[2].descriptorCount   = RHI_Context::descriptor_max_textures;
+        pool_sizes[2].descriptorCount   = RHI_Context::descriptor_max_textures * descriptor_set_capacity;
         pool_sizes[3].type              = VK_DESCRIPTOR_TYPE_SAMPLER;
-        pool_sizes[3].descriptorCount   = RHI_Context::descriptor_max_samplers;
+        pool_sizes[3].descriptorCount   = RHI_Context::descriptor_max_samplers * descriptor_set_capacity;
 
         // Create info
         VkDescriptorPoolCreateInfo pool_create_info = {};
         pool_create_info.sType          = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        pool_create_info.flags          = 0;
+        pool_create_info.flags          = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT; // evicted descriptor sets are freed individually
         pool_create_info.poolSizeCount  = static_cast<uint32_t>(pool_sizes.size());
         pool_create_info.pPoolSizes     = pool_sizes.data();
         pool_create_info.maxSets        = descriptor_set_capacity;
 
         // Pool
-        const auto descriptor_pool = reinterpret_cast<VkDescriptorPool*>(&m_descriptor_pool);
-        if (!vulkan_utility::error::check(vkCreateDescriptorPool(m_rhi_device->GetContextRhi()->device, &pool_create_info, nullptr, descriptor_pool)))
+        VkDescriptorPool descriptor_pool = nullptr;
+        if (!vulkan_utility::error::check(vkCreateDescriptorPool(m_rhi_device->GetContextRhi()->device, &pool_create_info, nullptr, &descriptor_pool)))
             return false;
 
+        m_descriptor_pools.emplace_back(static_cast<void*>(descriptor_pool));
+        m_descriptor_set_capacity += descriptor_set_capacity;
+
         return true;
     }
+
+    void* RHI_DescriptorCache::AllocateDescriptorSet(void* descriptor_pool, void* descriptor_set_layout)
+    {
+        // Allocate info
+        VkDescriptorSetAllocateInfo allocate_info   = {};
+        allocate_info.sType                         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocate_info.descriptorPool                = static_cast<VkDescriptorPool>(descriptor_pool);
+        allocate_info.descriptorSetCount            = 1;
+        allocate_info.pSetLayouts                   = reinterpret_cast<VkDescriptorSetLayout*>(&descriptor_set_layout);
+
+        // Allocate, running out of pool memory is expected and handled by the caller, so it's not checked
+        VkDescriptorSet descriptor_set = nullptr;
+        if (vkAllocateDescriptorSets(m_rhi_device->GetContextRhi()->device, &allocate_info, &descriptor_set) != VK_SUCCESS)
+            return nullptr;
+
+        return static_cast<void*>(descriptor_set);
+    }
+
+    void RHI_DescriptorCache::FreeDescriptorSet(void* descriptor_pool, void* descriptor_set)
+    {
+        VkDescriptorSet vk_descriptor_set = static_cast<VkDescriptorSet>(descriptor_set);
+        vkFreeDescriptorSets(m_rhi_device->GetContextRhi()->device, static_cast<VkDescriptorPool>(descriptor_pool), 1, &vk_descriptor_set);
+    }
 }
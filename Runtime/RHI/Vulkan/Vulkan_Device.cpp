@@ -268,6 +268,7 @@ namespace Spartan
         // Release resources
 		if (Queue_Wait(RHI_Queue_Graphics))
 		{
+            Release_All();
             m_rhi_context->destroy_allocator();
 
             if (m_rhi_context->debug)
@@ -35,18 +35,8 @@ namespace Spartan
 {
     void RHI_IndexBuffer::_destroy()
     {
-        // Wait in case the buffer is still in use
-        m_rhi_device->Queue_WaitAll();
-
-        // Unmap
-        if (m_mapped)
-        {
-            vmaUnmapMemory(m_rhi_device->GetContextRhi()->allocator, static_cast<VmaAllocation>(m_allocation));
-            m_mapped = nullptr;
-        }
-
-        // Destroy
-        vulkan_utility::buffer::destroy(m_buffer);
+        // The buffer might still be in use by frames in flight
+        vulkan_utility::buffer::destroy_deferred(m_buffer, m_allocation, m_mapped);
     }
 
 	bool RHI_IndexBuffer::_create(const void* indices)
@@ -40,7 +40,7 @@ using namespace std;
 
 namespace Spartan
 {
-	RHI_Pipeline::RHI_Pipeline(const RHI_Device* rhi_device, RHI_PipelineState& pipeline_state, void* descriptor_set_layout)
+	RHI_Pipeline::RHI_Pipeline(const RHI_Device* rhi_device, RHI_PipelineState& pipeline_state, void* descriptor_set_layout, void* pipeline_cache /*= nullptr*/)
 	{
 		m_rhi_device    = rhi_device;
 		m_state         = pipeline_state;
@@ -313,7 +313,7 @@ namespace Spartan
 
             // Create
             auto pipeline = reinterpret_cast<VkPipeline*>(&m_pipeline);
-            vulkan_utility::error::check(vkCreateGraphicsPipelines(m_rhi_device->GetContextRhi()->device, nullptr, 1, &pipeline_info, nullptr, pipeline));
+            vulkan_utility::error::check(vkCreateGraphicsPipelines(m_rhi_device->GetContextRhi()->device, static_cast<VkPipelineCache>(pipeline_cache), 1, &pipeline_info, nullptr, pipeline));
 
             // Name
             vulkan_utility::debug::set_name(*pipeline, m_state.pass_name);
@@ -322,13 +322,14 @@ namespace Spartan
 
 	RHI_Pipeline::~RHI_Pipeline()
 	{
-        // Wait in case the buffer is still in use
-        m_rhi_device->Queue_WaitAll();
-
-		vkDestroyPipeline(m_rhi_device->GetContextRhi()->device, static_cast<VkPipeline>(m_pipeline), nullptr);
-		m_pipeline = nullptr;
+        // The pipeline might still be in use by frames in flight
+        m_rhi_device->Release([device = m_rhi_device->GetContextRhi()->device, pipeline = m_pipeline, pipeline_layout = m_pipeline_layout]()
+        {
+		    vkDestroyPipeline(device, static_cast<VkPipeline>(pipeline), nullptr);
+		    vkDestroyPipelineLayout(device, static_cast<VkPipelineLayout>(pipeline_layout), nullptr);
+        });
 
-		vkDestroyPipelineLayout(m_rhi_device->GetContextRhi()->device, static_cast<VkPipelineLayout>(m_pipeline_layout), nullptr);
-		m_pipeline_layout = nullptr;
+		m_pipeline          = nullptr;
+		m_pipeline_layout   = nullptr;
 	}
 }
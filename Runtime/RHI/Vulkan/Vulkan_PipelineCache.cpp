@@ -0,0 +1,169 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES ========================
+#include "Spartan.h"
+#include "../RHI_Implementation.h"
+#include "../RHI_PipelineCache.h"
+#include "../RHI_Device.h"
+#include <fstream>
+//===================================
+
+//= NAMESPACES =====
+using namespace std;
+//==================
+
+namespace Spartan
+{
+    // Precedes the driver's data, so that data from another GPU or driver is never handed to the driver
+    struct PipelineCacheHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendor_id;
+        uint32_t device_id;
+        uint32_t driver_version;
+        uint8_t uuid[VK_UUID_SIZE];
+        uint64_t data_size;
+    };
+
+    static const uint32_t pipeline_cache_magic      = 0x43505053; // "SPPC"
+    static const uint32_t pipeline_cache_version    = 1;
+
+    static PipelineCacheHeader create_header(const VkPhysicalDeviceProperties& properties, const uint64_t data_size)
+    {
+        PipelineCacheHeader header  = {};
+        header.magic                = pipeline_cache_magic;
+        header.version              = pipeline_cache_version;
+        header.vendor_id            = properties.vendorID;
+        header.device_id            = properties.deviceID;
+        header.driver_version       = properties.driverVersion;
+        header.data_size            = data_size;
+        memcpy(header.uuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+        return header;
+    }
+
+    static vector<char> load(const string& file_path, const VkPhysicalDeviceProperties& properties)
+    {
+        vector<char> data;
+
+        ifstream in(file_path, ios::binary);
+        if (!in)
+            return data;
+
+        PipelineCacheHeader header = {};
+        if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+            return data;
+
+        const bool is_compatible =
+            header.magic            == pipeline_cache_magic     &&
+            header.version          == pipeline_cache_version   &&
+            header.vendor_id        == properties.vendorID      &&
+            header.device_id        == properties.deviceID      &&
+            header.driver_version   == properties.driverVersion &&
+            memcmp(header.uuid, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+
+        if (!is_compatible)
+        {
+            LOG_INFO("Ignoring the pipeline cache, it was created by a different GPU or driver");
+            return data;
+        }
+
+        data.resize(static_cast<size_t>(header.data_size));
+        if (!in.read(data.data(), data.size()))
+        {
+            LOG_WARNING("Ignoring the pipeline cache, it's truncated");
+            data.clear();
+        }
+
+        return data;
+    }
+
+    void RHI_PipelineCache::_Create()
+    {
+        const RHI_Context* rhi_context = m_rhi_device->GetContextRhi();
+
+        // What previous runs compiled
+        const vector<char> data = m_file_path.empty() ? vector<char>() : load(m_file_path, rhi_context->device_properties);
+
+        VkPipelineCacheCreateInfo create_info   = {};
+        create_info.sType                       = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        create_info.initialDataSize             = data.size();
+        create_info.pInitialData                = data.empty() ? nullptr : data.data();
+
+        VkPipelineCache pipeline_cache = nullptr;
+        if (vkCreatePipelineCache(rhi_context->device, &create_info, nullptr, &pipeline_cache) != VK_SUCCESS && !data.empty())
+        {
+            // Start empty rather than not at all
+            LOG_WARNING("The driver rejected the pipeline cache, starting with an empty one");
+            create_info.initialDataSize = 0;
+            create_info.pInitialData    = nullptr;
+            pipeline_cache              = nullptr;
+            vulkan_utility::error::check(vkCreatePipelineCache(rhi_context->device, &create_info, nullptr, &pipeline_cache));
+        }
+        else if (!data.empty())
+        {
+            LOG_INFO("Loaded %u kb of pipelines from \"%s\"", static_cast<uint32_t>(data.size() / 1000), m_file_path.c_str());
+        }
+
+        m_resource = static_cast<void*>(pipeline_cache);
+    }
+
+    void RHI_PipelineCache::_Destroy()
+    {
+        if (!m_resource)
+            return;
+
+        vkDestroyPipelineCache(m_rhi_device->GetContextRhi()->device, static_cast<VkPipelineCache>(m_resource), nullptr);
+        m_resource = nullptr;
+    }
+
+    bool RHI_PipelineCache::Save() const
+    {
+        if (!m_resource || m_file_path.empty())
+            return false;
+
+        const RHI_Context* rhi_context          = m_rhi_device->GetContextRhi();
+        const VkPipelineCache pipeline_cache    = static_cast<VkPipelineCache>(m_resource);
+
+        size_t data_size = 0;
+        if (!vulkan_utility::error::check(vkGetPipelineCacheData(rhi_context->device, pipeline_cache, &data_size, nullptr)) || data_size == 0)
+            return false;
+
+        vector<char> data(data_size);
+        if (!vulkan_utility::error::check(vkGetPipelineCacheData(rhi_context->device, pipeline_cache, &data_size, data.data())))
+            return false;
+
+        ofstream out(m_file_path, ios::binary | ios::trunc);
+        if (!out)
+        {
+            LOG_ERROR("Failed to write pipeline cache \"%s\"", m_file_path.c_str());
+            return false;
+        }
+
+        const PipelineCacheHeader header = create_header(rhi_context->device_properties, static_cast<uint64_t>(data_size));
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(data.data(), data_size);
+
+        return static_cast<bool>(out);
+    }
+}
@@ -75,7 +75,9 @@ namespace Spartan
         RHI_SwapChain* render_target_swapchain,
         array<RHI_Texture*, state_max_render_target_count>& render_target_color_textures,
         array<Math::Vector4, state_max_render_target_count>& render_target_color_clear,
+        const RHI_Image_Layout render_target_color_layout,
         RHI_Texture* render_target_depth_texture,
+        const RHI_Image_Layout render_target_depth_layout,
         float clear_value_depth,
         uint32_t clear_value_stencil,
         void*& render_pass
@@ -118,7 +120,8 @@ namespace Spartan
                         if (!texture)
                             continue;
 
-                        VkImageLayout layout = vulkan_image_layout[texture->GetLayout()];
+                        // The layout the pipeline state deduced, the texture may not have been transitioned to it yet
+                        VkImageLayout layout = vulkan_image_layout[render_target_color_layout];
 
                         VkAttachmentDescription attachment_desc  = {};
                         attachment_desc.format                   = vulkan_format[texture->GetFormat()];
@@ -141,7 +144,7 @@ namespace Spartan
             // Depth
             if (render_target_depth_texture)
             {
-                VkImageLayout layout = vulkan_image_layout[render_target_depth_texture->GetLayout()];
+                VkImageLayout layout = vulkan_image_layout[render_target_depth_layout];
 
                 VkAttachmentDescription attachment_desc  = {};
                 attachment_desc.format                   = vulkan_format[render_target_depth_texture->GetFormat()];
@@ -222,7 +225,7 @@ namespace Spartan
         DestroyFrameResources();
 
         // Create a render pass
-        if (!create_render_pass(m_rhi_device->GetContextRhi(), depth_stencil_state, render_target_swapchain, render_target_color_textures, clear_color, render_target_depth_texture, clear_depth, clear_stencil, m_render_pass))
+        if (!create_render_pass(m_rhi_device->GetContextRhi(), depth_stencil_state, render_target_swapchain, render_target_color_textures, clear_color, render_target_color_layout_initial, render_target_depth_texture, render_target_depth_layout_initial, clear_depth, clear_stencil, m_render_pass))
             return false;
 
         // Name the render pass
@@ -282,20 +285,21 @@ namespace Spartan
         if (!m_rhi_device)
             return;
 
-        // Wait in case the buffer is still in use by the graphics queue
-        m_rhi_device->Queue_Wait(RHI_Queue_Graphics);
-
-        for (uint32_t i = 0; i < state_max_render_target_count; i++)
+        // The frame buffers and the render pass might still be in use by frames in flight
+        m_rhi_device->Release([device = m_rhi_device->GetContextRhi()->device, frame_buffers = m_frame_buffers, render_pass = m_render_pass]()
         {
-            if (void* frame_buffer = m_frame_buffers[i])
+            for (void* frame_buffer : frame_buffers)
             {
-                vkDestroyFramebuffer(m_rhi_device->GetContextRhi()->device, static_cast<VkFramebuffer>(frame_buffer), nullptr);
+                if (frame_buffer)
+                {
+                    vkDestroyFramebuffer(device, static_cast<VkFramebuffer>(frame_buffer), nullptr);
+                }
             }
-        }
-        m_frame_buffers.fill(nullptr);
 
-        // Destroy render pass
-        vkDestroyRenderPass(m_rhi_device->GetContextRhi()->device, static_cast<VkRenderPass>(m_render_pass), nullptr);
+            vkDestroyRenderPass(device, static_cast<VkRenderPass>(render_pass), nullptr);
+        });
+
+        m_frame_buffers.fill(nullptr);
         m_render_pass = nullptr;
     }
 }
@@ -334,8 +334,42 @@ namespace Spartan
 		};
 	}
 	
+    const string& RHI_Shader::GetCompilerVersion()
+    {
+        static string version;
+        static once_flag version_flag;
+        call_once(version_flag, []()
+        {
+            UINT32 major = 0;
+            UINT32 minor = 0;
+            CComPtr<IDxcVersionInfo> version_info = nullptr;
+            if (SUCCEEDED(DxShaderCompiler::Instance::Get().compiler->QueryInterface(&version_info)))
+            {
+                version_info->GetVersion(&major, &minor);
+            }
+
+            // The arguments which don't vary per shader are part of the version, the resource shifts in particular
+            version =
+                "dxc " + to_string(major) + "." + to_string(minor) + " spirv vulkan1.1 shifts " +
+                to_string(RHI_Context::shader_shift_buffer)     + " " +
+                to_string(RHI_Context::shader_shift_texture)    + " " +
+                to_string(RHI_Context::shader_shift_sampler)    + " " +
+                to_string(RHI_Context::shader_shift_rw_buffer);
+            #ifdef DEBUG
+            version += " debug";
+            #endif
+        });
+
+        return version;
+    }
+
 	void* RHI_Shader::_Compile(const string& shader)
 	{
+        // Load the blob from the cache, if this exact compilation has been done before
+        vector<std::byte> blob_cached;
+        if (_CacheLoad(&blob_cached))
+            return _CreateResource(blob_cached.data(), blob_cached.size(), shader);
+
 		// Deduce some things
         const auto is_file	    = FileSystem::IsSupportedShaderFile(shader);
         const auto file_name	= is_file ? FileSystem::StringToWstring(FileSystem::GetFileNameFromFilePath(shader)) : wstring(L"shader");
@@ -441,47 +475,49 @@ namespace Spartan
 			}
 		}
 		
-		// Create shader module
-		CComPtr<IDxcBlob> shader_compiled	= nullptr;
-		VkShaderModule shader_module		= nullptr;
-        if (SUCCEEDED(compilation_result->GetResult(&shader_compiled)))
+		// Get the compiled blob, reflect shader resources (so that descriptor sets can be created later) and save both to the cache
+		CComPtr<IDxcBlob> shader_compiled = nullptr;
+        if (FAILED(compilation_result->GetResult(&shader_compiled)))
+		{
+            LOG_ERROR("Failed to get shader buffer.");
+            return nullptr;
+		}
+
+        _Reflect
+        (
+            m_shader_type,
+            reinterpret_cast<uint32_t*>(shader_compiled->GetBufferPointer()),
+            static_cast<uint32_t>(shader_compiled->GetBufferSize() / 4)
+        );
+        _CacheSave(shader_compiled->GetBufferPointer(), static_cast<uint64_t>(shader_compiled->GetBufferSize()));
+
+        return _CreateResource(shader_compiled->GetBufferPointer(), static_cast<size_t>(shader_compiled->GetBufferSize()), shader);
+	}
+
+    void* RHI_Shader::_CreateResource(const void* code, const size_t size, const string& shader)
+    {
+        VkShaderModuleCreateInfo create_info = {};
+        create_info.sType       = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        create_info.codeSize    = size;
+        create_info.pCode       = reinterpret_cast<const uint32_t*>(code);
+
+        VkShaderModule shader_module = nullptr;
+        if (vkCreateShaderModule(m_rhi_device->GetContextRhi()->device, &create_info, nullptr, &shader_module) != VK_SUCCESS)
         {
-			VkShaderModuleCreateInfo create_info = {};
-			create_info.sType		= VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-			create_info.codeSize	= static_cast<size_t>(shader_compiled->GetBufferSize());
-			create_info.pCode		= reinterpret_cast<const uint32_t*>(shader_compiled->GetBufferPointer());
-	
-			if (vkCreateShaderModule(m_rhi_device->GetContextRhi()->device, &create_info, nullptr, &shader_module) == VK_SUCCESS)
-			{
-				// Reflect shader resources (so that descriptor sets can be created later)
-				_Reflect
-				(
-                    m_shader_type,
-					reinterpret_cast<uint32_t*>(shader_compiled->GetBufferPointer()),
-					static_cast<uint32_t>(shader_compiled->GetBufferSize() / 4)
-				);
+            LOG_ERROR("Failed to create shader module.");
+            return nullptr;
+        }
 
-                // Create input layout
-                if (m_vertex_type != RHI_Vertex_Type_Unknown)
-                {
-                    if (!m_input_layout->Create(m_vertex_type, nullptr))
-                    {
-                        LOG_ERROR("Failed to create input layout for %s", FileSystem::GetFileNameFromFilePath(shader).c_str());
-                        return nullptr;
-                    }
-                }
-			}
-            else
+        // Create input layout
+        if (m_vertex_type != RHI_Vertex_Type_Unknown)
+        {
+            if (!m_input_layout->Create(m_vertex_type, nullptr))
             {
-                LOG_ERROR("Failed to create shader module.");
+                LOG_ERROR("Failed to create input layout for %s", FileSystem::GetFileNameFromFilePath(shader).c_str());
+                vkDestroyShaderModule(m_rhi_device->GetContextRhi()->device, shader_module, nullptr);
                 return nullptr;
             }
-		}	
-        else
-		{
-            LOG_ERROR("Failed to get shader buffer.");
-            return nullptr;
-		}
+        }
 
 		return static_cast<void*>(shader_module);
 	}		
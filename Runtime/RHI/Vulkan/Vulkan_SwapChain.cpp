@@ -252,9 +252,6 @@ namespace Spartan
 			m_image_acquired_semaphore
 		);
 
-        // Create command pool
-        vulkan_utility::command_pool::create(m_cmd_pool, RHI_Queue_Graphics);
-
         // Create command lists
         for (uint32_t i = 0; i < m_buffer_count; i++)
         {
@@ -272,9 +269,6 @@ namespace Spartan
         // Command buffers
         m_cmd_lists.clear();
 
-        // Command pool
-        vulkan_utility::command_pool::destroy(m_cmd_pool);
-
         // Resources
         _Vulkan_SwapChain::destroy
         (
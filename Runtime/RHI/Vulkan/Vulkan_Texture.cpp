@@ -179,17 +179,10 @@ namespace Spartan
         if (!m_rhi_device->IsInitialized())
             return;
 
-        m_rhi_device->Queue_WaitAll();
         m_data.clear();
 
-        vulkan_utility::image::view::destroy(m_resource_view[0]);
-        vulkan_utility::image::view::destroy(m_resource_view[1]);
-        for (uint32_t i = 0; i < state_max_render_target_count; i++)
-        {
-            vulkan_utility::image::view::destroy(m_resource_view_depthStencil[i]);
-            vulkan_utility::image::view::destroy(m_resource_view_renderTarget[i]);
-        }
-        vulkan_utility::image::destroy(this);
+        // The image might still be in use by frames in flight (e.g. a shadow map which was re-created)
+        vulkan_utility::image::destroy_deferred(this);
 	}
 
     void RHI_Texture::SetLayout(const RHI_Image_Layout new_layout, RHI_CommandList* command_list /*= nullptr*/)
@@ -318,17 +311,10 @@ namespace Spartan
         if (!m_rhi_device->IsInitialized())
             return;
 
-        m_rhi_device->Queue_WaitAll();
         m_data.clear();
 
-        vulkan_utility::image::view::destroy(m_resource_view[0]);
-        vulkan_utility::image::view::destroy(m_resource_view[1]);
-        for (uint32_t i = 0; i < state_max_render_target_count; i++)
-        {
-            vulkan_utility::image::view::destroy(m_resource_view_depthStencil[i]);
-            vulkan_utility::image::view::destroy(m_resource_view_renderTarget[i]);
-        }
-        vulkan_utility::image::destroy(this);
+        // Same as above
+        vulkan_utility::image::destroy_deferred(this);
 	}
 
 	bool RHI_TextureCube::CreateResourceGpu()
@@ -102,21 +102,51 @@ namespace Spartan::vulkan_utility
         return true;
 	}
 
-    void image::destroy(RHI_Texture* texture)
+    void image::destroy(void*& image, const uint64_t allocation_id)
     {
-        void* resource          = texture->Get_Resource();
-        uint64_t allocation_id  = texture->GetId();
-
         auto it = globals::rhi_context->allocations.find(allocation_id);
         if (it != globals::rhi_context->allocations.end())
         {
             VmaAllocation allocation = it->second;
-            vmaDestroyImage(globals::rhi_context->allocator, static_cast<VkImage>(resource), allocation);
+            vmaDestroyImage(globals::rhi_context->allocator, static_cast<VkImage>(image), allocation);
             globals::rhi_context->allocations.erase(allocation_id);
-            texture->Set_Resource(nullptr);
+            image = nullptr;
         }
     }
 
+    void image::destroy(RHI_Texture* texture)
+    {
+        void* resource = texture->Get_Resource();
+        destroy(resource, texture->GetId());
+        texture->Set_Resource(resource);
+    }
+
+    void image::destroy_deferred(RHI_Texture* texture)
+    {
+        // Copy the handles, the texture is gone by the time they are destroyed
+        void* resource                  = texture->Get_Resource();
+        const uint64_t allocation_id    = texture->GetId();
+        array<void*, 2> views           = { texture->Get_Resource_View(0), texture->Get_Resource_View(1) };
+        array<void*, state_max_render_target_count> views_render_target;
+        array<void*, state_max_render_target_count> views_depth_stencil;
+        for (uint32_t i = 0; i < state_max_render_target_count; i++)
+        {
+            views_render_target[i] = texture->Get_Resource_View_RenderTarget(i);
+            views_depth_stencil[i] = texture->Get_Resource_View_DepthStencil(i);
+        }
+
+        globals::rhi_device->Release([resource, allocation_id, views, views_render_target, views_depth_stencil]() mutable
+        {
+            view::destroy(views[0]);
+            view::destroy(views[1]);
+            view::destroy(views_render_target);
+            view::destroy(views_depth_stencil);
+            destroy(resource, allocation_id);
+        });
+
+        texture->Set_Resource(nullptr);
+    }
+
     VmaAllocation buffer::create(void*& _buffer, const uint64_t size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memory_property_flags, const bool written_frequently /*= false*/, const void* data /*= nullptr*/)
     {
         VmaAllocator allocator = globals::rhi_context->allocator;
@@ -202,4 +232,26 @@ namespace Spartan::vulkan_utility
             _buffer = nullptr;
         }
     }
+
+    void buffer::destroy_deferred(void*& _buffer, void*& allocation, void*& mapped)
+    {
+        if (!_buffer)
+            return;
+
+        globals::rhi_device->Release([buffer = _buffer, allocation, mapped]() mutable
+        {
+            // Unmap
+            if (mapped)
+            {
+                vmaUnmapMemory(globals::rhi_context->allocator, static_cast<VmaAllocation>(allocation));
+            }
+
+            // Destroy
+            destroy(buffer);
+        });
+
+        _buffer     = nullptr;
+        allocation  = nullptr;
+        mapped      = nullptr;
+    }
 }
@@ -469,6 +469,8 @@ namespace Spartan::vulkan_utility
 	{
         VmaAllocation create(void*& _buffer, const uint64_t size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memory_property_flags, const bool written_frequently = false, const void* data = nullptr);
         void destroy(void*& _buffer);
+        // Destroys the buffer once the frames in flight which could be using it have completed
+        void destroy_deferred(void*& _buffer, void*& allocation, void*& mapped);
 	}
 
     namespace image
@@ -540,7 +542,10 @@ namespace Spartan::vulkan_utility
 
         bool create(RHI_Texture* texture);
 
+        void destroy(void*& image, const uint64_t allocation_id);
         void destroy(RHI_Texture* texture);
+        // Destroys the image and its views once the frames in flight which could be using them have completed
+        void destroy_deferred(RHI_Texture* texture);
 
         inline VkPipelineStageFlags access_flags_to_pipeline_stage(VkAccessFlags access_flags, const VkPipelineStageFlags enabled_graphics_shader_stages)
         {
@@ -0,0 +1,216 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES ===============
+#include "Spartan.h"
+#include "LightClusters.h"
+//==========================
+
+//= NAMESPACES ================
+using namespace std;
+using namespace Spartan::Math;
+//=============================
+
+namespace Spartan
+{
+    LightClusters::LightClusters()
+    {
+        m_clusters.resize(cluster_count, 0);
+        m_indices.resize(index_max, 0);
+        m_cluster_min.resize(cluster_count);
+        m_cluster_max.resize(cluster_count);
+        m_cluster_lights.resize(cluster_count * cluster_light_max, 0);
+        m_cluster_light_counts.resize(cluster_count, 0);
+    }
+
+    void LightClusters::Build(const View& view, const vector<Light>& lights)
+    {
+        ComputeClusterBounds(view);
+
+        fill(m_cluster_light_counts.begin(), m_cluster_light_counts.end(), 0);
+        m_light_count   = Helper::Min(static_cast<uint32_t>(lights.size()), light_max);
+        m_overflowing   = lights.size() > light_max;
+
+        // Scatter every light into the clusters it touches, lights are visited in order so every cluster's list ends up sorted
+        for (uint32_t light_index = 0; light_index < m_light_count; light_index++)
+        {
+            const Light& light = lights[light_index];
+
+            const Vector3 center    = view.view * light.position;
+            const Vector4 direction = view.view * Vector4(light.direction.x, light.direction.y, light.direction.z, 0.0f);
+            const float radius      = light.range;
+
+            if (radius <= 0.0f || center.z + radius < view.near_plane || center.z - radius > view.far_plane)
+                continue;
+
+            const uint32_t slice_start  = ComputeSlice(center.z - radius);
+            const uint32_t slice_end    = ComputeSlice(center.z + radius);
+
+            for (uint32_t slice = slice_start; slice <= slice_end; slice++)
+            {
+                for (uint32_t y = 0; y < tile_count_y; y++)
+                {
+                    for (uint32_t x = 0; x < tile_count_x; x++)
+                    {
+                        const uint32_t cluster_index = ComputeClusterIndex(x, y, slice);
+                        if (!Intersects(cluster_index, center, radius, light, Vector3(direction.x, direction.y, direction.z)))
+                            continue;
+
+                        uint32_t& count = m_cluster_light_counts[cluster_index];
+                        if (count == cluster_light_max)
+                        {
+                            m_overflowing = true;
+                            continue;
+                        }
+
+                        m_cluster_lights[cluster_index * cluster_light_max + count] = static_cast<uint8_t>(light_index);
+                        count++;
+                    }
+                }
+            }
+        }
+
+        // Compact the per cluster lists into a single index list
+        m_index_count = 0;
+        for (uint32_t cluster_index = 0; cluster_index < cluster_count; cluster_index++)
+        {
+            uint32_t count = m_cluster_light_counts[cluster_index];
+            if (m_index_count + count > index_max)
+            {
+                count           = index_max - m_index_count;
+                m_overflowing   = true;
+            }
+
+            if (count != 0)
+            {
+                memcpy(&m_indices[m_index_count], &m_cluster_lights[cluster_index * cluster_light_max], count);
+            }
+
+            m_clusters[cluster_index]   = m_index_count | (count << 16);
+            m_index_count               += count;
+        }
+    }
+
+    uint32_t LightClusters::ComputeSlice(const float depth) const
+    {
+        if (depth <= m_view_bounds.near_plane)
+            return 0;
+
+        const float slice = log(depth) * m_slice_scale - m_slice_bias;
+        return static_cast<uint32_t>(Helper::Clamp(slice, 0.0f, static_cast<float>(slice_count - 1)));
+    }
+
+    void LightClusters::ComputeClusterBounds(const View& view)
+    {
+        const bool dirty =
+            m_bounds_dirty                                      ||
+            view.projection_x   != m_view_bounds.projection_x   ||
+            view.projection_y   != m_view_bounds.projection_y   ||
+            view.near_plane     != m_view_bounds.near_plane     ||
+            view.far_plane      != m_view_bounds.far_plane      ||
+            view.orthographic   != m_view_bounds.orthographic;
+
+        if (!dirty)
+            return;
+
+        m_view_bounds   = view;
+        m_bounds_dirty  = false;
+
+        const float near_plane  = Helper::Max(view.near_plane, Helper::M_EPSILON);
+        const float far_plane   = Helper::Max(view.far_plane, near_plane + Helper::M_EPSILON);
+        const float depth_ratio = log(far_plane / near_plane);
+        m_slice_scale           = static_cast<float>(slice_count) / depth_ratio;
+        m_slice_bias            = static_cast<float>(slice_count) * log(near_plane) / depth_ratio;
+
+        for (uint32_t slice = 0; slice < slice_count; slice++)
+        {
+            const float z_near  = near_plane * pow(far_plane / near_plane, static_cast<float>(slice) / slice_count);
+            const float z_far   = near_plane * pow(far_plane / near_plane, static_cast<float>(slice + 1) / slice_count);
+
+            for (uint32_t y = 0; y < tile_count_y; y++)
+            {
+                // Tiles go top to bottom, like texture coordinates
+                const float ndc_y_max = 1.0f - 2.0f * static_cast<float>(y) / tile_count_y;
+                const float ndc_y_min = 1.0f - 2.0f * static_cast<float>(y + 1) / tile_count_y;
+
+                for (uint32_t x = 0; x < tile_count_x; x++)
+                {
+                    const float ndc_x_min = -1.0f + 2.0f * static_cast<float>(x) / tile_count_x;
+                    const float ndc_x_max = -1.0f + 2.0f * static_cast<float>(x + 1) / tile_count_x;
+
+                    // A perspective tile widens with depth, so its extent is taken at both ends of the slice
+                    const float scale_near  = view.orthographic ? 1.0f : z_near;
+                    const float scale_far   = view.orthographic ? 1.0f : z_far;
+
+                    const uint32_t cluster_index = ComputeClusterIndex(x, y, slice);
+                    m_cluster_min[cluster_index] = Vector3
+                    (
+                        Helper::Min(ndc_x_min * scale_near, ndc_x_min * scale_far) / view.projection_x,
+                        Helper::Min(ndc_y_min * scale_near, ndc_y_min * scale_far) / view.projection_y,
+                        z_near
+                    );
+                    m_cluster_max[cluster_index] = Vector3
+                    (
+                        Helper::Max(ndc_x_max * scale_near, ndc_x_max * scale_far) / view.projection_x,
+                        Helper::Max(ndc_y_max * scale_near, ndc_y_max * scale_far) / view.projection_y,
+                        z_far
+                    );
+                }
+            }
+        }
+    }
+
+    bool LightClusters::Intersects(const uint32_t cluster_index, const Vector3& center, const float radius, const Light& light, const Vector3& direction) const
+    {
+        const Vector3& box_min = m_cluster_min[cluster_index];
+        const Vector3& box_max = m_cluster_max[cluster_index];
+
+        // Sphere against the cluster's bounding box
+        const Vector3 closest = Vector3
+        (
+            Helper::Clamp(center.x, box_min.x, box_max.x),
+            Helper::Clamp(center.y, box_min.y, box_max.y),
+            Helper::Clamp(center.z, box_min.z, box_max.z)
+        );
+
+        if (Vector3::DistanceSquared(closest, center) > radius * radius)
+            return false;
+
+        // Point light
+        if (light.cos_angle <= -1.0f)
+            return true;
+
+        // Cone against the cluster's bounding sphere
+        const Vector3 cluster_center    = (box_min + box_max) * 0.5f;
+        const float cluster_radius      = (box_max - box_min).Length() * 0.5f;
+        const Vector3 v                 = cluster_center - center;
+        const float v_length_squared    = v.LengthSquared();
+        const float v_along_axis        = Vector3::Dot(v, direction);
+        const float sin_angle           = sqrt(Helper::Max(1.0f - light.cos_angle * light.cos_angle, 0.0f));
+        const float distance_to_cone    = light.cos_angle * sqrt(Helper::Max(v_length_squared - v_along_axis * v_along_axis, 0.0f)) - v_along_axis * sin_angle;
+
+        const bool outside_angle    = distance_to_cone > cluster_radius;
+        const bool beyond_range     = v_along_axis > cluster_radius + light.range;
+        const bool behind_apex      = light.cos_angle > 0.0f && v_along_axis < -cluster_radius;
+
+        return !outside_angle && !beyond_range && !behind_apex;
+    }
+}
@@ -0,0 +1,104 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+//= INCLUDES ======================
+#include <vector>
+#include "../Math/Matrix.h"
+#include "../Core/Spartan_Definitions.h"
+//=================================
+
+namespace Spartan
+{
+    // Bins lights into a grid of froxels (screen tiles by exponentially distributed depth slices) and produces, for every froxel,
+    // a compact list of the lights which can reach it. It only depends on the math library, so it can be driven and verified on its own.
+    class SPARTAN_CLASS LightClusters
+    {
+    public:
+        static const uint32_t tile_count_x  = 16;   // must match the shader
+        static const uint32_t tile_count_y  = 8;    // must match the shader
+        static const uint32_t slice_count   = 24;   // must match the shader
+        static const uint32_t cluster_count = tile_count_x * tile_count_y * slice_count;
+        static const uint32_t light_max     = 256;  // must match the shader, light indices are packed as bytes
+        static const uint32_t index_max     = 32768; // must match the shader
+        static const uint32_t cluster_light_max = 128; // lights beyond this, in a single froxel, are dropped
+
+        struct Light
+        {
+            Math::Vector3 position  = Math::Vector3::Zero;
+            Math::Vector3 direction = Math::Vector3::Forward;
+            float range             = 0.0f;
+            float cos_angle         = -1.0f; // cosine of the cone's half angle, -1 for point lights
+        };
+
+        struct View
+        {
+            Math::Matrix view       = Math::Matrix::Identity;
+            float projection_x      = 1.0f; // projection.m00
+            float projection_y      = 1.0f; // projection.m11
+            float near_plane        = 0.3f;
+            float far_plane         = 1000.0f;
+            bool orthographic       = false;
+        };
+
+        LightClusters();
+        ~LightClusters() = default;
+
+        void Build(const View& view, const std::vector<Light>& lights);
+
+        // Per cluster, the offset of its first index (low 16 bits) and its light count (high 16 bits)
+        const auto& GetClusters()   const { return m_clusters; }
+        const auto& GetIndices()    const { return m_indices; }
+        uint32_t GetIndexCount()    const { return m_index_count; }
+        uint32_t GetLightCount()    const { return m_light_count; }
+        bool IsOverflowing()        const { return m_overflowing; } // some light references were dropped
+
+        // Slice distribution, slice = log(depth) * scale - bias
+        float GetSliceScale()       const { return m_slice_scale; }
+        float GetSliceBias()        const { return m_slice_bias; }
+        uint32_t ComputeSlice(const float depth) const;
+        static uint32_t ComputeClusterIndex(const uint32_t x, const uint32_t y, const uint32_t slice) { return x + y * tile_count_x + slice * tile_count_x * tile_count_y; }
+
+    private:
+        void ComputeClusterBounds(const View& view);
+        bool Intersects(const uint32_t cluster_index, const Math::Vector3& center, const float radius, const Light& light, const Math::Vector3& direction) const;
+
+        // Output
+        std::vector<uint32_t> m_clusters;
+        std::vector<uint8_t> m_indices;
+        uint32_t m_index_count  = 0;
+        uint32_t m_light_count  = 0;
+        bool m_overflowing      = false;
+
+        // Cluster bounds (view space), only recomputed when the projection changes
+        std::vector<Math::Vector3> m_cluster_min;
+        std::vector<Math::Vector3> m_cluster_max;
+        View m_view_bounds;
+        bool m_bounds_dirty     = true;
+        float m_slice_scale     = 0.0f;
+        float m_slice_bias      = 0.0f;
+
+        // Scratch, cluster_light_max entries per cluster
+        std::vector<uint8_t> m_cluster_lights;
+        std::vector<uint32_t> m_cluster_light_counts;
+    };
+}
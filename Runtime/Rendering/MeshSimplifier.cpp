@@ -0,0 +1,387 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES ==================
+#include "Spartan.h"
+#include "MeshSimplifier.h"
+#include <numeric>
+#include <unordered_map>
+//=============================
+
+//= NAMESPACES ================
+using namespace std;
+using namespace Spartan::Math;
+//=============================
+
+namespace Spartan
+{
+    // The sum of the squared distances to a set of planes, weighted by the area of the triangles they came from
+    struct Quadric
+    {
+        void AddPlane(const Vector3& normal, const float distance, const float weight)
+        {
+            a00 += weight * normal.x * normal.x;
+            a11 += weight * normal.y * normal.y;
+            a22 += weight * normal.z * normal.z;
+            a10 += weight * normal.y * normal.x;
+            a20 += weight * normal.z * normal.x;
+            a21 += weight * normal.z * normal.y;
+            b0  += weight * normal.x * distance;
+            b1  += weight * normal.y * distance;
+            b2  += weight * normal.z * distance;
+            c   += weight * distance * distance;
+            w   += weight;
+        }
+
+        void Add(const Quadric& other)
+        {
+            a00 += other.a00; a11 += other.a11; a22 += other.a22;
+            a10 += other.a10; a20 += other.a20; a21 += other.a21;
+            b0  += other.b0;  b1  += other.b1;  b2  += other.b2;
+            c   += other.c;
+            w   += other.w;
+        }
+
+        // Mean squared distance of a position to the planes
+        float Error(const Vector3& p) const
+        {
+            const float rx = a00 * p.x + a10 * p.y + a20 * p.z;
+            const float ry = a10 * p.x + a11 * p.y + a21 * p.z;
+            const float rz = a20 * p.x + a21 * p.y + a22 * p.z;
+            const float e  = rx * p.x + ry * p.y + rz * p.z + 2.0f * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+
+            return Helper::Max(e, 0.0f) / Helper::Max(w, Helper::M_EPSILON);
+        }
+
+        float a00 = 0.0f, a11 = 0.0f, a22 = 0.0f;
+        float a10 = 0.0f, a20 = 0.0f, a21 = 0.0f;
+        float b0  = 0.0f, b1  = 0.0f, b2  = 0.0f;
+        float c   = 0.0f;
+        float w   = 0.0f;
+    };
+
+    struct Collapse
+    {
+        uint32_t from   = 0;
+        uint32_t to     = 0;
+        float cost      = 0.0f;
+    };
+
+    static bool attributes_equal(const RHI_Vertex_PosTexNorTan& a, const RHI_Vertex_PosTexNorTan& b)
+    {
+        const float epsilon = 1e-4f;
+
+        return
+            Helper::Abs(a.tex[0] - b.tex[0]) < epsilon && Helper::Abs(a.tex[1] - b.tex[1]) < epsilon &&
+            Helper::Abs(a.nor[0] - b.nor[0]) < epsilon && Helper::Abs(a.nor[1] - b.nor[1]) < epsilon && Helper::Abs(a.nor[2] - b.nor[2]) < epsilon;
+    }
+
+    float MeshSimplifier::Simplify(const RHI_Vertex_PosTexNorTan* vertices, const uint32_t vertex_count, const uint32_t* indices, const uint32_t index_count, const uint32_t target_index_count, const float target_error, vector<uint32_t>* indices_out)
+    {
+        if (!vertices || !indices || !indices_out || index_count % 3 != 0)
+        {
+            LOG_ERROR_INVALID_PARAMETER();
+            return 0.0f;
+        }
+
+        indices_out->assign(indices, indices + index_count);
+        if (target_index_count >= index_count)
+            return 0.0f;
+
+        for (uint32_t i = 0; i < index_count; i++)
+        {
+            if (indices[i] >= vertex_count)
+            {
+                LOG_ERROR("Index %d is out of range", indices[i]);
+                return 0.0f;
+            }
+        }
+
+        // Normalize the positions, so that errors are relative to the size of the mesh
+        vector<Vector3> positions(vertex_count);
+        {
+            Vector3 min = Vector3::Infinity;
+            Vector3 max = Vector3::InfinityNeg;
+            for (uint32_t i = 0; i < vertex_count; i++)
+            {
+                positions[i]    = Vector3(vertices[i].pos[0], vertices[i].pos[1], vertices[i].pos[2]);
+                min             = Vector3(Helper::Min(min.x, positions[i].x), Helper::Min(min.y, positions[i].y), Helper::Min(min.z, positions[i].z));
+                max             = Vector3(Helper::Max(max.x, positions[i].x), Helper::Max(max.y, positions[i].y), Helper::Max(max.z, positions[i].z));
+            }
+
+            const Vector3 size      = max - min;
+            const float scale_inv   = 1.0f / Helper::Max(Helper::Max(size.x, Helper::Max(size.y, size.z)), Helper::M_EPSILON);
+            for (Vector3& position : positions)
+            {
+                position = (position - min) * scale_inv;
+            }
+        }
+
+        // Vertices which share a position are one vertex as far as the topology goes (remap points to the first of them). If they also
+        // share their attributes they are merged altogether, if not, they lie on a seam and are locked so that the seam doesn't tear.
+        vector<uint32_t> remap(vertex_count);
+        vector<uint8_t> locked(vertex_count, 0);
+        {
+            vector<uint32_t> order(vertex_count);
+            iota(order.begin(), order.end(), 0);
+            sort(order.begin(), order.end(), [vertices](const uint32_t a, const uint32_t b)
+            {
+                const float* pa = vertices[a].pos;
+                const float* pb = vertices[b].pos;
+                if (pa[0] != pb[0]) return pa[0] < pb[0];
+                if (pa[1] != pb[1]) return pa[1] < pb[1];
+                if (pa[2] != pb[2]) return pa[2] < pb[2];
+                return a < b;
+            });
+
+            for (uint32_t i = 0; i < vertex_count;)
+            {
+                const uint32_t first = order[i];
+                const float* p = vertices[first].pos;
+
+                uint32_t j = i;
+                for (; j < vertex_count; j++)
+                {
+                    const float* q = vertices[order[j]].pos;
+                    if (q[0] != p[0] || q[1] != p[1] || q[2] != p[2])
+                        break;
+
+                    remap[order[j]] = first;
+                    if (!attributes_equal(vertices[first], vertices[order[j]]))
+                    {
+                        locked[first] = 1;
+                    }
+                }
+
+                i = j;
+            }
+        }
+
+        // Merge the duplicates and drop the triangles which are degenerate to begin with
+        {
+            uint32_t count = 0;
+            for (uint32_t i = 0; i < index_count; i += 3)
+            {
+                uint32_t triangle[3];
+                for (uint32_t corner = 0; corner < 3; corner++)
+                {
+                    const uint32_t index    = indices[i + corner];
+                    triangle[corner]        = locked[remap[index]] ? index : remap[index];
+                }
+
+                if (remap[triangle[0]] == remap[triangle[1]] || remap[triangle[1]] == remap[triangle[2]] || remap[triangle[2]] == remap[triangle[0]])
+                    continue;
+
+                (*indices_out)[count++] = triangle[0];
+                (*indices_out)[count++] = triangle[1];
+                (*indices_out)[count++] = triangle[2];
+            }
+            indices_out->resize(count);
+        }
+
+        // Edges which aren't shared by exactly two triangles are open borders (or worse), their vertices are locked to keep the outline
+        {
+            unordered_map<uint64_t, uint32_t> edges;
+            edges.reserve(indices_out->size());
+            for (uint32_t i = 0; i < static_cast<uint32_t>(indices_out->size()); i += 3)
+            {
+                for (uint32_t corner = 0; corner < 3; corner++)
+                {
+                    const uint32_t a = remap[(*indices_out)[i + corner]];
+                    const uint32_t b = remap[(*indices_out)[i + (corner + 1) % 3]];
+                    edges[(static_cast<uint64_t>(Helper::Min(a, b)) << 32) | Helper::Max(a, b)]++;
+                }
+            }
+
+            for (const auto& edge : edges)
+            {
+                if (edge.second != 2)
+                {
+                    locked[static_cast<uint32_t>(edge.first >> 32)]         = 1;
+                    locked[static_cast<uint32_t>(edge.first & 0xFFFFFFFF)]  = 1;
+                }
+            }
+        }
+
+        // Every vertex starts with the planes of the triangles around it
+        vector<Quadric> quadrics(vertex_count);
+        for (uint32_t i = 0; i < static_cast<uint32_t>(indices_out->size()); i += 3)
+        {
+            const uint32_t v0 = remap[(*indices_out)[i + 0]];
+            const uint32_t v1 = remap[(*indices_out)[i + 1]];
+            const uint32_t v2 = remap[(*indices_out)[i + 2]];
+
+            Vector3 normal      = Vector3::Cross(positions[v1] - positions[v0], positions[v2] - positions[v0]);
+            const float length  = normal.Length();
+            if (length <= Helper::M_EPSILON)
+                continue;
+
+            normal              *= 1.0f / length;
+            const float distance = -Vector3::Dot(normal, positions[v0]);
+            const float area     = length * 0.5f;
+
+            quadrics[v0].AddPlane(normal, distance, area);
+            quadrics[v1].AddPlane(normal, distance, area);
+            quadrics[v2].AddPlane(normal, distance, area);
+        }
+
+        // Collapse in passes, cheapest first. A vertex takes part in at most one collapse per pass, and so do the vertices around it,
+        // which keeps the triangles a collapse inspects unchanged until the pass is applied.
+        const float error_limit = target_error * target_error;
+        float error_max         = 0.0f;
+        vector<uint32_t> adjacency_offsets(vertex_count + 1);
+        vector<uint32_t> adjacency;
+        vector<uint32_t> index_remap(vertex_count);
+        vector<uint8_t> touched(vertex_count);
+        vector<Collapse> collapses;
+        while (indices_out->size() > target_index_count)
+        {
+            vector<uint32_t>& triangles     = *indices_out;
+            const uint32_t triangle_count   = static_cast<uint32_t>(triangles.size() / 3);
+
+            // Triangles around each vertex
+            fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0);
+            for (const uint32_t index : triangles)
+            {
+                adjacency_offsets[remap[index] + 1]++;
+            }
+            for (uint32_t i = 0; i < vertex_count; i++)
+            {
+                adjacency_offsets[i + 1] += adjacency_offsets[i];
+            }
+            adjacency.resize(triangles.size());
+            {
+                vector<uint32_t> cursor(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+                for (uint32_t i = 0; i < static_cast<uint32_t>(triangles.size()); i++)
+                {
+                    adjacency[cursor[remap[triangles[i]]]++] = i / 3;
+                }
+            }
+
+            // Every edge can collapse either way, unless the vertex which would move is locked
+            collapses.clear();
+            for (uint32_t i = 0; i < static_cast<uint32_t>(triangles.size()); i++)
+            {
+                const uint32_t a = remap[triangles[i]];
+                const uint32_t b = remap[triangles[i - i % 3 + (i % 3 + 1) % 3]];
+
+                if (!locked[a])
+                {
+                    Quadric quadric = quadrics[a];
+                    quadric.Add(quadrics[b]);
+                    collapses.push_back({ a, b, quadric.Error(positions[b]) });
+                }
+            }
+            sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+            iota(index_remap.begin(), index_remap.end(), 0);
+            fill(touched.begin(), touched.end(), 0);
+            const uint32_t triangles_to_remove  = (static_cast<uint32_t>(triangles.size()) - target_index_count) / 3 + 1;
+            uint32_t triangles_removed          = 0;
+            uint32_t collapse_count             = 0;
+            for (const Collapse& collapse : collapses)
+            {
+                if (collapse.cost > error_limit || triangles_removed >= triangles_to_remove)
+                    break;
+
+                if (touched[collapse.from] || touched[collapse.to])
+                    continue;
+
+                // Seams split the target into several vertices, the triangles around the moving vertex must all see the same one (or the
+                // seam would tear), and the ones which don't degenerate must not turn by more than 60 degrees. Turning by anything short of
+                // flipping isn't enough, a triangle can take part in several collapses and end up facing away after all.
+                uint32_t target         = numeric_limits<uint32_t>::max();
+                uint32_t degenerate     = 0;
+                bool valid              = true;
+                for (uint32_t a = adjacency_offsets[collapse.from]; a < adjacency_offsets[collapse.from + 1] && valid; a++)
+                {
+                    const uint32_t* triangle = &triangles[adjacency[a] * 3];
+
+                    uint32_t corner_to = 3;
+                    for (uint32_t corner = 0; corner < 3; corner++)
+                    {
+                        if (remap[triangle[corner]] == collapse.to)
+                        {
+                            corner_to = corner;
+                        }
+                    }
+
+                    if (corner_to != 3)
+                    {
+                        valid = target == numeric_limits<uint32_t>::max() || target == triangle[corner_to];
+                        target = triangle[corner_to];
+                        degenerate++;
+                        continue;
+                    }
+
+                    const Vector3& p0   = positions[remap[triangle[0]]];
+                    const Vector3& p1   = positions[remap[triangle[1]]];
+                    const Vector3& p2   = positions[remap[triangle[2]]];
+                    const Vector3& q0   = remap[triangle[0]] == collapse.from ? positions[collapse.to] : p0;
+                    const Vector3& q1   = remap[triangle[1]] == collapse.from ? positions[collapse.to] : p1;
+                    const Vector3& q2   = remap[triangle[2]] == collapse.from ? positions[collapse.to] : p2;
+                    const Vector3 before = Vector3::Cross(p1 - p0, p2 - p0);
+                    const Vector3 after  = Vector3::Cross(q1 - q0, q2 - q0);
+                    valid = Vector3::Dot(before, after) > 0.5f * before.Length() * after.Length();
+                }
+
+                if (!valid || target == numeric_limits<uint32_t>::max())
+                    continue;
+
+                index_remap[collapse.from] = target;
+                quadrics[collapse.to].Add(quadrics[collapse.from]);
+                for (uint32_t a = adjacency_offsets[collapse.from]; a < adjacency_offsets[collapse.from + 1]; a++)
+                {
+                    const uint32_t* triangle = &triangles[adjacency[a] * 3];
+                    touched[remap[triangle[0]]] = 1;
+                    touched[remap[triangle[1]]] = 1;
+                    touched[remap[triangle[2]]] = 1;
+                }
+
+                error_max           = Helper::Max(error_max, collapse.cost);
+                triangles_removed   += degenerate;
+                collapse_count++;
+            }
+
+            if (collapse_count == 0)
+                break;
+
+            // Apply the collapses, dropping the triangles which became lines
+            uint32_t count = 0;
+            for (uint32_t i = 0; i < triangle_count * 3; i += 3)
+            {
+                const uint32_t i0 = index_remap[triangles[i + 0]];
+                const uint32_t i1 = index_remap[triangles[i + 1]];
+                const uint32_t i2 = index_remap[triangles[i + 2]];
+
+                if (remap[i0] == remap[i1] || remap[i1] == remap[i2] || remap[i2] == remap[i0])
+                    continue;
+
+                triangles[count++] = i0;
+                triangles[count++] = i1;
+                triangles[count++] = i2;
+            }
+            triangles.resize(count);
+        }
+
+        return sqrt(error_max);
+    }
+}
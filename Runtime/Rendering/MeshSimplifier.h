@@ -0,0 +1,52 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+//= INCLUDES ======================
+#include <vector>
+#include "../RHI/RHI_Vertex.h"
+#include "../Core/Spartan_Definitions.h"
+//=================================
+
+namespace Spartan
+{
+    // Reduces the triangle count of a mesh by collapsing edges onto one of their vertices, in order of the quadric error they
+    // introduce (the squared distance to the planes of the triangles which were merged into a vertex). Vertices are never moved
+    // or created, so the result indexes the same vertices and can share their buffer. Vertices on open borders and on attribute
+    // seams are kept in place, which preserves silhouettes and texture mapping at the cost of reducing less around them.
+    // It only depends on the vertex layout, so it can be driven and verified on its own.
+    class SPARTAN_CLASS MeshSimplifier
+    {
+    public:
+        // Simplifies the triangles down to about target_index_count indices, stopping early if a collapse would exceed target_error.
+        // Errors are relative to the largest dimension of the mesh. Returns the largest error introduced, in the same units.
+        static float Simplify(
+            const RHI_Vertex_PosTexNorTan* vertices,
+            uint32_t vertex_count,
+            const uint32_t* indices,
+            uint32_t index_count,
+            uint32_t target_index_count,
+            float target_error,
+            std::vector<uint32_t>* indices_out
+        );
+    };
+}
@@ -23,6 +23,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Spartan.h"
 #include "Model.h"
 #include "Mesh.h"
+#include "MeshSimplifier.h"
 #include "Renderer.h"
 #include "../IO/FileStream.h"
 #include "../Core/Stopwatch.h"
@@ -62,6 +63,7 @@ namespace Spartan
         m_vertex_buffer.reset();
         m_index_buffer.reset();
         m_mesh->Geometry_Clear();
+        m_lods.clear();
         m_aabb.Undefine();
         m_normalized_scale = 1.0f;
         m_is_animated = false;
@@ -90,6 +92,21 @@ namespace Spartan
             file->Read(&m_mesh->Indices_Get());
             file->Read(&m_mesh->Vertices_Get());
 
+            // Levels of detail (older files end before them, which reads as zero meshes)
+            uint32_t lod_mesh_count = 0;
+            file->Read(&lod_mesh_count);
+            for (uint32_t mesh_index = 0; mesh_index < lod_mesh_count; mesh_index++)
+            {
+                vector<ModelLod>& lods = m_lods[file->ReadAs<uint32_t>()];
+                lods.resize(file->ReadAs<uint32_t>());
+                for (ModelLod& lod : lods)
+                {
+                    file->Read(&lod.index_offset);
+                    file->Read(&lod.index_count);
+                    file->Read(&lod.error);
+                }
+            }
+
             UpdateGeometry();
         }
         // Load foreign format
@@ -102,7 +119,6 @@ namespace Spartan
                 // Set the normalized scale to the root entity's transform
                 m_normalized_scale = GeometryComputeNormalizedScale();
                 m_root_entity.lock()->GetComponent<Transform>()->SetScale(m_normalized_scale);
-                m_root_entity.lock()->GetComponent<Transform>()->UpdateTransform();
             }
             else
             {
@@ -139,6 +155,19 @@ namespace Spartan
 		file->Write(m_mesh->Indices_Get());
 		file->Write(m_mesh->Vertices_Get());
 
+        file->Write(static_cast<uint32_t>(m_lods.size()));
+        for (const auto& it : m_lods)
+        {
+            file->Write(it.first);
+            file->Write(static_cast<uint32_t>(it.second.size()));
+            for (const ModelLod& lod : it.second)
+            {
+                file->Write(lod.index_offset);
+                file->Write(lod.index_count);
+                file->Write(lod.error);
+            }
+        }
+
         file->Close();
 
 		return true;
@@ -157,6 +186,47 @@ namespace Spartan
 		m_mesh->Vertices_Append(vertices, vertex_offset);
 	}
 
+    void Model::GeometryGenerateLods(const vector<uint32_t>& indices, const vector<RHI_Vertex_PosTexNorTan>& vertices, const uint32_t index_offset)
+    {
+        const uint32_t index_count  = static_cast<uint32_t>(indices.size());
+        const uint32_t vertex_count = static_cast<uint32_t>(vertices.size());
+        if (index_count / 3 < m_lod_triangle_min)
+            return;
+
+        vector<ModelLod> lods;
+        lods.push_back({ index_offset, index_count, 0.0f });
+
+        // Every level aims for half the triangles of the previous one, and is allowed twice its error. They are all simplified from
+        // the full detail geometry, so that errors don't accumulate from one level to the next.
+        vector<uint32_t> lod_indices;
+        for (uint32_t lod_index = 1; lod_index < m_lod_count_max; lod_index++)
+        {
+            const uint32_t target_index_count   = (index_count >> lod_index) / 3 * 3;
+            const float target_error            = GetLodErrorAllowed(lod_index);
+            const float error                   = MeshSimplifier::Simplify(vertices.data(), vertex_count, indices.data(), index_count, target_index_count, target_error, &lod_indices);
+
+            // A level which is barely smaller than the previous one isn't worth switching to, and neither are the ones after it
+            if (lod_indices.empty() || lod_indices.size() > lods.back().index_count * 4 / 5)
+                break;
+
+            ModelLod& lod   = lods.emplace_back();
+            lod.index_count = static_cast<uint32_t>(lod_indices.size());
+            lod.error       = error;
+            m_mesh->Indices_Append(lod_indices, &lod.index_offset);
+        }
+
+        if (lods.size() > 1)
+        {
+            m_lods[index_offset] = move(lods);
+        }
+    }
+
+    const vector<ModelLod>* Model::GetLods(const uint32_t index_offset) const
+    {
+        const auto it = m_lods.find(index_offset);
+        return it != m_lods.end() ? &it->second : nullptr;
+    }
+
 	void Model::GetGeometry(const uint32_t index_offset, const uint32_t index_count, const uint32_t vertex_offset, const uint32_t vertex_count, vector<uint32_t>* indices, vector<RHI_Vertex_PosTexNorTan>* vertices) const
 	{
 		m_mesh->Geometry_Get(index_offset, index_count, vertex_offset, vertex_count, indices, vertices);
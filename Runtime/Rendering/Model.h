@@ -24,6 +24,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //= INCLUDES =====================
 #include <memory>
 #include <vector>
+#include <unordered_map>
 #include "Material.h"
 #include "../RHI/RHI_Definition.h"
 #include "../Resource/IResource.h"
@@ -37,6 +38,14 @@ namespace Spartan
 	class Mesh;
 	namespace Math{ class BoundingBox; }
 
+    // A simplified version of a mesh, a range of the index buffer which indexes the same vertices as the full detail geometry
+    struct ModelLod
+    {
+        uint32_t index_offset   = 0;
+        uint32_t index_count    = 0;
+        float error             = 0.0f; // relative to the largest dimension of the mesh
+    };
+
 	class SPARTAN_CLASS Model : public IResource, public std::enable_shared_from_this<Model>
 	{
 	public:
@@ -69,6 +78,11 @@ namespace Spartan
         const auto& GetAabb() const { return m_aabb; }
         const auto& GetMesh() const { return m_mesh; }
 
+        // Levels of detail, the simplified versions are appended right after the geometry they are generated from
+        void GeometryGenerateLods(const std::vector<uint32_t>& indices, const std::vector<RHI_Vertex_PosTexNorTan>& vertices, uint32_t index_offset);
+        const std::vector<ModelLod>* GetLods(uint32_t index_offset) const;
+        float GetLodErrorAllowed(const uint32_t lod_index) const { return lod_index == 0 ? 0.0f : m_lod_error * static_cast<float>(1 << (lod_index - 1)); }
+
 		// Add resources to the model
         void SetRootEntity(const std::shared_ptr<Entity>& entity) { m_root_entity = entity; }
 		void AddMaterial(std::shared_ptr<Material>& material, const std::shared_ptr<Entity>& entity) const;
@@ -95,6 +109,12 @@ namespace Spartan
 		float m_normalized_scale	= 1.0f;
 		bool m_is_animated			= false;
 
+        // Levels of detail, per mesh, keyed by the index offset of its full detail geometry (which is level 0)
+        std::unordered_map<uint32_t, std::vector<ModelLod>> m_lods;
+        uint32_t m_lod_count_max    = 5;        // including the full detail geometry
+        uint32_t m_lod_triangle_min = 256;      // below this, meshes are cheap enough as they are
+        float m_lod_error           = 0.01f;    // error allowed to the first level, each subsequent level doubles it
+
         // Dependencies
 		ResourceCache* m_resource_manager;
 		std::shared_ptr<RHI_Device> m_rhi_device;	
@@ -0,0 +1,314 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES ================
+#include "Spartan.h"
+#include "OcclusionBuffer.h"
+//===========================
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define SPARTAN_OCCLUSION_SSE
+#include <emmintrin.h>
+#endif
+
+//= NAMESPACES ================
+using namespace std;
+using namespace Spartan::Math;
+//=============================
+
+namespace Spartan
+{
+    // Projects to pixel coordinates, fails for anything in front of the near plane, as such triangles or boxes are not clipped
+    static bool project(const Matrix& transform, const float* position, const bool reverse_z, float* x, float* y, float* closeness)
+    {
+        const float clip_x = (position[0] * transform.m00) + (position[1] * transform.m10) + (position[2] * transform.m20) + transform.m30;
+        const float clip_y = (position[0] * transform.m01) + (position[1] * transform.m11) + (position[2] * transform.m21) + transform.m31;
+        const float clip_z = (position[0] * transform.m02) + (position[1] * transform.m12) + (position[2] * transform.m22) + transform.m32;
+        const float clip_w = (position[0] * transform.m03) + (position[1] * transform.m13) + (position[2] * transform.m23) + transform.m33;
+
+        if (clip_w <= Helper::M_EPSILON)
+            return false;
+
+        const float w_inv   = 1.0f / clip_w;
+        const float depth   = clip_z * w_inv;
+        if (depth < 0.0f || depth > 1.0f)
+            return false;
+
+        *x          = (clip_x * w_inv * 0.5f + 0.5f) * static_cast<float>(OcclusionBuffer::width);
+        *y          = (0.5f - clip_y * w_inv * 0.5f) * static_cast<float>(OcclusionBuffer::height);
+        *closeness  = reverse_z ? depth : 1.0f - depth;
+
+        return true;
+    }
+
+    OcclusionBuffer::OcclusionBuffer()
+    {
+        m_depth.resize(width * height, 0.0f);
+        m_tile_min.resize(tile_count_x * tile_count_y, 0.0f);
+    }
+
+    void OcclusionBuffer::Begin(const Matrix& view_projection, const bool reverse_z, const uint32_t occluder_count)
+    {
+        m_view_projection   = view_projection;
+        m_reverse_z         = reverse_z;
+
+        // Keep the allocations of the triangles around, occluders tend to be the same from frame to frame
+        m_occluders.resize(occluder_count);
+        for (vector<Triangle>& triangles : m_occluders)
+        {
+            triangles.clear();
+        }
+    }
+
+    void OcclusionBuffer::SetOccluder(const uint32_t occluder_index, const Matrix& transform, const RHI_Vertex_PosTexNorTan* vertices, const uint32_t* indices, const uint32_t index_count)
+    {
+        vector<Triangle>& triangles     = m_occluders[occluder_index];
+        const Matrix world_view_projection  = transform * m_view_projection;
+
+        for (uint32_t i = 0; i + 2 < index_count; i += 3)
+        {
+            float x[3], y[3], d[3];
+            if (!project(world_view_projection, vertices[indices[i + 0]].pos, m_reverse_z, &x[0], &y[0], &d[0]) ||
+                !project(world_view_projection, vertices[indices[i + 1]].pos, m_reverse_z, &x[1], &y[1], &d[1]) ||
+                !project(world_view_projection, vertices[indices[i + 2]].pos, m_reverse_z, &x[2], &y[2], &d[2]))
+                continue;
+
+            // Pixel bounds, pixels are sampled at their centers
+            Triangle triangle;
+            triangle.min_x = Helper::Max(static_cast<int32_t>(floor(Helper::Min(x[0], Helper::Min(x[1], x[2])) - 0.5f)), 0);
+            triangle.max_x = Helper::Min(static_cast<int32_t>(ceil(Helper::Max(x[0], Helper::Max(x[1], x[2])) + 0.5f)), static_cast<int32_t>(width));
+            triangle.min_y = Helper::Max(static_cast<int32_t>(floor(Helper::Min(y[0], Helper::Min(y[1], y[2])) - 0.5f)), 0);
+            triangle.max_y = Helper::Min(static_cast<int32_t>(ceil(Helper::Max(y[0], Helper::Max(y[1], y[2])) + 0.5f)), static_cast<int32_t>(height));
+            if (triangle.min_x >= triangle.max_x || triangle.min_y >= triangle.max_y)
+                continue;
+
+            // Edge functions, each one is zero on the edge opposite to a vertex and equal to twice the area on that vertex
+            for (uint32_t edge = 0; edge < 3; edge++)
+            {
+                const uint32_t v0 = (edge + 1) % 3;
+                const uint32_t v1 = (edge + 2) % 3;
+                triangle.edge_a[edge] = y[v0] - y[v1];
+                triangle.edge_b[edge] = x[v1] - x[v0];
+                triangle.edge_c[edge] = x[v0] * y[v1] - x[v1] * y[v0];
+            }
+
+            const float area = triangle.edge_a[0] * x[0] + triangle.edge_b[0] * y[0] + triangle.edge_c[0];
+            if (Helper::Abs(area) < Helper::M_EPSILON)
+                continue;
+
+            // Depth is a plane in screen space, the edge functions divided by the area are the barycentrics
+            const float area_inv    = 1.0f / area;
+            triangle.depth_a        = (triangle.edge_a[0] * d[0] + triangle.edge_a[1] * d[1] + triangle.edge_a[2] * d[2]) * area_inv;
+            triangle.depth_b        = (triangle.edge_b[0] * d[0] + triangle.edge_b[1] * d[1] + triangle.edge_b[2] * d[2]) * area_inv;
+            triangle.depth_c        = (triangle.edge_c[0] * d[0] + triangle.edge_c[1] * d[1] + triangle.edge_c[2] * d[2]) * area_inv;
+
+            // Both windings are rasterized, so flip the edges of the ones which are wound the other way
+            if (area < 0.0f)
+            {
+                for (uint32_t edge = 0; edge < 3; edge++)
+                {
+                    triangle.edge_a[edge] = -triangle.edge_a[edge];
+                    triangle.edge_b[edge] = -triangle.edge_b[edge];
+                    triangle.edge_c[edge] = -triangle.edge_c[edge];
+                }
+            }
+
+            triangles.emplace_back(triangle);
+        }
+    }
+
+    void OcclusionBuffer::RasterizeBand(const uint32_t band_index)
+    {
+        const int32_t band_start    = static_cast<int32_t>(band_index * band_height);
+        const int32_t band_end      = band_start + static_cast<int32_t>(band_height);
+
+        fill(m_depth.begin() + band_start * width, m_depth.begin() + band_end * width, 0.0f);
+
+        for (const vector<Triangle>& triangles : m_occluders)
+        {
+            for (const Triangle& triangle : triangles)
+            {
+                const int32_t y_start   = Helper::Max(triangle.min_y, band_start);
+                const int32_t y_end     = Helper::Min(triangle.max_y, band_end);
+                const int32_t x_start   = triangle.min_x & ~3; // four pixels at a time, the row is a multiple of four
+                const int32_t x_end     = triangle.max_x;
+
+                for (int32_t y = y_start; y < y_end; y++)
+                {
+                    const float py  = static_cast<float>(y) + 0.5f;
+                    float* row      = &m_depth[y * width];
+
+                    // Edge functions and depth at the first pixel of the row, they are linear so stepping is just an addition
+                    float e0    = triangle.edge_a[0] * (static_cast<float>(x_start) + 0.5f) + triangle.edge_b[0] * py + triangle.edge_c[0];
+                    float e1    = triangle.edge_a[1] * (static_cast<float>(x_start) + 0.5f) + triangle.edge_b[1] * py + triangle.edge_c[1];
+                    float e2    = triangle.edge_a[2] * (static_cast<float>(x_start) + 0.5f) + triangle.edge_b[2] * py + triangle.edge_c[2];
+                    float depth = triangle.depth_a * (static_cast<float>(x_start) + 0.5f) + triangle.depth_b * py + triangle.depth_c;
+
+                    #ifdef SPARTAN_OCCLUSION_SSE
+                    const __m128 lane       = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+                    __m128 e0_4             = _mm_add_ps(_mm_set1_ps(e0),    _mm_mul_ps(lane, _mm_set1_ps(triangle.edge_a[0])));
+                    __m128 e1_4             = _mm_add_ps(_mm_set1_ps(e1),    _mm_mul_ps(lane, _mm_set1_ps(triangle.edge_a[1])));
+                    __m128 e2_4             = _mm_add_ps(_mm_set1_ps(e2),    _mm_mul_ps(lane, _mm_set1_ps(triangle.edge_a[2])));
+                    __m128 depth_4          = _mm_add_ps(_mm_set1_ps(depth), _mm_mul_ps(lane, _mm_set1_ps(triangle.depth_a)));
+                    const __m128 e0_step    = _mm_set1_ps(triangle.edge_a[0] * 4.0f);
+                    const __m128 e1_step    = _mm_set1_ps(triangle.edge_a[1] * 4.0f);
+                    const __m128 e2_step    = _mm_set1_ps(triangle.edge_a[2] * 4.0f);
+                    const __m128 depth_step = _mm_set1_ps(triangle.depth_a * 4.0f);
+                    const __m128 zero       = _mm_setzero_ps();
+
+                    for (int32_t x = x_start; x < x_end; x += 4)
+                    {
+                        // Coverage mask of the four pixels
+                        const __m128 mask = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0_4, zero), _mm_cmpge_ps(e1_4, zero)), _mm_cmpge_ps(e2_4, zero));
+                        if (_mm_movemask_ps(mask) != 0)
+                        {
+                            const __m128 current    = _mm_loadu_ps(row + x);
+                            const __m128 closest    = _mm_max_ps(current, depth_4);
+                            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(mask, closest), _mm_andnot_ps(mask, current)));
+                        }
+
+                        e0_4    = _mm_add_ps(e0_4, e0_step);
+                        e1_4    = _mm_add_ps(e1_4, e1_step);
+                        e2_4    = _mm_add_ps(e2_4, e2_step);
+                        depth_4 = _mm_add_ps(depth_4, depth_step);
+                    }
+                    #else
+                    for (int32_t x = x_start; x < x_end; x++)
+                    {
+                        if (e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f)
+                        {
+                            row[x] = Helper::Max(row[x], depth);
+                        }
+
+                        e0      += triangle.edge_a[0];
+                        e1      += triangle.edge_a[1];
+                        e2      += triangle.edge_a[2];
+                        depth   += triangle.depth_a;
+                    }
+                    #endif
+                }
+            }
+        }
+
+        // The farthest closeness of every tile in the band
+        for (uint32_t tile_y = band_start / tile_size; tile_y < band_end / tile_size; tile_y++)
+        {
+            for (uint32_t tile_x = 0; tile_x < tile_count_x; tile_x++)
+            {
+                float tile_min = 1.0f;
+                for (uint32_t y = tile_y * tile_size; y < (tile_y + 1) * tile_size; y++)
+                {
+                    for (uint32_t x = tile_x * tile_size; x < (tile_x + 1) * tile_size; x++)
+                    {
+                        tile_min = Helper::Min(tile_min, m_depth[y * width + x]);
+                    }
+                }
+
+                m_tile_min[tile_y * tile_count_x + tile_x] = tile_min;
+            }
+        }
+    }
+
+    bool OcclusionBuffer::IsVisible(const BoundingBox& box) const
+    {
+        const Vector3& min = box.GetMin();
+        const Vector3& max = box.GetMax();
+
+        // Screen rectangle and closest point of the box, depth is monotonic along any direction so the closest point is a corner
+        float rect_min_x    = numeric_limits<float>::max();
+        float rect_min_y    = numeric_limits<float>::max();
+        float rect_max_x    = numeric_limits<float>::lowest();
+        float rect_max_y    = numeric_limits<float>::lowest();
+        float closeness_max = 0.0f;
+        for (uint32_t corner = 0; corner < 8; corner++)
+        {
+            const float position[3] =
+            {
+                (corner & 1) ? max.x : min.x,
+                (corner & 2) ? max.y : min.y,
+                (corner & 4) ? max.z : min.z
+            };
+
+            // Boxes which reach in front of the near plane, or beyond the far plane, are not worth the trouble
+            float x, y, closeness;
+            if (!project(m_view_projection, position, m_reverse_z, &x, &y, &closeness))
+                return true;
+
+            rect_min_x      = Helper::Min(rect_min_x, x);
+            rect_min_y      = Helper::Min(rect_min_y, y);
+            rect_max_x      = Helper::Max(rect_max_x, x);
+            rect_max_y      = Helper::Max(rect_max_y, y);
+            closeness_max   = Helper::Max(closeness_max, closeness);
+        }
+
+        // Pixels the box touches, grown by one to make up for occluders being sampled at pixel centers
+        const int32_t x_start   = Helper::Max(static_cast<int32_t>(floor(rect_min_x)) - 1, 0);
+        const int32_t y_start   = Helper::Max(static_cast<int32_t>(floor(rect_min_y)) - 1, 0);
+        const int32_t x_end     = Helper::Min(static_cast<int32_t>(ceil(rect_max_x)) + 1, static_cast<int32_t>(width));
+        const int32_t y_end     = Helper::Min(static_cast<int32_t>(ceil(rect_max_y)) + 1, static_cast<int32_t>(height));
+        if (x_start >= x_end || y_start >= y_end)
+            return true;
+
+        // Only what is clearly closer than the box can hide it
+        const float closeness_occluder_min = closeness_max * (1.0f + depth_bias);
+
+        // The tiles are a conservative answer, if they are all closer than the box, so is every pixel
+        bool tiles_occlude = true;
+        for (int32_t tile_y = y_start / tile_size; tile_y <= (y_end - 1) / static_cast<int32_t>(tile_size) && tiles_occlude; tile_y++)
+        {
+            for (int32_t tile_x = x_start / tile_size; tile_x <= (x_end - 1) / static_cast<int32_t>(tile_size); tile_x++)
+            {
+                if (m_tile_min[tile_y * tile_count_x + tile_x] <= closeness_occluder_min)
+                {
+                    tiles_occlude = false;
+                    break;
+                }
+            }
+        }
+
+        if (tiles_occlude)
+            return false;
+
+        // Otherwise, a single pixel where the box is closer than the occluders is enough for it to be visible
+        for (int32_t y = y_start; y < y_end; y++)
+        {
+            const float* row = &m_depth[y * width];
+            for (int32_t x = x_start; x < x_end; x++)
+            {
+                if (row[x] <= closeness_occluder_min)
+                    return true;
+            }
+        }
+
+        return false;
+    }
+
+    uint32_t OcclusionBuffer::GetTriangleCount() const
+    {
+        uint32_t count = 0;
+        for (const vector<Triangle>& triangles : m_occluders)
+        {
+            count += static_cast<uint32_t>(triangles.size());
+        }
+
+        return count;
+    }
+}
@@ -0,0 +1,87 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+//= INCLUDES ======================
+#include <vector>
+#include "../Math/Matrix.h"
+#include "../Math/BoundingBox.h"
+#include "../RHI/RHI_Vertex.h"
+#include "../Core/Spartan_Definitions.h"
+//=================================
+
+namespace Spartan
+{
+    // A low resolution depth buffer which occluders are rasterized into, on the CPU, so that renderables hidden behind them can be
+    // rejected before they are submitted. Triangles are set up once and rasterized in horizontal bands, four pixels at a time, with
+    // the edge functions producing a coverage mask. Bands don't share pixels, so they can be rasterized on different threads.
+    // Depth is stored as closeness (1 is the near plane, 0 is nothing), so that it doesn't matter whether reverse-z is used or not.
+    // It only depends on the math library, so it can be driven and verified on its own.
+    class SPARTAN_CLASS OcclusionBuffer
+    {
+    public:
+        static const uint32_t width         = 256;
+        static const uint32_t height        = 128;
+        static const uint32_t tile_size     = 8;    // closeness is also kept, conservatively, per tile
+        static const uint32_t tile_count_x  = width / tile_size;
+        static const uint32_t tile_count_y  = height / tile_size;
+        static const uint32_t band_height   = 16;   // must be a multiple of the tile size
+        static const uint32_t band_count    = height / band_height;
+        // Occluders only hide what is farther by more than this, relative to the closeness of the box. Closeness is roughly
+        // near plane over distance, so this is about one percent of the distance, enough to absorb interpolation error on
+        // surfaces which touch the box (like an occluder's own faces) without letting anything behind a wall through.
+        static constexpr float depth_bias   = 0.01f;
+
+        OcclusionBuffer();
+        ~OcclusionBuffer() = default;
+
+        // Clears the buffer and prepares for the given number of occluders
+        void Begin(const Math::Matrix& view_projection, const bool reverse_z, const uint32_t occluder_count);
+
+        // Sets up the triangles of an occluder, different occluders can be set up on different threads
+        void SetOccluder(const uint32_t occluder_index, const Math::Matrix& transform, const RHI_Vertex_PosTexNorTan* vertices, const uint32_t* indices, const uint32_t index_count);
+
+        // Rasterizes every occluder into a band of rows, different bands can be rasterized on different threads
+        void RasterizeBand(const uint32_t band_index);
+
+        // Once all bands are rasterized, an axis aligned box (in world space) is visible unless it's behind the occluders everywhere it covers
+        bool IsVisible(const Math::BoundingBox& box) const;
+
+        // Closeness per pixel, rows top to bottom
+        const auto& GetDepth()      const { return m_depth; }
+        uint32_t GetTriangleCount() const;
+
+    private:
+        struct Triangle
+        {
+            int32_t min_x, max_x, min_y, max_y; // pixel bounds, max exclusive
+            float edge_a[3], edge_b[3], edge_c[3]; // positive inside
+            float depth_a, depth_b, depth_c;
+        };
+
+        std::vector<std::vector<Triangle>> m_occluders;
+        std::vector<float> m_depth;
+        std::vector<float> m_tile_min; // the farthest closeness of each tile
+        Math::Matrix m_view_projection;
+        bool m_reverse_z = false;
+    };
+}
@@ -0,0 +1,504 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+//= INCLUDES ======================
+#include "Spartan.h"
+#include <unordered_map>
+#include "RenderGraph.h"
+#include "../Utilities/Hash.h"
+#include "../RHI/RHI_Texture2D.h"
+#include "../RHI/RHI_CommandList.h"
+//=================================
+
+//= NAMESPACES =====
+using namespace std;
+//==================
+
+namespace Spartan
+{
+    static uint32_t bytes_per_pixel(const RHI_Format format)
+    {
+        switch (format)
+        {
+            case RHI_Format_R8_Unorm:               return 1;
+            case RHI_Format_R16_Uint:               return 2;
+            case RHI_Format_R16_Float:              return 2;
+            case RHI_Format_R8G8_Unorm:             return 2;
+            case RHI_Format_R32_Uint:               return 4;
+            case RHI_Format_R32_Float:              return 4;
+            case RHI_Format_R16G16_Float:           return 4;
+            case RHI_Format_R11G11B10_Float:        return 4;
+            case RHI_Format_R8G8B8A8_Unorm:         return 4;
+            case RHI_Format_R10G10B10A2_Unorm:      return 4;
+            case RHI_Format_D32_Float:              return 4;
+            case RHI_Format_R32G32_Float:           return 8;
+            case RHI_Format_R16G16B16A16_Float:     return 8;
+            case RHI_Format_D32_Float_S8X24_Uint:   return 8;
+            case RHI_Format_R32G32B32_Float:        return 12;
+            case RHI_Format_R32G32B32A32_Float:     return 16;
+            default:                                return 0;
+        }
+    }
+
+    static uint64_t texture_size(const RenderGraph::TextureDesc& desc)
+    {
+        return static_cast<uint64_t>(desc.width) * desc.height * bytes_per_pixel(desc.format);
+    }
+
+    static bool is_depth(const RHI_Format format)
+    {
+        return format == RHI_Format_D32_Float || format == RHI_Format_D32_Float_S8X24_Uint;
+    }
+
+    RenderGraph::RenderGraph(Context* context)
+    {
+        m_context = context;
+    }
+
+    void RenderGraph::AddTexture(const uint64_t id, shared_ptr<RHI_Texture>* slot, const TextureDesc& desc)
+    {
+        // Ids are bits, so that passes can declare what they use as masks
+        if (!slot || id == 0 || (id & (id - 1)) != 0)
+        {
+            LOG_ERROR("Invalid parameters");
+            return;
+        }
+
+        for (const Texture& texture : m_textures)
+        {
+            if (texture.id == id)
+            {
+                LOG_ERROR("A texture with the same id has already been added");
+                return;
+            }
+        }
+
+        Texture& texture        = m_textures.emplace_back();
+        texture.id              = id;
+        texture.slot            = slot;
+        texture.desc            = desc;
+        texture.desc.persistent |= desc.output;
+
+        // Persistent textures are never shared, so there is no reason to wait for a compilation
+        if (texture.desc.persistent)
+        {
+            texture.texture = make_shared<RHI_Texture2D>(m_context, desc.width, desc.height, desc.format, 1, desc.flags, desc.name);
+        }
+
+        *slot   = texture.texture;
+        m_dirty = true;
+    }
+
+    void RenderGraph::RemoveTextures()
+    {
+        for (const Texture& texture : m_textures)
+        {
+            *texture.slot = nullptr;
+        }
+
+        m_textures.clear();
+        m_allocations.clear();
+        m_dirty = true;
+    }
+
+    void RenderGraph::Begin()
+    {
+        m_passes.clear();
+        m_hash = 0;
+    }
+
+    void RenderGraph::AddPass(const char* name, const uint64_t reads, const uint64_t writes, function<void(RHI_CommandList*)>&& execute, const bool cullable /*= true*/)
+    {
+        Pass& pass      = m_passes.emplace_back();
+        pass.name       = name;
+        pass.reads      = reads;
+        pass.writes     = writes;
+        pass.cullable   = cullable;
+        pass.execute    = move(execute);
+
+        // Passes are declared every frame, the hash tells if they are any different from what was compiled
+        Utility::Hash::hash_combine(m_hash, reads);
+        Utility::Hash::hash_combine(m_hash, writes);
+        Utility::Hash::hash_combine(m_hash, cullable);
+    }
+
+    void RenderGraph::Compile()
+    {
+        if (!m_dirty && m_hash == m_hash_compiled)
+            return;
+
+        const uint32_t pass_count = static_cast<uint32_t>(m_passes.size());
+        m_passes_compiled.clear();
+        m_passes_compiled.resize(pass_count);
+
+        // Cull, walking backwards, a pass is needed if a pass which is needed after it (or something outside the graph) reads what it writes
+        {
+            uint64_t needed = 0;
+            for (const Texture& texture : m_textures)
+            {
+                needed |= texture.desc.output ? texture.id : 0;
+            }
+
+            m_pass_culled_count = 0;
+            for (uint32_t i = pass_count; i-- > 0;)
+            {
+                const Pass& pass    = m_passes[i];
+                const bool culled   = pass.cullable && (pass.writes & needed) == 0;
+
+                m_passes_compiled[i].culled = culled;
+                m_pass_culled_count         += culled ? 1 : 0;
+                needed                      |= culled ? 0 : pass.reads;
+            }
+        }
+
+        // Lifetimes
+        {
+            for (Texture& texture : m_textures)
+            {
+                texture.used        = false;
+                texture.history     = false;
+                texture.allocation  = -1;
+            }
+
+            uint64_t written = 0;
+            for (uint32_t i = 0; i < pass_count; i++)
+            {
+                if (m_passes_compiled[i].culled)
+                    continue;
+
+                const Pass& pass = m_passes[i];
+                for (Texture& texture : m_textures)
+                {
+                    if (((pass.reads | pass.writes) & texture.id) == 0)
+                        continue;
+
+                    if (!texture.used)
+                    {
+                        texture.used        = true;
+                        texture.pass_first  = i;
+                    }
+                    texture.pass_last = i;
+
+                    // Nothing wrote it so far this frame, so what's read is left over from the previous one
+                    texture.history |= (pass.reads & texture.id) != 0 && (written & texture.id) == 0;
+                }
+
+                written |= pass.writes;
+            }
+        }
+
+        // Allocate, transient textures (in the order they come to life) go to the first allocation of the same size and format which is free by then
+        {
+            vector<uint32_t> order;
+            for (uint32_t i = 0; i < static_cast<uint32_t>(m_textures.size()); i++)
+            {
+                if (m_textures[i].used && !m_textures[i].desc.persistent)
+                {
+                    order.emplace_back(i);
+                }
+            }
+            stable_sort(order.begin(), order.end(), [this](const uint32_t a, const uint32_t b) { return m_textures[a].pass_first < m_textures[b].pass_first; });
+
+            vector<Allocation> allocations;
+            for (const uint32_t texture_index : order)
+            {
+                Texture& texture = m_textures[texture_index];
+
+                // History has to survive until the next frame, so it gets an allocation of its own
+                int32_t allocation_index = -1;
+                for (uint32_t i = 0; i < static_cast<uint32_t>(allocations.size()) && !texture.history; i++)
+                {
+                    const Allocation& allocation = allocations[i];
+                    if (allocation.desc.width   == texture.desc.width   &&
+                        allocation.desc.height  == texture.desc.height  &&
+                        allocation.desc.format  == texture.desc.format  &&
+                        allocation.pass_last    < texture.pass_first)
+                    {
+                        allocation_index = static_cast<int32_t>(i);
+                        break;
+                    }
+                }
+
+                if (allocation_index == -1)
+                {
+                    allocation_index = static_cast<int32_t>(allocations.size());
+                    Allocation& allocation  = allocations.emplace_back();
+                    allocation.desc         = texture.desc;
+                    allocation.desc.flags   = 0;
+                    allocation.desc.name.clear();
+                }
+
+                // The flags of everything that shares an allocation are combined
+                Allocation& allocation  = allocations[allocation_index];
+                allocation.desc.flags   |= texture.desc.flags;
+                allocation.desc.name    += (allocation.desc.name.empty() ? "" : "|") + texture.desc.name;
+                allocation.pass_last    = texture.history ? numeric_limits<uint32_t>::max() : texture.pass_last;
+                texture.allocation      = allocation_index;
+            }
+
+            // Textures from the previous compilation are picked up again when their description matches, the ones which aren't are released
+            m_allocation_count = 0;
+            for (Allocation& allocation : allocations)
+            {
+                for (Allocation& allocation_previous : m_allocations)
+                {
+                    if (allocation_previous.texture                                 &&
+                        allocation_previous.desc.width  == allocation.desc.width    &&
+                        allocation_previous.desc.height == allocation.desc.height   &&
+                        allocation_previous.desc.format == allocation.desc.format   &&
+                        allocation_previous.desc.flags  == allocation.desc.flags)
+                    {
+                        allocation.texture = move(allocation_previous.texture);
+                        break;
+                    }
+                }
+
+                if (!allocation.texture)
+                {
+                    allocation.texture = make_shared<RHI_Texture2D>(m_context, allocation.desc.width, allocation.desc.height, allocation.desc.format, 1, allocation.desc.flags, allocation.desc.name);
+                    m_allocation_count++;
+                }
+            }
+            m_allocations = move(allocations);
+        }
+
+        // The layout each pass needs its textures in
+        for (uint32_t i = 0; i < pass_count; i++)
+        {
+            if (m_passes_compiled[i].culled)
+                continue;
+
+            const Pass& pass = m_passes[i];
+            for (uint32_t texture_index = 0; texture_index < static_cast<uint32_t>(m_textures.size()); texture_index++)
+            {
+                const Texture& texture = m_textures[texture_index];
+                if (((pass.reads | pass.writes) & texture.id) == 0)
+                    continue;
+
+                const bool write = (pass.writes & texture.id) != 0;
+                RHI_Image_Layout layout;
+                if (is_depth(texture.desc.format))
+                {
+                    layout = write ? RHI_Image_Depth_Stencil_Attachment_Optimal : RHI_Image_Depth_Stencil_Read_Only_Optimal;
+                }
+                else
+                {
+                    layout = write ? RHI_Image_Color_Attachment_Optimal : RHI_Image_Shader_Read_Only_Optimal;
+                }
+
+                m_passes_compiled[i].transitions.push_back({ texture_index, layout });
+            }
+        }
+
+        // Barriers per frame, the first frame only brings the layouts to where the last pass of every frame leaves them
+        {
+            unordered_map<const RHI_Texture*, RHI_Image_Layout> layouts;
+            m_barrier_count_expected = 0;
+            for (uint32_t frame = 0; frame < 2; frame++)
+            {
+                for (const CompiledPass& pass : m_passes_compiled)
+                {
+                    for (const Transition& transition : pass.transitions)
+                    {
+                        const RHI_Texture* texture = GetBoundTexture(m_textures[transition.texture_index]);
+                        const auto it = layouts.find(texture);
+                        if (it == layouts.end() || it->second != transition.layout)
+                        {
+                            layouts[texture]            = transition.layout;
+                            m_barrier_count_expected    += frame == 1 ? 1 : 0;
+                        }
+                    }
+                }
+            }
+        }
+
+        // Stats
+        m_texture_used_count        = 0;
+        m_texture_allocated_count   = static_cast<uint32_t>(m_allocations.size());
+        m_memory_declared           = 0;
+        m_memory_allocated          = 0;
+        for (const Texture& texture : m_textures)
+        {
+            m_texture_used_count        += texture.used ? 1 : 0;
+            m_texture_allocated_count   += texture.desc.persistent ? 1 : 0;
+            m_memory_declared           += texture_size(texture.desc);
+            m_memory_allocated          += texture.desc.persistent ? texture_size(texture.desc) : 0;
+        }
+        for (const Allocation& allocation : m_allocations)
+        {
+            m_memory_allocated += texture_size(allocation.desc);
+        }
+
+        m_hash_compiled = m_hash;
+        m_dirty         = false;
+
+        // Anything which looks the render targets up before the next execution (e.g. the pipeline warm-up) finds them bound
+        Bind();
+
+        LOG_INFO("%u passes (%u culled), %u textures in %u allocations (%u new), %.1f MB instead of %.1f MB, %u barriers per frame",
+            pass_count, m_pass_culled_count,
+            m_texture_used_count, m_texture_allocated_count, m_allocation_count,
+            static_cast<float>(m_memory_allocated) / 1048576.0f, static_cast<float>(m_memory_declared) / 1048576.0f,
+            m_barrier_count_expected
+        );
+    }
+
+    void RenderGraph::Execute(RHI_CommandList* cmd_list, const bool execute_passes /*= true*/)
+    {
+        if (m_dirty || m_hash != m_hash_compiled)
+        {
+            LOG_ERROR("The graph has to be compiled first");
+            return;
+        }
+
+        // Passes can swap the textures of their slots around (post-processing ping-pongs that way), so this is done every time
+        Bind();
+
+        m_barrier_count = 0;
+        for (uint32_t i = 0; i < static_cast<uint32_t>(m_passes.size()); i++)
+        {
+            const CompiledPass& pass_compiled = m_passes_compiled[i];
+            if (pass_compiled.culled)
+                continue;
+
+            // Transition whatever is in the slot now, it's not necessarily what was bound above
+            for (const Transition& transition : pass_compiled.transitions)
+            {
+                RHI_Texture* texture = m_textures[transition.texture_index].slot->get();
+                if (!texture || texture->GetLayout() == transition.layout)
+                    continue;
+
+                texture->SetLayout(transition.layout, cmd_list);
+                m_barrier_count += texture->GetLayout() == transition.layout ? 1 : 0;
+            }
+
+            if (execute_passes && m_passes[i].execute)
+            {
+                m_passes[i].execute(cmd_list);
+            }
+        }
+    }
+
+    bool RenderGraph::Validate() const
+    {
+        bool valid = true;
+
+        for (uint32_t i = 0; i < static_cast<uint32_t>(m_textures.size()); i++)
+        {
+            const Texture& texture = m_textures[i];
+            if (!texture.used)
+                continue;
+
+            const RHI_Texture* texture_bound = GetBoundTexture(texture);
+            if (!texture_bound)
+            {
+                LOG_ERROR("%s is used but has no texture", texture.desc.name.c_str());
+                valid = false;
+            }
+            else if (texture_bound->GetWidth() != texture.desc.width || texture_bound->GetHeight() != texture.desc.height || texture_bound->GetFormat() != texture.desc.format)
+            {
+                LOG_ERROR("%s is %ux%u but is bound to a texture which is %ux%u or of another format",
+                    texture.desc.name.c_str(), texture.desc.width, texture.desc.height, texture_bound->GetWidth(), texture_bound->GetHeight());
+                valid = false;
+            }
+
+            if (texture.allocation == -1)
+                continue;
+
+            for (uint32_t j = i + 1; j < static_cast<uint32_t>(m_textures.size()); j++)
+            {
+                const Texture& other = m_textures[j];
+                if (!other.used || other.allocation != texture.allocation)
+                    continue;
+
+                if (other.desc.width != texture.desc.width || other.desc.height != texture.desc.height || other.desc.format != texture.desc.format)
+                {
+                    LOG_ERROR("%s and %s share an allocation, but differ in size or format", texture.desc.name.c_str(), other.desc.name.c_str());
+                    valid = false;
+                }
+
+                if (texture.history || other.history)
+                {
+                    LOG_ERROR("%s and %s share an allocation, but one of them carries content to the next frame", texture.desc.name.c_str(), other.desc.name.c_str());
+                    valid = false;
+                }
+
+                if (texture.pass_first <= other.pass_last && other.pass_first <= texture.pass_last)
+                {
+                    LOG_ERROR("%s and %s share an allocation while they are both alive", texture.desc.name.c_str(), other.desc.name.c_str());
+                    valid = false;
+                }
+            }
+
+            if (!texture.history && (m_passes[texture.pass_first].writes & texture.id) == 0)
+            {
+                LOG_ERROR("%s is read before it's written", texture.desc.name.c_str());
+                valid = false;
+            }
+        }
+
+        return valid;
+    }
+
+    bool RenderGraph::IsShared(const uint64_t id_a, const uint64_t id_b) const
+    {
+        const Texture* texture_a = GetTexture(id_a);
+        const Texture* texture_b = GetTexture(id_b);
+        if (!texture_a || !texture_b || !texture_a->used || !texture_b->used)
+            return false;
+
+        return texture_a->allocation != -1 && texture_a->allocation == texture_b->allocation;
+    }
+
+    const char* RenderGraph::GetTextureName(const uint64_t id) const
+    {
+        const Texture* texture = GetTexture(id);
+        return texture ? texture->desc.name.c_str() : "";
+    }
+
+    void RenderGraph::Bind()
+    {
+        for (const Texture& texture : m_textures)
+        {
+            *texture.slot = texture.desc.persistent ? texture.texture : (texture.allocation != -1 ? m_allocations[texture.allocation].texture : nullptr);
+        }
+    }
+
+    RHI_Texture* RenderGraph::GetBoundTexture(const Texture& texture) const
+    {
+        if (texture.desc.persistent)
+            return texture.texture.get();
+
+        return texture.allocation != -1 ? m_allocations[texture.allocation].texture.get() : nullptr;
+    }
+
+    const RenderGraph::Texture* RenderGraph::GetTexture(const uint64_t id) const
+    {
+        for (const Texture& texture : m_textures)
+        {
+            if (texture.id == id)
+                return &texture;
+        }
+
+        return nullptr;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,161 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#pragma once
+
+//= INCLUDES ======================
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include "../RHI/RHI_Definition.h"
+#include "../Core/Spartan_Definitions.h"
+//=================================
+
+namespace Spartan
+{
+    class Context;
+
+    // Passes declare the textures they read and write, as masks of texture ids (single bits), and from that the graph
+    // - culls the passes whose writes are never read (unless they have side effects which the graph can't see),
+    // - computes the lifetime of every texture, from the first to the last pass which uses it,
+    // - lets transient textures of the same size and format share a single texture, as long as their lifetimes don't overlap,
+    // - transitions every texture to the layout a pass needs right before it, and only when it isn't in it already.
+    // Textures are bound to slots, which is where the passes pick them up from, every time the graph executes.
+    class SPARTAN_CLASS RenderGraph
+    {
+    public:
+        struct TextureDesc
+        {
+            std::string name;
+            uint32_t width      = 0;
+            uint32_t height     = 0;
+            RHI_Format format   = RHI_Format_Undefined;
+            uint16_t flags      = 0;
+            bool persistent     = false; // keeps its content across frames, so it's created right away and never shared
+            bool output         = false; // used after the graph executes, so the passes which write it are never culled
+        };
+
+        RenderGraph(Context* context);
+        ~RenderGraph() = default;
+
+        // Textures
+        void AddTexture(const uint64_t id, std::shared_ptr<RHI_Texture>* slot, const TextureDesc& desc);
+        void RemoveTextures();
+
+        // Passes are declared every frame, in the order they execute
+        void Begin();
+        void AddPass(const char* name, const uint64_t reads, const uint64_t writes, std::function<void(RHI_CommandList*)>&& execute, const bool cullable = true);
+
+        // Culls, computes lifetimes, allocates and plans barriers, only does work if the passes or the textures changed
+        void Compile();
+
+        // Binds the textures to their slots and executes the passes, preceded by the barriers they need
+        void Execute(RHI_CommandList* cmd_list, const bool execute_passes = true);
+
+        // Checks that textures which share memory are never alive at the same time, that they match the size and format of what they are bound to
+        // and that transient textures are written before they are read
+        bool Validate() const;
+
+        // Stats of the last compilation/execution
+        uint32_t GetPassCount()             const { return static_cast<uint32_t>(m_passes.size()); }
+        uint32_t GetPassCulledCount()       const { return m_pass_culled_count; }
+        uint32_t GetTextureCount()          const { return m_texture_used_count; }
+        uint32_t GetTextureAllocatedCount() const { return m_texture_allocated_count; }
+        uint32_t GetAllocationCount()       const { return m_allocation_count; }    // textures which the last compilation had to create
+        uint64_t GetMemoryDeclared()        const { return m_memory_declared; }     // bytes, if every texture had its own memory
+        uint64_t GetMemoryAllocated()       const { return m_memory_allocated; }    // bytes
+        uint32_t GetBarrierCount()          const { return m_barrier_count; }       // issued by the last execution
+        uint32_t GetBarrierCountExpected()  const { return m_barrier_count_expected; } // per frame, once the layouts cycle from frame to frame
+
+        // True if both textures are used and bound to the same allocation
+        bool IsShared(const uint64_t id_a, const uint64_t id_b) const;
+        const char* GetTextureName(const uint64_t id) const;
+
+    private:
+        struct Texture
+        {
+            uint64_t id                                 = 0;
+            std::shared_ptr<RHI_Texture>* slot          = nullptr;
+            TextureDesc desc;
+            std::shared_ptr<RHI_Texture> texture;       // persistent textures only
+            uint32_t pass_first                         = 0;
+            uint32_t pass_last                          = 0;
+            bool used                                   = false;
+            bool history                                = false; // read before it's written, so it carries content from the previous frame
+            int32_t allocation                          = -1;    // index into the allocations, transient textures only
+        };
+
+        struct Pass
+        {
+            const char* name = nullptr;
+            uint64_t reads   = 0;
+            uint64_t writes  = 0;
+            bool cullable    = true;
+            std::function<void(RHI_CommandList*)> execute;
+        };
+
+        // What a texture has to be transitioned to before a pass
+        struct Transition
+        {
+            uint32_t texture_index;
+            RHI_Image_Layout layout;
+        };
+
+        struct CompiledPass
+        {
+            bool culled = false;
+            std::vector<Transition> transitions;
+        };
+
+        // A texture which one or more transient textures are bound to
+        struct Allocation
+        {
+            TextureDesc desc;
+            std::shared_ptr<RHI_Texture> texture;
+            uint32_t pass_last = 0;
+        };
+
+        void Bind();
+        RHI_Texture* GetBoundTexture(const Texture& texture) const;
+        const Texture* GetTexture(const uint64_t id) const;
+
+        Context* m_context = nullptr;
+        std::vector<Texture> m_textures;
+        std::vector<Pass> m_passes;
+        std::vector<CompiledPass> m_passes_compiled;
+        std::vector<Allocation> m_allocations;
+        size_t m_hash           = 0;
+        size_t m_hash_compiled  = 0;
+        bool m_dirty            = true;
+
+        // Stats
+        uint32_t m_pass_culled_count        = 0;
+        uint32_t m_texture_used_count       = 0;
+        uint32_t m_texture_allocated_count  = 0;
+        uint32_t m_allocation_count         = 0;
+        uint64_t m_memory_declared          = 0;
+        uint64_t m_memory_allocated         = 0;
+        uint32_t m_barrier_count            = 0;
+        uint32_t m_barrier_count_expected   = 0;
+    };
+}
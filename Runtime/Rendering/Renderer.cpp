@@ -23,13 +23,21 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Spartan.h"
 #include "Renderer.h"
 #include "Model.h"
+#include "Mesh.h"
 #include "ShaderGBuffer.h"
+#include "ShaderLight.h"
+#include "RenderGraph.h"
 #include "Font/Font.h"
 #include "Gizmos/Grid.h"
 #include "Gizmos/Transform_Gizmo.h"
 #include "../Utilities/Sampling.h"
+#include "../Utilities/RadixSort.h"
+#include "../Utilities/Hash.h"
+#include "../IO/FileStream.h"
 #include "../Profiling/Profiler.h"
 #include "../Resource/ResourceCache.h"
+#include "../Threading/Threading.h"
+#include "../World/World.h"
 #include "../World/Entity.h"
 #include "../World/Components/Transform.h"
 #include "../World/Components/Renderable.h"
@@ -37,6 +45,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../World/Components/Light.h"
 #include "../RHI/RHI_Device.h"
 #include "../RHI/RHI_PipelineCache.h"
+#include "../RHI/RHI_PipelineState.h"
+#include "../RHI/RHI_ShaderCache.h"
 #include "../RHI/RHI_ConstantBuffer.h"
 #include "../RHI/RHI_CommandList.h"
 #include "../RHI/RHI_Texture2D.h"
@@ -53,8 +63,64 @@ using namespace Spartan::Math;
 
 namespace Spartan
 {
+    static Renderer_Object_Type renderable_object_type(const Renderable* renderable)
+    {
+        bool is_transparent = false;
+
+        if (const Material* material = renderable->GetMaterial())
+        {
+            is_transparent = material->GetColorAlbedo().w < 1.0f;
+        }
+
+        return is_transparent ? Renderer_Object_Transparent : Renderer_Object_Opaque;
+    }
+
+    // Converts luminous power to luminous intensity
+    static float light_luminous_intensity(const Light* light, const float exposure)
+    {
+        float luminous_intensity = light->GetIntensity() * exposure;
+        if (light->GetLightType() == LightType::Point)
+        {
+            luminous_intensity /= Math::Helper::PI_4; // lumens to candelas
+            luminous_intensity *= 255.0f; // this is a hack, must fix whats my color units
+        }
+        else if (light->GetLightType() == LightType::Spot)
+        {
+            luminous_intensity /= Math::Helper::PI; // lumens to candelas
+            luminous_intensity *= 255.0f; // this is a hack, must fix whats my color units
+        }
+
+        return luminous_intensity;
+    }
+
+    // Ids are truncated to fit, a collision only costs a redundant bind
+    static uint64_t draw_call_key(const Renderer_Object_Type object_type, const uint16_t variation, const uint32_t material_id, const uint32_t geometry_id, const float depth)
+    {
+        const uint64_t depth_quantized = static_cast<uint64_t>(Helper::Saturate(depth) * 65535.0f);
+
+        return
+            (static_cast<uint64_t>(object_type & 0x3)       << 62) |
+            (static_cast<uint64_t>(variation)               << 46) |
+            (static_cast<uint64_t>(material_id & 0xFFFF)    << 30) |
+            (static_cast<uint64_t>(geometry_id & 0x3FFF)    << 16) |
+            depth_quantized;
+    }
+
+    // Where the shaders of a persisted pipeline come from
+    enum Pipeline_Shader_Source : uint32_t
+    {
+        Pipeline_Shader_None,
+        Pipeline_Shader_Renderer,
+        Pipeline_Shader_GBuffer,
+        Pipeline_Shader_Light
+    };
+
+    static const uint32_t pipelines_version = 1;
+
     Renderer::Renderer(Context* context) : ISubsystem(context)
     {
+        SetTickDependencies(Subsystem_Data_All, Subsystem_Data_Render | Subsystem_Data_Profiling, true);
+
         // Options
         m_options |= Render_ReverseZ;
         m_options |= Render_Debug_Transform;
@@ -72,6 +138,7 @@ namespace Spartan
         m_options |= Render_Sharpening_LumaSharpen;
         m_options |= Render_FilmGrain;
         m_options |= Render_ChromaticAberration;
+        m_options |= Render_OcclusionCulling;
 
         // Option values
         m_option_values[Option_Value_Anisotropy]        = 16.0f;
@@ -82,6 +149,8 @@ namespace Spartan
         m_option_values[Option_Value_Sharpen_Clamp]     = 0.35f;
         m_option_values[Option_Value_Bloom_Intensity]   = 0.1f;
 
+        m_light_clusters_task = make_unique<TaskCounter>();
+
 		// Subscribe to events
 		SUBSCRIBE_TO_EVENT(EventType::WorldResolved,    EVENT_HANDLER_VARIANT(RenderablesAcquire));
         SUBSCRIBE_TO_EVENT(EventType::WorldUnload,              EVENT_HANDLER(ClearEntities));
@@ -95,6 +164,18 @@ namespace Spartan
 		m_entities.clear();
 		m_camera = nullptr;
 
+        // Record the pipelines the current world used, so that they can be created while it loads the next time
+        if (m_world)
+        {
+            PipelinesSave(m_world->GetName());
+        }
+
+        // Record the shader permutations which were used, so that they can be precompiled offline
+        if (m_shader_cache)
+        {
+            m_shader_cache->SaveManifest(m_shader_cache->GetDirectory() + "manifest.txt");
+        }
+
 		// Log to file as the renderer is no more
 		LOG_TO_FILE(true);
 	}
@@ -104,6 +185,8 @@ namespace Spartan
         // Get required systems		
         m_resource_cache    = m_context->GetSubsystem<ResourceCache>();
         m_profiler          = m_context->GetSubsystem<Profiler>();
+        m_world             = m_context->GetSubsystem<World>();
+        m_threading         = m_context->GetSubsystem<Threading>();
 
         // Resolution, viewport and swapchain default to whatever the window size is
         const WindowData& window_data = m_context->m_engine->GetWindowData();
@@ -124,11 +207,19 @@ namespace Spartan
             return false;
         }
 
-        // Create pipeline cache
-        m_pipeline_cache = make_shared<RHI_PipelineCache>(m_rhi_device.get());
+        // Create pipeline cache, it picks up what the driver compiled during previous runs
+        {
+            const string directory = m_resource_cache->GetDataDirectory(Asset_PipelineCache);
+            if (!FileSystem::Exists(directory))
+            {
+                FileSystem::CreateDirectory_(directory);
+            }
+
+            m_pipeline_cache = make_shared<RHI_PipelineCache>(m_rhi_device.get(), directory + "/pipelines.bin");
+        }
 
-        // Create descriptor cache
-        m_descriptor_cache = make_shared<RHI_DescriptorCache>(m_rhi_device.get());
+        // Create shader cache
+        m_shader_cache = make_shared<RHI_ShaderCache>(m_context, m_resource_cache->GetDataDirectory(Asset_ShaderCache));
 
         // Create swap chain
         {
@@ -161,7 +252,11 @@ namespace Spartan
         m_gizmo_grid = make_unique<Grid>(m_rhi_device);
         m_gizmo_transform = make_unique<Transform_Gizmo>(m_context);
 
+        // Render graph, the render targets are added to it when they are created
+        m_render_graph = make_unique<RenderGraph>(m_context);
+
         CreateConstantBuffers();
+        CreateRecordingContexts();
 		CreateShaders();
 		CreateDepthStencilStates();
 		CreateRasterizerStates();
@@ -209,11 +304,15 @@ namespace Spartan
 			return;
 		}
 
-        // Reset dynamic buffer indices when the swapchain resets to first buffer/command list
-        if (m_swap_chain->GetCmdIndex() == 0)
+        // Dynamic buffers allocate from the region of this frame, the command list has already waited for its previous use of it
+        m_buffer_uber_gpu->BeginFrame(m_swap_chain->GetCmdIndex());
+        m_buffer_object_gpu->BeginFrame(m_swap_chain->GetCmdIndex());
+        m_buffer_instance_gpu->BeginFrame(m_swap_chain->GetCmdIndex());
+        for (const auto& context : m_recording_contexts)
         {
-            m_buffer_uber_offset_index      = 0;
-            m_buffer_object_offset_index    = 0;
+            context->buffer_uber_gpu->BeginFrame(m_swap_chain->GetCmdIndex());
+            context->buffer_object_gpu->BeginFrame(m_swap_chain->GetCmdIndex());
+            context->buffer_instance_gpu->BeginFrame(m_swap_chain->GetCmdIndex());
         }
 
 		// Get camera matrices
@@ -259,6 +358,22 @@ namespace Spartan
         Pass_Main(m_swap_chain->GetCmdList());
         m_is_rendering = false;
 
+        m_profiler->m_rhi_dynamic_buffer_high_water =
+            m_buffer_uber_gpu->GetHighWaterMark()   * m_buffer_uber_gpu->GetStride() +
+            m_buffer_object_gpu->GetHighWaterMark() * m_buffer_object_gpu->GetStride() +
+            m_buffer_instance_gpu->GetHighWaterMark() * m_buffer_instance_gpu->GetStride();
+        for (const auto& context : m_recording_contexts)
+        {
+            m_profiler->m_rhi_dynamic_buffer_high_water +=
+                context->buffer_uber_gpu->GetHighWaterMark()        * context->buffer_uber_gpu->GetStride() +
+                context->buffer_object_gpu->GetHighWaterMark()      * context->buffer_object_gpu->GetStride() +
+                context->buffer_instance_gpu->GetHighWaterMark()    * context->buffer_instance_gpu->GetStride();
+        }
+
+        m_profiler->m_rhi_pipelines_created         = m_pipeline_cache->ConsumeCreatedCount();
+        m_profiler->m_time_pipeline_creation        = m_pipeline_cache->ConsumeCreationTimeMs();
+        m_profiler->m_time_pipeline_creation_max    = Helper::Max(m_profiler->m_time_pipeline_creation_max, m_profiler->m_time_pipeline_creation);
+
         m_frame_num++;
         m_is_odd_frame = (m_frame_num % 2) == 1;
 	}
@@ -267,8 +382,6 @@ namespace Spartan
     {
         if (m_viewport.width != width || m_viewport.height != height)
         {
-            Flush(); // viewport quad might be in use
-
             m_brdf_specular_lut_rendered = false; // todo, Vulkan needs to re-renderer it, it shouldn't, what am I missing ?
 
             // Update viewport
@@ -441,61 +554,40 @@ namespace Spartan
     }
 
     template<typename T>
-    inline bool update_dynamic_buffer(RHI_CommandList* cmd_list, RHI_ConstantBuffer* buffer_gpu, T& buffer_cpu, T& buffer_cpu_previous, uint32_t& offset_index)
+    inline bool update_dynamic_buffer(RHI_ConstantBuffer* buffer_gpu, T& buffer_cpu, T& buffer_cpu_previous)
     {
-        offset_index++;
-
-        // Only update if needed
-        bool update = buffer_gpu->GetOffsetIndexDynamic() != offset_index;
-        update      = update ? true : buffer_cpu != buffer_cpu_previous;
-        if (!update)
-            return true;
-
-        const uint32_t offset_count = offset_index + 1;
-
-        // Re-allocate buffer with double size (if needed)
-        if (buffer_gpu->IsDynamic())
+        // Buffers which can't be sub-allocated (D3D11) are simply mapped and updated
+        if (!buffer_gpu->IsDynamic())
         {
-            if (offset_count >= buffer_gpu->GetOffsetCount())
+            T* buffer = static_cast<T*>(buffer_gpu->Map());
+            if (!buffer)
             {
-                cmd_list->Flush();
-                const uint32_t new_size = Math::Helper::NextPowerOfTwo(offset_count);
-                if (!buffer_gpu->Create<T>(new_size))
-                {
-                    LOG_ERROR("Failed to re-allocate %s buffer with %d offsets", buffer_gpu->GetName().c_str(), new_size);
-                    return false;
-                }
-                LOG_INFO("Increased %s buffer size to %d, that's %d kb", buffer_gpu->GetName().c_str(), new_size, (new_size * buffer_gpu->GetStride()) / 1000);
+                LOG_ERROR("Failed to map buffer");
+                return false;
             }
+
+            *buffer             = buffer_cpu;
+            buffer_cpu_previous = buffer_cpu;
+
+            return buffer_gpu->Unmap();
         }
 
-        // Set new buffer offset
-        buffer_gpu->SetOffsetIndexDynamic(offset_index);
+        // Only update if needed, the previous allocation of this frame can be re-used if the data didn't change
+        if (buffer_gpu->GetAllocationCount() != 0 && buffer_cpu == buffer_cpu_previous)
+            return true;
 
-        // Map  
-        T* buffer = static_cast<T*>(buffer_gpu->Map());
+        // Sub-allocate from the region of this frame, the memory is persistently mapped so there is nothing to unmap
+        T* buffer = static_cast<T*>(buffer_gpu->Allocate());
         if (!buffer)
         {
-            LOG_ERROR("Failed to map buffer");
+            LOG_ERROR("Failed to allocate from %s buffer", buffer_gpu->GetName().c_str());
             return false;
         }
 
-        uint64_t size   = buffer_gpu->GetStride();
-        uint64_t offset = offset_index * size;
-
-        // Update
-        if (buffer_gpu->IsDynamic())
-        {
-            memcpy(reinterpret_cast<std::byte*>(buffer) + offset, reinterpret_cast<std::byte*>(&buffer_cpu), size);
-        }
-        else
-        {
-            *buffer = buffer_cpu;
-        }
+        *buffer             = buffer_cpu;
         buffer_cpu_previous = buffer_cpu;
 
-        // Unmap
-        return buffer_gpu->Unmap(offset, size);
+        return true;
     }
 
     bool Renderer::UpdateUberBuffer(RHI_CommandList* cmd_list)
@@ -506,7 +598,7 @@ namespace Spartan
             return false;
         }
 
-        if (!update_dynamic_buffer<BufferUber>(cmd_list, m_buffer_uber_gpu.get(), m_buffer_uber_cpu, m_buffer_uber_cpu_previous, m_buffer_uber_offset_index))
+        if (!update_dynamic_buffer<BufferUber>(m_buffer_uber_gpu.get(), m_buffer_uber_cpu, m_buffer_uber_cpu_previous))
             return false;
 
         // Dynamic buffers with offsets have to be rebound whenever the offset changes
@@ -521,50 +613,81 @@ namespace Spartan
             return false;
         }
 
-        if (!update_dynamic_buffer<BufferObject>(cmd_list, m_buffer_object_gpu.get(), m_buffer_object_cpu, m_buffer_object_cpu_previous, m_buffer_object_offset_index))
+        if (!update_dynamic_buffer<BufferObject>(m_buffer_object_gpu.get(), m_buffer_object_cpu, m_buffer_object_cpu_previous))
             return false;
 
         // Dynamic buffers with offsets have to be rebound whenever the offset changes
         return cmd_list->SetConstantBuffer(3, RHI_Shader_Vertex, m_buffer_object_gpu);
     }
 
-    bool Renderer::UpdateLightBuffer(const Light* light)
+    bool Renderer::UpdateUberBuffer(RHI_CommandList* cmd_list, RecordingContext& context)
     {
-        if (!light)
+        if (!update_dynamic_buffer<BufferUber>(context.buffer_uber_gpu.get(), context.buffer_uber_cpu, context.buffer_uber_cpu_previous))
             return false;
 
-        // Only update if needed
-        if (m_buffer_light_cpu == m_buffer_light_cpu_previous)
-            return true;
+        return cmd_list->SetConstantBuffer(2, RHI_Shader_Pixel | RHI_Shader_Vertex, context.buffer_uber_gpu);
+    }
 
-        // Map
-        BufferLight* buffer = static_cast<BufferLight*>(m_buffer_light_gpu->Map());
+    bool Renderer::UpdateObjectBuffer(RHI_CommandList* cmd_list, RecordingContext& context)
+    {
+        if (!update_dynamic_buffer<BufferObject>(context.buffer_object_gpu.get(), context.buffer_object_cpu, context.buffer_object_cpu_previous))
+            return false;
+
+        return cmd_list->SetConstantBuffer(3, RHI_Shader_Vertex, context.buffer_object_gpu);
+    }
+
+    // Instance data is never the same twice, so there is no comparison with the previous update, and only the instances which are drawn are copied
+    static bool update_instance_buffer(RHI_ConstantBuffer* buffer_gpu, const BufferInstance& buffer_cpu, const uint32_t instance_count)
+    {
+        if (instance_count == 0 || instance_count > m_max_instances)
+        {
+            LOG_ERROR("Invalid instance count %d", instance_count);
+            return false;
+        }
+
+        BufferInstance* buffer = static_cast<BufferInstance*>(buffer_gpu->IsDynamic() ? buffer_gpu->Allocate() : buffer_gpu->Map());
         if (!buffer)
         {
-            LOG_ERROR("Failed to map buffer");
+            LOG_ERROR("Failed to update %s buffer", buffer_gpu->GetName().c_str());
             return false;
         }
 
+        memcpy(buffer->transform,       buffer_cpu.transform,       sizeof(Matrix) * instance_count);
+        memcpy(buffer->wvp_previous,    buffer_cpu.wvp_previous,    sizeof(Matrix) * instance_count);
+
+        return buffer_gpu->IsDynamic() ? true : buffer_gpu->Unmap();
+    }
+
+    bool Renderer::UpdateInstanceBuffer(RHI_CommandList* cmd_list, const uint32_t instance_count)
+    {
+        if (!update_instance_buffer(m_buffer_instance_gpu.get(), m_buffer_instance_cpu, instance_count))
+            return false;
+
+        return cmd_list->SetConstantBuffer(5, RHI_Shader_Vertex, m_buffer_instance_gpu);
+    }
+
+    bool Renderer::UpdateInstanceBuffer(RHI_CommandList* cmd_list, RecordingContext& context, const uint32_t instance_count)
+    {
+        if (!update_instance_buffer(context.buffer_instance_gpu.get(), context.buffer_instance_cpu, instance_count))
+            return false;
+
+        return cmd_list->SetConstantBuffer(5, RHI_Shader_Vertex, context.buffer_instance_gpu);
+    }
+
+    bool Renderer::UpdateLightBuffer(const Light* light)
+    {
+        if (!light)
+            return false;
+
         const bool volumetric         = static_cast<float>(m_options & Render_VolumetricLighting);
         const bool contact_shadows    = static_cast<float>(m_options & Render_ScreenSpaceShadows);
 
         for (uint32_t i = 0; i < light->GetShadowArraySize(); i++)
         {
-            m_buffer_light_cpu.view_projection[i] = light->GetViewMatrix(i) * light->GetProjectionMatrix(i);
+            m_buffer_light_cpu.view_projection[i] = GetShadowViewProjection(light, i);
         }
 
-        // Convert luminous power to luminous intensity
-        float luminous_intensity = light->GetIntensity() * m_camera->GetExposure();
-        if (light->GetLightType() == LightType::Point)
-        {
-            luminous_intensity /= Math::Helper::PI_4; // lumens to candelas
-            luminous_intensity *= 255.0f; // this is a hack, must fix whats my color units
-        }
-        else if (light->GetLightType() == LightType::Spot)
-        {
-            luminous_intensity /= Math::Helper::PI; // lumens to candelas
-            luminous_intensity *= 255.0f; // this is a hack, must fix whats my color units
-        }
+        const float luminous_intensity = light_luminous_intensity(light, m_camera->GetExposure());
 
         m_buffer_light_cpu.intensity_range_angle_bias   = Vector4(luminous_intensity, light->GetRange(), light->GetAngle(), GetOption(Render_ReverseZ) ? light->GetBias() : -light->GetBias());
         m_buffer_light_cpu.color                        = light->GetColor();
@@ -572,6 +695,18 @@ namespace Spartan
         m_buffer_light_cpu.position                     = light->GetTransform()->GetPosition();
         m_buffer_light_cpu.direction                    = light->GetDirection();
 
+        // Only update if needed
+        if (m_buffer_light_cpu == m_buffer_light_cpu_previous)
+            return true;
+
+        // Map
+        BufferLight* buffer = static_cast<BufferLight*>(m_buffer_light_gpu->Map());
+        if (!buffer)
+        {
+            LOG_ERROR("Failed to map buffer");
+            return false;
+        }
+
         // Update
         *buffer = m_buffer_light_cpu;
         m_buffer_light_cpu_previous = m_buffer_light_cpu;
@@ -580,6 +715,68 @@ namespace Spartan
         return m_buffer_light_gpu->Unmap();
     }
 
+    bool Renderer::UpdateLightClusterBuffers()
+    {
+        // The binning job has been running alongside the recording of the depth passes
+        m_threading->Wait(*m_light_clusters_task);
+        m_profiler->m_renderer_lights_clustered = m_light_clusters.GetLightCount();
+        m_profiler->m_time_light_binning        = m_light_clusters_time;
+
+        if (m_light_clusters.GetLightCount() == 0)
+            return true;
+
+        // Lights
+        {
+            BufferLights* buffer = static_cast<BufferLights*>(m_buffer_lights_gpu->Map());
+            if (!buffer)
+            {
+                LOG_ERROR("Failed to map buffer");
+                return false;
+            }
+
+            // Same order as the one they were binned in
+            const vector<Entity*>& entities = m_entities[Renderer_Object_Light];
+            uint32_t light_index = 0;
+            for (uint32_t i = 0; i < static_cast<uint32_t>(entities.size()); i++)
+            {
+                if (!m_lights_clustered[i])
+                    continue;
+
+                const Light* light              = entities[i]->GetComponent<Light>();
+                const float luminous_intensity  = light_luminous_intensity(light, m_camera->GetExposure());
+                const Vector4& color            = light->GetColor();
+
+                buffer->position_range[light_index]     = Vector4(light->GetTransform()->GetPosition(), light->GetRange());
+                buffer->color_type[light_index]         = Vector4(color.x * luminous_intensity, color.y * luminous_intensity, color.z * luminous_intensity, light->GetLightType() == LightType::Spot ? 1.0f : 0.0f);
+                buffer->direction_angle[light_index]    = Vector4(light->GetDirection(), light->GetAngle());
+                light_index++;
+            }
+
+            buffer->slice_scale = m_light_clusters.GetSliceScale();
+            buffer->slice_bias  = m_light_clusters.GetSliceBias();
+            buffer->light_count = static_cast<float>(light_index);
+
+            if (!m_buffer_lights_gpu->Unmap())
+                return false;
+        }
+
+        // Clusters
+        {
+            BufferClusters* buffer = static_cast<BufferClusters*>(m_buffer_clusters_gpu->Map());
+            if (!buffer)
+            {
+                LOG_ERROR("Failed to map buffer");
+                return false;
+            }
+
+            // Only the part of the index list which is in use
+            memcpy(buffer->clusters, m_light_clusters.GetClusters().data(), sizeof(buffer->clusters));
+            memcpy(buffer->indices, m_light_clusters.GetIndices().data(), m_light_clusters.GetIndexCount());
+
+            return m_buffer_clusters_gpu->Unmap();
+        }
+    }
+
 	void Renderer::RenderablesAcquire(const Variant& entities_variant)
 	{
         SCOPED_TIME_BLOCK(m_profiler);
@@ -601,14 +798,7 @@ namespace Spartan
 
 			if (renderable)
 			{
-                bool is_transparent = false;
-
-                if (const Material* material = renderable->GetMaterial())
-                {
-                    is_transparent = material->GetColorAlbedo().w < 1.0f;
-                }
-
-                m_entities[is_transparent ? Renderer_Object_Transparent : Renderer_Object_Opaque].emplace_back(entity.get());
+                m_entities[renderable_object_type(renderable)].emplace_back(entity.get());
 			}
 
 			if (light)
@@ -622,37 +812,12 @@ namespace Spartan
 				m_camera = camera->GetPtrShared<Camera>();
 			}
 		}
-
-		RenderablesSort(&m_entities[Renderer_Object_Opaque]);
-		RenderablesSort(&m_entities[Renderer_Object_Transparent]);
-	}
-
-	void Renderer::RenderablesSort(vector<Entity*>* renderables)
-	{
-		if (!m_camera || renderables->size() <= 2)
-			return;
-
-		auto comparison_op = [this](Entity* entity)
-		{
-			auto renderable = entity->GetRenderable();
-			if (!renderable)
-				return 0.0f;
-
-			return (renderable->GetAabb().GetCenter() - m_camera->GetTransform()->GetPosition()).LengthSquared();
-		};
-
-		// Sort by depth (front to back)
-		sort(renderables->begin(), renderables->end(), [&comparison_op](Entity* a, Entity* b)
-		{
-            return comparison_op(a) < comparison_op(b);
-		});
 	}
 
     void Renderer::ClearEntities()
     {
-        m_rhi_device->Queue_WaitAll();
-
-        // light depth buffers might be used by the command list
+        // Light depth buffers might be referenced by the commands recorded so far, frames in flight
+        // are fine as every GPU resource which is destroyed along with the entities has its release deferred.
         if (!m_swap_chain->GetCmdList()->Reset())
         {
             LOG_ERROR("Failed to reset command pool");
@@ -660,87 +825,1156 @@ namespace Spartan
         }
 
         m_entities.clear();
+        m_views.clear();
+        m_views_light.clear();
+        m_shadow_slices.clear();
+        m_shadow_casters.clear();
     }
 
-    const shared_ptr<Spartan::RHI_Texture>& Renderer::GetEnvironmentTexture()
+    void Renderer::VisibilityCompute()
     {
-        if (m_render_targets.find(RenderTarget_Brdf_Prefiltered_Environment) != m_render_targets.end())
-            return m_render_targets[RenderTarget_Brdf_Prefiltered_Environment];
+        SCOPED_TIME_BLOCK(m_profiler);
 
-        return m_tex_white;
-    }
+        // Describe the views, the camera first, followed by every shadow slice of every light
+        const auto& entities_light = m_entities[Renderer_Object_Light];
+        uint32_t view_count = 1;
+        m_views_light.resize(entities_light.size());
+        for (uint32_t light_index = 0; light_index < static_cast<uint32_t>(entities_light.size()); light_index++)
+        {
+            m_views_light[light_index] = view_count;
 
-    void Renderer::SetEnvironmentTexture(const shared_ptr<RHI_Texture>& texture)
-    {
-        m_render_targets[RenderTarget_Brdf_Prefiltered_Environment] = texture;
-    }
+            const Light* light = entities_light[light_index]->GetComponent<Light>();
+            if (light && light->GetShadowsEnabled() && light->GetDepthTexture())
+            {
+                view_count += light->GetDepthTexture()->GetArraySize();
+            }
+        }
+        m_views.resize(view_count);
 
-	void Renderer::SetOption(Renderer_Option option, bool enable)
-	{
-        if (enable && !GetOption(option))
+        m_views[0].frustum              = m_camera->GetFrustum();
+        m_views[0].ignore_near_plane    = false;
+        m_views[0].is_camera            = true;
+        m_views[0].shadow_casters       = false;
+
+        for (uint32_t light_index = 0; light_index < static_cast<uint32_t>(entities_light.size()); light_index++)
         {
-            m_options |= option;
+            const Light* light = entities_light[light_index]->GetComponent<Light>();
+            if (!light || !light->GetShadowsEnabled() || !light->GetDepthTexture())
+                continue;
+
+            for (uint32_t array_index = 0; array_index < light->GetDepthTexture()->GetArraySize(); array_index++)
+            {
+                VisibilityView& view    = m_views[m_views_light[light_index] + array_index];
+                view.frustum            = light->GetFrustum(array_index);
+                view.ignore_near_plane  = light->GetFrustumIgnoreNearPlane();
+                view.is_camera          = false;
+                view.shadow_casters     = true;
+            }
         }
-        else if (!enable && GetOption(option))
+
+        // Levels of detail are picked once, from the camera, so that every view agrees on them
+        LodCompute();
+
+        // Views are independent, so they are computed in parallel
+        m_threading->ParallelFor(view_count, 1, [this](const uint32_t start, const uint32_t end)
         {
-            m_options &= ~option;
-        }
-        else
+            for (uint32_t i = start; i < end; i++)
+            {
+                VisibilityComputeView(m_views[i]);
+            }
+        });
+    }
+
+    void Renderer::VisibilityComputeView(VisibilityView& view)
+    {
+        for (auto& draw_calls : view.draw_calls)
         {
-            return;
+            draw_calls.clear();
         }
-	}
 
-    void Renderer::SetOptionValue(Renderer_Option_Value option, float value)
-    {
-        if (!m_rhi_device || !m_rhi_device->GetContextRhi())
+        if (!m_world)
             return;
 
-        if (option == Option_Value_Anisotropy)
+        thread_local vector<Entity*> candidates;
+        candidates.clear();
+        m_world->GetBvh().QueryFrustum(view.frustum, candidates, view.ignore_near_plane);
+
+        const Vector3 camera_position   = m_camera->GetTransform()->GetPosition();
+        const float camera_far_inv      = 1.0f / Helper::Max(m_camera->GetFarPlane(), Helper::M_EPSILON);
+
+        for (Entity* entity : candidates)
         {
-            value = Helper::Clamp(value, 0.0f, 16.0f);
+            if (!entity->IsActive())
+                continue;
+
+            // Skip renderables without geometry
+            Renderable* renderable  = entity->GetRenderable();
+            const Model* model      = renderable->GeometryModel();
+            if (!model || !model->GetVertexBuffer() || !model->GetIndexBuffer())
+                continue;
+
+            const Material* material = renderable->GetMaterial();
+            if (view.shadow_casters && (!renderable->GetCastShadows() || !material))
+                continue;
+
+            const Renderer_Object_Type object_type = renderable_object_type(renderable);
+
+            // Skip transparent objects that won't contribute
+            if (view.is_camera && object_type == Renderer_Object_Transparent && material->GetColorAlbedo().w == 0)
+                continue;
+
+            // Only the camera cares about shader variations and about drawing front to back
+            uint16_t variation  = 0;
+            float depth         = 0.0f;
+            if (view.is_camera)
+            {
+                variation   = material ? material->GetFlags() : 0;
+                depth       = Vector3::Distance(renderable->GetAabb().GetCenter(), camera_position) * camera_far_inv;
+            }
+
+            // Shadows are filtered and mostly seen from afar, so they can afford coarser geometry than the camera
+            uint32_t lod = renderable->GetLod();
+            if (view.shadow_casters)
+            {
+                lod = Helper::Min(lod + m_lod_shadow_bias, renderable->GeometryLodCount() - 1);
+            }
+
+            DrawCall& draw_call = view.draw_calls[object_type].emplace_back();
+            draw_call.entity    = entity;
+            draw_call.lod       = lod;
+            draw_call.key       = draw_call_key(object_type, variation, material ? material->GetId() : 0, model->GetId(), depth);
         }
-        else if (option == Option_Value_ShadowResolution)
+
+        thread_local vector<DrawCall> scratch;
+        for (auto& draw_calls : view.draw_calls)
         {
-            value = Helper::Clamp(value, static_cast<float>(m_resolution_shadow_min), static_cast<float>(m_rhi_device->GetContextRhi()->max_texture_dimension_2d));
+            Utility::RadixSort(draw_calls, scratch);
         }
+    }
 
-        if (m_option_values[option] == value)
+    void Renderer::LodCompute()
+    {
+        if (!m_camera)
             return;
 
-        m_option_values[option] = value;
+        const Vector3 camera_position   = m_camera->GetTransform()->GetPosition();
+        const float tan_half_fov_inv    = 1.0f / Helper::Max(tan(m_camera->GetFovVerticalRad() * 0.5f), Helper::M_EPSILON);
 
-        // Shadow resolution handling
-        if (option == Option_Value_ShadowResolution)
+        // The screen size below which a level can be used
+        const auto lod_screen_size = [this](const uint32_t lod) { return m_lod_screen_size / static_cast<float>(1 << (lod - 1)); };
+
+        for (const Renderer_Object_Type object_type : { Renderer_Object_Opaque, Renderer_Object_Transparent })
         {
-            const auto& light_entities = m_entities[Renderer_Object_Light];
-            for (const auto& light_entity : light_entities)
+            const vector<Entity*>& entities = m_entities[object_type];
+            m_threading->ParallelFor(static_cast<uint32_t>(entities.size()), 64, [&](const uint32_t start, const uint32_t end)
             {
-                auto light = light_entity->GetComponent<Light>();
-                if (light->GetShadowsEnabled())
+                for (uint32_t i = start; i < end; i++)
                 {
-                    light->CreateShadowMap();
+                    Renderable* renderable      = entities[i]->GetRenderable();
+                    const uint32_t lod_count    = renderable->GeometryLodCount();
+                    if (lod_count == 1)
+                    {
+                        renderable->SetLod(0);
+                        continue;
+                    }
+
+                    // Fraction of the screen height covered by the bounding sphere
+                    const BoundingBox& aabb = renderable->GetAabb();
+                    const float distance    = Helper::Max(Vector3::Distance(aabb.GetCenter(), camera_position), Helper::M_EPSILON);
+                    const float size        = aabb.GetExtents().Length() / distance * tan_half_fov_inv;
+
+                    // Move from the current level only once the size is clearly past a threshold, so that levels don't flicker
+                    uint32_t lod = Helper::Min(renderable->GetLod(), lod_count - 1);
+                    while (lod + 1 < lod_count && size < lod_screen_size(lod + 1) * (1.0f - m_lod_hysteresis))
+                    {
+                        lod++;
+                    }
+                    while (lod > 0 && size > lod_screen_size(lod) * (1.0f + m_lod_hysteresis))
+                    {
+                        lod--;
+                    }
+
+                    renderable->SetLod(lod);
                 }
-            }
+            });
         }
     }
 
-    bool Renderer::Present()
+    void Renderer::OcclusionCompute()
     {
-        if (m_swap_chain->GetCmdList()->IsRecording())
-        {
-            if (!m_swap_chain->GetCmdList()->Submit())
-            {
-                LOG_ERROR("Failed to submit");
-                return false;
-            }
-        }
+        m_profiler->m_renderer_occluders        = 0;
+        m_profiler->m_renderer_objects_occluded = 0;
 
-        if (!m_swap_chain->Present())
-        {
-            LOG_ERROR("Failed to present");
-            return false;
-        }
+        if (!GetOption(Render_OcclusionCulling) || !m_camera)
+            return;
+
+        SCOPED_TIME_BLOCK(m_profiler);
+
+        VisibilityView& view            = m_views[0];
+        const Vector3 camera_position   = m_camera->GetTransform()->GetPosition();
+
+        // Pick the occluders, the ones which are marked as such and the biggest ones on screen which are cheap enough to rasterize
+        m_occluders.clear();
+        for (const DrawCall& draw_call : view.draw_calls[Renderer_Object_Opaque])
+        {
+            Renderable* renderable  = draw_call.entity->GetRenderable();
+            const Model* model      = renderable->GeometryModel();
+            if (!model || !model->GetMesh())
+                continue;
+
+            const BoundingBox& aabb = renderable->GetAabb();
+            const float distance    = Helper::Max(Vector3::Distance(aabb.GetCenter(), camera_position), Helper::M_EPSILON);
+            const float size        = aabb.GetExtents().Length() / distance;
+
+            if (!renderable->GetOccluder() && (renderable->GeometryIndexCount() / 3 > m_occluder_triangle_max || size < m_occluder_size_min))
+                continue;
+
+            m_occluders.emplace_back(renderable->GetOccluder() ? numeric_limits<float>::max() : size, draw_call.entity);
+        }
+
+        const uint32_t occluder_count = Helper::Min(static_cast<uint32_t>(m_occluders.size()), m_occluder_max);
+        partial_sort(m_occluders.begin(), m_occluders.begin() + occluder_count, m_occluders.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+        m_occluders.resize(occluder_count);
+
+        m_occluder_entities.clear();
+        for (const auto& occluder : m_occluders)
+        {
+            m_occluder_entities.emplace_back(occluder.second);
+        }
+        sort(m_occluder_entities.begin(), m_occluder_entities.end());
+
+        // Set up the triangles of the occluders, then rasterize them, both in parallel
+        m_occlusion_buffer.Begin(m_camera->GetViewProjectionMatrix(), GetOption(Render_ReverseZ), occluder_count);
+        m_threading->ParallelFor(occluder_count, 1, [this](const uint32_t start, const uint32_t end)
+        {
+            for (uint32_t i = start; i < end; i++)
+            {
+                const Entity* entity            = m_occluders[i].second;
+                const Renderable* renderable    = entity->GetRenderable();
+                Mesh* mesh                      = renderable->GeometryModel()->GetMesh().get();
+                const auto& vertices            = mesh->Vertices_Get();
+                const auto& indices             = mesh->Indices_Get();
+                if (renderable->GeometryIndexOffset() + renderable->GeometryIndexCount() > indices.size() || renderable->GeometryVertexOffset() >= vertices.size())
+                    continue;
+
+                m_occlusion_buffer.SetOccluder(i, entity->GetTransform()->GetMatrix(), vertices.data() + renderable->GeometryVertexOffset(), indices.data() + renderable->GeometryIndexOffset(), renderable->GeometryIndexCount());
+            }
+        });
+
+        m_threading->ParallelFor(OcclusionBuffer::band_count, 1, [this](const uint32_t start, const uint32_t end)
+        {
+            for (uint32_t band_index = start; band_index < end; band_index++)
+            {
+                m_occlusion_buffer.RasterizeBand(band_index);
+            }
+        });
+
+        // Test everything the camera sees against it, and drop what's hidden (keeping the order of the rest)
+        uint32_t occluded_count = 0;
+        for (vector<DrawCall>& draw_calls : view.draw_calls)
+        {
+            m_occlusion_visible.resize(draw_calls.size());
+            m_threading->ParallelFor(static_cast<uint32_t>(draw_calls.size()), 64, [this, &draw_calls](const uint32_t start, const uint32_t end)
+            {
+                for (uint32_t i = start; i < end; i++)
+                {
+                    // An occluder is in the buffer, testing it would mostly compare it against its own depth
+                    const Entity* entity    = draw_calls[i].entity;
+                    const bool is_occluder  = binary_search(m_occluder_entities.begin(), m_occluder_entities.end(), entity);
+
+                    m_occlusion_visible[i] = (is_occluder || m_occlusion_buffer.IsVisible(entity->GetRenderable()->GetAabb())) ? 1 : 0;
+                }
+            });
+
+            uint32_t visible_count = 0;
+            for (uint32_t i = 0; i < static_cast<uint32_t>(draw_calls.size()); i++)
+            {
+                if (m_occlusion_visible[i])
+                {
+                    draw_calls[visible_count++] = draw_calls[i];
+                }
+            }
+
+            occluded_count += static_cast<uint32_t>(draw_calls.size()) - visible_count;
+            draw_calls.resize(visible_count);
+        }
+
+        m_profiler->m_renderer_occluders        = occluder_count;
+        m_profiler->m_renderer_objects_occluded = occluded_count;
+    }
+
+    // Every caster of a slice contributes, in no particular order, so that the way the draw calls are sorted doesn't matter
+    static size_t shadow_caster_hash(const Entity* entity, const uint32_t lod, const uint64_t frame_moved, const bool transparent)
+    {
+        const Renderable* renderable = entity->GetRenderable();
+
+        size_t hash = 0;
+        Utility::Hash::hash_combine(hash, entity->GetId());
+        Utility::Hash::hash_combine(hash, frame_moved);
+        Utility::Hash::hash_combine(hash, renderable->GeometryModel()->GetId());
+        Utility::Hash::hash_combine(hash, renderable->GeometryIndexOffset());
+        Utility::Hash::hash_combine(hash, lod);
+        if (transparent)
+        {
+            Utility::Hash::hash_combine(hash, renderable->GetMaterial()->GetId());
+        }
+
+        return hash;
+    }
+
+    // The far cascades of directional lights cover a lot of ground at a low density, so they are allowed to lag behind a bit
+    static bool shadow_slice_due(const Light* light, const uint32_t array_index, const uint64_t frame)
+    {
+        if (light->GetLightType() != LightType::Directional)
+            return true;
+
+        if (array_index == 2)
+            return (frame % 2) == 0;
+
+        if (array_index >= 3)
+            return (frame % 4) == 1;
+
+        return true;
+    }
+
+    void Renderer::ShadowCastersTrack()
+    {
+        // A caster has moved whenever its transform differs from the one it had in the previous frame
+        uint32_t caster_count = 0;
+        for (const Renderer_Object_Type object_type : { Renderer_Object_Opaque, Renderer_Object_Transparent })
+        {
+            for (const Entity* entity : m_entities[object_type])
+            {
+                if (!entity->GetRenderable()->GetCastShadows())
+                    continue;
+
+                const Matrix& transform     = entity->GetTransform()->GetMatrix();
+                auto [it, inserted]         = m_shadow_casters.try_emplace(entity);
+                ShadowCasterMotion& motion  = it->second;
+                if (inserted || motion.transform != transform)
+                {
+                    motion.transform    = transform;
+                    motion.frame_moved  = m_frame_num;
+                }
+                motion.frame_seen = m_frame_num;
+                caster_count++;
+            }
+        }
+
+        // Forget the casters which are gone
+        if (m_shadow_casters.size() > caster_count)
+        {
+            for (auto it = m_shadow_casters.begin(); it != m_shadow_casters.end();)
+            {
+                it = it->second.frame_seen != m_frame_num ? m_shadow_casters.erase(it) : next(it);
+            }
+        }
+    }
+
+    void Renderer::ShadowSlicesCompute()
+    {
+        struct SliceRef
+        {
+            const Light* light      = nullptr;
+            uint32_t light_index    = 0;
+            uint32_t array_index    = 0;
+            ShadowSliceCache* cache = nullptr;
+        };
+
+        // Gather the slices of this frame
+        const auto& entities_light = m_entities[Renderer_Object_Light];
+        vector<SliceRef> slices;
+        vector<const Light*> lights;
+        for (uint32_t light_index = 0; light_index < static_cast<uint32_t>(entities_light.size()); light_index++)
+        {
+            const Light* light = entities_light[light_index]->GetComponent<Light>();
+            if (!light || !light->GetShadowsEnabled() || !light->GetDepthTexture())
+                continue;
+
+            const uint32_t array_size           = light->GetDepthTexture()->GetArraySize();
+            vector<ShadowSliceCache>& caches    = m_shadow_slices[light];
+            caches.resize(array_size);
+            lights.emplace_back(light);
+
+            for (uint32_t array_index = 0; array_index < array_size; array_index++)
+            {
+                slices.push_back({ light, light_index, array_index, &caches[array_index] });
+            }
+        }
+
+        // Lights which are gone, or don't cast shadows anymore, take their slices with them
+        if (m_shadow_slices.size() > lights.size())
+        {
+            for (auto it = m_shadow_slices.begin(); it != m_shadow_slices.end();)
+            {
+                it = find(lights.begin(), lights.end(), it->first) == lights.end() ? m_shadow_slices.erase(it) : next(it);
+            }
+        }
+
+        // Split the opaque casters into static and dynamic ones and hash everything, slices are independent so they are done in parallel
+        m_threading->ParallelFor(static_cast<uint32_t>(slices.size()), 1, [this, &slices](const uint32_t start, const uint32_t end)
+        {
+            for (uint32_t i = start; i < end; i++)
+            {
+                const SliceRef& slice       = slices[i];
+                ShadowSliceCache& cache     = *slice.cache;
+                const VisibilityView& view  = m_views[m_views_light[slice.light_index] + slice.array_index];
+
+                const Matrix view_projection = slice.light->GetViewMatrix(slice.array_index) * slice.light->GetProjectionMatrix(slice.array_index);
+                size_t hash_view = 0;
+                for (uint32_t element = 0; element < 16; element++)
+                {
+                    Utility::Hash::hash_combine(hash_view, view_projection.Data()[element]);
+                }
+
+                size_t sum_static   = 0;
+                size_t sum_dynamic  = 0;
+                cache.draw_calls_static.clear();
+                cache.draw_calls_dynamic.clear();
+                for (const DrawCall& draw_call : view.draw_calls[Renderer_Object_Opaque])
+                {
+                    const auto it               = m_shadow_casters.find(draw_call.entity);
+                    const uint64_t frame_moved  = it != m_shadow_casters.end() ? it->second.frame_moved : m_frame_num;
+                    const bool is_static        = (m_frame_num - frame_moved) >= m_shadow_static_frames;
+
+                    (is_static ? cache.draw_calls_static : cache.draw_calls_dynamic).emplace_back(draw_call);
+                    (is_static ? sum_static : sum_dynamic) += shadow_caster_hash(draw_call.entity, draw_call.lod, frame_moved, false);
+                }
+
+                size_t sum_transparent = 0;
+                if (slice.light->GetShadowsTransparentEnabled())
+                {
+                    for (const DrawCall& draw_call : view.draw_calls[Renderer_Object_Transparent])
+                    {
+                        const auto it               = m_shadow_casters.find(draw_call.entity);
+                        const uint64_t frame_moved  = it != m_shadow_casters.end() ? it->second.frame_moved : m_frame_num;
+                        sum_transparent             += shadow_caster_hash(draw_call.entity, draw_call.lod, frame_moved, true);
+                    }
+                }
+
+                cache.hash_view_current     = hash_view;
+                cache.hash_static_current   = hash_view;
+                Utility::Hash::hash_combine(cache.hash_static_current, sum_static);
+                Utility::Hash::hash_combine(cache.hash_static_current, cache.draw_calls_static.size());
+
+                cache.hash_current = cache.hash_static_current;
+                Utility::Hash::hash_combine(cache.hash_current, sum_dynamic);
+                Utility::Hash::hash_combine(cache.hash_current, cache.draw_calls_dynamic.size());
+                Utility::Hash::hash_combine(cache.hash_current, sum_transparent);
+                Utility::Hash::hash_combine(cache.hash_current, view.draw_calls[Renderer_Object_Transparent].size());
+            }
+        });
+
+        // Decide what each slice does this frame
+        const bool copy_supported   = m_shaders[Shader_DepthCopy_P]->IsCompiled();
+        uint32_t slices_rendered    = 0;
+        uint32_t slices_reused      = 0;
+        for (const SliceRef& slice : slices)
+        {
+            ShadowSliceCache& cache = *slice.cache;
+            RHI_Texture* tex_depth  = slice.light->GetDepthTexture();
+            const bool valid        = cache.rendered && cache.texture == tex_depth;
+
+            // Nothing changed, or it's a slice which is allowed to lag behind and it isn't its turn
+            cache.render            = !valid || (cache.hash_current != cache.hash && shadow_slice_due(slice.light, slice.array_index, m_frame_num));
+            cache.render_static     = false;
+            cache.restore_static    = false;
+
+            if (cache.render)
+            {
+                // If only dynamic casters changed, they are drawn over a copy of the static layer
+                cache.restore_static = copy_supported && valid && cache.static_valid && cache.hash_static_current == cache.hash_static;
+
+                // Otherwise, the static layer is rebuilt once the view has settled, and only if there is something dynamic to draw over it
+                if (!cache.restore_static && copy_supported && cache.hash_view_current == cache.hash_view_previous && !cache.draw_calls_static.empty() && !cache.draw_calls_dynamic.empty())
+                {
+                    if (!cache.tex_static || cache.tex_static->GetWidth() != tex_depth->GetWidth() || cache.tex_static->GetHeight() != tex_depth->GetHeight())
+                    {
+                        cache.tex_static = make_shared<RHI_Texture2D>(m_context, tex_depth->GetWidth(), tex_depth->GetHeight(), RHI_Format_D32_Float, 1, 0, "shadow_static");
+                    }
+
+                    cache.render_static = true;
+                }
+
+                cache.texture           = tex_depth;
+                cache.view_projection   = slice.light->GetViewMatrix(slice.array_index) * slice.light->GetProjectionMatrix(slice.array_index);
+                cache.hash              = cache.hash_current;
+                cache.hash_static       = cache.hash_static_current;
+                cache.static_valid      = cache.restore_static || cache.render_static;
+                cache.rendered          = true;
+                slices_rendered++;
+            }
+            else
+            {
+                slices_reused++;
+            }
+
+            cache.hash_view_previous = cache.hash_view_current;
+        }
+
+        m_profiler->m_renderer_shadow_slices_rendered   = slices_rendered;
+        m_profiler->m_renderer_shadow_slices_reused     = slices_reused;
+    }
+
+    Matrix Renderer::GetShadowViewProjection(const Light* light, const uint32_t array_index) const
+    {
+        // Slices which are being reused have to be sampled with the view-projection they were rendered with
+        const auto it = m_shadow_slices.find(light);
+        if (it != m_shadow_slices.end() && array_index < it->second.size())
+        {
+            const ShadowSliceCache& cache = it->second[array_index];
+            if (cache.rendered && cache.texture == light->GetDepthTexture())
+                return cache.view_projection;
+        }
+
+        return light->GetViewMatrix(array_index) * light->GetProjectionMatrix(array_index);
+    }
+
+    void Renderer::LightClustersCompute()
+    {
+        // Collect the lights, the job only ever touches this copy of them
+        const vector<Entity*>& entities = m_entities[Renderer_Object_Light];
+        m_light_clusters_input.clear();
+        m_lights_clustered.assign(entities.size(), false);
+        for (uint32_t i = 0; i < static_cast<uint32_t>(entities.size()); i++)
+        {
+            const Light* light = entities[i]->GetComponent<Light>();
+            if (!light || light->GetIntensity() == 0 || !IsLightClustered(light))
+                continue;
+
+            // Lights which don't fit are shaded by a pass of their own
+            if (m_light_clusters_input.size() == LightClusters::light_max)
+                break;
+
+            LightClusters::Light input;
+            input.position  = light->GetTransform()->GetPosition();
+            input.direction = light->GetDirection();
+            input.range     = light->GetRange();
+            input.cos_angle = light->GetLightType() == LightType::Spot ? Helper::Clamp(1.0f - light->GetAngle(), -1.0f, 1.0f) : -1.0f; // same cutoff as the shader
+            m_light_clusters_input.emplace_back(input);
+
+            m_lights_clustered[i] = true;
+        }
+
+        m_light_clusters_view.view          = m_camera->GetViewMatrix();
+        m_light_clusters_view.projection_x  = m_camera->GetProjectionMatrix().m00;
+        m_light_clusters_view.projection_y  = m_camera->GetProjectionMatrix().m11;
+        m_light_clusters_view.near_plane    = m_camera->GetNearPlane();
+        m_light_clusters_view.far_plane     = m_camera->GetFarPlane();
+        m_light_clusters_view.orthographic  = m_camera->GetProjectionType() == Projection_Orthographic;
+
+        m_threading->AddTask([this]()
+        {
+            Stopwatch timer;
+            m_light_clusters.Build(m_light_clusters_view, m_light_clusters_input);
+            m_light_clusters_time = timer.GetElapsedTimeMs();
+        }, m_light_clusters_task.get());
+    }
+
+    bool Renderer::IsLightClustered(const Light* light) const
+    {
+        // Shadow maps are bound one light at a time, so lights which need them (or screen space shadows) keep a pass of their own
+        if (light->GetLightType() == LightType::Directional || light->GetShadowsEnabled())
+            return false;
+
+        if (light->GetShadowsScreenSpaceEnabled() && GetOption(Render_ScreenSpaceShadows))
+            return false;
+
+        return true;
+    }
+
+    vector<ShaderPermutation> Renderer::ShaderPermutationsGather(const vector<shared_ptr<Entity>>& entities) const
+    {
+        vector<ShaderPermutation> permutations;
+        auto add = [&permutations](const Renderer_Shader_Permutation_Type type, const uint16_t flags)
+        {
+            const auto it = find_if(permutations.begin(), permutations.end(), [type, flags](const ShaderPermutation& permutation)
+            {
+                return permutation.type == type && permutation.flags == flags;
+            });
+
+            if (it == permutations.end())
+            {
+                permutations.push_back({ type, flags });
+            }
+        };
+
+        bool has_clustered_lights = false;
+        for (const auto& entity : entities)
+        {
+            if (Renderable* renderable = entity->GetRenderable())
+            {
+                if (Material* material = renderable->GetMaterial())
+                {
+                    add(Shader_Permutation_GBuffer, material->GetFlags());
+                }
+            }
+
+            if (Light* light = entity->GetComponent<Light>())
+            {
+                if (IsLightClustered(light))
+                {
+                    has_clustered_lights = true;
+                }
+                else
+                {
+                    add(Shader_Permutation_Light, ShaderLight::ComputeFlags(light, m_options));
+                }
+            }
+        }
+
+        // The clustered pass adds reflections only when no light had a pass of its own, so it can go either way
+        if (has_clustered_lights)
+        {
+            add(Shader_Permutation_Light, ShaderLight::ComputeFlagsClustered(m_options, true));
+            add(Shader_Permutation_Light, ShaderLight::ComputeFlagsClustered(m_options, false));
+        }
+
+        return permutations;
+    }
+
+    vector<ShaderPermutation> Renderer::ShaderPermutationsAll() const
+    {
+        vector<ShaderPermutation> permutations;
+
+        // Every subset of the bits in mask, combined with base
+        auto add_subsets = [&permutations](const Renderer_Shader_Permutation_Type type, const uint16_t base, const uint16_t mask)
+        {
+            uint16_t subset = mask;
+            do
+            {
+                permutations.push_back({ type, static_cast<uint16_t>(base | subset) });
+                subset = (subset - 1) & mask;
+            } while (subset != mask);
+        };
+
+        // Any combination of texture maps
+        const uint16_t material_maps = Material_Color | Material_Roughness | Material_Metallic | Material_Normal | Material_Height | Material_Occlusion | Material_Emission | Material_Mask;
+        add_subsets(Shader_Permutation_GBuffer, 0, material_maps);
+
+        // Each light type, with any combination of shadow, volumetric and reflection options
+        const uint16_t light_options = Shader_Light_Shadows | Shader_Light_ShadowsScreenSpace | Shader_Light_ShadowsTransparent | Shader_Light_Volumetric | Shader_Light_ScreenSpaceReflections;
+        add_subsets(Shader_Permutation_Light, Shader_Light_Directional, light_options);
+        add_subsets(Shader_Permutation_Light, Shader_Light_Point,       light_options);
+        add_subsets(Shader_Permutation_Light, Shader_Light_Spot,        light_options);
+        add_subsets(Shader_Permutation_Light, Shader_Light_Clustered,   Shader_Light_ScreenSpaceReflections);
+
+        return permutations;
+    }
+
+    bool Renderer::ShaderPermutationsCompile(const vector<ShaderPermutation>& permutations, const function<void(uint32_t, uint32_t)>& on_progress /*= nullptr*/, const bool log_timings /*= false*/)
+    {
+        const uint32_t count = static_cast<uint32_t>(permutations.size());
+        vector<RHI_Shader*> shaders(count, nullptr);
+        uint32_t compiled_count = 0;
+        mutex mutex_progress;
+        const Stopwatch timer;
+
+        // One permutation per chunk, they vary a lot in cost
+        m_threading->ParallelFor(count, 1, [this, &permutations, &shaders, &compiled_count, &mutex_progress, &on_progress, count](uint32_t start, uint32_t end)
+        {
+            for (uint32_t i = start; i < end; i++)
+            {
+                const ShaderPermutation& permutation = permutations[i];
+
+                RHI_Shader* shader = nullptr;
+                if (permutation.type == Shader_Permutation_GBuffer)
+                {
+                    shader = ShaderGBuffer::GenerateVariation(m_context, permutation.flags, false);
+                }
+                else
+                {
+                    shader = ShaderLight::GenerateVariation(m_context, permutation.flags, false);
+                }
+
+                // A permutation which was requested earlier may still be queued or compiling
+                shader->WaitForCompilation();
+                shaders[i] = shader;
+
+                if (on_progress)
+                {
+                    lock_guard<mutex> lock(mutex_progress);
+                    on_progress(++compiled_count, count);
+                }
+            }
+        });
+
+        const bool success = all_of(shaders.begin(), shaders.end(), [](const RHI_Shader* shader) { return shader->IsCompiled(); });
+
+        // Slowest first, so that permutation growth stands out
+        if (log_timings)
+        {
+            vector<uint32_t> order(count);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                order[i] = i;
+            }
+            sort(order.begin(), order.end(), [&shaders](const uint32_t a, const uint32_t b) { return shaders[a]->GetCompileTimeMs() > shaders[b]->GetCompileTimeMs(); });
+
+            float time_sum = 0.0f;
+            for (const uint32_t i : order)
+            {
+                const RHI_Shader* shader = shaders[i];
+                time_sum += shader->GetCompileTimeMs();
+
+                LOG_INFO("%8.2f ms  %s 0x%04x%s%s",
+                    shader->GetCompileTimeMs(),
+                    shader->GetName().c_str(),
+                    permutations[i].flags,
+                    shader->IsFromCache() ? " (cached)" : "",
+                    shader->IsCompiled() ? "" : " (failed)"
+                );
+            }
+
+            LOG_INFO("Shader compile time: %.2f ms summed over %u permutations", time_sum, count);
+        }
+
+        LOG_INFO("Compiled %u shader permutations in %.2f ms", count, timer.GetElapsedTimeMs());
+
+        return success;
+    }
+
+    string Renderer::PipelinesGetFilePath(const string& world_name) const
+    {
+        return m_resource_cache->GetDataDirectory(Asset_PipelineCache) + "/" + world_name + ".pipelines";
+    }
+
+    vector<const void*> Renderer::PipelinesGetStates() const
+    {
+        // The order is part of the file format, only append to it
+        return
+        {
+            m_depth_stencil_off_off.get(),
+            m_depth_stencil_off_on_r.get(),
+            m_depth_stencil_on_off_w.get(),
+            m_depth_stencil_on_off_r.get(),
+            m_depth_stencil_on_on_w.get(),
+            m_blend_disabled.get(),
+            m_blend_alpha.get(),
+            m_blend_additive.get(),
+            m_rasterizer_cull_back_solid.get(),
+            m_rasterizer_cull_back_solid_no_clip.get(),
+            m_rasterizer_cull_front_solid.get(),
+            m_rasterizer_cull_none_solid.get(),
+            m_rasterizer_cull_back_wireframe.get(),
+            m_rasterizer_cull_front_wireframe.get(),
+            m_rasterizer_cull_none_wireframe.get()
+        };
+    }
+
+    bool Renderer::PipelinesSave(const string& world_name)
+    {
+        if (world_name.empty() || !m_pipeline_cache)
+            return false;
+
+        const vector<const void*> states = PipelinesGetStates();
+
+        // Shaders are stored as a source and a value, which is either a renderer shader type or variation flags
+        auto resolve_shader = [this](const RHI_Shader* shader, uint32_t* source, uint32_t* value)
+        {
+            *source = Pipeline_Shader_None;
+            *value  = 0;
+
+            if (!shader)
+                return true;
+
+            uint16_t flags = 0;
+            if (ShaderGBuffer::GetVariationFlags(shader, &flags))
+            {
+                *source = Pipeline_Shader_GBuffer;
+                *value  = flags;
+                return true;
+            }
+
+            if (ShaderLight::GetVariationFlags(shader, &flags))
+            {
+                *source = Pipeline_Shader_Light;
+                *value  = flags;
+                return true;
+            }
+
+            for (const auto& it : m_shaders)
+            {
+                if (it.second.get() == shader)
+                {
+                    *source = Pipeline_Shader_Renderer;
+                    *value  = static_cast<uint32_t>(it.first);
+                    return true;
+                }
+            }
+
+            return false;
+        };
+
+        auto resolve_state = [&states](const void* state, int* index)
+        {
+            *index = -1;
+
+            if (!state)
+                return true;
+
+            const auto it = find(states.begin(), states.end(), state);
+            if (it == states.end())
+                return false;
+
+            *index = static_cast<int>(it - states.begin());
+            return true;
+        };
+
+        auto resolve_texture = [this](const RHI_Texture* texture, uint64_t* id)
+        {
+            *id = 0;
+
+            if (!texture)
+                return true;
+
+            for (const auto& it : m_render_targets)
+            {
+                if (it.second.get() == texture)
+                {
+                    *id = static_cast<uint64_t>(it.first);
+                    return true;
+                }
+            }
+
+            return false;
+        };
+
+        // Resolve every pipeline state that was used, anything that doesn't belong to the renderer (shadow maps, editor) is skipped
+        struct PipelineEntry
+        {
+            const RHI_PipelineState* state;
+            uint32_t shader_source[3];
+            uint32_t shader_value[3];
+            int state_index[3];
+            uint64_t render_target_depth;
+            uint64_t render_target_color[state_max_render_target_count];
+        };
+
+        vector<PipelineEntry> entries;
+        for (const RHI_PipelineState* state : m_pipeline_cache->GetUsedPipelineStates())
+        {
+            PipelineEntry entry = {};
+            entry.state = state;
+
+            bool resolved =
+                resolve_shader(state->shader_vertex,  &entry.shader_source[0], &entry.shader_value[0]) &&
+                resolve_shader(state->shader_pixel,   &entry.shader_source[1], &entry.shader_value[1]) &&
+                resolve_shader(state->shader_compute, &entry.shader_source[2], &entry.shader_value[2]) &&
+                resolve_state(state->depth_stencil_state,   &entry.state_index[0]) &&
+                resolve_state(state->blend_state,           &entry.state_index[1]) &&
+                resolve_state(state->rasterizer_state,      &entry.state_index[2]) &&
+                resolve_texture(state->render_target_depth_texture, &entry.render_target_depth);
+
+            for (uint32_t i = 0; i < state_max_render_target_count && resolved; i++)
+            {
+                resolved = resolve_texture(state->render_target_color_textures[i], &entry.render_target_color[i]);
+            }
+
+            if (state->render_target_swapchain && state->render_target_swapchain != m_swap_chain.get())
+            {
+                resolved = false;
+            }
+
+            if (resolved)
+            {
+                entries.emplace_back(entry);
+            }
+        }
+
+        if (entries.empty())
+            return false;
+
+        auto file = make_unique<FileStream>(PipelinesGetFilePath(world_name), FileStream_Write);
+        if (!file->IsOpen())
+        {
+            LOG_ERROR("Failed to open \"%s\" for writing", PipelinesGetFilePath(world_name).c_str());
+            return false;
+        }
+
+        file->Write(pipelines_version);
+        file->Write(static_cast<uint32_t>(entries.size()));
+        for (const PipelineEntry& entry : entries)
+        {
+            const RHI_PipelineState* state = entry.state;
+
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                file->Write(entry.shader_source[i]);
+                file->Write(entry.shader_value[i]);
+            }
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                file->Write(entry.state_index[i]);
+            }
+            file->Write(static_cast<uint32_t>(state->primitive_topology));
+            file->Write(state->viewport.x);
+            file->Write(state->viewport.y);
+            file->Write(state->viewport.width);
+            file->Write(state->viewport.height);
+            file->Write(state->viewport.depth_min);
+            file->Write(state->viewport.depth_max);
+            file->Write(state->scissor.left);
+            file->Write(state->scissor.top);
+            file->Write(state->scissor.right);
+            file->Write(state->scissor.bottom);
+            file->Write(state->dynamic_scissor);
+            file->Write(state->vertex_buffer_stride);
+            file->Write(static_cast<uint32_t>(state->render_target_color_layout_initial));
+            file->Write(static_cast<uint32_t>(state->render_target_color_layout_final));
+            file->Write(static_cast<uint32_t>(state->render_target_depth_layout_initial));
+            file->Write(static_cast<uint32_t>(state->render_target_depth_layout_final));
+            file->Write(state->render_target_swapchain != nullptr);
+            file->Write(entry.render_target_depth);
+            for (uint32_t i = 0; i < state_max_render_target_count; i++)
+            {
+                file->Write(entry.render_target_color[i]);
+            }
+            file->Write(state->render_target_color_texture_array_index);
+            file->Write(state->render_target_depth_stencil_texture_array_index);
+            file->Write(state->clear_depth);
+            file->Write(state->clear_stencil);
+            for (uint32_t i = 0; i < state_max_render_target_count; i++)
+            {
+                file->Write(state->clear_color[i]);
+            }
+        }
+
+        return true;
+    }
+
+    uint32_t Renderer::PipelinesWarmUp(const string& world_name, const function<void(uint32_t, uint32_t)>& on_progress /*= nullptr*/)
+    {
+        if (!m_pipeline_cache)
+            return 0;
+
+        // Start recording the pipelines of this world from scratch
+        m_pipeline_cache->ResetUsage();
+
+        const string file_path = PipelinesGetFilePath(world_name);
+        if (world_name.empty() || !FileSystem::Exists(file_path))
+            return 0;
+
+        auto file = make_unique<FileStream>(file_path, FileStream_Read);
+        if (!file->IsOpen())
+            return 0;
+
+        if (file->ReadAs<uint32_t>() != pipelines_version)
+        {
+            LOG_WARNING("\"%s\" was written by a different version, ignoring it", file_path.c_str());
+            return 0;
+        }
+
+        const vector<const void*> states = PipelinesGetStates();
+
+        auto resolve_shader = [this](const uint32_t source, const uint32_t value) -> RHI_Shader*
+        {
+            if (source == Pipeline_Shader_GBuffer)
+                return ShaderGBuffer::GenerateVariation(m_context, static_cast<uint16_t>(value), false);
+
+            if (source == Pipeline_Shader_Light)
+                return ShaderLight::GenerateVariation(m_context, static_cast<uint16_t>(value), false);
+
+            if (source == Pipeline_Shader_Renderer)
+            {
+                const auto it = m_shaders.find(static_cast<Renderer_Shader_Type>(value));
+                return it != m_shaders.end() ? it->second.get() : nullptr;
+            }
+
+            return nullptr;
+        };
+
+        auto resolve_texture = [this](const uint64_t id) -> RHI_Texture*
+        {
+            const auto it = m_render_targets.find(static_cast<Renderer_RenderTarget_Type>(id));
+            return it != m_render_targets.end() ? it->second.get() : nullptr;
+        };
+
+        // Reserved up front, pipeline states can't be moved around once filled
+        const uint32_t count = file->ReadAs<uint32_t>();
+        vector<RHI_PipelineState> pipeline_states;
+        pipeline_states.reserve(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            RHI_PipelineState& state = pipeline_states.emplace_back();
+
+            RHI_Shader* shaders[3];
+            for (uint32_t j = 0; j < 3; j++)
+            {
+                const uint32_t source   = file->ReadAs<uint32_t>();
+                const uint32_t value    = file->ReadAs<uint32_t>();
+                shaders[j]              = resolve_shader(source, value);
+            }
+            state.shader_vertex     = shaders[0];
+            state.shader_pixel      = shaders[1];
+            state.shader_compute    = shaders[2];
+
+            int state_index[3];
+            for (uint32_t j = 0; j < 3; j++)
+            {
+                state_index[j] = file->ReadAs<int>();
+                if (state_index[j] >= static_cast<int>(states.size()))
+                {
+                    state_index[j] = -1;
+                }
+            }
+            state.depth_stencil_state   = state_index[0] != -1 ? static_cast<RHI_DepthStencilState*>(const_cast<void*>(states[state_index[0]])) : nullptr;
+            state.blend_state           = state_index[1] != -1 ? static_cast<RHI_BlendState*>(const_cast<void*>(states[state_index[1]])) : nullptr;
+            state.rasterizer_state      = state_index[2] != -1 ? static_cast<RHI_RasterizerState*>(const_cast<void*>(states[state_index[2]])) : nullptr;
+
+            state.primitive_topology = static_cast<RHI_PrimitiveTopology_Mode>(file->ReadAs<uint32_t>());
+            file->Read(&state.viewport.x);
+            file->Read(&state.viewport.y);
+            file->Read(&state.viewport.width);
+            file->Read(&state.viewport.height);
+            file->Read(&state.viewport.depth_min);
+            file->Read(&state.viewport.depth_max);
+            file->Read(&state.scissor.left);
+            file->Read(&state.scissor.top);
+            file->Read(&state.scissor.right);
+            file->Read(&state.scissor.bottom);
+            file->Read(&state.dynamic_scissor);
+            file->Read(&state.vertex_buffer_stride);
+            state.render_target_color_layout_initial    = static_cast<RHI_Image_Layout>(file->ReadAs<uint32_t>());
+            state.render_target_color_layout_final      = static_cast<RHI_Image_Layout>(file->ReadAs<uint32_t>());
+            state.render_target_depth_layout_initial    = static_cast<RHI_Image_Layout>(file->ReadAs<uint32_t>());
+            state.render_target_depth_layout_final      = static_cast<RHI_Image_Layout>(file->ReadAs<uint32_t>());
+            state.render_target_swapchain               = file->ReadAs<bool>() ? m_swap_chain.get() : nullptr;
+            state.render_target_depth_texture           = resolve_texture(file->ReadAs<uint64_t>());
+            for (uint32_t j = 0; j < state_max_render_target_count; j++)
+            {
+                state.render_target_color_textures[j] = resolve_texture(file->ReadAs<uint64_t>());
+            }
+            file->Read(&state.render_target_color_texture_array_index);
+            file->Read(&state.render_target_depth_stencil_texture_array_index);
+            file->Read(&state.clear_depth);
+            file->Read(&state.clear_stencil);
+            for (uint32_t j = 0; j < state_max_render_target_count; j++)
+            {
+                file->Read(&state.clear_color[j]);
+            }
+        }
+        file.reset();
+
+        // Shaders compile and pipelines get created on all threads, an entry which doesn't resolve anymore (e.g. a render target was removed) is simply dropped
+        atomic<uint32_t> created_count  = 0;
+        uint32_t processed_count        = 0;
+        mutex mutex_progress;
+        const Stopwatch timer;
+        m_threading->ParallelFor(count, 1, [this, &pipeline_states, &created_count, &processed_count, &mutex_progress, &on_progress, count](uint32_t start, uint32_t end)
+        {
+            for (uint32_t i = start; i < end; i++)
+            {
+                RHI_PipelineState& state = pipeline_states[i];
+
+                for (RHI_Shader* shader : { state.shader_vertex, state.shader_pixel, state.shader_compute })
+                {
+                    if (shader)
+                    {
+                        shader->WaitForCompilation();
+                    }
+                }
+
+                if (m_pipeline_cache->WarmUp(state))
+                {
+                    created_count++;
+                }
+
+                if (on_progress)
+                {
+                    lock_guard<mutex> lock(mutex_progress);
+                    on_progress(++processed_count, count);
+                }
+            }
+        });
+
+        LOG_INFO("Created %u of %u pipelines in %.2f ms", created_count.load(), count, timer.GetElapsedTimeMs());
+
+        return created_count;
+    }
+
+    const shared_ptr<Spartan::RHI_Texture>& Renderer::GetEnvironmentTexture()
+    {
+        if (m_render_targets.find(RenderTarget_Brdf_Prefiltered_Environment) != m_render_targets.end())
+            return m_render_targets[RenderTarget_Brdf_Prefiltered_Environment];
+
+        return m_tex_white;
+    }
+
+    void Renderer::SetEnvironmentTexture(const shared_ptr<RHI_Texture>& texture)
+    {
+        m_render_targets[RenderTarget_Brdf_Prefiltered_Environment] = texture;
+    }
+
+	void Renderer::SetOption(Renderer_Option option, bool enable)
+	{
+        if (enable && !GetOption(option))
+        {
+            m_options |= option;
+        }
+        else if (!enable && GetOption(option))
+        {
+            m_options &= ~option;
+        }
+        else
+        {
+            return;
+        }
+	}
+
+    void Renderer::SetOptionValue(Renderer_Option_Value option, float value)
+    {
+        if (!m_rhi_device || !m_rhi_device->GetContextRhi())
+            return;
+
+        if (option == Option_Value_Anisotropy)
+        {
+            value = Helper::Clamp(value, 0.0f, 16.0f);
+        }
+        else if (option == Option_Value_ShadowResolution)
+        {
+            value = Helper::Clamp(value, static_cast<float>(m_resolution_shadow_min), static_cast<float>(m_rhi_device->GetContextRhi()->max_texture_dimension_2d));
+        }
+
+        if (m_option_values[option] == value)
+            return;
+
+        m_option_values[option] = value;
+
+        // Shadow resolution handling
+        if (option == Option_Value_ShadowResolution)
+        {
+            const auto& light_entities = m_entities[Renderer_Object_Light];
+            for (const auto& light_entity : light_entities)
+            {
+                auto light = light_entity->GetComponent<Light>();
+                if (light->GetShadowsEnabled())
+                {
+                    light->CreateShadowMap();
+                }
+            }
+        }
+    }
+
+    bool Renderer::Present()
+    {
+        if (m_swap_chain->GetCmdList()->IsRecording())
+        {
+            if (!m_swap_chain->GetCmdList()->Submit())
+            {
+                LOG_ERROR("Failed to submit");
+                return false;
+            }
+        }
+
+        if (!m_swap_chain->Present())
+        {
+            LOG_ERROR("Failed to present");
+            return false;
+        }
+
+        // Anything released from now on belongs to the next frame
+        m_rhi_device->Frame_Advance();
 
         return true;
     }
@@ -766,7 +2000,8 @@ namespace Spartan
 
     void Renderer::SetGlobalShaderObjectTransform(RHI_CommandList* cmd_list, const Math::Matrix& transform)
     {
-        m_buffer_object_cpu.object = transform;
+        m_buffer_object_cpu.object      = transform;
+        m_buffer_object_cpu.instanced   = 0.0f;
         UpdateObjectBuffer(cmd_list);
     }
 }
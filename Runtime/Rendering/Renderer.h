@@ -25,10 +25,14 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <unordered_map>
 #include <array>
 #include <atomic>
+#include <thread>
+#include <functional>
 #include "Renderer_ConstantBuffers.h"
 #include "Material.h"
+#include "OcclusionBuffer.h"
 #include "../Core/ISubsystem.h"
 #include "../Math/Rectangle.h"
+#include "../Math/Frustum.h"
 #include "../RHI/RHI_Definition.h"
 #include "../RHI/RHI_Viewport.h"
 #include "../RHI/RHI_Vertex.h"
@@ -46,11 +50,14 @@ namespace Spartan
 	class Grid;
 	class Transform_Gizmo;
 	class Profiler;
+	class TaskCounter;
+	class World;
+	class Threading;
+	class RenderGraph;
 
 	namespace Math
 	{
 		class BoundingBox;
-		class Frustum;
 	}
 
 	enum Renderer_Option : uint64_t
@@ -79,7 +86,8 @@ namespace Spartan
 		Render_ChromaticAberration	    = 1 << 21,
 		Render_Dithering			    = 1 << 22,
         Render_ReverseZ                 = 1 << 23,
-        Render_DepthPrepass             = 1 << 24
+        Render_DepthPrepass             = 1 << 24,
+        Render_OcclusionCulling         = 1 << 25
 	};
 
     enum Renderer_Option_Value
@@ -115,6 +123,7 @@ namespace Spartan
         Shader_Gbuffer_P,
 		Shader_Depth_V,
         Shader_Depth_P,
+        Shader_DepthCopy_P,
 		Shader_Quad_V,
 		Shader_Texture_P,
         Shader_Copy_C,
@@ -161,6 +170,19 @@ namespace Spartan
         Shader_Entity_Outline_P
 	};
 
+    enum Renderer_Shader_Permutation_Type
+    {
+        Shader_Permutation_GBuffer,
+        Shader_Permutation_Light
+    };
+
+    // A variation of an uber shader, the flags select the defines it's compiled with
+    struct ShaderPermutation
+    {
+        Renderer_Shader_Permutation_Type type;
+        uint16_t flags;
+    };
+
     enum Renderer_RenderTarget_Type : uint64_t
     {
         RenderTarget_Gbuffer_Albedo                 = 1 << 0,
@@ -185,6 +207,7 @@ namespace Spartan
         RenderTarget_Ssr                            = 1 << 19,
         RenderTarget_Ssgi                           = 1 << 20,
         RenderTarget_TaaHistory                     = 1 << 21,
+        RenderTarget_Occlusion                      = 1 << 22, // debug only, the CPU occlusion buffer
     };
 
 	class SPARTAN_CLASS Renderer : public ISubsystem
@@ -248,7 +271,7 @@ namespace Spartan
         // Misc
         const std::shared_ptr<RHI_Device>& GetRhiDevice()   const { return m_rhi_device; } 
         RHI_PipelineCache* GetPipelineCache()               const { return m_pipeline_cache.get(); }
-        RHI_DescriptorCache* GetDescriptorCache()           const { return m_descriptor_cache.get(); }
+        RHI_ShaderCache* GetShaderCache()                   const { return m_shader_cache.get(); }
         RHI_Texture* GetFrameTexture()                      const { return m_render_targets.at(RenderTarget_Ldr).get(); }
         auto GetFrameNum()                                  const { return m_frame_num; }
         const auto& GetCamera()                             const { return m_camera; }
@@ -257,12 +280,109 @@ namespace Spartan
         bool IsRendering()                                  const { return m_is_rendering; }
         uint32_t GetMaxResolution() const;
 
+        // Shader permutations
+        std::vector<ShaderPermutation> ShaderPermutationsGather(const std::vector<std::shared_ptr<Entity>>& entities) const;
+        std::vector<ShaderPermutation> ShaderPermutationsAll() const;
+        // Compiles on all worker threads and returns once done, progress is reported as (compiled, total) from any thread
+        bool ShaderPermutationsCompile(const std::vector<ShaderPermutation>& permutations, const std::function<void(uint32_t, uint32_t)>& on_progress = nullptr, const bool log_timings = false);
+
+        // Pipelines, the ones a world uses are recorded so that they can be created while it loads the next time
+        std::string PipelinesGetFilePath(const std::string& world_name) const;
+        bool PipelinesSave(const std::string& world_name);
+        uint32_t PipelinesWarmUp(const std::string& world_name, const std::function<void(uint32_t, uint32_t)>& on_progress = nullptr);
+
+        // Render graph, declares the passes with what they read and write, compiling it works out their textures and barriers
+        void RenderGraphBuild(const bool draw_transparent_objects);
+        RenderGraph* GetRenderGraph() const { return m_render_graph.get(); }
+
         // Globals
         void SetGlobalShaderObjectTransform(RHI_CommandList* cmd_list, const Math::Matrix& transform);
         void SetGlobalSamplersAndConstantBuffers(RHI_CommandList* cmd_list) const;
         RHI_Texture* GetBlackTexture() const { return m_tex_black_transparent.get(); }
 
 	private:
+        // A draw, the key orders draws so that state changes are minimized
+        // [63..62 object type][61..46 shader variation][45..30 material][29..16 geometry][15..0 depth]
+        struct DrawCall
+        {
+            uint64_t key    = 0;
+            Entity* entity  = nullptr;
+            uint32_t lod    = 0;
+        };
+
+        // What can be seen from a single point of view (the camera or a light's shadow slice)
+        struct VisibilityView
+        {
+            Math::Frustum frustum;
+            bool ignore_near_plane  = false;
+            bool is_camera          = false;    // keys include the g-buffer shader variation and the depth
+            bool shadow_casters     = false;    // only keep entities which cast shadows
+            // Visible entities sorted by key, indexed by Renderer_Object_Opaque and Renderer_Object_Transparent
+            std::array<std::vector<DrawCall>, 2> draw_calls;
+        };
+
+        // Command lists (one per frame in flight) which can be recorded on any thread, with dynamic buffers of their
+        // own so that they never sub-allocate from the ones the main command list is using at the same time
+        struct RecordingContext
+        {
+            std::vector<std::shared_ptr<RHI_CommandList>> cmd_lists;
+            BufferUber buffer_uber_cpu;
+            BufferUber buffer_uber_cpu_previous;
+            std::shared_ptr<RHI_ConstantBuffer> buffer_uber_gpu;
+            BufferObject buffer_object_cpu;
+            BufferObject buffer_object_cpu_previous;
+            std::shared_ptr<RHI_ConstantBuffer> buffer_object_gpu;
+            BufferInstance buffer_instance_cpu;
+            std::shared_ptr<RHI_ConstantBuffer> buffer_instance_gpu;
+            std::thread::id thread_id;      // the thread which recorded it last
+            float time_recording = 0.0f;    // ms
+        };
+
+        // A range of the draw calls of a light's shadow slice, large slices are split over several recording contexts
+        struct LightDepthChunk
+        {
+            const Light* light                      = nullptr;
+            uint32_t light_index                    = 0;
+            uint32_t array_index                    = 0;
+            Renderer_Object_Type object_type        = Renderer_Object_Opaque;
+            uint32_t draw_start                     = 0;
+            uint32_t draw_end                       = 0;
+            uint32_t context_index                  = 0;
+            RHI_PipelineState* pipeline_state       = nullptr; // only the first chunk of a slice clears it
+            const std::vector<DrawCall>* draw_calls = nullptr;
+            RHI_Texture* tex_static                 = nullptr; // if set, the chunk draws no casters but copies this cached static depth into the slice
+        };
+
+        // A shadow slice as it was last rendered, it's reused for as long as nothing inside it changes
+        struct ShadowSliceCache
+        {
+            const RHI_Texture* texture                  = nullptr;  // the depth texture it was rendered into, a different one invalidates it
+            Math::Matrix view_projection;                           // the one it was rendered with, which is also the one it has to be sampled with
+            size_t hash                                 = 0;        // view-projection and every caster
+            size_t hash_static                          = 0;        // view-projection and the opaque casters which haven't moved for a while
+            size_t hash_view_previous                   = 0;        // view-projection of the previous frame, the static layer is only built once it settles
+            std::shared_ptr<RHI_Texture> tex_static;                // depth of the static casters alone, the dynamic ones are drawn over a copy of it
+            bool static_valid                           = false;
+            bool rendered                               = false;
+            // Computed every frame
+            bool render                                 = false;
+            bool render_static                          = false;    // also render the static casters into the static layer
+            bool restore_static                         = false;    // start from the static layer and render only the dynamic casters
+            size_t hash_current                         = 0;
+            size_t hash_static_current                  = 0;
+            size_t hash_view_current                    = 0;
+            std::vector<DrawCall> draw_calls_static;
+            std::vector<DrawCall> draw_calls_dynamic;
+        };
+
+        // When a shadow caster last moved, casters which stay put for long enough go into the static layer of the slices
+        struct ShadowCasterMotion
+        {
+            Math::Matrix transform;
+            uint64_t frame_moved    = 0;
+            uint64_t frame_seen     = 0;
+        };
+
         // Resource creation
         void CreateConstantBuffers();
 		void CreateDepthStencilStates();
@@ -273,10 +393,12 @@ namespace Spartan
 		void CreateShaders();
 		void CreateSamplers();
 		void CreateRenderTextures();
+        void CreateRecordingContexts();
 
 		// Passes
 		void Pass_Main(RHI_CommandList* cmd_list);
-		void Pass_LightDepth(RHI_CommandList* cmd_list, const Renderer_Object_Type object_type);
+		void Pass_LightDepth(RHI_CommandList* cmd_list);
+        void Pass_LightDepthChunk(RHI_CommandList* cmd_list, RecordingContext& context, const LightDepthChunk& chunk);
         void Pass_DepthPrePass(RHI_CommandList* cmd_list);
 		void Pass_GBuffer(RHI_CommandList* cmd_list, const Renderer_Object_Type object_type);
 		void Pass_Hbao(RHI_CommandList* cmd_list, const bool use_stencil);
@@ -316,16 +438,41 @@ namespace Spartan
         bool UpdateMaterialBuffer();
         bool UpdateUberBuffer(RHI_CommandList* cmd_list);
         bool UpdateObjectBuffer(RHI_CommandList* cmd_list);
+        bool UpdateUberBuffer(RHI_CommandList* cmd_list, RecordingContext& context);
+        bool UpdateObjectBuffer(RHI_CommandList* cmd_list, RecordingContext& context);
+        bool UpdateInstanceBuffer(RHI_CommandList* cmd_list, const uint32_t instance_count);
+        bool UpdateInstanceBuffer(RHI_CommandList* cmd_list, RecordingContext& context, const uint32_t instance_count);
         bool UpdateLightBuffer(const Light* light);
+        bool UpdateLightClusterBuffers();
+
+        // Pipeline recording, only states made of renderer owned objects can be found again in a later run
+        std::vector<const void*> PipelinesGetStates() const;
 
         // Misc
         void RenderablesAcquire(const Variant& renderables);
-        void RenderablesSort(std::vector<Entity*>* renderables);
         void ClearEntities();
 
-        // Render textures
+        // Visibility
+        void VisibilityCompute();
+        void VisibilityComputeView(VisibilityView& view);
+        void LodCompute();
+
+        // Occlusion culling
+        void OcclusionCompute();
+
+        // Shadow caching
+        void ShadowCastersTrack();
+        void ShadowSlicesCompute();
+        Math::Matrix GetShadowViewProjection(const Light* light, const uint32_t array_index) const;
+
+        // Clustered lighting
+        void LightClustersCompute();
+        bool IsLightClustered(const Light* light) const;
+
+        // Render textures, the render graph binds the render targets to these every frame
         std::unordered_map<Renderer_RenderTarget_Type, std::shared_ptr<RHI_Texture>> m_render_targets;
         std::vector<std::shared_ptr<RHI_Texture>> m_render_tex_bloom;
+        std::unique_ptr<RenderGraph> m_render_graph;
 
         // Standard textures
         std::shared_ptr<RHI_Texture> m_tex_noise_normal;
@@ -415,20 +562,61 @@ namespace Spartan
         BufferUber m_buffer_uber_cpu;
         BufferUber m_buffer_uber_cpu_previous;
         std::shared_ptr<RHI_ConstantBuffer> m_buffer_uber_gpu;
-        uint32_t m_buffer_uber_offset_index = 0;
 
         BufferObject m_buffer_object_cpu;
         BufferObject m_buffer_object_cpu_previous;
         std::shared_ptr<RHI_ConstantBuffer> m_buffer_object_gpu;
-        uint32_t m_buffer_object_offset_index = 0;
+
+        BufferInstance m_buffer_instance_cpu;
+        std::shared_ptr<RHI_ConstantBuffer> m_buffer_instance_gpu;
 
         BufferLight m_buffer_light_cpu;
         BufferLight m_buffer_light_cpu_previous;
         std::shared_ptr<RHI_ConstantBuffer> m_buffer_light_gpu;
+
+        std::shared_ptr<RHI_ConstantBuffer> m_buffer_lights_gpu;
+        std::shared_ptr<RHI_ConstantBuffer> m_buffer_clusters_gpu;
         //========================================================
 
         // Entities and material references
         std::unordered_map<Renderer_Object_Type, std::vector<Entity*>> m_entities;
+        // Computed every frame, index 0 is the camera, followed by the shadow slices of each light
+        std::vector<VisibilityView> m_views;
+        std::vector<uint32_t> m_views_light; // index of the first view of each light in m_entities[Renderer_Object_Light]
+
+        // Parallel recording
+        std::vector<std::unique_ptr<RecordingContext>> m_recording_contexts; // a single one, without command lists, if the API can't record in parallel
+        std::vector<LightDepthChunk> m_light_depth_chunks;
+        std::vector<std::shared_ptr<RHI_PipelineState>> m_light_depth_pipeline_states; // one per chunk, kept alive until the next frame
+        const uint32_t m_recording_context_max      = 8;
+        const uint32_t m_recording_chunk_draws_min  = 256; // fewer draws than this are not worth a thread of their own
+
+        // Occlusion culling, the camera's draw calls are tested against a buffer which the biggest occluders are rasterized into on the CPU
+        OcclusionBuffer m_occlusion_buffer;
+        std::vector<std::pair<float, Entity*>> m_occluders; // by screen size
+        std::vector<const Entity*> m_occluder_entities; // sorted, the draw calls of the occluders are not tested against themselves
+        std::vector<uint8_t> m_occlusion_visible; // per draw call, written in parallel
+        const uint32_t m_occluder_max           = 64;
+        const uint32_t m_occluder_triangle_max  = 4096;    // more than this isn't worth it, unless the renderable is marked as an occluder
+        const float m_occluder_size_min         = 0.05f;   // bounding sphere radius over distance
+
+        // Levels of detail, picked by the fraction of the screen height a renderable's bounding sphere covers
+        const float m_lod_screen_size       = 0.5f; // below this the first simplified level is used, each subsequent level halves it
+        const float m_lod_hysteresis        = 0.1f; // how far past a threshold the size has to go before the level changes
+        const uint32_t m_lod_shadow_bias    = 1;    // shadows use levels this much coarser than the camera
+
+        // Shadow caching, slices are re-rendered only when their casters or their view change
+        std::unordered_map<const Light*, std::vector<ShadowSliceCache>> m_shadow_slices;
+        std::unordered_map<const Entity*, ShadowCasterMotion> m_shadow_casters;
+        const uint64_t m_shadow_static_frames = 30; // frames a caster has to stay put for, before it's considered static
+
+        // Clustered lighting, binned by a job which runs while the depth passes are recorded
+        LightClusters m_light_clusters;
+        LightClusters::View m_light_clusters_view;
+        std::vector<LightClusters::Light> m_light_clusters_input;
+        std::vector<bool> m_lights_clustered; // per entry of m_entities[Renderer_Object_Light], true if it's shaded by the clustered pass
+        std::unique_ptr<TaskCounter> m_light_clusters_task;
+        float m_light_clusters_time = 0.0f; // ms
         std::array<Material*, m_max_material_instances> m_material_instances;
         
         std::shared_ptr<Camera> m_camera;
@@ -437,10 +625,12 @@ namespace Spartan
         std::shared_ptr<RHI_Device> m_rhi_device;
         std::shared_ptr<RHI_SwapChain> m_swap_chain;
         std::shared_ptr<RHI_PipelineCache> m_pipeline_cache;
-        std::shared_ptr<RHI_DescriptorCache> m_descriptor_cache;
+        std::shared_ptr<RHI_ShaderCache> m_shader_cache;
 
         // Dependencies
         Profiler* m_profiler            = nullptr;
         ResourceCache* m_resource_cache = nullptr;
+        World* m_world                  = nullptr;
+        Threading* m_threading          = nullptr;
     };
 }
@@ -25,6 +25,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "..\Math\Vector2.h"
 #include "..\Math\Vector3.h"
 #include "..\Math\Matrix.h"
+#include "LightClusters.h"
 //==========================
 
 namespace Spartan
@@ -131,17 +132,29 @@ namespace Spartan
         Math::Matrix object;
         Math::Matrix wvp_current;
         Math::Matrix wvp_previous;
+
+        float instanced; // the transforms come from BufferInstance instead
+        Math::Vector3 padding;
     
         bool operator==(const BufferObject& rhs) const
         {
             return
                 object          == rhs.object       &&
                 wvp_current     == rhs.wvp_current  &&
-                wvp_previous    == rhs.wvp_previous;
+                wvp_previous    == rhs.wvp_previous &&
+                instanced       == rhs.instanced;
         }
 
         bool operator!=(const BufferObject& rhs) const { return !(*this == rhs); }
     };
+
+    // High frequency - Updates once per instanced draw, only the first instance_count elements are uploaded
+    static const uint32_t m_max_instances = 64; // must match the shader
+    struct BufferInstance
+    {
+        Math::Matrix transform[m_max_instances];
+        Math::Matrix wvp_previous[m_max_instances];
+    };
     
     // Light buffer
     struct BufferLight
@@ -164,4 +177,24 @@ namespace Spartan
                 direction                   == rhs.direction;
         }
     };
+
+    // Low frequency - Updates once per frame, the lights which are shaded by the clustered lighting pass
+    struct BufferLights
+    {
+        Math::Vector4 position_range[LightClusters::light_max];
+        Math::Vector4 color_type[LightClusters::light_max]; // color pre-multiplied by the luminous intensity, w is 1 for spot lights
+        Math::Vector4 direction_angle[LightClusters::light_max];
+
+        float slice_scale;
+        float slice_bias;
+        float light_count;
+        float padding;
+    };
+
+    // Low frequency - Updates once per frame, the light lists of every cluster
+    struct BufferClusters
+    {
+        uint32_t clusters[LightClusters::cluster_count];    // index offset (low 16 bits) and light count (high 16 bits)
+        uint8_t indices[LightClusters::index_max];          // packed as bytes, 16 per shader element
+    };
 }
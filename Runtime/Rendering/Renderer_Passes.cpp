@@ -25,6 +25,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Model.h"
 #include "ShaderGBuffer.h"
 #include "ShaderLight.h"
+#include "RenderGraph.h"
 #include "Font/Font.h"
 #include "Gizmos/Grid.h"
 #include "Gizmos/Transform_Gizmo.h"
@@ -34,6 +35,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../RHI/RHI_VertexBuffer.h"
 #include "../RHI/RHI_PipelineState.h"
 #include "../RHI/RHI_Texture.h"
+#include "../RHI/RHI_Texture2D.h"
+#include "../RHI/RHI_SwapChain.h"
+#include "../Threading/Threading.h"
 #include "../World/Entity.h"
 #include "../World/Components/Light.h"
 #include "../World/Components/Camera.h"
@@ -48,6 +52,34 @@ using namespace Spartan::Math;
 
 namespace Spartan
 {
+    // Counts the draws, starting at start, which share the geometry range and level of detail (and the material, if it matters) and can therefore be drawn as instances of one draw
+    template<typename T>
+    static uint32_t instance_batch_size(const vector<T>& draw_calls, const uint32_t start, const uint32_t end, const bool match_material)
+    {
+        const Renderable* renderable    = draw_calls[start].entity->GetRenderable();
+        const uint32_t lod              = draw_calls[start].lod;
+
+        uint32_t instance_count = 1;
+        while (start + instance_count < end && instance_count < m_max_instances)
+        {
+            const Renderable* other = draw_calls[start + instance_count].entity->GetRenderable();
+
+            const bool same_geometry =
+                other->GeometryModel()          == renderable->GeometryModel()          &&
+                other->GeometryIndexOffset()    == renderable->GeometryIndexOffset()    &&
+                other->GeometryIndexCount()     == renderable->GeometryIndexCount()     &&
+                other->GeometryVertexOffset()   == renderable->GeometryVertexOffset()   &&
+                draw_calls[start + instance_count].lod == lod;
+
+            if (!same_geometry || (match_material && other->GetMaterial() != renderable->GetMaterial()))
+                break;
+
+            instance_count++;
+        }
+
+        return instance_count;
+    }
+
     void Renderer::SetGlobalSamplersAndConstantBuffers(RHI_CommandList* cmd_list) const
     {
         // Constant buffers
@@ -56,6 +88,9 @@ namespace Spartan
         cmd_list->SetConstantBuffer(2, RHI_Shader_Vertex | RHI_Shader_Pixel, m_buffer_uber_gpu);
         cmd_list->SetConstantBuffer(3, RHI_Shader_Vertex, m_buffer_object_gpu);
         cmd_list->SetConstantBuffer(4, RHI_Shader_Pixel, m_buffer_light_gpu);
+        cmd_list->SetConstantBuffer(5, RHI_Shader_Vertex, m_buffer_instance_gpu);
+        cmd_list->SetConstantBuffer(6, RHI_Shader_Pixel, m_buffer_lights_gpu);
+        cmd_list->SetConstantBuffer(7, RHI_Shader_Pixel, m_buffer_clusters_gpu);
         
         // Samplers
         cmd_list->SetSampler(0, m_sampler_compare_depth);
@@ -66,6 +101,79 @@ namespace Spartan
         cmd_list->SetSampler(5, m_sampler_anisotropic_wrap);
     }
 
+    void Renderer::RenderGraphBuild(const bool draw_transparent_objects)
+    {
+        // The passes pick their textures up from the slots when they execute, since post-processing swaps them around
+        const uint64_t gbuffer           = RenderTarget_Gbuffer_Albedo | RenderTarget_Gbuffer_Normal | RenderTarget_Gbuffer_Material | RenderTarget_Gbuffer_Velocity | RenderTarget_Gbuffer_Depth;
+        const uint64_t light             = RenderTarget_Light_Diffuse | RenderTarget_Light_Specular | RenderTarget_Light_Volumetric;
+        const uint64_t depth_normal      = RenderTarget_Gbuffer_Depth | RenderTarget_Gbuffer_Normal;
+        const uint64_t hbao_writes       = RenderTarget_Hbao | RenderTarget_Hbao_Noisy;
+        const uint64_t depth_prepass     = GetOption(Render_DepthPrepass) ? RenderTarget_Gbuffer_Depth : 0;
+        const uint64_t hbao              = GetOption(Render_Hbao) ? RenderTarget_Hbao : 0;
+        const uint64_t ssr               = GetOption(Render_ScreenSpaceReflections) ? RenderTarget_Ssr : 0;
+        const uint64_t indirect_bounce   = GetOption(Render_IndirectBounce) ? RenderTarget_Light_Diffuse : 0;
+        const uint64_t light_reads       = RenderTarget_Gbuffer_Albedo | RenderTarget_Gbuffer_Normal | RenderTarget_Gbuffer_Material | RenderTarget_Gbuffer_Depth | RenderTarget_Hdr_2 | hbao | ssr;
+        const uint64_t composition_reads = light_reads | light | RenderTarget_Brdf_Specular_Lut;
+
+        m_render_graph->Begin();
+
+        // Runs only once, after that there is nothing it writes
+        m_render_graph->AddPass("brdf_specular_lut", 0, m_brdf_specular_lut_rendered ? 0 : RenderTarget_Brdf_Specular_Lut, [this](RHI_CommandList* cmd_list) { Pass_BrdfSpecularLut(cmd_list); });
+
+        // Depth, the shadow maps belong to the lights and the light clusters are buffers, so the graph can't see what they write
+        m_render_graph->AddPass("light_depth", 0, 0, [this](RHI_CommandList* cmd_list) { Pass_LightDepth(cmd_list); }, false);
+        if (depth_prepass)
+        {
+            m_render_graph->AddPass("depth_prepass", 0, RenderTarget_Gbuffer_Depth, [this](RHI_CommandList* cmd_list) { Pass_DepthPrePass(cmd_list); });
+        }
+        m_render_graph->AddPass("light_clusters", 0, 0, [this](RHI_CommandList*) { UpdateLightClusterBuffers(); }, false);
+
+        // G-Buffer to Composition
+        m_render_graph->AddPass("gbuffer",      depth_prepass,                      gbuffer,            [this](RHI_CommandList* cmd_list) { Pass_GBuffer(cmd_list, Renderer_Object_Opaque); });
+        m_render_graph->AddPass("hbao",         depth_normal | indirect_bounce,     hbao_writes,        [this](RHI_CommandList* cmd_list) { Pass_Hbao(cmd_list, false); });
+        m_render_graph->AddPass("ssr",          depth_normal,                       RenderTarget_Ssr,   [this](RHI_CommandList* cmd_list) { Pass_Ssr(cmd_list, false); });
+        m_render_graph->AddPass("light",        light_reads,                        light,              [this](RHI_CommandList* cmd_list) { Pass_Light(cmd_list, false); });
+        m_render_graph->AddPass("composition",  composition_reads,                  RenderTarget_Hdr,   [this](RHI_CommandList* cmd_list) { Pass_Composition(cmd_list, m_render_targets[RenderTarget_Hdr], false); });
+
+        // Lighting for transparent objects, alpha blended on top of the opaque composition
+        if (draw_transparent_objects)
+        {
+            m_render_graph->AddPass("gbuffer_transparent",      RenderTarget_Gbuffer_Depth,                         gbuffer,            [this](RHI_CommandList* cmd_list) { Pass_GBuffer(cmd_list, Renderer_Object_Transparent); });
+            m_render_graph->AddPass("hbao_transparent",         depth_normal | indirect_bounce | hbao,              hbao_writes,        [this](RHI_CommandList* cmd_list) { Pass_Hbao(cmd_list, true); });
+            m_render_graph->AddPass("ssr_transparent",          depth_normal | ssr,                                 RenderTarget_Ssr,   [this](RHI_CommandList* cmd_list) { Pass_Ssr(cmd_list, true); });
+            m_render_graph->AddPass("light_transparent",        light_reads | (indirect_bounce ? light : 0),        light,              [this](RHI_CommandList* cmd_list) { Pass_Light(cmd_list, true); });
+            m_render_graph->AddPass("composition_transparent",  composition_reads,                                  RenderTarget_Hdr_2, [this](RHI_CommandList* cmd_list) { Pass_Composition(cmd_list, m_render_targets[RenderTarget_Hdr_2], true); });
+            m_render_graph->AddPass("alpha_blend",              RenderTarget_Hdr_2 | RenderTarget_Gbuffer_Depth,    RenderTarget_Hdr,   [this](RHI_CommandList* cmd_list) { Pass_AlphaBlend(cmd_list, m_render_targets[RenderTarget_Hdr_2].get(), m_render_targets[RenderTarget_Hdr].get(), true); });
+        }
+
+        // Post-processing, ping-pongs between the HDR and the LDR textures and leaves the frame in RenderTarget_Ldr
+        {
+            const bool taa          = GetOption(Render_AntiAliasing_Taa);
+            const bool motion_blur  = GetOption(Render_MotionBlur);
+            const bool dof          = GetOption(Render_DepthOfField);
+
+            uint64_t reads  = RenderTarget_Hdr;
+            reads           |= (taa || motion_blur || dof) ? RenderTarget_Gbuffer_Depth : 0;
+            reads           |= (taa || motion_blur) ? RenderTarget_Gbuffer_Velocity : 0;
+            reads           |= taa ? RenderTarget_TaaHistory : 0;
+
+            uint64_t writes = RenderTarget_Hdr | RenderTarget_Hdr_2 | RenderTarget_Ldr | RenderTarget_Ldr_2;
+            writes          |= taa ? RenderTarget_TaaHistory : 0;
+            writes          |= dof ? RenderTarget_Dof_Half | RenderTarget_Dof_Half_2 : 0;
+
+            m_render_graph->AddPass("post_process", reads, writes, [this](RHI_CommandList* cmd_list) { Pass_PostProcess(cmd_list); });
+        }
+
+        // Editor and debug overlays
+        const uint64_t outline_reads = GetOption(Render_Debug_SelectionOutline) ? RenderTarget_Gbuffer_Depth | RenderTarget_Gbuffer_Normal : 0;
+        m_render_graph->AddPass("outline",          outline_reads,              RenderTarget_Ldr, [this](RHI_CommandList* cmd_list) { Pass_Outline(cmd_list, m_render_targets[RenderTarget_Ldr]); });
+        m_render_graph->AddPass("lines",            RenderTarget_Gbuffer_Depth, RenderTarget_Ldr, [this](RHI_CommandList* cmd_list) { Pass_Lines(cmd_list, m_render_targets[RenderTarget_Ldr]); });
+        m_render_graph->AddPass("transform_handle", 0,                          RenderTarget_Ldr, [this](RHI_CommandList* cmd_list) { Pass_TransformHandle(cmd_list, m_render_targets[RenderTarget_Ldr].get()); });
+        m_render_graph->AddPass("icons",            0,                          RenderTarget_Ldr, [this](RHI_CommandList* cmd_list) { Pass_Icons(cmd_list, m_render_targets[RenderTarget_Ldr].get()); });
+        m_render_graph->AddPass("debug_buffer",     m_render_target_debug,      RenderTarget_Ldr, [this](RHI_CommandList* cmd_list) { Pass_DebugBuffer(cmd_list, m_render_targets[RenderTarget_Ldr]); });
+        m_render_graph->AddPass("text",             0,                          RenderTarget_Ldr, [this](RHI_CommandList* cmd_list) { Pass_Text(cmd_list, m_render_targets[RenderTarget_Ldr].get()); });
+    }
+
     void Renderer::Pass_Main(RHI_CommandList* cmd_list)
 	{
         // Validate RHI device as it's required almost everywhere
@@ -76,128 +184,219 @@ namespace Spartan
 
         // Updates onces, used almost everywhere
         UpdateFrameBuffer();
-        
-        // Runs only once
-        Pass_BrdfSpecularLut(cmd_list);
-        
-        const bool draw_transparent_objects = !m_entities[Renderer_Object_Transparent].empty();
-        
-        // Depth
-        {
-            Pass_LightDepth(cmd_list, Renderer_Object_Opaque);
-            if (draw_transparent_objects)
-            {
-                Pass_LightDepth(cmd_list, Renderer_Object_Transparent);
-            }
-        
-            if (GetOption(Render_DepthPrepass))
-            {
-                Pass_DepthPrePass(cmd_list);
-            }
-        }
-        
-        // G-Buffer to Composition
-        {
-            // Lighting
-            Pass_GBuffer(cmd_list, Renderer_Object_Opaque);
-            Pass_Hbao(cmd_list, false);
-            Pass_Ssr(cmd_list, false);
-            Pass_Light(cmd_list, false);
-            Pass_Composition(cmd_list, m_render_targets[RenderTarget_Hdr], false);
-        
-            // Lighting for transparent objects
-            if (draw_transparent_objects)
-            {
-                Pass_GBuffer(cmd_list, Renderer_Object_Transparent);
-                Pass_Hbao(cmd_list, true);
-                Pass_Ssr(cmd_list, true);
-                Pass_Light(cmd_list, true);
-                Pass_Composition(cmd_list, m_render_targets[RenderTarget_Hdr_2], true);
-        
-                // Alpha blend the transparent composition on top of opaque one
-                Pass_AlphaBlend(cmd_list, m_render_targets[RenderTarget_Hdr_2].get(), m_render_targets[RenderTarget_Hdr].get(), true);
-            }
-        }
-        
-        // Post-processing
-        {
-            Pass_PostProcess(cmd_list);
-            Pass_Outline(cmd_list, m_render_targets[RenderTarget_Ldr]);
-            Pass_Lines(cmd_list, m_render_targets[RenderTarget_Ldr]);
-            Pass_TransformHandle(cmd_list, m_render_targets[RenderTarget_Ldr].get());
-            Pass_Icons(cmd_list, m_render_targets[RenderTarget_Ldr].get());
-            Pass_DebugBuffer(cmd_list, m_render_targets[RenderTarget_Ldr]);
-            Pass_Text(cmd_list, m_render_targets[RenderTarget_Ldr].get());
-        }
+
+        // Bins the lights into clusters, on another thread, while the passes up to the lighting are recorded
+        LightClustersCompute();
+
+        // Builds the draw lists of the camera and of every shadow slice, the passes below only walk them
+        VisibilityCompute();
+
+        // Drops the camera's draw calls which are hidden behind big occluders
+        OcclusionCompute();
+
+        // The passes are declared every frame, but the graph is only compiled again when they (or the render targets) change
+        RenderGraphBuild(!m_entities[Renderer_Object_Transparent].empty());
+        m_render_graph->Compile();
+        m_render_graph->Execute(cmd_list);
 	}
 
-	void Renderer::Pass_LightDepth(RHI_CommandList* cmd_list, const Renderer_Object_Type object_type)
+	void Renderer::Pass_LightDepth(RHI_CommandList* cmd_list)
 	{
         // All opaque objects are rendered from the lights point of view.
         // Opaque objects write their depth information to a depth buffer, using just a vertex shader.
         // Transparent objects, read the opaque depth but don't write their own, instead, they write their color information using a pixel shader.
+        // Slices are only re-rendered when their view or their casters change, if only dynamic casters changed, they are drawn over a copy of the static ones.
+        // The draw calls of every shadow slice are split into chunks, which are recorded in parallel into the command lists of the recording contexts.
 
 		// Acquire shader
-		RHI_Shader* shader_v = m_shaders[Shader_Depth_V].get();
-        RHI_Shader* shader_p = m_shaders[Shader_Depth_P].get();
+		RHI_Shader* shader_v        = m_shaders[Shader_Depth_V].get();
+        RHI_Shader* shader_p        = m_shaders[Shader_Depth_P].get();
+        RHI_Shader* shader_copy_p   = m_shaders[Shader_DepthCopy_P].get();
 		if (!shader_v->IsCompiled() || !shader_p->IsCompiled())
 			return;
 
-        // Get entities
-        const auto& entities = m_entities[object_type];
-        if (entities.empty())
-            return;
+        SCOPED_TIME_BLOCK(m_profiler);
 
-        const bool transparent_pass = object_type == Renderer_Object_Transparent;
+        // Decide which slices have to be rendered, and how
+        ShadowCastersTrack();
+        ShadowSlicesCompute();
 
-        // Go through all of the lights
-		const auto& entities_light = m_entities[Renderer_Object_Light];
-        for (uint32_t light_index = 0; light_index < entities_light.size(); light_index++)
+        // What a chunk does to its slice, in the order they have to execute
+        enum class SlicePass
         {
-            const Light* light = entities_light[light_index]->GetComponent<Light>();
+            Static,     // static casters into the static layer
+            Restore,    // copy of the static layer into the slice
+            Opaque,     // all opaque casters, or the dynamic ones only (after a restore)
+            Transparent
+        };
 
-            // Skip some obvious cases
-            if (!light || !light->GetShadowsEnabled())
-                continue;
+        // Visits the passes of every slice which is rendered this frame, opaque passes of all lights come first as the transparent ones read their depth
+        static const vector<DrawCall> draw_calls_none;
+        const auto& entities_light = m_entities[Renderer_Object_Light];
+        auto for_each_slice_pass = [this, &entities_light](auto&& function)
+        {
+            for (const Renderer_Object_Type object_type : { Renderer_Object_Opaque, Renderer_Object_Transparent })
+            {
+                const bool transparent_pass = object_type == Renderer_Object_Transparent;
 
-            // Skip lights that don't cast transparent shadows (if this is a transparent pass)
-            if (transparent_pass && !light->GetShadowsTransparentEnabled())
-                continue;
+                for (uint32_t light_index = 0; light_index < entities_light.size(); light_index++)
+                {
+                    const Light* light = entities_light[light_index]->GetComponent<Light>();
 
-            // Acquire light's shadow maps
-            RHI_Texture* tex_depth = light->GetDepthTexture();
-            RHI_Texture* tex_color = light->GetColorTexture();
-            if (!tex_depth)
-                continue;
+                    // Skip some obvious cases
+                    if (!light || !light->GetShadowsEnabled())
+                        continue;
 
-            // Set render state
-            static RHI_PipelineState pipeline_state;
-            pipeline_state.shader_vertex                    = shader_v;
-            pipeline_state.vertex_buffer_stride             = static_cast<uint32_t>(sizeof(RHI_Vertex_PosTexNorTan)); // assume all vertex buffers have the same stride (which they do)
-            pipeline_state.shader_pixel                     = transparent_pass ? shader_p : nullptr;
-            pipeline_state.blend_state                      = transparent_pass ? m_blend_alpha.get() : m_blend_disabled.get();
-            pipeline_state.depth_stencil_state              = transparent_pass ? m_depth_stencil_on_off_r.get() : m_depth_stencil_on_off_w.get();
-            pipeline_state.render_target_color_textures[0]  = tex_color; // always bind so we can clear to white (in case there are now transparent objects)
-            pipeline_state.render_target_depth_texture      = tex_depth;
-            pipeline_state.clear_stencil                    = state_stencil_dont_care;
-            pipeline_state.viewport                         = tex_depth->GetViewport();
-            pipeline_state.primitive_topology               = RHI_PrimitiveTopology_TriangleList;
-            pipeline_state.pass_name                        = transparent_pass ? "Pass_LightDepthTransparent" : "Pass_LightDepth";
+                    // Skip lights that don't cast transparent shadows (if this is a transparent pass)
+                    if (transparent_pass && !light->GetShadowsTransparentEnabled())
+                        continue;
+
+                    // Acquire light's shadow maps
+                    RHI_Texture* tex_depth = light->GetDepthTexture();
+                    if (!tex_depth)
+                        continue;
+
+                    const auto it = m_shadow_slices.find(light);
+                    if (it == m_shadow_slices.end())
+                        continue;
+
+                    for (uint32_t array_index = 0; array_index < tex_depth->GetArraySize() && array_index < it->second.size(); array_index++)
+                    {
+                        ShadowSliceCache& slice = it->second[array_index];
+                        if (!slice.render)
+                            continue;
+
+                        // Shadow casters which are visible from this slice, sorted by material and geometry
+                        const VisibilityView& view = m_views[m_views_light[light_index] + array_index];
+
+                        if (transparent_pass)
+                        {
+                            if (!view.draw_calls[Renderer_Object_Transparent].empty())
+                            {
+                                function(light, light_index, array_index, SlicePass::Transparent, view.draw_calls[Renderer_Object_Transparent], slice);
+                            }
+
+                            continue;
+                        }
+
+                        if (slice.render_static)
+                        {
+                            function(light, light_index, array_index, SlicePass::Static, slice.draw_calls_static, slice);
+                        }
+
+                        if (slice.restore_static)
+                        {
+                            function(light, light_index, array_index, SlicePass::Restore, draw_calls_none, slice);
+
+                            if (!slice.draw_calls_dynamic.empty())
+                            {
+                                function(light, light_index, array_index, SlicePass::Opaque, slice.draw_calls_dynamic, slice);
+                            }
+                        }
+                        else
+                        {
+                            // Even without any casters, so that it gets cleared
+                            function(light, light_index, array_index, SlicePass::Opaque, view.draw_calls[Renderer_Object_Opaque], slice);
+                        }
+                    }
+                }
+            }
+        };
+
+        uint32_t draw_count = 0;
+        uint32_t pass_count = 0;
+        for_each_slice_pass([&](const Light*, uint32_t, uint32_t, SlicePass, const vector<DrawCall>& draw_calls, const ShadowSliceCache&)
+        {
+            draw_count += static_cast<uint32_t>(draw_calls.size());
+            pass_count++;
+        });
+        if (pass_count == 0)
+            return;
+
+        // Aim for one chunk per context, but don't split slices into chunks which are too small to be worth it
+        const bool parallel_recording   = m_rhi_device->GetContextRhi()->parallel_recording;
+        const uint32_t context_count    = static_cast<uint32_t>(m_recording_contexts.size());
+        const uint32_t chunk_draws      = Math::Helper::Max(m_recording_chunk_draws_min, (draw_count + context_count - 1) / context_count);
+        const uint32_t draw_count_total = Math::Helper::Max(draw_count, 1u);
+
+        // Build the chunks, contexts get contiguous runs of them so that submitting the contexts in order preserves the order of the slices
+        m_light_depth_chunks.clear();
+        uint32_t draws_assigned = 0;
+        for_each_slice_pass([&](const Light* light, const uint32_t light_index, const uint32_t array_index, const SlicePass slice_pass, const vector<DrawCall>& draw_calls, const ShadowSliceCache& slice)
+        {
+            const bool transparent_pass     = slice_pass == SlicePass::Transparent;
+            const uint32_t slice_draw_count = static_cast<uint32_t>(draw_calls.size());
+            RHI_Texture* tex_depth          = slice_pass == SlicePass::Static ? slice.tex_static.get() : light->GetDepthTexture();
 
-            for (uint32_t array_index = 0; array_index < tex_depth->GetArraySize(); array_index++)
+            // Passes without draws still get a chunk, as it clears or restores the slice
+            uint32_t draw_start = 0;
+            do
             {
-                // Set render target texture array index
+                LightDepthChunk chunk;
+                chunk.light         = light;
+                chunk.light_index   = light_index;
+                chunk.array_index   = array_index;
+                chunk.object_type   = transparent_pass ? Renderer_Object_Transparent : Renderer_Object_Opaque;
+                chunk.draw_calls    = &draw_calls;
+                chunk.tex_static    = slice_pass == SlicePass::Restore ? slice.tex_static.get() : nullptr;
+                chunk.draw_start    = draw_start;
+                chunk.draw_end      = Math::Helper::Min(draw_start + chunk_draws, slice_draw_count);
+                chunk.context_index = Math::Helper::Min(static_cast<uint32_t>((static_cast<uint64_t>(draws_assigned) * context_count) / draw_count_total), context_count - 1);
+                draws_assigned      += chunk.draw_end - chunk.draw_start;
+
+                // Every chunk gets a pipeline state of its own, as they are recorded at the same time
+                const uint32_t chunk_index = static_cast<uint32_t>(m_light_depth_chunks.size());
+                if (chunk_index >= m_light_depth_pipeline_states.size())
+                {
+                    m_light_depth_pipeline_states.emplace_back(make_shared<RHI_PipelineState>());
+                }
+                chunk.pipeline_state = m_light_depth_pipeline_states[chunk_index].get();
+
+                // Set render state
+                RHI_PipelineState& pipeline_state                               = *chunk.pipeline_state;
+                pipeline_state.shader_vertex                                    = shader_v;
+                pipeline_state.vertex_buffer_stride                             = static_cast<uint32_t>(sizeof(RHI_Vertex_PosTexNorTan)); // assume all vertex buffers have the same stride (which they do)
+                pipeline_state.shader_pixel                                     = transparent_pass ? shader_p : nullptr;
+                pipeline_state.blend_state                                      = transparent_pass ? m_blend_alpha.get() : m_blend_disabled.get();
+                pipeline_state.depth_stencil_state                              = transparent_pass ? m_depth_stencil_on_off_r.get() : m_depth_stencil_on_off_w.get();
+                pipeline_state.render_target_color_textures[0]                  = light->GetColorTexture(); // always bind so we can clear to white (in case there are now transparent objects)
+                pipeline_state.render_target_depth_texture                      = tex_depth;
                 pipeline_state.render_target_color_texture_array_index          = array_index;
                 pipeline_state.render_target_depth_stencil_texture_array_index  = array_index;
+                pipeline_state.clear_stencil                                    = state_stencil_dont_care;
+                pipeline_state.viewport                                         = tex_depth->GetViewport();
+                pipeline_state.primitive_topology                               = RHI_PrimitiveTopology_TriangleList;
+                pipeline_state.pass_name                                        = transparent_pass ? "Pass_LightDepthTransparent" : "Pass_LightDepth";
+
+                // Set clear values, chunks after the first one of a slice load what the previous ones rendered
+                const bool first_chunk          = draw_start == 0;
+                pipeline_state.clear_color[0]   = first_chunk ? Vector4::One : state_color_load;
+                pipeline_state.clear_depth      = (first_chunk && !transparent_pass) ? GetClearDepth() : state_depth_load;
+
+                // The static layer is a texture of its own, without color
+                if (slice_pass == SlicePass::Static)
+                {
+                    pipeline_state.render_target_color_textures[0]                  = nullptr;
+                    pipeline_state.render_target_color_texture_array_index          = 0;
+                    pipeline_state.render_target_depth_stencil_texture_array_index  = 0;
+                    pipeline_state.pass_name                                        = "Pass_LightDepthStatic";
+                }
 
-                // Set clear values
-                pipeline_state.clear_color[0] = Vector4::One;
-                pipeline_state.clear_depth    = transparent_pass ? state_depth_load : GetClearDepth();
-
-                const Matrix& view_projection = light->GetViewMatrix(array_index) * light->GetProjectionMatrix(array_index);
+                // The restore is a full screen quad which outputs the depth of the static layer, the dynamic casters load it
+                if (slice_pass == SlicePass::Restore)
+                {
+                    pipeline_state.shader_pixel         = shader_copy_p;
+                    pipeline_state.vertex_buffer_stride = m_viewport_quad.GetVertexBuffer()->GetStride();
+                    pipeline_state.pass_name            = "Pass_LightDepthRestore";
+                }
+                else if (slice_pass == SlicePass::Opaque && slice.restore_static)
+                {
+                    pipeline_state.clear_color[0]   = state_color_load;
+                    pipeline_state.clear_depth      = state_depth_load;
+                }
 
                 // Set appropriate rasterizer state
-                if (light->GetLightType() == LightType::Directional)
+                if (light->GetLightType() == LightType::Directional && slice_pass != SlicePass::Restore)
                 {
                     // "Pancaking" - https://www.gamedev.net/forums/topic/639036-shadow-mapping-and-high-up-objects/
                     // It's basically a way to capture the silhouettes of potential shadow casters behind the light's view point.
@@ -209,80 +408,216 @@ namespace Spartan
                     pipeline_state.rasterizer_state = m_rasterizer_cull_back_solid.get();
                 }
 
-                // State tracking
-                bool render_pass_active     = false;
-                uint32_t m_set_material_id  = 0;
+                m_light_depth_chunks.emplace_back(chunk);
+                draw_start += chunk_draws;
+            } while (draw_start < slice_draw_count);
+        });
+
+        // Without parallel recording, everything is recorded serially into the main command list
+        if (!parallel_recording)
+        {
+            RecordingContext& context = *m_recording_contexts[0];
+            Stopwatch stopwatch;
 
-                for (uint32_t entity_index = 0; entity_index < static_cast<uint32_t>(entities.size()); entity_index++)
+            // Static layers are sampled inside of render passes, so they have to be in the right layout before any of them begins
+            for (const LightDepthChunk& chunk : m_light_depth_chunks)
+            {
+                if (chunk.tex_static)
                 {
-                    Entity* entity = entities[entity_index];
+                    chunk.tex_static->SetLayout(RHI_Image_Depth_Stencil_Read_Only_Optimal, cmd_list);
+                }
+            }
 
-                    // Acquire renderable component
-                    const auto& renderable = entity->GetRenderable();
-                    if (!renderable)
-                        continue;
+            for (const LightDepthChunk& chunk : m_light_depth_chunks)
+            {
+                Pass_LightDepthChunk(cmd_list, context, chunk);
+            }
 
-                    // Skip meshes that don't cast shadows
-                    if (!renderable->GetCastShadows())
-                        continue;
+            context.thread_id       = this_thread::get_id();
+            context.time_recording  = stopwatch.GetElapsedTimeMs();
+            m_profiler->m_time_cmd_recording.assign(1, context.time_recording);
+            return;
+        }
 
-                    // Acquire geometry
-                    const auto& model = renderable->GeometryModel();
-                    if (!model || !model->GetVertexBuffer() || !model->GetIndexBuffer())
-                        continue;
+        // Begin the command lists of the contexts that have something to record
+        const uint32_t context_count_used   = m_light_depth_chunks.back().context_index + 1;
+        const uint32_t cmd_index            = m_swap_chain->GetCmdIndex();
+        for (uint32_t i = 0; i < context_count_used; i++)
+        {
+            if (!m_recording_contexts[i]->cmd_lists[cmd_index]->Begin())
+            {
+                LOG_ERROR("Failed to begin command list");
+                return;
+            }
+        }
 
-                    // Acquire material
-                    const auto& material = renderable->GetMaterial();
-                    if (!material)
-                        continue;
+        // Image layouts are tracked per texture, so the transitions are recorded here, before any thread can race on them.
+        // They go into the first context's command list which is submitted before all the others.
+        {
+            RHI_CommandList* cmd_list_first = m_recording_contexts[0]->cmd_lists[cmd_index].get();
 
-                    // Skip objects outside of the view frustum
-                    if (!light->IsInViewFrustrum(renderable, array_index))
-                        continue;
+            for (const LightDepthChunk& chunk : m_light_depth_chunks)
+            {
+                if (RHI_Texture* tex_color = chunk.pipeline_state->render_target_color_textures[0])
+                {
+                    tex_color->SetLayout(RHI_Image_Color_Attachment_Optimal, cmd_list_first);
+                }
+
+                chunk.pipeline_state->render_target_depth_texture->SetLayout(RHI_Image_Depth_Stencil_Attachment_Optimal, cmd_list_first);
+
+                // Static layers which are restored
+                if (chunk.tex_static)
+                {
+                    chunk.tex_static->SetLayout(RHI_Image_Depth_Stencil_Read_Only_Optimal, cmd_list_first);
+                }
 
-                    if (!render_pass_active)
+                // Transparent shadow casters sample their albedo
+                if (chunk.object_type == Renderer_Object_Transparent)
+                {
+                    const auto& draw_calls = *chunk.draw_calls;
+                    for (uint32_t i = chunk.draw_start; i < chunk.draw_end; i++)
                     {
-                        render_pass_active = cmd_list->BeginRenderPass(pipeline_state);
+                        RHI_Texture* tex_albedo = draw_calls[i].entity->GetRenderable()->GetMaterial()->GetTexture_Ptr(Material_Color);
+                        if (tex_albedo && tex_albedo->IsColorFormat() && tex_albedo->GetLayout() != RHI_Image_Undefined && tex_albedo->GetLayout() != RHI_Image_Preinitialized)
+                        {
+                            tex_albedo->SetLayout(RHI_Image_Shader_Read_Only_Optimal, cmd_list_first);
+                        }
                     }
+                }
+            }
+        }
 
-                    // Bind material
-                    if (transparent_pass && m_set_material_id != material->GetId())
+        // Record, one context per task, the calling thread takes part
+        m_threading->ParallelFor(context_count_used, 1, [this, cmd_index](const uint32_t start, const uint32_t end)
+        {
+            for (uint32_t context_index = start; context_index < end; context_index++)
+            {
+                RecordingContext& context   = *m_recording_contexts[context_index];
+                RHI_CommandList* cmd_list   = context.cmd_lists[cmd_index].get();
+                Stopwatch stopwatch;
+
+                for (const LightDepthChunk& chunk : m_light_depth_chunks)
+                {
+                    if (chunk.context_index == context_index)
                     {
-                        // Bind material textures
-                        RHI_Texture* tex_albedo = material->GetTexture_Ptr(Material_Color);
-                        cmd_list->SetTexture(28, tex_albedo ? tex_albedo : m_tex_white.get());
+                        Pass_LightDepthChunk(cmd_list, context, chunk);
+                    }
+                }
 
-                        // Update uber buffer with material properties
-                        m_buffer_uber_cpu.mat_albedo    = material->GetColorAlbedo();
-                        m_buffer_uber_cpu.mat_tiling_uv = material->GetTiling();
-                        m_buffer_uber_cpu.mat_offset_uv = material->GetOffset();
+                context.thread_id       = this_thread::get_id();
+                context.time_recording  = stopwatch.GetElapsedTimeMs();
+            }
+        });
 
-                        // Update constant buffer
-                        UpdateUberBuffer(cmd_list);
+        // Submit in order, all of it executes before the main command list which is submitted at the end of the frame
+        m_profiler->m_time_cmd_recording.clear();
+        for (uint32_t i = 0; i < context_count_used; i++)
+        {
+            if (!m_recording_contexts[i]->cmd_lists[cmd_index]->Submit())
+            {
+                LOG_ERROR("Failed to submit command list");
+            }
 
-                        m_set_material_id = material->GetId();
-                    }
+            m_profiler->m_time_cmd_recording.emplace_back(m_recording_contexts[i]->time_recording);
+        }
+	}
 
-                    // Bind geometry
-                    cmd_list->SetBufferIndex(model->GetIndexBuffer());
-                    cmd_list->SetBufferVertex(model->GetVertexBuffer());
+    void Renderer::Pass_LightDepthChunk(RHI_CommandList* cmd_list, RecordingContext& context, const LightDepthChunk& chunk)
+    {
+        const bool transparent_pass     = chunk.object_type == Renderer_Object_Transparent;
+        const Matrix view_projection    = chunk.light->GetViewMatrix(chunk.array_index) * chunk.light->GetProjectionMatrix(chunk.array_index);
+        const auto& draw_calls          = *chunk.draw_calls;
 
-                    // Update uber buffer with cascade transform
-                    m_buffer_object_cpu.object = entity->GetTransform()->GetMatrix() * view_projection;
-                    if (!UpdateObjectBuffer(cmd_list))
-                        continue;
+        if (!cmd_list->BeginRenderPass(*chunk.pipeline_state))
+            return;
+
+        // Restore the cached depth of the static casters, the quad covers the whole slice
+        if (chunk.tex_static)
+        {
+            cmd_list->SetTexture(28, chunk.tex_static);
+            cmd_list->SetBufferVertex(m_viewport_quad.GetVertexBuffer());
+            cmd_list->SetBufferIndex(m_viewport_quad.GetIndexBuffer());
 
-                    cmd_list->DrawIndexed(renderable->GeometryIndexCount(), renderable->GeometryIndexOffset(), renderable->GeometryVertexOffset());
+            context.buffer_object_cpu.object    = m_buffer_frame_cpu.view_projection_ortho;
+            context.buffer_object_cpu.instanced = 0.0f;
+            if (UpdateObjectBuffer(cmd_list, context))
+            {
+                cmd_list->DrawIndexed(Rectangle::GetIndexCount());
+            }
 
-                }
+            cmd_list->EndRenderPass();
+            return;
+        }
 
-                if (render_pass_active)
+        // State tracking
+        uint32_t m_set_material_id = 0;
+        uint32_t m_set_geometry_id = 0;
+
+        for (uint32_t i = chunk.draw_start; i < chunk.draw_end;)
+        {
+            Entity* entity              = draw_calls[i].entity;
+            const auto& renderable      = entity->GetRenderable();
+            const auto& model           = renderable->GeometryModel();
+            const auto& material        = renderable->GetMaterial();
+
+            // Draws which share geometry (and material, when it's sampled) are drawn as instances of a single draw
+            const uint32_t instance_start = i;
+            const uint32_t instance_count = instance_batch_size(draw_calls, i, chunk.draw_end, transparent_pass);
+            i += instance_count;
+
+            // Bind material
+            if (transparent_pass && m_set_material_id != material->GetId())
+            {
+                // Bind material textures
+                RHI_Texture* tex_albedo = material->GetTexture_Ptr(Material_Color);
+                cmd_list->SetTexture(28, tex_albedo ? tex_albedo : m_tex_white.get());
+
+                // Update uber buffer with material properties
+                context.buffer_uber_cpu.mat_albedo      = material->GetColorAlbedo();
+                context.buffer_uber_cpu.mat_tiling_uv   = material->GetTiling();
+                context.buffer_uber_cpu.mat_offset_uv   = material->GetOffset();
+
+                // Update constant buffer
+                UpdateUberBuffer(cmd_list, context);
+
+                m_set_material_id = material->GetId();
+            }
+
+            // Bind geometry
+            if (m_set_geometry_id != model->GetId())
+            {
+                cmd_list->SetBufferIndex(model->GetIndexBuffer());
+                cmd_list->SetBufferVertex(model->GetVertexBuffer());
+                m_set_geometry_id = model->GetId();
+            }
+
+            // Update object buffer with cascade transform, or the instance buffer with the transforms of all the instances
+            if (instance_count == 1)
+            {
+                context.buffer_object_cpu.object    = entity->GetTransform()->GetMatrix() * view_projection;
+                context.buffer_object_cpu.instanced = 0.0f;
+            }
+            else
+            {
+                for (uint32_t instance_index = 0; instance_index < instance_count; instance_index++)
                 {
-                    cmd_list->EndRenderPass();
+                    context.buffer_instance_cpu.transform[instance_index] = draw_calls[instance_start + instance_index].entity->GetTransform()->GetMatrix() * view_projection;
                 }
+
+                if (!UpdateInstanceBuffer(cmd_list, context, instance_count))
+                    continue;
+
+                context.buffer_object_cpu.instanced = 1.0f;
             }
+
+            if (!UpdateObjectBuffer(cmd_list, context))
+                continue;
+
+            cmd_list->DrawIndexed(renderable->GeometryLodIndexCount(draw_calls[instance_start].lod), renderable->GeometryLodIndexOffset(draw_calls[instance_start].lod), renderable->GeometryVertexOffset(), instance_count);
         }
-	}
+
+        cmd_list->EndRenderPass();
+    }
 
     void Renderer::Pass_DepthPrePass(RHI_CommandList* cmd_list)
     {
@@ -292,7 +627,7 @@ namespace Spartan
         // Acquire required resources/data
         const auto& shader_depth    = m_shaders[Shader_Depth_V];
         const auto& tex_depth       = m_render_targets[RenderTarget_Gbuffer_Depth];
-        const auto& entities        = m_entities[Renderer_Object_Opaque];
+        const auto& draw_calls      = m_views[0].draw_calls[Renderer_Object_Opaque];
 
         // Ensure the shader has compiled
         if (!shader_depth->IsCompiled())
@@ -314,27 +649,23 @@ namespace Spartan
         // Record commands
         if (cmd_list->BeginRenderPass(pipeline_state))
         { 
-            if (!entities.empty())
+            if (!draw_calls.empty())
             {
                 // Variables that help reduce state changes
                 uint32_t currently_bound_geometry = 0;
 
                 // Draw opaque
-                for (const auto& entity : entities)
+                const uint32_t draw_count = static_cast<uint32_t>(draw_calls.size());
+                for (uint32_t i = 0; i < draw_count;)
                 {
-                    // Get renderable
-                    const auto& renderable = entity->GetRenderable();
-                    if (!renderable)
-                        continue;
+                    Entity* entity          = draw_calls[i].entity;
+                    const auto& renderable  = entity->GetRenderable();
+                    const auto& model       = renderable->GeometryModel();
 
-                    // Get geometry
-                    const auto& model = renderable->GeometryModel();
-                    if (!model || !model->GetVertexBuffer() || !model->GetIndexBuffer())
-                        continue;
-
-                    // Skip objects outside of the view frustum
-                    if (!m_camera->IsInViewFrustrum(renderable))
-                        continue;
+                    // Draws which share geometry are drawn as instances of a single draw
+                    const uint32_t instance_start = i;
+                    const uint32_t instance_count = instance_batch_size(draw_calls, i, draw_count, false);
+                    i += instance_count;
 
                     // Bind geometry
                     if (currently_bound_geometry != model->GetId())
@@ -344,16 +675,30 @@ namespace Spartan
                         currently_bound_geometry = model->GetId();
                     }
 
-                    // Update uber buffer with entity transform
-                    if (Transform* transform = entity->GetTransform())
+                    // Update object buffer with entity transform, or the instance buffer with the transforms of all the instances
+                    if (instance_count == 1)
                     {
-                        // Update uber buffer with cascade transform
-                        m_buffer_uber_cpu.transform = transform->GetMatrix() * m_buffer_frame_cpu.view_projection;
-                        UpdateUberBuffer(cmd_list);
+                        m_buffer_object_cpu.object      = entity->GetTransform()->GetMatrix() * m_buffer_frame_cpu.view_projection;
+                        m_buffer_object_cpu.instanced   = 0.0f;
+                    }
+                    else
+                    {
+                        for (uint32_t instance_index = 0; instance_index < instance_count; instance_index++)
+                        {
+                            m_buffer_instance_cpu.transform[instance_index] = draw_calls[instance_start + instance_index].entity->GetTransform()->GetMatrix() * m_buffer_frame_cpu.view_projection;
+                        }
+
+                        if (!UpdateInstanceBuffer(cmd_list, instance_count))
+                            continue;
+
+                        m_buffer_object_cpu.instanced = 1.0f;
                     }
 
+                    if (!UpdateObjectBuffer(cmd_list))
+                        continue;
+
                     // Draw	
-                    cmd_list->DrawIndexed(renderable->GeometryIndexCount(), renderable->GeometryIndexOffset(), renderable->GeometryVertexOffset());
+                    cmd_list->DrawIndexed(renderable->GeometryLodIndexCount(draw_calls[instance_start].lod), renderable->GeometryLodIndexOffset(draw_calls[instance_start].lod), renderable->GeometryVertexOffset(), instance_count);
                 }
             }
             cmd_list->EndRenderPass();
@@ -404,141 +749,161 @@ namespace Spartan
         uint32_t material_bound_id = 0;
         m_material_instances.fill(nullptr);
 
-        // Iterate through all the G-Buffer shader variations
-        for (const auto& it : ShaderGBuffer::GetVariations())
-        {
-            // Skip the shader until it compiles or the users spots a compilation error
-            if (!it.second->IsCompiled())
-                continue;
+        // Draws are sorted by shader variation, then material, geometry and depth
+        const auto& draw_calls          = m_views[0].draw_calls[object_type];
+        bool render_pass_active         = false;
+        bool variation_first            = true;
+        uint16_t variation_bound        = 0;
+        uint32_t geometry_bound_id      = 0;
 
-            // Set pixel shader
-            pso.shader_pixel = static_cast<RHI_Shader*>(it.second.get());
+        // Record commands
+        const uint32_t draw_count = static_cast<uint32_t>(draw_calls.size());
+        for (uint32_t i = 0; i < draw_count;)
+        {
+            Entity* entity          = draw_calls[i].entity;
+            const auto& renderable  = entity->GetRenderable();
+            Material* material      = renderable->GetMaterial();
+            const auto& model       = renderable->GeometryModel();
 
-            // Set pass name
-            pso.pass_name = pso.shader_pixel->GetName().c_str();
+            // Draws which share geometry and material are drawn as instances of a single draw
+            const uint32_t instance_start = i;
+            const uint32_t instance_count = instance_batch_size(draw_calls, i, draw_count, true);
+            i += instance_count;
 
-            bool render_pass_active = false;
-            auto& entities = m_entities[object_type];
+            if (!material)
+                continue;
 
-            // Record commands
-            for (uint32_t i = 0; i < static_cast<uint32_t>(entities.size()); i++)
+            // A shader variation change requires a new render pass
+            const uint16_t variation = material->GetFlags();
+            if (variation_first || variation != variation_bound)
             {
-                Entity* entity = entities[i];
-
-                // Get renderable
-                const auto& renderable = entity->GetRenderable();
-                if (!renderable)
-                    continue;
-
-                // Get material
-                Material* material = renderable->GetMaterial();
-                if (!material)
-                    continue;
-
-                // Skip objects with different shader requirements
-                if (!static_cast<ShaderGBuffer*>(pso.shader_pixel)->IsSuitable(material->GetFlags()))
-                    continue;
-
-                // Skip transparent objects that won't contribute
-                if (material->GetColorAlbedo().w == 0 && is_transparent)
-                    continue;
-
-                // Get geometry
-                const auto& model = renderable->GeometryModel();
-                if (!model || !model->GetVertexBuffer() || !model->GetIndexBuffer())
-                    continue;
+                if (render_pass_active)
+                {
+                    cmd_list->EndRenderPass();
+                    render_pass_active = false;
+                }
 
-                // Skip objects outside of the view frustum
-                if (!m_camera->IsInViewFrustrum(renderable))
-                    continue;
+                variation_first     = false;
+                variation_bound     = variation;
+                geometry_bound_id   = 0;
 
-                if (!render_pass_active)
+                // Skip the shader until it compiles or the users spots a compilation error
+                ShaderGBuffer* shader = ShaderGBuffer::GetVariation(variation);
+                if (shader && shader->IsCompiled())
                 {
-                    render_pass_active = cmd_list->BeginRenderPass(pso);
+                    pso.shader_pixel    = static_cast<RHI_Shader*>(shader);
+                    pso.pass_name       = pso.shader_pixel->GetName().c_str();
+                    render_pass_active  = cmd_list->BeginRenderPass(pso);
                 }
+            }
 
-                // Set geometry (will only happen if not already set)
+            if (!render_pass_active)
+                continue;
+
+            // Set geometry
+            if (geometry_bound_id != model->GetId())
+            {
                 cmd_list->SetBufferIndex(model->GetIndexBuffer());
                 cmd_list->SetBufferVertex(model->GetVertexBuffer());
+                geometry_bound_id = model->GetId();
+            }
 
-                // Bind material
-                bool firs_run       = material_index == 0;
-                bool new_material   = material_bound_id != material->GetId();
-                if (firs_run || new_material)
-                {
-                    material_bound_id = material->GetId();
-
-                    // Keep track of used material instances (they get mapped to shaders)
-                    if (material_index + 1 < m_material_instances.size())
-                    {
-                        // Advance index (0 is reserved for the sky)
-                        material_index++;
+            // Bind material
+            bool firs_run       = material_index == 0;
+            bool new_material   = material_bound_id != material->GetId();
+            if (firs_run || new_material)
+            {
+                material_bound_id = material->GetId();
 
-                        // Keep reference
-                        m_material_instances[material_index] = material;
-                    }
-                    else
-                    {
-                        LOG_ERROR("Material instance array has reached it's maximum capacity of %d elements. Consider increasing the size.", m_max_material_instances);
-                    }
+                // Keep track of used material instances (they get mapped to shaders)
+                if (material_index + 1 < m_material_instances.size())
+                {
+                    // Advance index (0 is reserved for the sky)
+                    material_index++;
 
-                    // Bind material textures		
-                    cmd_list->SetTexture(0, material->GetTexture_Ptr(Material_Color));
-                    cmd_list->SetTexture(1, material->GetTexture_Ptr(Material_Roughness));
-                    cmd_list->SetTexture(2, material->GetTexture_Ptr(Material_Metallic));
-                    cmd_list->SetTexture(3, material->GetTexture_Ptr(Material_Normal));
-                    cmd_list->SetTexture(4, material->GetTexture_Ptr(Material_Height));
-                    cmd_list->SetTexture(5, material->GetTexture_Ptr(Material_Occlusion));
-                    cmd_list->SetTexture(6, material->GetTexture_Ptr(Material_Emission));
-                    cmd_list->SetTexture(7, material->GetTexture_Ptr(Material_Mask));
-                
-                    // Update uber buffer with material properties
-                    m_buffer_uber_cpu.mat_id            = static_cast<float>(material_index);
-                    m_buffer_uber_cpu.mat_albedo        = material->GetColorAlbedo();
-                    m_buffer_uber_cpu.mat_tiling_uv     = material->GetTiling();
-                    m_buffer_uber_cpu.mat_offset_uv     = material->GetOffset();
-                    m_buffer_uber_cpu.mat_roughness_mul = material->GetProperty(Material_Roughness);
-                    m_buffer_uber_cpu.mat_metallic_mul  = material->GetProperty(Material_Metallic);
-                    m_buffer_uber_cpu.mat_normal_mul    = material->GetProperty(Material_Normal);
-                    m_buffer_uber_cpu.mat_height_mul    = material->GetProperty(Material_Height);
-
-                    // Update constant buffer
-                    UpdateUberBuffer(cmd_list);
+                    // Keep reference
+                    m_material_instances[material_index] = material;
                 }
-                
-                // Update uber buffer with entity transform
-                if (Transform* transform = entity->GetTransform())
+                else
                 {
-                    m_buffer_object_cpu.object          = transform->GetMatrix();
-                    m_buffer_object_cpu.wvp_current     = transform->GetMatrix() * m_buffer_frame_cpu.view_projection;
-                    m_buffer_object_cpu.wvp_previous    = transform->GetWvpLastFrame();
-
-                    // Save matrix for velocity computation
-                    transform->SetWvpLastFrame(m_buffer_object_cpu.wvp_current);
-
-                    // Update object buffer
-                    if (!UpdateObjectBuffer(cmd_list))
-                        continue;
+                    LOG_ERROR("Material instance array has reached it's maximum capacity of %d elements. Consider increasing the size.", m_max_material_instances);
                 }
-                
-                // Render	
-                cmd_list->DrawIndexed(renderable->GeometryIndexCount(), renderable->GeometryIndexOffset(), renderable->GeometryVertexOffset());
-                m_profiler->m_renderer_meshes_rendered++;
 
-                // Clear only on first pass
-                if (!cleared)
+                // Bind material textures		
+                cmd_list->SetTexture(0, material->GetTexture_Ptr(Material_Color));
+                cmd_list->SetTexture(1, material->GetTexture_Ptr(Material_Roughness));
+                cmd_list->SetTexture(2, material->GetTexture_Ptr(Material_Metallic));
+                cmd_list->SetTexture(3, material->GetTexture_Ptr(Material_Normal));
+                cmd_list->SetTexture(4, material->GetTexture_Ptr(Material_Height));
+                cmd_list->SetTexture(5, material->GetTexture_Ptr(Material_Occlusion));
+                cmd_list->SetTexture(6, material->GetTexture_Ptr(Material_Emission));
+                cmd_list->SetTexture(7, material->GetTexture_Ptr(Material_Mask));
+            
+                // Update uber buffer with material properties
+                m_buffer_uber_cpu.mat_id            = static_cast<float>(material_index);
+                m_buffer_uber_cpu.mat_albedo        = material->GetColorAlbedo();
+                m_buffer_uber_cpu.mat_tiling_uv     = material->GetTiling();
+                m_buffer_uber_cpu.mat_offset_uv     = material->GetOffset();
+                m_buffer_uber_cpu.mat_roughness_mul = material->GetProperty(Material_Roughness);
+                m_buffer_uber_cpu.mat_metallic_mul  = material->GetProperty(Material_Metallic);
+                m_buffer_uber_cpu.mat_normal_mul    = material->GetProperty(Material_Normal);
+                m_buffer_uber_cpu.mat_height_mul    = material->GetProperty(Material_Height);
+
+                // Update constant buffer
+                UpdateUberBuffer(cmd_list);
+            }
+            
+            // Update object buffer with entity transform, or the instance buffer with the transforms of all the instances
+            if (instance_count == 1)
+            {
+                Transform* transform                = entity->GetTransform();
+                m_buffer_object_cpu.object          = transform->GetMatrix();
+                m_buffer_object_cpu.wvp_current     = transform->GetMatrix() * m_buffer_frame_cpu.view_projection;
+                m_buffer_object_cpu.wvp_previous    = transform->GetWvpLastFrame();
+                m_buffer_object_cpu.instanced       = 0.0f;
+
+                // Save matrix for velocity computation
+                transform->SetWvpLastFrame(m_buffer_object_cpu.wvp_current);
+            }
+            else
+            {
+                for (uint32_t instance_index = 0; instance_index < instance_count; instance_index++)
                 {
-                    pso.ResetClearValues();
-                    cleared = true;
+                    Transform* transform                                = draw_calls[instance_start + instance_index].entity->GetTransform();
+                    m_buffer_instance_cpu.transform[instance_index]     = transform->GetMatrix();
+                    m_buffer_instance_cpu.wvp_previous[instance_index]  = transform->GetWvpLastFrame();
+
+                    // Save matrix for velocity computation
+                    transform->SetWvpLastFrame(transform->GetMatrix() * m_buffer_frame_cpu.view_projection);
                 }
+
+                if (!UpdateInstanceBuffer(cmd_list, instance_count))
+                    continue;
+
+                m_buffer_object_cpu.instanced = 1.0f;
             }
 
-            if (render_pass_active)
+            // Update object buffer
+            if (!UpdateObjectBuffer(cmd_list))
+                continue;
+            
+            // Render	
+            cmd_list->DrawIndexed(renderable->GeometryLodIndexCount(draw_calls[instance_start].lod), renderable->GeometryLodIndexOffset(draw_calls[instance_start].lod), renderable->GeometryVertexOffset(), instance_count);
+            m_profiler->m_renderer_meshes_rendered += instance_count;
+
+            // Clear only on first pass
+            if (!cleared)
             {
-                cmd_list->EndRenderPass();
+                pso.ResetClearValues();
+                cleared = true;
             }
         }
 
+        if (render_pass_active)
+        {
+            cmd_list->EndRenderPass();
+        }
+
         // Update constant buffer (light pass will access it using material IDs)
         UpdateMaterialBuffer();
 	}
@@ -737,11 +1102,72 @@ namespace Spartan
         pipeline_state.pass_name                                = "Pass_Light";
 
         bool cleared = false;
+        auto draw = [this, cmd_list, tex_depth, use_stencil, &cleared](const Light* light)
+        {
+            if (!cmd_list->BeginRenderPass(pipeline_state))
+                return;
+
+            cmd_list->SetBufferVertex(m_viewport_quad.GetVertexBuffer());
+            cmd_list->SetBufferIndex(m_viewport_quad.GetIndexBuffer());
+            cmd_list->SetTexture(8, m_render_targets[RenderTarget_Gbuffer_Albedo]);
+            cmd_list->SetTexture(9, m_render_targets[RenderTarget_Gbuffer_Normal]);
+            cmd_list->SetTexture(10, m_render_targets[RenderTarget_Gbuffer_Material]);
+            cmd_list->SetTexture(12, tex_depth);
+            cmd_list->SetTexture(22, (m_options & Render_Hbao) ? m_render_targets[RenderTarget_Hbao] : m_tex_black_opaque);
+            cmd_list->SetTexture(26, (m_options & Render_ScreenSpaceReflections) ? m_render_targets[RenderTarget_Ssr] : m_tex_black_transparent);
+            cmd_list->SetTexture(27, m_render_targets[RenderTarget_Hdr_2]); // previous frame before post-processing
+            cmd_list->SetTexture(31, m_tex_blue_noise);
+
+            // The clustered pass reads its lights from the light and cluster buffers instead
+            if (light)
+            {
+                // Update light buffer
+                UpdateLightBuffer(light);
+
+                // Set shadow map
+                if (light->GetShadowsEnabled())
+                {
+                    RHI_Texture* tex_depth = light->GetDepthTexture();
+                    RHI_Texture* tex_color = light->GetShadowsTransparentEnabled() ? light->GetColorTexture() : m_tex_white.get();
+
+                    if (light->GetLightType() == LightType::Directional)
+                    {
+                        cmd_list->SetTexture(13, tex_depth);
+                        cmd_list->SetTexture(14, tex_color);
+                    }
+                    else if (light->GetLightType() == LightType::Point)
+                    {
+                        cmd_list->SetTexture(15, tex_depth);
+                        cmd_list->SetTexture(16, tex_color);
+                    }
+                    else if (light->GetLightType() == LightType::Spot)
+                    {
+                        cmd_list->SetTexture(17, tex_depth);
+                        cmd_list->SetTexture(18, tex_color);
+                    }
+                }
+            }
+
+            // Draw
+            cmd_list->DrawIndexed(Rectangle::GetIndexCount());
+            cmd_list->EndRenderPass();
 
-        // Iterate through all the light entities
-        for (const auto& entity : entities)
+            // Clear only on first pass
+            if (!cleared && !use_stencil)
+            {
+                pipeline_state.ResetClearValues();
+                cleared = true;
+            }
+        };
+
+        // Lights which need their shadow maps get a pass of their own
+        bool reflections_added = false;
+        for (uint32_t i = 0; i < static_cast<uint32_t>(entities.size()); i++)
         {
-            if (Light* light = entity->GetComponent<Light>())
+            if (i < m_lights_clustered.size() && m_lights_clustered[i])
+                continue;
+
+            if (Light* light = entities[i]->GetComponent<Light>())
             {
                 if (light->GetIntensity() != 0)
                 {
@@ -752,59 +1178,21 @@ namespace Spartan
                     if (!pipeline_state.shader_pixel->IsCompiled())
                         continue;
 
-                    if (cmd_list->BeginRenderPass(pipeline_state))
-                    {
-                        cmd_list->SetBufferVertex(m_viewport_quad.GetVertexBuffer());
-                        cmd_list->SetBufferIndex(m_viewport_quad.GetIndexBuffer());
-                        cmd_list->SetTexture(8, m_render_targets[RenderTarget_Gbuffer_Albedo]);
-                        cmd_list->SetTexture(9, m_render_targets[RenderTarget_Gbuffer_Normal]);
-                        cmd_list->SetTexture(10, m_render_targets[RenderTarget_Gbuffer_Material]);
-                        cmd_list->SetTexture(12, tex_depth);
-                        cmd_list->SetTexture(22, (m_options & Render_Hbao) ? m_render_targets[RenderTarget_Hbao] : m_tex_black_opaque);
-                        cmd_list->SetTexture(26, (m_options & Render_ScreenSpaceReflections) ? m_render_targets[RenderTarget_Ssr] : m_tex_black_transparent);
-                        cmd_list->SetTexture(27, m_render_targets[RenderTarget_Hdr_2]); // previous frame before post-processing
-                        cmd_list->SetTexture(31, m_tex_blue_noise);
-
-                        // Update light buffer
-                        UpdateLightBuffer(light);
-
-                        // Set shadow map
-                        if (light->GetShadowsEnabled())
-                        {
-                            RHI_Texture* tex_depth = light->GetDepthTexture();
-                            RHI_Texture* tex_color = light->GetShadowsTransparentEnabled() ? light->GetColorTexture() : m_tex_white.get();
-
-                            if (light->GetLightType() == LightType::Directional)
-                            {
-                                cmd_list->SetTexture(13, tex_depth);
-                                cmd_list->SetTexture(14, tex_color);
-                            }
-                            else if (light->GetLightType() == LightType::Point)
-                            {
-                                cmd_list->SetTexture(15, tex_depth);
-                                cmd_list->SetTexture(16, tex_color);
-                            }
-                            else if (light->GetLightType() == LightType::Spot)
-                            {
-                                cmd_list->SetTexture(17, tex_depth);
-                                cmd_list->SetTexture(18, tex_color);
-                            }
-                        }
-
-                        // Draw
-                        cmd_list->DrawIndexed(Rectangle::GetIndexCount());
-                        cmd_list->EndRenderPass();
-
-                        // Clear only on first pass
-                        if (!cleared && !use_stencil)
-                        {
-                            pipeline_state.ResetClearValues();
-                            cleared = true;
-                        }
-                    }
+                    draw(light);
+                    reflections_added = true;
                 }
             }
         }
+
+        // The rest are shaded by a single pass, which only iterates the lights of each pixel's cluster
+        if (m_light_clusters.GetLightCount() != 0)
+        {
+            pipeline_state.shader_pixel = static_cast<RHI_Shader*>(ShaderLight::GetVariationClustered(m_context, m_options, !reflections_added));
+            if (pipeline_state.shader_pixel->IsCompiled())
+            {
+                draw(nullptr);
+            }
+        }
     }
 
 	void Renderer::Pass_Composition(RHI_CommandList* cmd_list, shared_ptr<RHI_Texture>& tex_out, const bool use_stencil)
@@ -819,19 +1207,20 @@ namespace Spartan
 
         // Set render state
         static RHI_PipelineState pipeline_state;
-        pipeline_state.shader_vertex                    = shader_v.get();
-        pipeline_state.shader_pixel                     = shader_p.get();
-        pipeline_state.rasterizer_state                 = m_rasterizer_cull_back_solid.get();
-        pipeline_state.depth_stencil_state              = use_stencil ? m_depth_stencil_off_on_r.get() : m_depth_stencil_off_off.get();
-        pipeline_state.blend_state                      = m_blend_disabled.get();
-        pipeline_state.vertex_buffer_stride             = m_viewport_quad.GetVertexBuffer()->GetStride();
-        pipeline_state.render_target_color_textures[0]  = tex_out.get();
-        pipeline_state.clear_color[0]                   = state_color_dont_care;
-        pipeline_state.render_target_depth_texture      = use_stencil ? m_render_targets[RenderTarget_Gbuffer_Depth].get() : nullptr;
-        pipeline_state.clear_stencil                    = use_stencil ? state_stencil_load : state_stencil_dont_care;
-        pipeline_state.viewport                         = tex_out->GetViewport();
-        pipeline_state.primitive_topology               = RHI_PrimitiveTopology_TriangleList;
-        pipeline_state.pass_name                        = "Pass_Composition";
+        pipeline_state.shader_vertex                            = shader_v.get();
+        pipeline_state.shader_pixel                             = shader_p.get();
+        pipeline_state.rasterizer_state                         = m_rasterizer_cull_back_solid.get();
+        pipeline_state.depth_stencil_state                      = use_stencil ? m_depth_stencil_off_on_r.get() : m_depth_stencil_off_off.get();
+        pipeline_state.blend_state                              = m_blend_disabled.get();
+        pipeline_state.vertex_buffer_stride                     = m_viewport_quad.GetVertexBuffer()->GetStride();
+        pipeline_state.render_target_color_textures[0]          = tex_out.get();
+        pipeline_state.clear_color[0]                           = state_color_dont_care;
+        pipeline_state.render_target_depth_texture              = use_stencil ? m_render_targets[RenderTarget_Gbuffer_Depth].get() : nullptr;
+        pipeline_state.render_target_depth_texture_read_only    = use_stencil;
+        pipeline_state.clear_stencil                            = use_stencil ? state_stencil_load : state_stencil_dont_care;
+        pipeline_state.viewport                                 = tex_out->GetViewport();
+        pipeline_state.primitive_topology                       = RHI_PrimitiveTopology_TriangleList;
+        pipeline_state.pass_name                                = "Pass_Composition";
 
         // Begin commands
         if (cmd_list->BeginRenderPass(pipeline_state))
@@ -876,19 +1265,20 @@ namespace Spartan
 
         // Set render state
         static RHI_PipelineState pipeline_state;
-        pipeline_state.shader_vertex                    = shader_v.get();
-        pipeline_state.shader_pixel                     = shader_p.get();
-        pipeline_state.rasterizer_state                 = m_rasterizer_cull_back_solid.get();
-        pipeline_state.blend_state                      = m_blend_alpha.get();
-        pipeline_state.depth_stencil_state              = use_stencil ? m_depth_stencil_off_on_r.get() : m_depth_stencil_off_off.get();
-        pipeline_state.vertex_buffer_stride             = m_viewport_quad.GetVertexBuffer()->GetStride();
-        pipeline_state.render_target_color_textures[0]  = tex_out;
-        pipeline_state.clear_color[0]                   = use_stencil ? state_color_load : state_color_dont_care;
-        pipeline_state.render_target_depth_texture      = use_stencil ? m_render_targets[RenderTarget_Gbuffer_Depth].get() : nullptr;
-        pipeline_state.clear_stencil                    = use_stencil ? state_stencil_load : state_stencil_dont_care;
-        pipeline_state.viewport                         = tex_out->GetViewport();
-        pipeline_state.primitive_topology               = RHI_PrimitiveTopology_TriangleList;
-        pipeline_state.pass_name                        = "Pass_AlphaBlend";
+        pipeline_state.shader_vertex                            = shader_v.get();
+        pipeline_state.shader_pixel                             = shader_p.get();
+        pipeline_state.rasterizer_state                         = m_rasterizer_cull_back_solid.get();
+        pipeline_state.blend_state                              = m_blend_alpha.get();
+        pipeline_state.depth_stencil_state                      = use_stencil ? m_depth_stencil_off_on_r.get() : m_depth_stencil_off_off.get();
+        pipeline_state.vertex_buffer_stride                     = m_viewport_quad.GetVertexBuffer()->GetStride();
+        pipeline_state.render_target_color_textures[0]          = tex_out;
+        pipeline_state.clear_color[0]                           = use_stencil ? state_color_load : state_color_dont_care;
+        pipeline_state.render_target_depth_texture              = use_stencil ? m_render_targets[RenderTarget_Gbuffer_Depth].get() : nullptr;
+        pipeline_state.render_target_depth_texture_read_only    = use_stencil;
+        pipeline_state.clear_stencil                            = use_stencil ? state_stencil_load : state_stencil_dont_care;
+        pipeline_state.viewport                                 = tex_out->GetViewport();
+        pipeline_state.primitive_topology                       = RHI_PrimitiveTopology_TriangleList;
+        pipeline_state.pass_name                                = "Pass_AlphaBlend";
         
         // Record commands
         if (cmd_list->BeginRenderPass(pipeline_state))
@@ -1075,18 +1465,19 @@ namespace Spartan
 
         // Set render state
         static RHI_PipelineState pipeline_state;
-        pipeline_state.shader_vertex                    = shader_v.get();
-        pipeline_state.shader_pixel                     = shader_p.get();
-        pipeline_state.rasterizer_state                 = m_rasterizer_cull_back_solid.get();
-        pipeline_state.blend_state                      = m_blend_disabled.get();
-        pipeline_state.depth_stencil_state              = use_stencil ? m_depth_stencil_off_on_r.get() : m_depth_stencil_off_off.get();
-        pipeline_state.vertex_buffer_stride             = m_viewport_quad.GetVertexBuffer()->GetStride();
-        pipeline_state.render_target_color_textures[0]  = tex_out.get();
-        pipeline_state.clear_color[0]                   = state_color_dont_care;
-        pipeline_state.render_target_depth_texture      = use_stencil ? m_render_targets[RenderTarget_Gbuffer_Depth].get() : nullptr;
-        pipeline_state.viewport                         = tex_out->GetViewport();
-        pipeline_state.primitive_topology               = RHI_PrimitiveTopology_TriangleList;
-        pipeline_state.pass_name                        = "Pass_BlurBox";
+        pipeline_state.shader_vertex                            = shader_v.get();
+        pipeline_state.shader_pixel                             = shader_p.get();
+        pipeline_state.rasterizer_state                         = m_rasterizer_cull_back_solid.get();
+        pipeline_state.blend_state                              = m_blend_disabled.get();
+        pipeline_state.depth_stencil_state                      = use_stencil ? m_depth_stencil_off_on_r.get() : m_depth_stencil_off_off.get();
+        pipeline_state.vertex_buffer_stride                     = m_viewport_quad.GetVertexBuffer()->GetStride();
+        pipeline_state.render_target_color_textures[0]          = tex_out.get();
+        pipeline_state.clear_color[0]                           = state_color_dont_care;
+        pipeline_state.render_target_depth_texture              = use_stencil ? m_render_targets[RenderTarget_Gbuffer_Depth].get() : nullptr;
+        pipeline_state.render_target_depth_texture_read_only    = use_stencil;
+        pipeline_state.viewport                                 = tex_out->GetViewport();
+        pipeline_state.primitive_topology                       = RHI_PrimitiveTopology_TriangleList;
+        pipeline_state.pass_name                                = "Pass_BlurBox";
 
         // Record commands
         if (cmd_list->BeginRenderPass(pipeline_state))
@@ -1201,19 +1592,20 @@ namespace Spartan
 
         // Set render state for horizontal pass
         static RHI_PipelineState pipeline_state_horizontal;
-        pipeline_state_horizontal.shader_vertex                     = shader_v.get();
-        pipeline_state_horizontal.shader_pixel                      = shader_p.get();
-        pipeline_state_horizontal.rasterizer_state                  = m_rasterizer_cull_back_solid.get();
-        pipeline_state_horizontal.blend_state                       = m_blend_disabled.get();
-        pipeline_state_horizontal.depth_stencil_state               = use_stencil ? m_depth_stencil_off_on_r.get() : m_depth_stencil_off_off.get();
-        pipeline_state_horizontal.vertex_buffer_stride              = m_viewport_quad.GetVertexBuffer()->GetStride();
-        pipeline_state_horizontal.render_target_color_textures[0]   = tex_out.get();
-        pipeline_state_horizontal.clear_color[0]                    = state_color_dont_care;
-        pipeline_state_horizontal.render_target_depth_texture       = use_stencil ? tex_depth : nullptr;
-        pipeline_state_horizontal.clear_stencil                     = use_stencil ? state_stencil_load : state_stencil_dont_care;
-        pipeline_state_horizontal.viewport                          = tex_out->GetViewport();
-        pipeline_state_horizontal.primitive_topology                = RHI_PrimitiveTopology_TriangleList;
-        pipeline_state_horizontal.pass_name                         = "Pass_BlurBilateralGaussian_Horizontal";
+        pipeline_state_horizontal.shader_vertex                            = shader_v.get();
+        pipeline_state_horizontal.shader_pixel                             = shader_p.get();
+        pipeline_state_horizontal.rasterizer_state                         = m_rasterizer_cull_back_solid.get();
+        pipeline_state_horizontal.blend_state                              = m_blend_disabled.get();
+        pipeline_state_horizontal.depth_stencil_state                      = use_stencil ? m_depth_stencil_off_on_r.get() : m_depth_stencil_off_off.get();
+        pipeline_state_horizontal.vertex_buffer_stride                     = m_viewport_quad.GetVertexBuffer()->GetStride();
+        pipeline_state_horizontal.render_target_color_textures[0]          = tex_out.get();
+        pipeline_state_horizontal.clear_color[0]                           = state_color_dont_care;
+        pipeline_state_horizontal.render_target_depth_texture              = use_stencil ? tex_depth : nullptr;
+        pipeline_state_horizontal.render_target_depth_texture_read_only    = use_stencil;
+        pipeline_state_horizontal.clear_stencil                            = use_stencil ? state_stencil_load : state_stencil_dont_care;
+        pipeline_state_horizontal.viewport                                 = tex_out->GetViewport();
+        pipeline_state_horizontal.primitive_topology                       = RHI_PrimitiveTopology_TriangleList;
+        pipeline_state_horizontal.pass_name                                = "Pass_BlurBilateralGaussian_Horizontal";
 
         // Record commands for horizontal pass
         if (cmd_list->BeginRenderPass(pipeline_state_horizontal))
@@ -1235,19 +1627,20 @@ namespace Spartan
 
         // Set render state for vertical pass
         static RHI_PipelineState pipeline_state_vertical;
-        pipeline_state_vertical.shader_vertex                   = shader_v.get();
-        pipeline_state_vertical.shader_pixel                    = shader_p.get();
-        pipeline_state_vertical.rasterizer_state                = m_rasterizer_cull_back_solid.get();
-        pipeline_state_vertical.blend_state                     = m_blend_disabled.get();
-        pipeline_state_vertical.depth_stencil_state             = use_stencil ? m_depth_stencil_off_on_r.get() : m_depth_stencil_off_off.get();
-        pipeline_state_vertical.vertex_buffer_stride            = m_viewport_quad.GetVertexBuffer()->GetStride();
-        pipeline_state_vertical.render_target_color_textures[0] = tex_in.get();
-        pipeline_state_vertical.clear_color[0]                  = state_color_dont_care;
-        pipeline_state_vertical.render_target_depth_texture     = use_stencil ? tex_depth : nullptr;
-        pipeline_state_vertical.clear_stencil                   = use_stencil ? state_stencil_load : state_stencil_dont_care;
-        pipeline_state_vertical.viewport                        = tex_in->GetViewport();
-        pipeline_state_vertical.primitive_topology              = RHI_PrimitiveTopology_TriangleList;
-        pipeline_state_vertical.pass_name                       = "Pass_BlurBilateralGaussian_Vertical";
+        pipeline_state_vertical.shader_vertex                            = shader_v.get();
+        pipeline_state_vertical.shader_pixel                             = shader_p.get();
+        pipeline_state_vertical.rasterizer_state                         = m_rasterizer_cull_back_solid.get();
+        pipeline_state_vertical.blend_state                              = m_blend_disabled.get();
+        pipeline_state_vertical.depth_stencil_state                      = use_stencil ? m_depth_stencil_off_on_r.get() : m_depth_stencil_off_off.get();
+        pipeline_state_vertical.vertex_buffer_stride                     = m_viewport_quad.GetVertexBuffer()->GetStride();
+        pipeline_state_vertical.render_target_color_textures[0]          = tex_in.get();
+        pipeline_state_vertical.clear_color[0]                           = state_color_dont_care;
+        pipeline_state_vertical.render_target_depth_texture              = use_stencil ? tex_depth : nullptr;
+        pipeline_state_vertical.render_target_depth_texture_read_only    = use_stencil;
+        pipeline_state_vertical.clear_stencil                            = use_stencil ? state_stencil_load : state_stencil_dont_care;
+        pipeline_state_vertical.viewport                                 = tex_in->GetViewport();
+        pipeline_state_vertical.primitive_topology                       = RHI_PrimitiveTopology_TriangleList;
+        pipeline_state_vertical.pass_name                                = "Pass_BlurBilateralGaussian_Vertical";
 
         // Record commands for vertical pass
         if (cmd_list->BeginRenderPass(pipeline_state_vertical))
@@ -1992,17 +2385,18 @@ namespace Spartan
             {
                 // Set render state
                 static RHI_PipelineState pipeline_state;
-                pipeline_state.shader_vertex                    = shader_color_v.get();
-                pipeline_state.shader_pixel                     = shader_color_p.get();
-                pipeline_state.rasterizer_state                 = m_rasterizer_cull_back_wireframe.get();
-                pipeline_state.blend_state                      = m_blend_alpha.get();
-                pipeline_state.depth_stencil_state              = m_depth_stencil_on_off_r.get();
-                pipeline_state.vertex_buffer_stride             = m_gizmo_grid->GetVertexBuffer()->GetStride();
-                pipeline_state.render_target_color_textures[0]  = tex_out.get();
-                pipeline_state.render_target_depth_texture      = m_render_targets[RenderTarget_Gbuffer_Depth].get();
-                pipeline_state.viewport                         = tex_out->GetViewport();
-                pipeline_state.primitive_topology               = RHI_PrimitiveTopology_LineList;
-                pipeline_state.pass_name                        = "Pass_Lines_Grid";
+                pipeline_state.shader_vertex                            = shader_color_v.get();
+                pipeline_state.shader_pixel                             = shader_color_p.get();
+                pipeline_state.rasterizer_state                         = m_rasterizer_cull_back_wireframe.get();
+                pipeline_state.blend_state                              = m_blend_alpha.get();
+                pipeline_state.depth_stencil_state                      = m_depth_stencil_on_off_r.get();
+                pipeline_state.vertex_buffer_stride                     = m_gizmo_grid->GetVertexBuffer()->GetStride();
+                pipeline_state.render_target_color_textures[0]          = tex_out.get();
+                pipeline_state.render_target_depth_texture              = m_render_targets[RenderTarget_Gbuffer_Depth].get();
+                pipeline_state.render_target_depth_texture_read_only    = true;
+                pipeline_state.viewport                                 = tex_out->GetViewport();
+                pipeline_state.primitive_topology                       = RHI_PrimitiveTopology_LineList;
+                pipeline_state.pass_name                                = "Pass_Lines_Grid";
 
                 // Create and submit command list
                 if (cmd_list->BeginRenderPass(pipeline_state))
@@ -2037,17 +2431,18 @@ namespace Spartan
 
                 // Set render state
                 static RHI_PipelineState pipeline_state;
-                pipeline_state.shader_vertex                    = shader_color_v.get();
-                pipeline_state.shader_pixel                     = shader_color_p.get();
-                pipeline_state.rasterizer_state                 = m_rasterizer_cull_back_wireframe.get();
-                pipeline_state.blend_state                      = m_blend_alpha.get();
-                pipeline_state.depth_stencil_state              = m_depth_stencil_on_off_r.get();
-                pipeline_state.vertex_buffer_stride             = m_vertex_buffer_lines->GetStride();
-                pipeline_state.render_target_color_textures[0]  = tex_out.get();
-                pipeline_state.render_target_depth_texture      = m_render_targets[RenderTarget_Gbuffer_Depth].get();
-                pipeline_state.viewport                         = tex_out->GetViewport();
-                pipeline_state.primitive_topology               = RHI_PrimitiveTopology_LineList;
-                pipeline_state.pass_name                        = "Pass_Lines";
+                pipeline_state.shader_vertex                            = shader_color_v.get();
+                pipeline_state.shader_pixel                             = shader_color_p.get();
+                pipeline_state.rasterizer_state                         = m_rasterizer_cull_back_wireframe.get();
+                pipeline_state.blend_state                              = m_blend_alpha.get();
+                pipeline_state.depth_stencil_state                      = m_depth_stencil_on_off_r.get();
+                pipeline_state.vertex_buffer_stride                     = m_vertex_buffer_lines->GetStride();
+                pipeline_state.render_target_color_textures[0]          = tex_out.get();
+                pipeline_state.render_target_depth_texture              = m_render_targets[RenderTarget_Gbuffer_Depth].get();
+                pipeline_state.render_target_depth_texture_read_only    = true;
+                pipeline_state.viewport                                 = tex_out->GetViewport();
+                pipeline_state.primitive_topology                       = RHI_PrimitiveTopology_LineList;
+                pipeline_state.pass_name                                = "Pass_Lines";
 
                 // Create and submit command list
                 if (cmd_list->BeginRenderPass(pipeline_state))
@@ -2332,7 +2727,7 @@ namespace Spartan
                 cmd_list->SetTexture(9, tex_normal);
                 cmd_list->SetBufferVertex(model->GetVertexBuffer());
                 cmd_list->SetBufferIndex(model->GetIndexBuffer());
-                cmd_list->DrawIndexed(renderable->GeometryIndexCount(), renderable->GeometryIndexOffset(), renderable->GeometryVertexOffset());
+                cmd_list->DrawIndexed(renderable->GeometryLodIndexCount(renderable->GetLod()), renderable->GeometryLodIndexOffset(renderable->GetLod()), renderable->GeometryVertexOffset());
                 cmd_list->EndRenderPass();
             }
         }
@@ -2493,6 +2888,26 @@ namespace Spartan
             shader_type = Shader_Texture_P;
         }
 
+        if (m_render_target_debug == RenderTarget_Occlusion)
+        {
+            // Uploaded from the CPU, only while it's being looked at
+            const vector<float>& closeness  = m_occlusion_buffer.GetDepth();
+            const float closeness_max       = Helper::Max(*max_element(closeness.begin(), closeness.end()), Helper::M_EPSILON);
+            vector<std::byte> data(closeness.size() * 4);
+            for (uint32_t i = 0; i < static_cast<uint32_t>(closeness.size()); i++)
+            {
+                const std::byte value   = static_cast<std::byte>(closeness[i] > 0.0f ? static_cast<uint8_t>(64.0f + 191.0f * (closeness[i] / closeness_max)) : 0);
+                data[i * 4 + 0]         = value;
+                data[i * 4 + 1]         = value;
+                data[i * 4 + 2]         = value;
+                data[i * 4 + 3]         = static_cast<std::byte>(255);
+            }
+
+            m_render_targets[RenderTarget_Occlusion] = make_shared<RHI_Texture2D>(m_context, OcclusionBuffer::width, OcclusionBuffer::height, RHI_Format_R8G8B8A8_Unorm, data);
+            texture     = m_render_targets[RenderTarget_Occlusion].get();
+            shader_type = Shader_Texture_P;
+        }
+
         // Acquire shaders
         RHI_Shader* shader_v = m_shaders[Shader_Quad_V].get();
         RHI_Shader* shader_p = m_shaders[shader_type].get();
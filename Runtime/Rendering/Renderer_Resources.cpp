@@ -24,6 +24,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Renderer.h"
 #include "ShaderGBuffer.h"
 #include "ShaderLight.h"
+#include "RenderGraph.h"
 #include "Font/Font.h"
 #include "../Resource/ResourceCache.h"
 #include "../RHI/RHI_Texture2D.h"
@@ -35,6 +36,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../RHI/RHI_DepthStencilState.h"
 #include "../RHI/RHI_SwapChain.h"
 #include "../RHI/RHI_CommandList.h"
+#include "../RHI/RHI_Implementation.h"
+#include "../Threading/Threading.h"
 //=======================================
 
 //= NAMESPACES ===============
@@ -46,7 +49,8 @@ namespace Spartan
 {
     void Renderer::CreateConstantBuffers()
     {
-        bool is_dynamic = true;
+        bool is_dynamic                 = true;
+        const uint32_t frame_count      = m_swap_chain->GetBufferCount(); // dynamic buffers get a region per frame in flight
 
         m_buffer_frame_gpu = make_shared<RHI_ConstantBuffer>(m_rhi_device, "frame");
         m_buffer_frame_gpu->Create<BufferFrame>();
@@ -55,13 +59,56 @@ namespace Spartan
         m_buffer_material_gpu->Create<BufferMaterial>();
 
         m_buffer_uber_gpu = make_shared<RHI_ConstantBuffer>(m_rhi_device, "uber", is_dynamic);
-        m_buffer_uber_gpu->Create<BufferUber>(64);
+        m_buffer_uber_gpu->Create<BufferUber>(64, frame_count);
 
         m_buffer_object_gpu = make_shared<RHI_ConstantBuffer>(m_rhi_device, "object", is_dynamic);
-        m_buffer_object_gpu->Create<BufferObject>();
+        m_buffer_object_gpu->Create<BufferObject>(64, frame_count);
+
+        m_buffer_instance_gpu = make_shared<RHI_ConstantBuffer>(m_rhi_device, "instance", is_dynamic);
+        m_buffer_instance_gpu->Create<BufferInstance>(16, frame_count);
 
         m_buffer_light_gpu = make_shared<RHI_ConstantBuffer>(m_rhi_device, "light");
         m_buffer_light_gpu->Create<BufferLight>();
+
+        m_buffer_lights_gpu = make_shared<RHI_ConstantBuffer>(m_rhi_device, "lights");
+        m_buffer_lights_gpu->Create<BufferLights>();
+
+        m_buffer_clusters_gpu = make_shared<RHI_ConstantBuffer>(m_rhi_device, "clusters");
+        m_buffer_clusters_gpu->Create<BufferClusters>();
+    }
+
+    void Renderer::CreateRecordingContexts()
+    {
+        // One context per thread which can record, the calling thread included
+        const bool parallel_recording   = m_rhi_device->GetContextRhi()->parallel_recording;
+        const uint32_t context_count    = parallel_recording ? Math::Helper::Clamp(m_threading->GetThreadCount() + 1, 1u, m_recording_context_max) : 1;
+        const uint32_t frame_count      = m_swap_chain->GetBufferCount();
+
+        m_recording_contexts.clear();
+        for (uint32_t i = 0; i < context_count; i++)
+        {
+            auto context = make_unique<RecordingContext>();
+
+            // Without parallel recording, everything goes into the main command list
+            if (parallel_recording)
+            {
+                for (uint32_t frame_index = 0; frame_index < frame_count; frame_index++)
+                {
+                    context->cmd_lists.emplace_back(make_shared<RHI_CommandList>(frame_index, nullptr, m_context));
+                }
+            }
+
+            context->buffer_uber_gpu = make_shared<RHI_ConstantBuffer>(m_rhi_device, "uber_recording", true);
+            context->buffer_uber_gpu->Create<BufferUber>(64, frame_count);
+
+            context->buffer_object_gpu = make_shared<RHI_ConstantBuffer>(m_rhi_device, "object_recording", true);
+            context->buffer_object_gpu->Create<BufferObject>(64, frame_count);
+
+            context->buffer_instance_gpu = make_shared<RHI_ConstantBuffer>(m_rhi_device, "instance_recording", true);
+            context->buffer_instance_gpu->Create<BufferInstance>(16, frame_count);
+
+            m_recording_contexts.emplace_back(move(context));
+        }
     }
 
     void Renderer::CreateDepthStencilStates()
@@ -116,43 +163,59 @@ namespace Spartan
 
         Flush();
 
+        // The render graph creates the render targets, the ones which are never alive at the same time share a texture
+        m_render_graph->RemoveTextures();
+        auto add = [this](const Renderer_RenderTarget_Type type, const uint32_t width, const uint32_t height, const RHI_Format format, const uint16_t flags, const char* name, const bool persistent = false, const bool output = false)
+        {
+            RenderGraph::TextureDesc desc;
+            desc.name       = name;
+            desc.width      = width;
+            desc.height     = height;
+            desc.format     = format;
+            desc.flags      = flags;
+            desc.persistent = persistent;
+            desc.output     = output;
+
+            m_render_graph->AddTexture(type, &m_render_targets[type], desc);
+        };
+
         // G-Buffer
         // Stencil is used to mask transparent objects and also has a read only version
         // From and below Texture_Format_R8G8B8A8_UNORM, normals have noticeable banding
-        m_render_targets[RenderTarget_Gbuffer_Albedo]   = make_shared<RHI_Texture2D>(m_context, width, height, RHI_Format_R8G8B8A8_Unorm,       1, 0,                                       "rt_gbuffer_albedo");
-        m_render_targets[RenderTarget_Gbuffer_Normal]   = make_shared<RHI_Texture2D>(m_context, width, height, RHI_Format_R16G16B16A16_Float,   1, 0,                                       "rt_gbuffer_normal");
-        m_render_targets[RenderTarget_Gbuffer_Material] = make_shared<RHI_Texture2D>(m_context, width, height, RHI_Format_R8G8B8A8_Unorm,       1, 0,                                       "rt_gbuffer_material");
-        m_render_targets[RenderTarget_Gbuffer_Velocity] = make_shared<RHI_Texture2D>(m_context, width, height, RHI_Format_R16G16_Float,         1, 0,                                       "rt_gbuffer_velocity");
-        m_render_targets[RenderTarget_Gbuffer_Depth]    = make_shared<RHI_Texture2D>(m_context, width, height, RHI_Format_D32_Float_S8X24_Uint, 1, RHI_Texture_DepthStencilViewReadOnly,    "gbuffer_depth");
+        add(RenderTarget_Gbuffer_Albedo,    width, height, RHI_Format_R8G8B8A8_Unorm,       0,                                      "rt_gbuffer_albedo");
+        add(RenderTarget_Gbuffer_Normal,    width, height, RHI_Format_R16G16B16A16_Float,   0,                                      "rt_gbuffer_normal");
+        add(RenderTarget_Gbuffer_Material,  width, height, RHI_Format_R8G8B8A8_Unorm,       0,                                      "rt_gbuffer_material");
+        add(RenderTarget_Gbuffer_Velocity,  width, height, RHI_Format_R16G16_Float,         0,                                      "rt_gbuffer_velocity");
+        add(RenderTarget_Gbuffer_Depth,     width, height, RHI_Format_D32_Float_S8X24_Uint, RHI_Texture_DepthStencilViewReadOnly,   "gbuffer_depth");
 
         // Light
-        m_render_targets[RenderTarget_Light_Diffuse]    = make_unique<RHI_Texture2D>(m_context, width, height, RHI_Format_R11G11B10_Float, 1, 0, "rt_light_diffuse");
-        m_render_targets[RenderTarget_Light_Specular]   = make_unique<RHI_Texture2D>(m_context, width, height, RHI_Format_R11G11B10_Float, 1, 0, "rt_light_specular");
-        m_render_targets[RenderTarget_Light_Volumetric] = make_unique<RHI_Texture2D>(m_context, width, height, RHI_Format_R11G11B10_Float, 1, 0, "rt_light_volumetric");
+        add(RenderTarget_Light_Diffuse,     width, height, RHI_Format_R11G11B10_Float, 0, "rt_light_diffuse");
+        add(RenderTarget_Light_Specular,    width, height, RHI_Format_R11G11B10_Float, 0, "rt_light_specular");
+        add(RenderTarget_Light_Volumetric,  width, height, RHI_Format_R11G11B10_Float, 0, "rt_light_volumetric");
 
-        // BRDF Specular Lut
-        m_render_targets[RenderTarget_Brdf_Specular_Lut] = make_unique<RHI_Texture2D>(m_context, 400, 400, RHI_Format_R8G8_Unorm, 1, 0, "rt_brdf_specular_lut");
+        // BRDF Specular Lut, rendered once
+        add(RenderTarget_Brdf_Specular_Lut, 400, 400, RHI_Format_R8G8_Unorm, 0, "rt_brdf_specular_lut", true);
         m_brdf_specular_lut_rendered = false;
 
-        // Main HDR and LDR textures with secondary copies (necessary for ping-ponging during post-processing)
-        m_render_targets[RenderTarget_Hdr]      = make_unique<RHI_Texture2D>(m_context, width, height, RHI_Format_R16G16B16A16_Float, 1, 0, "rt_hdr");  // Investigate using less bits but have an alpha channel
-        m_render_targets[RenderTarget_Ldr]      = make_unique<RHI_Texture2D>(m_context, width, height, RHI_Format_R16G16B16A16_Float, 1, 0, "rt_ldr");  // Investigate using less bits but have an alpha channel
-        m_render_targets[RenderTarget_Hdr_2]    = make_unique<RHI_Texture2D>(m_context, width, height, RHI_Format_R16G16B16A16_Float, 1, 0, "rt_hdr2"); // Investigate using less bits but have an alpha channel
-        m_render_targets[RenderTarget_Ldr_2]    = make_unique<RHI_Texture2D>(m_context, width, height, RHI_Format_R16G16B16A16_Float, 1, 0, "rt_ldr2"); // Investigate using less bits but have an alpha channel
+        // Main HDR and LDR textures with secondary copies (necessary for ping-ponging during post-processing), the frame ends up in either of the LDR ones
+        add(RenderTarget_Hdr,   width, height, RHI_Format_R16G16B16A16_Float, 0, "rt_hdr");                  // Investigate using less bits but have an alpha channel
+        add(RenderTarget_Ldr,   width, height, RHI_Format_R16G16B16A16_Float, 0, "rt_ldr", false, true);     // Investigate using less bits but have an alpha channel
+        add(RenderTarget_Hdr_2, width, height, RHI_Format_R16G16B16A16_Float, 0, "rt_hdr2");                 // Investigate using less bits but have an alpha channel
+        add(RenderTarget_Ldr_2, width, height, RHI_Format_R16G16B16A16_Float, 0, "rt_ldr2", false, true);    // Investigate using less bits but have an alpha channel
 
          // Depth of Field
-        m_render_targets[RenderTarget_Dof_Half]     = make_unique<RHI_Texture2D>(m_context, width * 0.5f, height * 0.5f, RHI_Format_R16G16B16A16_Float, 1, 0, "rt_dof_half");   // Investigate using less bits but have an alpha channel
-        m_render_targets[RenderTarget_Dof_Half_2]   = make_unique<RHI_Texture2D>(m_context, width * 0.5f, height * 0.5f, RHI_Format_R16G16B16A16_Float, 1, 0, "rt_dof_half_2"); // Investigate using less bits but have an alpha channel
+        add(RenderTarget_Dof_Half,      width / 2, height / 2, RHI_Format_R16G16B16A16_Float, 0, "rt_dof_half");     // Investigate using less bits but have an alpha channel
+        add(RenderTarget_Dof_Half_2,    width / 2, height / 2, RHI_Format_R16G16B16A16_Float, 0, "rt_dof_half_2");   // Investigate using less bits but have an alpha channel
 
         // TAA
-        m_render_targets[RenderTarget_TaaHistory] = make_unique<RHI_Texture2D>(m_context, width, height, RHI_Format_R16G16B16A16_Float, 1, 0, "rt_taa_history");
+        add(RenderTarget_TaaHistory, width, height, RHI_Format_R16G16B16A16_Float, 0, "rt_taa_history");
 
         // HBAO + Indirect bounce
-        m_render_targets[RenderTarget_Hbao_Noisy]   = make_unique<RHI_Texture2D>(m_context, static_cast<uint32_t>(width), static_cast<uint32_t>(height), RHI_Format_R16G16B16A16_Float, 1, 0, "rt_hbao_noisy");
-        m_render_targets[RenderTarget_Hbao]         = make_unique<RHI_Texture2D>(m_context, static_cast<uint32_t>(width), static_cast<uint32_t>(height), RHI_Format_R16G16B16A16_Float, 1, 0, "rt_hbao");
+        add(RenderTarget_Hbao_Noisy,    width, height, RHI_Format_R16G16B16A16_Float, 0, "rt_hbao_noisy");
+        add(RenderTarget_Hbao,          width, height, RHI_Format_R16G16B16A16_Float, 0, "rt_hbao");
 
         // SSR
-        m_render_targets[RenderTarget_Ssr] = make_shared<RHI_Texture2D>(m_context, width, height, RHI_Format_R16G16_Float, 1, RHI_Texture_UnorderedAccessView, "rt_ssr");
+        add(RenderTarget_Ssr, width, height, RHI_Format_R16G16_Float, RHI_Texture_UnorderedAccessView, "rt_ssr");
 
         // Bloom
         {
@@ -172,6 +235,10 @@ namespace Spartan
                 );
             }
         }
+
+        // Compiled right away, so that the render targets are bound before the first frame (the pipeline warm-up looks them up)
+        RenderGraphBuild(!m_entities[Renderer_Object_Transparent].empty());
+        m_render_graph->Compile();
     }
 
     void Renderer::CreateShaders()
@@ -196,6 +263,9 @@ namespace Spartan
         m_shaders[Shader_Depth_V]->CompileAsync<RHI_Vertex_PosTex>(RHI_Shader_Vertex, dir_shaders + "Depth.hlsl");
         m_shaders[Shader_Depth_P] = make_shared<RHI_Shader>(m_context);
         m_shaders[Shader_Depth_P]->CompileAsync(RHI_Shader_Pixel, dir_shaders + "Depth.hlsl");
+        m_shaders[Shader_DepthCopy_P] = make_shared<RHI_Shader>(m_context);
+        m_shaders[Shader_DepthCopy_P]->AddDefine("DEPTH_COPY");
+        m_shaders[Shader_DepthCopy_P]->CompileAsync(RHI_Shader_Pixel, dir_shaders + "Depth.hlsl");
 
         // BRDF - Specular Lut
         m_shaders[Shader_BrdfSpecularLut] = make_shared<RHI_Shader>(m_context);
@@ -33,23 +33,48 @@ using namespace std;
 namespace Spartan
 {
 	unordered_map<uint16_t, shared_ptr<ShaderGBuffer>> ShaderGBuffer::m_variations;
+    mutex ShaderGBuffer::m_mutex;
 
 	ShaderGBuffer::ShaderGBuffer(Context* context, const uint16_t flags /*= 0*/) : RHI_Shader(context)
 	{
         m_flags = flags;
 	}
 
-    const ShaderGBuffer* ShaderGBuffer::GenerateVariation(Context* context, const uint16_t flags)
+    ShaderGBuffer* ShaderGBuffer::GenerateVariation(Context* context, const uint16_t flags, const bool async /*= true*/)
     {
         // Return existing shader, if it's already compiled
-        if (m_variations.find(flags) != m_variations.end())
-            return m_variations.at(flags).get();
+        if (ShaderGBuffer* shader = GetVariation(flags))
+            return shader;
 
         // Compile new shader
-        return Compile(context, flags);
+        return Compile(context, flags, async);
     }
 
-    ShaderGBuffer* ShaderGBuffer::Compile(Context* context, const uint16_t flags)
+    ShaderGBuffer* ShaderGBuffer::GetVariation(const uint16_t flags)
+    {
+        lock_guard<mutex> lock(m_mutex);
+
+        const auto it = m_variations.find(flags);
+        return it != m_variations.end() ? it->second.get() : nullptr;
+    }
+
+    bool ShaderGBuffer::GetVariationFlags(const RHI_Shader* shader, uint16_t* flags)
+    {
+        lock_guard<mutex> lock(m_mutex);
+
+        for (const auto& it : m_variations)
+        {
+            if (it.second.get() == shader)
+            {
+                *flags = it.first;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    ShaderGBuffer* ShaderGBuffer::Compile(Context* context, const uint16_t flags, const bool async)
 	{
         // Shader source file path
         string file_path = context->GetSubsystem<ResourceCache>()->GetDataDirectory(Asset_Shaders) + "/GBuffer.hlsl";
@@ -67,11 +92,26 @@ namespace Spartan
         shader->AddDefine("EMISSION_MAP",   (flags & Material_Emission)   ? "1" : "0");
         shader->AddDefine("MASK_MAP",       (flags & Material_Mask)       ? "1" : "0");
 
-        // Compile
-        shader->CompileAsync(RHI_Shader_Pixel, file_path);
+        // Save, unless another thread got there first
+        {
+            lock_guard<mutex> lock(m_mutex);
 
-        // Save
-        m_variations[flags] = shader;
+            const auto it = m_variations.find(flags);
+            if (it != m_variations.end())
+                return it->second.get();
+
+            m_variations[flags] = shader;
+        }
+
+        // Compile
+        if (async)
+        {
+            shader->CompileAsync(RHI_Shader_Pixel, file_path);
+        }
+        else
+        {
+            shader->RHI_Shader::Compile(RHI_Shader_Pixel, file_path);
+        }
 
         return shader.get();
 	}
@@ -23,6 +23,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //= INCLUDES =====================
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include "../RHI/RHI_Definition.h"
 #include "../RHI/RHI_Shader.h"
@@ -38,13 +39,18 @@ namespace Spartan
         
         bool IsSuitable(const uint16_t flags)  { return m_flags == flags; }
 
-        static const ShaderGBuffer* GenerateVariation(Context* context, const uint16_t flags);
+        // Compiles on a worker thread, unless async is false, in which case it compiles on the calling thread
+        static ShaderGBuffer* GenerateVariation(Context* context, const uint16_t flags, const bool async = true);
+        static ShaderGBuffer* GetVariation(const uint16_t flags);
+        // Finds the flags of a variation, returns false if the shader isn't one
+        static bool GetVariationFlags(const RHI_Shader* shader, uint16_t* flags);
         static const auto& GetVariations() { return m_variations; }
 
 	private:
-        static ShaderGBuffer* Compile(Context* context, const uint16_t flags);
+        static ShaderGBuffer* Compile(Context* context, const uint16_t flags, const bool async);
 
         uint16_t m_flags = 0;
         static std::unordered_map<uint16_t, std::shared_ptr<ShaderGBuffer>> m_variations;
+        static std::mutex m_mutex;
 	};
 }
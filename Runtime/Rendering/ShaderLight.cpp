@@ -34,6 +34,7 @@ using namespace std;
 namespace Spartan
 {
     unordered_map<uint16_t, shared_ptr<ShaderLight>> ShaderLight::m_variations;
+    mutex ShaderLight::m_mutex;
 
     ShaderLight::ShaderLight(Context* context, const uint16_t flags /*= 0*/) : RHI_Shader(context)
     {
@@ -42,7 +43,31 @@ namespace Spartan
 
     ShaderLight* ShaderLight::GetVariation(Context* context, const Light* light, const uint64_t renderer_flags)
     {
-        // Compute flags
+        return GenerateVariation(context, ComputeFlags(light, renderer_flags));
+    }
+
+    ShaderLight* ShaderLight::GetVariationClustered(Context* context, const uint64_t renderer_flags, const bool add_reflections)
+    {
+        return GenerateVariation(context, ComputeFlagsClustered(renderer_flags, add_reflections));
+    }
+
+    ShaderLight* ShaderLight::GenerateVariation(Context* context, const uint16_t flags, const bool async /*= true*/)
+    {
+        // Return existing shader, if it's already compiled
+        {
+            lock_guard<mutex> lock(m_mutex);
+
+            const auto it = m_variations.find(flags);
+            if (it != m_variations.end())
+                return it->second.get();
+        }
+
+        // Compile new shader
+        return Compile(context, flags, async);
+    }
+
+    uint16_t ShaderLight::ComputeFlags(const Light* light, const uint64_t renderer_flags)
+    {
         uint16_t flags = 0;
         flags |= light->GetLightType() == LightType::Directional                                            ? Shader_Light_Directional              : flags;
         flags |= light->GetLightType() == LightType::Point                                                  ? Shader_Light_Point                    : flags;
@@ -53,15 +78,34 @@ namespace Spartan
         flags |= (light->GetVolumetricEnabled() && (renderer_flags & Render_VolumetricLighting))            ? Shader_Light_Volumetric               : flags;
         flags |= (renderer_flags & Render_ScreenSpaceReflections)                                           ? Shader_Light_ScreenSpaceReflections   : flags;
 
-        // Return existing shader, if it's already compiled
-        if (m_variations.find(flags) != m_variations.end())
-            return m_variations.at(flags).get();
+        return flags;
+    }
 
-        // Compile new shader
-        return Compile(context, flags);
+    uint16_t ShaderLight::ComputeFlagsClustered(const uint64_t renderer_flags, const bool add_reflections)
+    {
+        uint16_t flags = Shader_Light_Clustered;
+        flags |= (add_reflections && (renderer_flags & Render_ScreenSpaceReflections)) ? Shader_Light_ScreenSpaceReflections : flags;
+
+        return flags;
+    }
+
+    bool ShaderLight::GetVariationFlags(const RHI_Shader* shader, uint16_t* flags)
+    {
+        lock_guard<mutex> lock(m_mutex);
+
+        for (const auto& it : m_variations)
+        {
+            if (it.second.get() == shader)
+            {
+                *flags = it.first;
+                return true;
+            }
+        }
+
+        return false;
     }
 
-    ShaderLight* ShaderLight::Compile(Context* context, const uint16_t flags)
+    ShaderLight* ShaderLight::Compile(Context* context, const uint16_t flags, const bool async)
     {
         // Shader source file path
         string file_path = context->GetSubsystem<ResourceCache>()->GetDataDirectory(Asset_Shaders) + "/Light.hlsl";
@@ -78,12 +122,28 @@ namespace Spartan
         shader->AddDefine("SHADOWS_TRANSPARENT",        (flags & Shader_Light_ShadowsTransparent)       ? "1" : "0");
         shader->AddDefine("VOLUMETRIC",                 (flags & Shader_Light_Volumetric)               ? "1" : "0");
         shader->AddDefine("SCREEN_SPACE_REFLECTIONS",   (flags & Shader_Light_ScreenSpaceReflections)   ? "1" : "0");
+        shader->AddDefine("CLUSTERED",                  (flags & Shader_Light_Clustered)                ? "1" : "0");
 
-        // Compile
-        shader->CompileAsync(RHI_Shader_Pixel, file_path);
+        // Save, unless another thread got there first
+        {
+            lock_guard<mutex> lock(m_mutex);
 
-        // Save
-        m_variations[flags] = shader;
+            const auto it = m_variations.find(flags);
+            if (it != m_variations.end())
+                return it->second.get();
+
+            m_variations[flags] = shader;
+        }
+
+        // Compile
+        if (async)
+        {
+            shader->CompileAsync(RHI_Shader_Pixel, file_path);
+        }
+        else
+        {
+            shader->RHI_Shader::Compile(RHI_Shader_Pixel, file_path);
+        }
 
         return shader.get();
     }
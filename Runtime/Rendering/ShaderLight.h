@@ -23,6 +23,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //= INCLUDES =====================
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include "../RHI/RHI_Definition.h"
 #include "../RHI/RHI_Shader.h"
@@ -42,7 +43,8 @@ namespace Spartan
         Shader_Light_ShadowsScreenSpace     = 1 << 4,
         Shader_Light_ShadowsTransparent     = 1 << 5,
         Shader_Light_Volumetric             = 1 << 6,
-        Shader_Light_ScreenSpaceReflections = 1 << 7
+        Shader_Light_ScreenSpaceReflections = 1 << 7,
+        Shader_Light_Clustered              = 1 << 8
     };
 
     class SPARTAN_CLASS ShaderLight : public RHI_Shader
@@ -52,12 +54,21 @@ namespace Spartan
         ~ShaderLight() = default;
 
         static ShaderLight* GetVariation(Context* context, const Light* light, const uint64_t renderer_flags);
+        // Shades every light of the pixel's cluster in a single pass, reflections are added when add_reflections is true
+        static ShaderLight* GetVariationClustered(Context* context, const uint64_t renderer_flags, const bool add_reflections);
+        // Compiles on a worker thread, unless async is false, in which case it compiles on the calling thread
+        static ShaderLight* GenerateVariation(Context* context, const uint16_t flags, const bool async = true);
+        static uint16_t ComputeFlags(const Light* light, const uint64_t renderer_flags);
+        static uint16_t ComputeFlagsClustered(const uint64_t renderer_flags, const bool add_reflections);
+        // Finds the flags of a variation, returns false if the shader isn't one
+        static bool GetVariationFlags(const RHI_Shader* shader, uint16_t* flags);
         static auto& GetVariations() { return m_variations; }
 
     private:
-        static ShaderLight* Compile(Context* context, const uint16_t flags);
+        static ShaderLight* Compile(Context* context, const uint16_t flags, const bool async);
 
         uint16_t m_flags = 0;
         static std::unordered_map<uint16_t, std::shared_ptr<ShaderLight>> m_variations;
+        static std::mutex m_mutex;
     };
 }
@@ -44,7 +44,6 @@ namespace Spartan::freeimage_helper
 		uint32_t height		    = 0;
 		uint32_t channel_count	= 0;
 		vector<std::byte>* data	= nullptr;
-		bool done			    = false;
 
 		RescaleJob(const uint32_t width, const uint32_t height, const uint32_t channel_count)
 		{
@@ -288,34 +287,21 @@ namespace Spartan
 		}
 
 		// Parallelize mipmap generation using multiple threads (because FreeImage_Rescale() using FILTER_LANCZOS3 is expensive)
-		auto threading = m_context->GetSubsystem<Threading>();
-		for (auto& job : jobs)
+		// One mip per chunk, since the work per mip is very uneven (each mip is a quarter of the previous one)
+		m_context->GetSubsystem<Threading>()->ParallelFor(static_cast<uint32_t>(jobs.size()), 1, [this, &jobs, &bitmap](uint32_t start, uint32_t end)
 		{
-			threading->AddTask([this, &job, &bitmap]()
+			for (uint32_t i = start; i < end; i++)
 			{
+				freeimage_helper::RescaleJob& job = jobs[i];
+
 				const auto bitmap_scaled = FreeImage_Rescale(bitmap, job.width, job.height, freeimage_helper::rescale_filter);
 				if (!GetBitsFromFibitmap(job.data, bitmap_scaled, job.width, job.height, job.channel_count))
 				{
 					LOG_ERROR("Failed to create mip level %dx%d", job.width, job.height);
 				}
 				FreeImage_Unload(bitmap_scaled);
-				job.done = true;
-			});
-		}
-
-		// Wait until all mipmaps have been generated
-		auto ready = false;
-		while (!ready)
-		{
-			ready = true;
-			for (const auto& job : jobs)
-			{
-				if (!job.done)
-				{
-					ready = false;
-				}
 			}
-		}
+		});
 	}
 
 	FIBITMAP* ImageImporter::ApplyBitmapCorrections(FIBITMAP* bitmap) const
@@ -338,6 +338,9 @@ namespace Spartan
 		uint32_t vertex_offset;
         params.model->AppendGeometry(move(indices), move(vertices), &index_offset, &vertex_offset);
 
+        // Generate simplified versions of it, to be drawn when it's small on screen
+        params.model->GeometryGenerateLods(indices, vertices, index_offset);
+
 		// Add a renderable component to this entity
 		auto renderable	= entity_parent->AddComponent<Renderable>();
 
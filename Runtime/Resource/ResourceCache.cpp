@@ -44,14 +44,18 @@ namespace Spartan
 {
 	ResourceCache::ResourceCache(Context* context) : ISubsystem(context)
 	{
+        SetTickDependencies(Subsystem_Data_None, Subsystem_Data_None, true);
+
         const string data_dir = "Data/";
 
 		// Add engine standard resource directories
 		AddDataDirectory(Asset_Cubemaps,		data_dir + "environment");
 		AddDataDirectory(Asset_Fonts,			data_dir + "fonts");
 		AddDataDirectory(Asset_Icons,			data_dir + "icons");
+		AddDataDirectory(Asset_PipelineCache,	data_dir + "pipeline_cache");
 		AddDataDirectory(Asset_Scripts,			data_dir + "scripts");
 		AddDataDirectory(Asset_ShaderCompiler,	data_dir + "shader_compiler");	
+		AddDataDirectory(Asset_ShaderCache,		data_dir + "shader_cache");
 		AddDataDirectory(Asset_Shaders,			data_dir + "shaders");
 		AddDataDirectory(Asset_Textures,		data_dir + "textures");
 
@@ -39,8 +39,10 @@ namespace Spartan
 		Asset_Cubemaps,
 		Asset_Fonts,
 		Asset_Icons,
+		Asset_PipelineCache,
 		Asset_Scripts,
 		Asset_ShaderCompiler,
+		Asset_ShaderCache,
 		Asset_Shaders,
 		Asset_Textures
 	};
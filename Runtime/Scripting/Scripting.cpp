@@ -30,6 +30,8 @@ namespace Spartan
 {
 	Scripting::Scripting(Context* context) : ISubsystem(context)
 	{
+        SetTickDependencies(Subsystem_Data_None, Subsystem_Data_None, true);
+
 		// Subscribe to events
 		SUBSCRIBE_TO_EVENT(EventType::WorldUnload, EVENT_HANDLER(Clear));
 	}
@@ -30,16 +30,101 @@ using namespace std;
 
 namespace Spartan
 {
+    // Index of the queue owned by the calling thread, threads which weren't created by the subsystem don't own one
+    static const uint32_t queue_index_none = numeric_limits<uint32_t>::max();
+    static thread_local uint32_t queue_index_current = queue_index_none;
+
+    bool TaskDeque::Push(Task* task)
+    {
+        const int64_t bottom    = m_bottom.load(memory_order_relaxed);
+        const int64_t top       = m_top.load(memory_order_acquire);
+
+        // Full
+        if (bottom - top >= capacity)
+            return false;
+
+        m_tasks[bottom & (capacity - 1)].store(task, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        m_bottom.store(bottom + 1, memory_order_relaxed);
+
+        return true;
+    }
+
+    Task* TaskDeque::Pop()
+    {
+        const int64_t bottom = m_bottom.load(memory_order_relaxed) - 1;
+        m_bottom.store(bottom, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        int64_t top = m_top.load(memory_order_relaxed);
+
+        // Empty
+        if (top > bottom)
+        {
+            m_bottom.store(bottom + 1, memory_order_relaxed);
+            return nullptr;
+        }
+
+        Task* task = m_tasks[bottom & (capacity - 1)].load(memory_order_relaxed);
+
+        // Last task, race against thieves for it
+        if (top == bottom)
+        {
+            if (!m_top.compare_exchange_strong(top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+            {
+                task = nullptr;
+            }
+
+            m_bottom.store(bottom + 1, memory_order_relaxed);
+        }
+
+        return task;
+    }
+
+    Task* TaskDeque::Steal()
+    {
+        int64_t top = m_top.load(memory_order_acquire);
+        atomic_thread_fence(memory_order_seq_cst);
+        const int64_t bottom = m_bottom.load(memory_order_acquire);
+
+        // Empty
+        if (top >= bottom)
+            return nullptr;
+
+        Task* task = m_tasks[top & (capacity - 1)].load(memory_order_relaxed);
+
+        // Lost the race against the owner or another thief
+        if (!m_top.compare_exchange_strong(top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+            return nullptr;
+
+        return task;
+    }
+
+    template <typename Condition>
+    void Threading::Sleep(Condition&& wake_condition)
+    {
+        unique_lock<mutex> lock(m_mutex_sleep);
+        m_threads_sleeping.fetch_add(1);
+        m_condition_var.wait(lock, wake_condition);
+        m_threads_sleeping.fetch_sub(1);
+    }
+
 	Threading::Threading(Context* context) : ISubsystem(context)
 	{
-		m_stopping	                            = false;
+        SetTickDependencies(Subsystem_Data_None, Subsystem_Data_None, true);
         m_thread_count_support                  = thread::hardware_concurrency();
 		m_thread_count                          = m_thread_count_support - 1; // exclude the main (this) thread
         m_thread_names[this_thread::get_id()]   = "main";
 
+        // Create a queue for every thread, including this one
+        for (uint32_t i = 0; i < m_thread_count + 1; i++)
+        {
+            m_queues.emplace_back(make_unique<TaskQueue>());
+        }
+        queue_index_current = 0;
+
 		for (uint32_t i = 0; i < m_thread_count; i++)
 		{
-			m_threads.emplace_back(thread(&Threading::ThreadLoop, this));
+			m_threads.emplace_back(thread(&Threading::ThreadLoop, this, i + 1));
             m_thread_names[m_threads.back().get_id()] = "worker_" + to_string(i);
 		}
 
@@ -50,14 +135,11 @@ namespace Spartan
     {
         Flush(true);
 
-        // Put unique lock on task mutex.
-        unique_lock<mutex> lock(m_mutex_tasks);
-
         // Set termination flag to true.
-        m_stopping = true;
-
-        // Unlock the mutex
-        lock.unlock();
+        {
+            lock_guard<mutex> lock(m_mutex_sleep);
+            m_stopping = true;
+        }
 
         // Wake up all threads.
         m_condition_var.notify_all();
@@ -72,16 +154,26 @@ namespace Spartan
         m_threads.clear();
     }
 
-    uint32_t Threading::GetThreadsAvailable() const
+    void Threading::Wait(const TaskCounter& counter)
     {
-        uint32_t available_threads = m_thread_count;
-
-        for (const auto& task : m_tasks)
+        while (!counter.IsDone())
         {
-            available_threads -= task->IsExecuting() ? 1 : 0;
+            // Help out instead of blocking
+            if (Task* task = AcquireTask())
+            {
+                ExecuteTask(task);
+                continue;
+            }
+
+            Sleep([this, &counter] { return counter.IsDone() || m_tasks_pending.load() != 0; });
         }
+    }
 
-        return available_threads;
+    uint32_t Threading::GetThreadsAvailable() const
+    {
+        // The running count can include threads which help out while waiting, so clamp it
+        const uint32_t tasks_running = m_tasks_running.load();
+        return tasks_running < m_thread_count ? m_thread_count - tasks_running : 0;
     }
 
     void Threading::Flush(bool removed_queued /*= false*/)
@@ -89,42 +181,209 @@ namespace Spartan
         // Clear any queued tasks
         if (removed_queued)
         {
-            m_tasks.clear();
+            for (auto& queue : m_queues)
+            {
+                while (Task* task = queue->deque.Steal())
+                {
+                    DiscardTask(task);
+                }
+            }
+
+            lock_guard<mutex> lock(m_mutex_tasks_external);
+            while (!m_tasks_external.empty())
+            {
+                DiscardTask(m_tasks_external.front());
+                m_tasks_external.pop_front();
+                m_tasks_external_count.fetch_sub(1);
+            }
         }
 
-        // If so, wait for them
+        // Help out with any queued tasks and wait for the running ones
+        m_threads_flushing.fetch_add(1);
         while (AreTasksRunning())
         {
-            std::this_thread::sleep_for(std::chrono::milliseconds(16));
+            if (Task* task = AcquireTask())
+            {
+                ExecuteTask(task);
+                continue;
+            }
+
+            Sleep([this] { return m_tasks_pending.load() != 0 || m_tasks_running.load() == 0; });
         }
+        m_threads_flushing.fetch_sub(1);
     }
 
-    void Threading::ThreadLoop()
+    void Threading::ThreadLoop(const uint32_t queue_index)
     {
-        shared_ptr<Task> task;
+        queue_index_current = queue_index;
+
         while (true)
         {
-            // Lock tasks mutex
-            unique_lock<mutex> lock(m_mutex_tasks);
+            if (Task* task = AcquireTask())
+            {
+                ExecuteTask(task);
+                continue;
+            }
 
-            // Check condition on notification
-            m_condition_var.wait(lock, [this] { return !m_tasks.empty() || m_stopping; });
+            // Nothing to do, sleep until a task is submitted
+            Sleep([this] { return m_tasks_pending.load() != 0 || m_stopping.load(); });
 
             // If m_stopping is true, it's time to shut everything down
-            if (m_stopping && m_tasks.empty())
+            if (m_stopping.load() && m_tasks_pending.load() == 0)
                 return;
+        }
+    }
 
-            // Get next task in the queue.
-            task = m_tasks.front();
+    Task* Threading::AllocateTask()
+    {
+        // Take a free slot from the pool of the calling thread
+        if (queue_index_current < m_queues.size())
+        {
+            TaskQueue* queue = m_queues[queue_index_current].get();
+
+            for (uint32_t i = 0; i < TaskQueue::pool_probes; i++)
+            {
+                Task* task          = &queue->pool[queue->pool_index];
+                queue->pool_index   = (queue->pool_index + 1) % TaskQueue::pool_size;
 
-            // Remove it from the queue.
-            m_tasks.pop_front();
+                if (!task->m_in_use.load(memory_order_acquire))
+                {
+                    task->m_in_use.store(true, memory_order_relaxed);
+                    return task;
+                }
+            }
+        }
 
-            // Unlock the mutex
-            lock.unlock();
+        // The pool is exhausted (or the calling thread doesn't own one), fall back to the heap
+        Task* task                  = new Task();
+        task->m_is_heap_allocated   = true;
+        return task;
+    }
 
-            // Execute the task.
-            task->Execute();
+    void Threading::Submit(Task* task)
+    {
+        // Count it before it becomes visible, so that whoever picks it up can't underflow the counter
+        m_tasks_pending.fetch_add(1);
+
+        const bool pushed = queue_index_current < m_queues.size() && m_queues[queue_index_current]->deque.Push(task);
+        if (!pushed)
+        {
+            lock_guard<mutex> lock(m_mutex_tasks_external);
+            m_tasks_external.push_back(task);
+            m_tasks_external_count.fetch_add(1);
+        }
+
+        WakeUp(false);
+    }
+
+    Task* Threading::AcquireTask()
+    {
+        const uint32_t queue_count  = static_cast<uint32_t>(m_queues.size());
+        const uint32_t queue_index  = queue_index_current;
+        Task* task                  = nullptr;
+
+        // Own queue first
+        if (queue_index < queue_count)
+        {
+            task = m_queues[queue_index]->deque.Pop();
+        }
+
+        // Then tasks submitted by external threads
+        if (!task && m_tasks_external_count.load() != 0)
+        {
+            lock_guard<mutex> lock(m_mutex_tasks_external);
+            if (!m_tasks_external.empty())
+            {
+                task = m_tasks_external.front();
+                m_tasks_external.pop_front();
+                m_tasks_external_count.fetch_sub(1);
+            }
+        }
+
+        // Then steal from the other queues, starting from the next one so that thieves spread out
+        if (!task)
+        {
+            const uint32_t start = queue_index < queue_count ? queue_index + 1 : 0;
+            for (uint32_t i = 0; i < queue_count && !task; i++)
+            {
+                const uint32_t victim = (start + i) % queue_count;
+                if (victim != queue_index)
+                {
+                    task = m_queues[victim]->deque.Steal();
+                }
+            }
+        }
+
+        if (task)
+        {
+            // Mark as running before it stops being pending, so that Flush() never sees a gap
+            m_tasks_running.fetch_add(1);
+            m_tasks_pending.fetch_sub(1);
+        }
+
+        return task;
+    }
+
+    void Threading::ExecuteTask(Task* task)
+    {
+        task->Execute();
+
+        TaskCounter* counter = task->GetCounter();
+        ReleaseTask(task);
+
+        const bool counter_done = counter && counter->Decrement();
+        const bool idle         = m_tasks_running.fetch_sub(1) == 1 && m_tasks_pending.load() == 0 && m_threads_flushing.load() != 0;
+
+        // Wake up anyone waiting on the counter or on a flush
+        if (counter_done || idle)
+        {
+            WakeUp(true);
+        }
+    }
+
+    void Threading::ReleaseTask(Task* task)
+    {
+        task->Reset();
+
+        if (task->m_is_heap_allocated)
+        {
+            delete task;
+        }
+        else
+        {
+            task->m_in_use.store(false, memory_order_release);
+        }
+    }
+
+    void Threading::DiscardTask(Task* task)
+    {
+        TaskCounter* counter = task->GetCounter();
+        ReleaseTask(task);
+        m_tasks_pending.fetch_sub(1);
+
+        if (counter && counter->Decrement())
+        {
+            WakeUp(true);
+        }
+    }
+
+    void Threading::WakeUp(const bool all)
+    {
+        if (m_threads_sleeping.load() == 0)
+            return;
+
+        // Acquire the lock so that a thread which is about to sleep can't miss the notification
+        {
+            lock_guard<mutex> lock(m_mutex_sleep);
+        }
+
+        if (all)
+        {
+            m_condition_var.notify_all();
+        }
+        else
+        {
+            m_condition_var.notify_one();
         }
     }
 }
@@ -21,33 +21,106 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #pragma once
 
-//= INCLUDES ==================
+//= INCLUDES ===================
 #include <vector>
+#include <algorithm>
 #include <thread>
 #include <mutex>
 #include <deque>
+#include <atomic>
+#include <array>
+#include <memory>
+#include <condition_variable>
 #include <unordered_map>
-#include <functional>
+#include <cstddef>
+#include <type_traits>
 #include "../Logging/Log.h"
 #include "../Core/ISubsystem.h"
-//=============================
+//==============================
 
 namespace Spartan
 {
+    // A counter which tasks decrement when they complete, it can be waited on via Threading::Wait()
+    class TaskCounter
+    {
+    public:
+        TaskCounter() = default;
+        TaskCounter(const TaskCounter&) = delete;
+        TaskCounter& operator=(const TaskCounter&) = delete;
+
+        void Increment(const uint32_t count = 1)    { m_value.fetch_add(count); }
+        bool Decrement()                            { return m_value.fetch_sub(1) == 1; } // returns true when the counter reaches zero
+        uint32_t GetValue()                   const { return m_value.load(); }
+        bool IsDone()                         const { return m_value.load() == 0; }
+
+    private:
+        std::atomic<uint32_t> m_value = 0;
+    };
+
 	class Task
 	{
 	public:
-		typedef std::function<void()> function_type;
+        // Callables which fit in here are stored in place, larger ones fall back to the heap
+        static constexpr size_t storage_size = 64;
+
+        Task() = default;
+        ~Task() { Reset(); }
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
 
-		Task(function_type&& function)  { m_function = std::forward<function_type>(function); }
-        void Execute()                  { m_is_executing = true; m_function(); m_is_executing = false; }
-        bool IsExecuting() const { return m_is_executing; }
+        template <typename Function>
+        void Set(Function&& function, TaskCounter* counter)
+        {
+            using function_type = std::decay_t<Function>;
+
+            if constexpr (sizeof(function_type) <= storage_size && alignof(function_type) <= alignof(std::max_align_t))
+            {
+                new (m_storage) function_type(std::forward<Function>(function));
+                m_invoke    = [](void* storage) { (*static_cast<function_type*>(storage))(); };
+                m_destroy   = [](void* storage) { static_cast<function_type*>(storage)->~function_type(); };
+            }
+            else
+            {
+                *reinterpret_cast<function_type**>(m_storage) = new function_type(std::forward<Function>(function));
+                m_invoke    = [](void* storage) { (**static_cast<function_type**>(storage))(); };
+                m_destroy   = [](void* storage) { delete *static_cast<function_type**>(storage); };
+            }
+
+            m_counter = counter;
+        }
+
+        void Execute()  { m_invoke(m_storage); }
+        void Reset()    { if (m_destroy) { m_destroy(m_storage); m_destroy = nullptr; m_invoke = nullptr; } }
+        TaskCounter* GetCounter() const { return m_counter; }
+
+        // Pool bookkeeping
+        std::atomic<bool> m_in_use  = false;
+        bool m_is_heap_allocated    = false;
 
 	private:
-        bool m_is_executing = false;
-		function_type m_function;
+        alignas(std::max_align_t) std::byte m_storage[storage_size];
+        void (*m_invoke)(void*)     = nullptr;
+        void (*m_destroy)(void*)    = nullptr;
+        TaskCounter* m_counter      = nullptr;
 	};
 
+    // Lock-free work-stealing deque (Chase-Lev), the owning thread pushes and pops at the bottom, other threads steal from the top
+    class TaskDeque
+    {
+    public:
+        static constexpr int64_t capacity = 4096;
+
+        bool Push(Task* task);
+        Task* Pop();
+        Task* Steal();
+        bool IsEmpty() const { return m_bottom.load(std::memory_order_relaxed) <= m_top.load(std::memory_order_relaxed); }
+
+    private:
+        alignas(64) std::atomic<int64_t> m_top      = 0;
+        alignas(64) std::atomic<int64_t> m_bottom   = 0;
+        std::array<std::atomic<Task*>, capacity> m_tasks;
+    };
+
 	class Threading : public ISubsystem
 	{
 	public:
@@ -56,7 +129,7 @@ namespace Spartan
 
 		// Add a task
 		template <typename Function>
-		void AddTask(Function&& function)
+		void AddTask(Function&& function, TaskCounter* counter = nullptr)
 		{
 			if (m_threads.empty())
 			{
@@ -65,75 +138,110 @@ namespace Spartan
 				return;
 			}
 
-			// Lock tasks mutex
-			std::unique_lock<std::mutex> lock(m_mutex_tasks);
-
-			// Save the task
-			m_tasks.push_back(std::make_shared<Task>(std::bind(std::forward<Function>(function))));
-
-			// Unlock the mutex
-			lock.unlock();
+            if (counter)
+            {
+                counter->Increment();
+            }
 
-			// Wake up a thread
-			m_condition_var.notify_one();
+            Task* task = AllocateTask();
+            task->Set(std::forward<Function>(function), counter);
+            Submit(task);
 		}
 
-        // Adds a task which is a loop and executes chunks of it in parallel
+        // Executes function(start, end) over [0, range) in chunks of grain_size, chunks are handed out dynamically
+        // and the calling thread helps, so the call returns once the whole range has been processed
         template <typename Function>
-        void AddTaskLoop(Function&& function, uint32_t range)
+        void ParallelFor(const uint32_t range, const uint32_t grain_size, Function&& function)
         {
-            uint32_t available_threads  = GetThreadsAvailable();
-            vector<bool> tasks_done     = vector<bool>(available_threads, false);
-            const uint32_t task_count   = available_threads + 1; // plus one for the current thread
+            if (range == 0)
+                return;
 
-            uint32_t start  = 0;
-            uint32_t end    = 0;
-            for (uint32_t i = 0; i < available_threads; i++)
-            {
-                start   = (range / task_count) * i;
-                end     = start + (range / task_count);
+            const uint32_t grain        = std::max(grain_size, 1u);
+            const uint32_t chunk_count  = (range + grain - 1) / grain;
 
-                // Kick off task
-                AddTask([&function, &tasks_done, i, start, end] { function(start, end); tasks_done[i] = true; });
+            if (m_threads.empty() || chunk_count == 1)
+            {
+                function(0, range);
+                return;
             }
 
-            // Do last task in the current thread
-            function(end, range);
-
-            // Wait till the threads are done
-            uint32_t tasks = 0;
-            while (tasks != tasks_done.size())
+            // Keeps pulling chunks until the range is exhausted
+            std::atomic<uint32_t> chunk_next = 0;
+            auto drain = [&chunk_next, &function, chunk_count, grain, range]()
             {
-                tasks = 0;
-                for (const bool job_done : tasks_done)
+                for (uint32_t chunk = chunk_next.fetch_add(1); chunk < chunk_count; chunk = chunk_next.fetch_add(1))
                 {
-                    tasks += job_done ? 1 : 0;
+                    const uint32_t start = chunk * grain;
+                    function(start, std::min(start + grain, range));
                 }
+            };
+
+            // One helper per worker, but never more than there are chunks left for them
+            TaskCounter counter;
+            const uint32_t helper_count = std::min(m_thread_count, chunk_count - 1);
+            for (uint32_t i = 0; i < helper_count; i++)
+            {
+                AddTask(drain, &counter);
             }
+
+            drain();
+            Wait(counter);
         }
 
+        // Waits for a counter to reach zero, the calling thread executes pending tasks while waiting
+        void Wait(const TaskCounter& counter);
+
         // Get the number of threads used
         uint32_t GetThreadCount()           const { return m_thread_count; }
         // Get the maximum number of threads the hardware supports
         uint32_t GetThreadCountSupport()    const { return m_thread_count_support; }
         // Get the number of threads which are not doing any work
         uint32_t GetThreadsAvailable()      const;
-        // Returns true if at least one task is running
-        bool AreTasksRunning()              const { return GetThreadsAvailable() != GetThreadCount(); }
+        // Returns true if at least one task is running or queued
+        bool AreTasksRunning()              const { return m_tasks_running.load() != 0 || m_tasks_pending.load() != 0; }
         // Waits for all executing (and queued if requested) tasks to finish
         void Flush(bool removed_queued = false);
 
 	private:
+        struct TaskQueue
+        {
+            static constexpr uint32_t pool_size     = 1024;
+            // Slots are handed out in order, if this many in a row are still in use the pool is saturated and scanning the rest won't pay off
+            static constexpr uint32_t pool_probes   = 8;
+
+            TaskDeque deque;
+            std::unique_ptr<Task[]> pool = std::make_unique<Task[]>(pool_size);
+            uint32_t pool_index = 0;
+        };
+
         // This function is invoked by the threads
-        void ThreadLoop();
+        void ThreadLoop(uint32_t queue_index);
+        Task* AllocateTask();
+        void Submit(Task* task);
+        Task* AcquireTask();
+        void ExecuteTask(Task* task);
+        void ReleaseTask(Task* task);
+        void DiscardTask(Task* task);
+        template <typename Condition>
+        void Sleep(Condition&& wake_condition);
+        void WakeUp(bool all);
 
 		uint32_t m_thread_count         = 0;
         uint32_t m_thread_count_support = 0;
 		std::vector<std::thread> m_threads;
-		std::deque<std::shared_ptr<Task>> m_tasks;
-		std::mutex m_mutex_tasks;
+        // One queue per thread, index 0 belongs to the thread which created the subsystem
+        std::vector<std::unique_ptr<TaskQueue>> m_queues;
+        // Tasks submitted from threads which don't own a queue
+        std::deque<Task*> m_tasks_external;
+        std::mutex m_mutex_tasks_external;
+        std::atomic<uint32_t> m_tasks_external_count    = 0;
+        std::atomic<uint32_t> m_tasks_pending           = 0;
+        std::atomic<uint32_t> m_tasks_running           = 0;
+        std::atomic<uint32_t> m_threads_sleeping        = 0;
+        std::atomic<uint32_t> m_threads_flushing        = 0;
+		std::mutex m_mutex_sleep;
 		std::condition_variable m_condition_var;
         std::unordered_map<std::thread::id, std::string> m_thread_names;
-		bool m_stopping;
+		std::atomic<bool> m_stopping = false;
 	};
 }
@@ -0,0 +1,93 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+//= INCLUDES ======
+#include <vector>
+#include <array>
+#include <algorithm>
+//=================
+
+namespace Spartan::Utility
+{
+    // Sorts elements by their 64-bit key member in ascending order, the sort is stable.
+    // It's an LSD radix sort with 8-bit digits, digits which are the same for all keys are skipped.
+    // The scratch vector is resized as needed, keep it around to avoid allocating on every call.
+    template <typename T>
+    inline void RadixSort(std::vector<T>& elements, std::vector<T>& scratch)
+    {
+        const size_t count = elements.size();
+
+        // Not worth it for small counts
+        if (count <= 64)
+        {
+            std::stable_sort(elements.begin(), elements.end(), [](const T& a, const T& b) { return a.key < b.key; });
+            return;
+        }
+
+        scratch.resize(count);
+
+        // Build the histograms of all the digits with a single pass
+        std::array<std::array<uint32_t, 256>, 8> histograms = {};
+        for (const T& element : elements)
+        {
+            for (uint32_t digit = 0; digit < 8; digit++)
+            {
+                histograms[digit][(element.key >> (digit * 8)) & 0xFF]++;
+            }
+        }
+
+        T* source       = elements.data();
+        T* destination  = scratch.data();
+        for (uint32_t digit = 0; digit < 8; digit++)
+        {
+            const uint32_t shift = digit * 8;
+            std::array<uint32_t, 256>& histogram = histograms[digit];
+
+            // All keys share this digit, the order wouldn't change
+            if (histogram[(source[0].key >> shift) & 0xFF] == count)
+                continue;
+
+            // Turn counts into offsets
+            uint32_t offset = 0;
+            for (uint32_t& bucket : histogram)
+            {
+                const uint32_t bucket_count = bucket;
+                bucket = offset;
+                offset += bucket_count;
+            }
+
+            for (size_t i = 0; i < count; i++)
+            {
+                destination[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
+            }
+
+            std::swap(source, destination);
+        }
+
+        // The result ended up in the scratch buffer
+        if (source != elements.data())
+        {
+            elements.swap(scratch);
+        }
+    }
+}
@@ -0,0 +1,536 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//= INCLUDES =======================
+#include "Spartan.h"
+#include "BoundingVolumeHierarchy.h"
+//==================================
+
+//= NAMESPACES ================
+using namespace std;
+using namespace Spartan::Math;
+//=============================
+
+namespace Spartan
+{
+    // How much leaf boxes are grown by, so that slowly moving entities don't have to be re-inserted every frame
+    static const float AABB_MARGIN = 0.1f;
+
+    static float surface_area(const BoundingBox& box)
+    {
+        const Vector3 size = box.GetSize();
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    static BoundingBox merge(const BoundingBox& a, const BoundingBox& b)
+    {
+        BoundingBox merged = a;
+        merged.Merge(b);
+        return merged;
+    }
+
+    uint32_t BoundingVolumeHierarchy::Insert(Entity* entity, const BoundingBox& aabb)
+    {
+        const uint32_t proxy = AllocateNode();
+
+        Node& node      = m_nodes[proxy];
+        node.aabb_tight = aabb;
+        node.aabb       = BoundingBox(aabb.GetMin() - AABB_MARGIN, aabb.GetMax() + AABB_MARGIN);
+        node.entity     = entity;
+        node.height     = 0;
+
+        InsertLeaf(proxy);
+        m_proxy_count++;
+
+        return proxy;
+    }
+
+    void BoundingVolumeHierarchy::Remove(const uint32_t proxy)
+    {
+        if (proxy >= m_nodes.size() || !m_nodes[proxy].IsLeaf() || m_nodes[proxy].height != 0)
+        {
+            LOG_ERROR("Invalid proxy");
+            return;
+        }
+
+        RemoveLeaf(proxy);
+        FreeNode(proxy);
+        m_proxy_count--;
+    }
+
+    bool BoundingVolumeHierarchy::Update(const uint32_t proxy, const BoundingBox& aabb)
+    {
+        Node& node      = m_nodes[proxy];
+        node.aabb_tight = aabb;
+
+        // Still inside the fattened box, nothing to do
+        if (node.aabb.IsInside(aabb) == Inside)
+            return false;
+
+        RemoveLeaf(proxy);
+        m_nodes[proxy].aabb = BoundingBox(aabb.GetMin() - AABB_MARGIN, aabb.GetMax() + AABB_MARGIN);
+        InsertLeaf(proxy);
+
+        return true;
+    }
+
+    void BoundingVolumeHierarchy::Clear()
+    {
+        m_nodes.clear();
+        m_root          = node_null;
+        m_free_list     = node_null;
+        m_proxy_count   = 0;
+    }
+
+    void BoundingVolumeHierarchy::QueryFrustum(const Frustum& frustum, vector<Entity*>& results, const bool ignore_near_plane /*= false*/) const
+    {
+        // Leaves which straddle the frustum are gathered into SoA arrays and tested in batches
+        struct LeafBounds
+        {
+            vector<uint32_t> nodes;
+            vector<float> center_x, center_y, center_z;
+            vector<float> extent_x, extent_y, extent_z;
+            vector<uint8_t> visible;
+        };
+        thread_local LeafBounds leaves;
+        leaves.nodes.clear();
+
+        Query([&frustum, ignore_near_plane](const BoundingBox& box) { return frustum.IsInside(box, ignore_near_plane); }, results, &leaves.nodes);
+
+        const uint32_t count = static_cast<uint32_t>(leaves.nodes.size());
+        if (count == 0)
+            return;
+
+        leaves.center_x.resize(count); leaves.center_y.resize(count); leaves.center_z.resize(count);
+        leaves.extent_x.resize(count); leaves.extent_y.resize(count); leaves.extent_z.resize(count);
+        leaves.visible.resize(count);
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const BoundingBox& box  = m_nodes[leaves.nodes[i]].aabb_tight;
+            const Vector3 center    = box.GetCenter();
+            const Vector3 extent    = box.GetExtents();
+
+            leaves.center_x[i] = center.x; leaves.center_y[i] = center.y; leaves.center_z[i] = center.z;
+            leaves.extent_x[i] = extent.x; leaves.extent_y[i] = extent.y; leaves.extent_z[i] = extent.z;
+        }
+
+        frustum.CullAabbs
+        (
+            leaves.center_x.data(), leaves.center_y.data(), leaves.center_z.data(),
+            leaves.extent_x.data(), leaves.extent_y.data(), leaves.extent_z.data(),
+            count,
+            leaves.visible.data(),
+            ignore_near_plane
+        );
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (leaves.visible[i])
+            {
+                results.emplace_back(m_nodes[leaves.nodes[i]].entity);
+            }
+        }
+    }
+
+    void BoundingVolumeHierarchy::QueryAabb(const BoundingBox& aabb, vector<Entity*>& results) const
+    {
+        Query([&aabb](const BoundingBox& box) { return aabb.IsInside(box); }, results);
+    }
+
+    void BoundingVolumeHierarchy::QuerySphere(const Vector3& center, const float radius, vector<Entity*>& results) const
+    {
+        const float radius_squared = radius * radius;
+
+        Query([&center, radius_squared](const BoundingBox& box)
+        {
+            // Squared distance to the closest and to the farthest point of the box
+            float distance_closest  = 0.0f;
+            float distance_farthest = 0.0f;
+            auto accumulate = [&distance_closest, &distance_farthest](const float c, const float min, const float max)
+            {
+                const float closest     = c < min ? min - c : (c > max ? c - max : 0.0f);
+                const float farthest    = Helper::Max(Helper::Abs(c - min), Helper::Abs(c - max));
+                distance_closest        += closest * closest;
+                distance_farthest       += farthest * farthest;
+            };
+            accumulate(center.x, box.GetMin().x, box.GetMax().x);
+            accumulate(center.y, box.GetMin().y, box.GetMax().y);
+            accumulate(center.z, box.GetMin().z, box.GetMax().z);
+
+            if (distance_closest > radius_squared)
+                return Outside;
+
+            return distance_farthest <= radius_squared ? Inside : Intersects;
+        }, results);
+    }
+
+    void BoundingVolumeHierarchy::QueryRay(const Ray& ray, vector<Entity*>& results) const
+    {
+        Query([&ray](const BoundingBox& box) { return ray.HitDistance(box) != INFINITY ? Intersects : Outside; }, results);
+    }
+
+    uint32_t BoundingVolumeHierarchy::AllocateNode()
+    {
+        if (m_free_list == node_null)
+        {
+            m_nodes.emplace_back();
+            return static_cast<uint32_t>(m_nodes.size() - 1);
+        }
+
+        const uint32_t index    = m_free_list;
+        m_free_list             = m_nodes[index].parent;
+        m_nodes[index]          = Node();
+
+        return index;
+    }
+
+    void BoundingVolumeHierarchy::FreeNode(const uint32_t index)
+    {
+        m_nodes[index]          = Node();
+        m_nodes[index].parent   = m_free_list;
+        m_free_list             = index;
+    }
+
+    void BoundingVolumeHierarchy::InsertLeaf(const uint32_t leaf)
+    {
+        if (m_root == node_null)
+        {
+            m_root                  = leaf;
+            m_nodes[leaf].parent    = node_null;
+            return;
+        }
+
+        // Find the best sibling, descending towards the child which increases the surface area the least
+        const BoundingBox leaf_aabb = m_nodes[leaf].aabb;
+        uint32_t index = m_root;
+        while (!m_nodes[index].IsLeaf())
+        {
+            const Node& node            = m_nodes[index];
+            const float area            = surface_area(node.aabb);
+            const float area_combined   = surface_area(merge(node.aabb, leaf_aabb));
+
+            // Cost of creating a new parent for this node and the leaf
+            const float cost = 2.0f * area_combined;
+
+            // Minimum cost of pushing the leaf further down the tree
+            const float cost_inheritance = 2.0f * (area_combined - area);
+
+            auto cost_descend = [this, &leaf_aabb, cost_inheritance](const uint32_t child)
+            {
+                const Node& node_child  = m_nodes[child];
+                const float area_new    = surface_area(merge(node_child.aabb, leaf_aabb));
+                return node_child.IsLeaf() ? area_new + cost_inheritance : (area_new - surface_area(node_child.aabb)) + cost_inheritance;
+            };
+
+            const float cost_left   = cost_descend(node.child_left);
+            const float cost_right  = cost_descend(node.child_right);
+
+            if (cost < cost_left && cost < cost_right)
+                break;
+
+            index = cost_left < cost_right ? node.child_left : node.child_right;
+        }
+
+        // Create a new parent for the sibling and the leaf
+        const uint32_t sibling      = index;
+        const uint32_t parent_old   = m_nodes[sibling].parent;
+        const uint32_t parent_new   = AllocateNode();
+        {
+            Node& node          = m_nodes[parent_new];
+            node.parent         = parent_old;
+            node.aabb           = merge(leaf_aabb, m_nodes[sibling].aabb);
+            node.height         = m_nodes[sibling].height + 1;
+            node.child_left     = sibling;
+            node.child_right    = leaf;
+        }
+
+        if (parent_old != node_null)
+        {
+            if (m_nodes[parent_old].child_left == sibling)
+            {
+                m_nodes[parent_old].child_left = parent_new;
+            }
+            else
+            {
+                m_nodes[parent_old].child_right = parent_new;
+            }
+        }
+        else
+        {
+            m_root = parent_new;
+        }
+
+        m_nodes[sibling].parent = parent_new;
+        m_nodes[leaf].parent    = parent_new;
+
+        Refit(parent_new);
+    }
+
+    void BoundingVolumeHierarchy::RemoveLeaf(const uint32_t leaf)
+    {
+        if (leaf == m_root)
+        {
+            m_root = node_null;
+            return;
+        }
+
+        const uint32_t parent       = m_nodes[leaf].parent;
+        const uint32_t grand_parent = m_nodes[parent].parent;
+        const uint32_t sibling      = m_nodes[parent].child_left == leaf ? m_nodes[parent].child_right : m_nodes[parent].child_left;
+
+        // The sibling takes the place of the parent
+        if (grand_parent != node_null)
+        {
+            if (m_nodes[grand_parent].child_left == parent)
+            {
+                m_nodes[grand_parent].child_left = sibling;
+            }
+            else
+            {
+                m_nodes[grand_parent].child_right = sibling;
+            }
+
+            m_nodes[sibling].parent = grand_parent;
+            FreeNode(parent);
+            Refit(grand_parent);
+        }
+        else
+        {
+            m_root                  = sibling;
+            m_nodes[sibling].parent = node_null;
+            FreeNode(parent);
+        }
+
+        m_nodes[leaf].parent = node_null;
+    }
+
+    void BoundingVolumeHierarchy::Refit(uint32_t index)
+    {
+        // Walk back up the tree, re-balancing and fixing heights and boxes
+        while (index != node_null)
+        {
+            index = Balance(index);
+
+            Node& node              = m_nodes[index];
+            const Node& child_left  = m_nodes[node.child_left];
+            const Node& child_right = m_nodes[node.child_right];
+            node.height             = 1 + Helper::Max(child_left.height, child_right.height);
+            node.aabb               = merge(child_left.aabb, child_right.aabb);
+
+            index = node.parent;
+        }
+    }
+
+    uint32_t BoundingVolumeHierarchy::Balance(const uint32_t index_a)
+    {
+        // Performs a left or right rotation if node A is imbalanced, returns the new root of the sub-tree
+        Node& a = m_nodes[index_a];
+        if (a.IsLeaf() || a.height < 2)
+            return index_a;
+
+        const uint32_t index_b  = a.child_left;
+        const uint32_t index_c  = a.child_right;
+        Node& b                 = m_nodes[index_b];
+        Node& c                 = m_nodes[index_c];
+        const int32_t balance   = c.height - b.height;
+
+        // Rotate C up
+        if (balance > 1)
+        {
+            const uint32_t index_f  = c.child_left;
+            const uint32_t index_g  = c.child_right;
+            Node& f                 = m_nodes[index_f];
+            Node& g                 = m_nodes[index_g];
+
+            // Swap A and C
+            c.child_left    = index_a;
+            c.parent        = a.parent;
+            a.parent        = index_c;
+
+            // A's old parent should point to C
+            if (c.parent != node_null)
+            {
+                if (m_nodes[c.parent].child_left == index_a)
+                {
+                    m_nodes[c.parent].child_left = index_c;
+                }
+                else
+                {
+                    m_nodes[c.parent].child_right = index_c;
+                }
+            }
+            else
+            {
+                m_root = index_c;
+            }
+
+            // The taller child of C stays with it
+            if (f.height > g.height)
+            {
+                c.child_right   = index_f;
+                a.child_right   = index_g;
+                g.parent        = index_a;
+                a.aabb          = merge(b.aabb, g.aabb);
+                c.aabb          = merge(a.aabb, f.aabb);
+                a.height        = 1 + Helper::Max(b.height, g.height);
+                c.height        = 1 + Helper::Max(a.height, f.height);
+            }
+            else
+            {
+                c.child_right   = index_g;
+                a.child_right   = index_f;
+                f.parent        = index_a;
+                a.aabb          = merge(b.aabb, f.aabb);
+                c.aabb          = merge(a.aabb, g.aabb);
+                a.height        = 1 + Helper::Max(b.height, f.height);
+                c.height        = 1 + Helper::Max(a.height, g.height);
+            }
+
+            return index_c;
+        }
+
+        // Rotate B up
+        if (balance < -1)
+        {
+            const uint32_t index_d  = b.child_left;
+            const uint32_t index_e  = b.child_right;
+            Node& d                 = m_nodes[index_d];
+            Node& e                 = m_nodes[index_e];
+
+            // Swap A and B
+            b.child_left    = index_a;
+            b.parent        = a.parent;
+            a.parent        = index_b;
+
+            // A's old parent should point to B
+            if (b.parent != node_null)
+            {
+                if (m_nodes[b.parent].child_left == index_a)
+                {
+                    m_nodes[b.parent].child_left = index_b;
+                }
+                else
+                {
+                    m_nodes[b.parent].child_right = index_b;
+                }
+            }
+            else
+            {
+                m_root = index_b;
+            }
+
+            // The taller child of B stays with it
+            if (d.height > e.height)
+            {
+                b.child_right   = index_d;
+                a.child_left    = index_e;
+                e.parent        = index_a;
+                a.aabb          = merge(c.aabb, e.aabb);
+                b.aabb          = merge(a.aabb, d.aabb);
+                a.height        = 1 + Helper::Max(c.height, e.height);
+                b.height        = 1 + Helper::Max(a.height, d.height);
+            }
+            else
+            {
+                b.child_right   = index_e;
+                a.child_left    = index_d;
+                d.parent        = index_a;
+                a.aabb          = merge(c.aabb, d.aabb);
+                b.aabb          = merge(a.aabb, e.aabb);
+                a.height        = 1 + Helper::Max(c.height, d.height);
+                b.height        = 1 + Helper::Max(a.height, e.height);
+            }
+
+            return index_b;
+        }
+
+        return index_a;
+    }
+
+    template <typename Overlap>
+    void BoundingVolumeHierarchy::Query(Overlap&& overlap, vector<Entity*>& results, vector<uint32_t>* leaves_deferred /*= nullptr*/) const
+    {
+        if (m_root == node_null)
+            return;
+
+        // One stack per thread, so that queries can run concurrently without allocating
+        thread_local vector<uint32_t> stack;
+        stack.clear();
+        stack.emplace_back(m_root);
+
+        while (!stack.empty())
+        {
+            const uint32_t index = stack.back();
+            stack.pop_back();
+
+            const Node& node = m_nodes[index];
+            if (leaves_deferred && node.IsLeaf())
+            {
+                leaves_deferred->emplace_back(index);
+                continue;
+            }
+
+            const Intersection result = overlap(node.IsLeaf() ? node.aabb_tight : node.aabb);
+
+            if (result == Outside)
+                continue;
+
+            if (node.IsLeaf())
+            {
+                results.emplace_back(node.entity);
+            }
+            else if (result == Inside)
+            {
+                // Everything below is inside as well, no need to test it
+                GatherLeaves(index, results);
+            }
+            else
+            {
+                stack.emplace_back(node.child_left);
+                stack.emplace_back(node.child_right);
+            }
+        }
+    }
+
+    void BoundingVolumeHierarchy::GatherLeaves(const uint32_t index, vector<Entity*>& results) const
+    {
+        thread_local vector<uint32_t> stack;
+        stack.clear();
+        stack.emplace_back(index);
+
+        while (!stack.empty())
+        {
+            const Node& node = m_nodes[stack.back()];
+            stack.pop_back();
+
+            if (node.IsLeaf())
+            {
+                results.emplace_back(node.entity);
+            }
+            else
+            {
+                stack.emplace_back(node.child_left);
+                stack.emplace_back(node.child_right);
+            }
+        }
+    }
+}
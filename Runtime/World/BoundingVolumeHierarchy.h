@@ -0,0 +1,103 @@
+/*
+Copyright(c) 2016-2020 Panos Karabelas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+//= INCLUDES ========================
+#include <vector>
+#include "../Math/BoundingBox.h"
+#include "../Core/Spartan_Definitions.h"
+//===================================
+
+namespace Spartan
+{
+    class Entity;
+
+    namespace Math
+    {
+        class Frustum;
+        class Ray;
+    }
+
+    // A dynamic AABB tree, leaves store fattened boxes so that small movements don't require the tree to be touched
+    class SPARTAN_CLASS BoundingVolumeHierarchy
+    {
+    public:
+        static constexpr uint32_t node_null = 0xFFFFFFFF;
+
+        BoundingVolumeHierarchy() = default;
+        ~BoundingVolumeHierarchy() = default;
+
+        // Inserts an entity and returns a proxy which identifies it
+        uint32_t Insert(Entity* entity, const Math::BoundingBox& aabb);
+        // Removes a proxy
+        void Remove(uint32_t proxy);
+        // Updates the box of a proxy, the tree is only modified if the box has left the fattened one
+        bool Update(uint32_t proxy, const Math::BoundingBox& aabb);
+        // Removes everything
+        void Clear();
+
+        //= QUERIES ======================================================================================================================
+        // All queries append the entities whose box overlaps the given volume to the results, they don't modify the tree
+        void QueryFrustum(const Math::Frustum& frustum, std::vector<Entity*>& results, bool ignore_near_plane = false) const;
+        void QueryAabb(const Math::BoundingBox& aabb, std::vector<Entity*>& results) const;
+        void QuerySphere(const Math::Vector3& center, float radius, std::vector<Entity*>& results) const;
+        void QueryRay(const Math::Ray& ray, std::vector<Entity*>& results) const;
+        //================================================================================================================================
+
+        Entity* GetEntity(const uint32_t proxy)                 const { return m_nodes[proxy].entity; }
+        const Math::BoundingBox& GetAabb(const uint32_t proxy)  const { return m_nodes[proxy].aabb_tight; }
+        uint32_t GetProxyCount()                                const { return m_proxy_count; }
+        uint32_t GetHeight()                                    const { return m_root == node_null ? 0 : m_nodes[m_root].height; }
+
+    private:
+        struct Node
+        {
+            bool IsLeaf() const { return child_left == node_null; }
+
+            Math::BoundingBox aabb;         // fattened, encloses the children
+            Math::BoundingBox aabb_tight;   // leaves only, the actual box of the entity
+            Entity* entity          = nullptr;
+            uint32_t parent         = node_null; // doubles as the next free node when the node is unused
+            uint32_t child_left     = node_null;
+            uint32_t child_right    = node_null;
+            int32_t height          = -1;        // leaves are 0, free nodes are -1
+        };
+
+        uint32_t AllocateNode();
+        void FreeNode(uint32_t index);
+        void InsertLeaf(uint32_t leaf);
+        void RemoveLeaf(uint32_t leaf);
+        void Refit(uint32_t index);
+        uint32_t Balance(uint32_t index);
+
+        // Walks the tree, overlap(box) returns the Intersection of a node box with the query volume.
+        // If leaves_deferred is provided, leaves which need testing are added to it instead of being tested.
+        template <typename Overlap>
+        void Query(Overlap&& overlap, std::vector<Entity*>& results, std::vector<uint32_t>* leaves_deferred = nullptr) const;
+        void GatherLeaves(uint32_t index, std::vector<Entity*>& results) const;
+
+        std::vector<Node> m_nodes;
+        uint32_t m_root         = node_null;
+        uint32_t m_free_list    = node_null;
+        uint32_t m_proxy_count  = 0;
+    };
+}
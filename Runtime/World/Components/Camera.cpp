@@ -78,7 +78,7 @@ namespace Spartan
         m_view              = ComputeViewMatrix();
         m_projection        = ComputeProjection(m_renderer->GetOption(Render_ReverseZ));
         m_view_projection   = m_view * m_projection;
-		m_frustrum          = Frustum(GetViewMatrix(), GetProjectionMatrix(), m_renderer->GetOption(Render_ReverseZ) ? GetNearPlane() : GetFarPlane());
+		m_frustrum          = Frustum(GetViewMatrix(), GetProjectionMatrix());
 
 		m_is_dirty = false;
 	}
@@ -55,6 +55,8 @@ namespace Spartan
 		Unknown
 	};
 
+	constexpr uint32_t component_type_count = static_cast<uint32_t>(ComponentType::Unknown);
+
 	struct Attribute
 	{
 		std::function<std::any()> getter;
@@ -98,6 +100,9 @@ namespace Spartan
 		Context* GetContext() const			        { return m_context; }
 		ComponentType GetType() const	            { return m_type; }
         void SetType(ComponentType type)            { m_type = type; }
+        // False when the component doesn't override OnTick(), such components are never ticked
+        bool IsTickable() const                     { return m_tickable; }
+        void SetTickable(const bool tickable)       { m_tickable = tickable; }
 
         template <typename T>
         std::shared_ptr<T> GetPtrShared() { return dynamic_pointer_cast<T>(shared_from_this()); }
@@ -142,6 +147,8 @@ namespace Spartan
 		ComponentType m_type	= ComponentType::Unknown;
 		// The state of the component
 		bool m_enabled			= false;
+		// Whether the component overrides OnTick()
+		bool m_tickable			= true;
 		// The owner of the component
 		Entity* m_entity		= nullptr;
 		// The transform of the component (always exists)
@@ -286,7 +286,7 @@ namespace Spartan
             const float min_z           = reverse_z ? cascade_depth : 0.0f;
             const float max_z           = reverse_z ? 0.0f : cascade_depth;
             m_matrix_projection[index]  = Matrix::CreateOrthoOffCenterLH(shadow_slice.min.x, shadow_slice.max.x, shadow_slice.min.y, shadow_slice.max.y, min_z, max_z);
-            shadow_slice.frustum        = Frustum(m_matrix_view[index], m_matrix_projection[index], max_z);
+            shadow_slice.frustum        = Frustum(m_matrix_view[index], m_matrix_projection[index]);
 		}
 		else
 		{
@@ -297,7 +297,7 @@ namespace Spartan
 			const float near_plane		= reverse_z ? m_range : 0.1f;
 			const float far_plane		= reverse_z ? 0.1f : m_range;
 			m_matrix_projection[index]	= Matrix::CreatePerspectiveFieldOfViewLH(fov, aspect_ratio, near_plane, far_plane);
-            shadow_slice.frustum        = Frustum(m_matrix_view[index], m_matrix_projection[index], far_plane);
+            shadow_slice.frustum        = Frustum(m_matrix_view[index], m_matrix_projection[index]);
 		}
 
 		return true;
@@ -497,9 +497,6 @@ namespace Spartan
         const auto center       = box.GetCenter();
         const auto extents      = box.GetExtents();
 
-        // ensure that potential shadow casters from behind the near plane are not rejected
-        const bool ignore_near_plane = (m_light_type == LightType::Directional) ? true : false;
-
-        return m_shadow_map.slices[index].frustum.IsVisible(center, extents, ignore_near_plane);
+        return m_shadow_map.slices[index].frustum.IsVisible(center, extents, GetFrustumIgnoreNearPlane());
     }
 }  
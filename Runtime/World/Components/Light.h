@@ -122,6 +122,9 @@ namespace Spartan
         void CreateShadowMap();
 
         bool IsInViewFrustrum(Renderable* renderable, uint32_t index) const;
+        const Math::Frustum& GetFrustum(uint32_t index) const { return m_shadow_map.slices[index].frustum; }
+        // Potential shadow casters from behind the near plane must not be rejected
+        bool GetFrustumIgnoreNearPlane() const { return m_light_type == LightType::Directional; }
 
 	private:
 		void ComputeViewMatrix();
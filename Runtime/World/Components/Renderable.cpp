@@ -192,6 +192,24 @@ namespace Spartan
 		}
 	}
 
+    uint32_t Renderable::GeometryLodCount() const
+    {
+        const vector<ModelLod>* lods = m_model ? m_model->GetLods(m_geometryIndexOffset) : nullptr;
+        return lods ? static_cast<uint32_t>(lods->size()) : 1;
+    }
+
+    uint32_t Renderable::GeometryLodIndexOffset(const uint32_t lod) const
+    {
+        const vector<ModelLod>* lods = m_model ? m_model->GetLods(m_geometryIndexOffset) : nullptr;
+        return (lods && lod != 0) ? (*lods)[Helper::Min(lod, static_cast<uint32_t>(lods->size()) - 1)].index_offset : m_geometryIndexOffset;
+    }
+
+    uint32_t Renderable::GeometryLodIndexCount(const uint32_t lod) const
+    {
+        const vector<ModelLod>* lods = m_model ? m_model->GetLods(m_geometryIndexOffset) : nullptr;
+        return (lods && lod != 0) ? (*lods)[Helper::Min(lod, static_cast<uint32_t>(lods->size()) - 1)].index_count : m_geometryIndexCount;
+    }
+
     void Renderable::GeometryClear()
     {
         GeometrySet("Cleared", 0, 0, 0, 0, BoundingBox(), nullptr);
@@ -80,6 +80,10 @@ namespace Spartan
         Geometry_Type GeometryType()			    const { return m_geometry_type; }
 		const std::string& GeometryName()	        const { return m_geometryName; }
 		const Model* GeometryModel()                const { return m_model.get(); }
+		// Levels of detail, 0 is the full geometry, the rest are simplified versions of it (when the model has them)
+		uint32_t GeometryLodCount() const;
+		uint32_t GeometryLodIndexOffset(uint32_t lod) const;
+		uint32_t GeometryLodIndexCount(uint32_t lod) const;
         const Math::BoundingBox& GetBoundingBox()   const { return m_bounding_box; }
         const Math::BoundingBox& GetAabb();
 		//=====================================================================================================
@@ -102,6 +106,12 @@ namespace Spartan
 		auto GetCastShadows() const							{ return m_castShadows; }
 		void SetReceiveShadows(const bool receive_shadows)	{ m_receiveShadows = receive_shadows; }
 		auto GetReceiveShadows() const						{ return m_receiveShadows; }
+		// Occluders are always rasterized by occlusion culling, regardless of their size
+		void SetOccluder(const bool occluder)				{ m_occluder = occluder; }
+		auto GetOccluder() const							{ return m_occluder; }
+		// The level of detail which the camera sees, maintained by the renderer
+		void SetLod(const uint32_t lod)						{ m_lod = lod; }
+		auto GetLod() const									{ return m_lod; }
 		//=========================================================================================
 
 	private:
@@ -117,6 +127,8 @@ namespace Spartan
         Math::Matrix m_last_transform   = Math::Matrix::Identity;
         bool m_castShadows              = true;
         bool m_receiveShadows           = true;
+        bool m_occluder                 = false;
+        uint32_t m_lod                  = 0;
 		bool m_material_default;
         std::shared_ptr<Material> m_material;
 	};
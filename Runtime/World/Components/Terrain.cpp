@@ -375,7 +375,7 @@ namespace Spartan
             }
         };
 
-        m_context->GetSubsystem<Threading>()->AddTaskLoop(compute_vertex_normals_tangents, vertex_count);
+        m_context->GetSubsystem<Threading>()->ParallelFor(vertex_count, 256, compute_vertex_normals_tangents);
 
         return true;
     }
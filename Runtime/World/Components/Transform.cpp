@@ -55,7 +55,8 @@ namespace Spartan
 	//= ICOMPONENT ==================================================================================
 	void Transform::OnInitialize()
 	{
-		UpdateTransform();
+		m_is_dirty_local = true;
+		MakeDirty();
 	}
 
 	void Transform::Serialize(FileStream* stream)
@@ -84,13 +85,34 @@ namespace Spartan
 			}
 		}
 
-		UpdateTransform();
+		m_is_dirty_local = true;
+		MakeDirty();
 	}
 	//===============================================================================================
-	void Transform::UpdateTransform()
+	void Transform::MakeDirty()
 	{
+		// If this transform is already dirty, so are its descendants
+		if (m_is_dirty)
+			return;
+
+		m_is_dirty = true;
+		for (const auto& child : m_children)
+		{
+			child->MakeDirty();
+		}
+	}
+
+	void Transform::UpdateTransform() const
+	{
+		if (!m_is_dirty)
+			return;
+
 		// Compute local transform
-		m_matrixLocal = Matrix(m_positionLocal, m_rotationLocal, m_scaleLocal);
+		if (m_is_dirty_local)
+		{
+			m_matrixLocal		= Matrix(m_positionLocal, m_rotationLocal, m_scaleLocal);
+			m_is_dirty_local	= false;
+		}
 
 		// Compute world transform
 		if (!HasParent())
@@ -101,21 +123,36 @@ namespace Spartan
 		{
 			m_matrix = m_matrixLocal * GetParentTransformMatrix();
 		}
-		
-		// Update children
-		for (const auto& child : m_children)
+
+		m_is_dirty          = false;
+		m_is_dirty_inverted = true;
+	}
+
+	const Matrix& Transform::GetMatrixInverted() const
+	{
+		if (m_is_dirty)
 		{
-			child->UpdateTransform();
+			UpdateTransform();
 		}
+
+		// Only inverted when asked for, as most transforms never have a child which is moved in world space
+		if (m_is_dirty_inverted)
+		{
+			m_matrix_inverted   = m_matrix.Inverted();
+			m_is_dirty_inverted = false;
+		}
+
+		return m_matrix_inverted;
 	}
 
 	//= TRANSLATION ==================================================================================
 	void Transform::SetPosition(const Vector3& position)
 	{
-		if (GetPosition() == position)
+		// Only compare against the world position when it's already resolved, so that repeated setters don't force an update
+		if (!m_is_dirty && GetPosition() == position)
 			return;
 
-		SetPositionLocal(!HasParent() ? position : position * GetParent()->GetMatrix().Inverted());
+		SetPositionLocal(!HasParent() ? position : position * GetParent()->GetMatrixInverted());
 	}
 
 	void Transform::SetPositionLocal(const Vector3& position)
@@ -124,14 +161,15 @@ namespace Spartan
 			return;
 
 		m_positionLocal = position;
-		UpdateTransform();
+		m_is_dirty_local = true;
+		MakeDirty();
 	}
 	//================================================================================================
 
 	//= ROTATION =====================================================================================
 	void Transform::SetRotation(const Quaternion& rotation)
 	{
-		if (GetRotation() == rotation)
+		if (!m_is_dirty && GetRotation() == rotation)
 			return;
 
 		SetRotationLocal(!HasParent() ? rotation : rotation * GetParent()->GetRotation().Inverse());
@@ -143,14 +181,15 @@ namespace Spartan
 			return;
 
 		m_rotationLocal = rotation;
-		UpdateTransform();
+		m_is_dirty_local = true;
+		MakeDirty();
 	}
 	//================================================================================================
 
 	//= SCALE ========================================================================================
 	void Transform::SetScale(const Vector3& scale)
 	{
-		if (GetScale() == scale)
+		if (!m_is_dirty && GetScale() == scale)
 			return;
 
 		SetScaleLocal(!HasParent() ? scale : scale / GetParent()->GetScale());
@@ -168,7 +207,8 @@ namespace Spartan
 		m_scaleLocal.y = (m_scaleLocal.y == 0.0f) ? Helper::M_EPSILON : m_scaleLocal.y;
 		m_scaleLocal.z = (m_scaleLocal.z == 0.0f) ? Helper::M_EPSILON : m_scaleLocal.z;
 
-		UpdateTransform();
+		m_is_dirty_local = true;
+		MakeDirty();
 	}
 	//================================================================================================
 
@@ -181,7 +221,7 @@ namespace Spartan
 		}
 		else
 		{
-			SetPositionLocal(m_positionLocal + GetParent()->GetMatrix().Inverted() * delta);
+			SetPositionLocal(m_positionLocal + GetParent()->GetMatrixInverted() * delta);
 		}
 	}
 
@@ -257,11 +297,15 @@ namespace Spartan
 		// if the new parent is a descendant of this transform
 		if (new_parent->IsDescendantOf(this))
 		{
+			// if this transform already has a parent
+			// copy, as the children remove themselves from m_children while switching parents
+			const auto children = m_children;
+
 			// if this transform already has a parent
 			if (this->HasParent())
 			{
 				// assign the parent of this transform to the children
-				for (const auto& child : m_children)
+				for (const auto& child : children)
 				{
 					child->SetParent(GetParent());
 				}
@@ -269,7 +313,7 @@ namespace Spartan
 			else // if this transform doesn't have a parent
 			{
 				// make the children orphans
-				for (const auto& child : m_children)
+				for (const auto& child : children)
 				{
 					child->BecomeOrphan();
 				}
@@ -279,15 +323,14 @@ namespace Spartan
 		// Switch parent but keep a pointer to the old one
 		auto parent_old = m_parent;
 		m_parent = new_parent;
-		if (parent_old) parent_old->AcquireChildren(); // update the old parent (so it removes this child)
+		if (parent_old) parent_old->RemoveChild(this); // update the old parent (so it removes this child)
 
-		// make the new parent "aware" of this transform/child
-		if (m_parent)
-		{
-			m_parent->AcquireChildren();
-		}
+		// make the new parent "aware" of this transform/child, there is no need to
+		// search the world for it as the parent was different until now
+		m_parent->m_children.emplace_back(this);
 
-		UpdateTransform();
+		MakeDirty();
+		GetContext()->GetSubsystem<World>()->MakeHierarchyDirty();
 	}
 
 	void Transform::AddChild(Transform* child)
@@ -412,14 +455,19 @@ namespace Spartan
 		m_parent = nullptr;
 
 		// Update the transform without the parent now
-		UpdateTransform();
+		MakeDirty();
+		GetContext()->GetSubsystem<World>()->MakeHierarchyDirty();
 
-		// make the parent search for children,
-		// that's indirect way of making the parent "forget"
-		// about this child, since it won't be able to find it
-		if (temp_ref)
+		// make the parent forget about this child
+		temp_ref->RemoveChild(this);
+	}
+
+	void Transform::RemoveChild(const Transform* child)
+	{
+		const auto it = find(m_children.begin(), m_children.end(), child);
+		if (it != m_children.end())
 		{
-			temp_ref->AcquireChildren();
+			m_children.erase(it);
 		}
 	}
 }
@@ -46,24 +46,29 @@ namespace Spartan
 		void Deserialize(FileStream* stream) override;
 		//============================================
 
-		void UpdateTransform();
+		// Marks the world matrix of this transform and its descendants as stale, it's recomputed when it's
+		// read or by the once per frame update in World, so repeated setters only cost a flag
+		void MakeDirty();
+		// Recomputes the matrices if they are stale, the parent is resolved first if it's stale as well
+		void UpdateTransform() const;
+		bool IsDirty() const { return m_is_dirty; }
 
 		//= POSITION ==============================================================
-		auto GetPosition()              const { return m_matrix.GetTranslation(); }
+		auto GetPosition()              const { return GetMatrix().GetTranslation(); }
 		const auto& GetPositionLocal()  const { return m_positionLocal; }
 		void SetPosition(const Math::Vector3& position);
 		void SetPositionLocal(const Math::Vector3& position);
 		//=========================================================================
 
 		//= ROTATION ===========================================================
-		Math::Quaternion GetRotation() const { return m_matrix.GetRotation(); }
+		Math::Quaternion GetRotation() const { return GetMatrix().GetRotation(); }
 		const auto& GetRotationLocal() const { return m_rotationLocal; }
 		void SetRotation(const Math::Quaternion& rotation);
 		void SetRotationLocal(const Math::Quaternion& rotation);
 		//======================================================================
 
 		//= SCALE =======================================================
-		auto GetScale()             const { return m_matrix.GetScale(); }
+		auto GetScale()             const { return GetMatrix().GetScale(); }
 		const auto& GetScaleLocal() const { return m_scaleLocal; }
 		void SetScale(const Math::Vector3& scale);
 		void SetScaleLocal(const Math::Vector3& scale);
@@ -103,21 +108,28 @@ namespace Spartan
 		//======================================================================================
 
 		void LookAt(const Math::Vector3& v)                       { m_lookAt = v; }
-		const Math::Matrix& GetMatrix()                     const { return m_matrix; }     
-		const Math::Matrix& GetLocalMatrix()                const { return m_matrixLocal; }
+		const Math::Matrix& GetMatrix()                     const { if (m_is_dirty) UpdateTransform(); return m_matrix; }
+		const Math::Matrix& GetLocalMatrix()                const { if (m_is_dirty) UpdateTransform(); return m_matrixLocal; }
+		const Math::Matrix& GetMatrixInverted()             const;
         const Math::Matrix& GetWvpLastFrame()               const { return m_wvp_previous; }
         void SetWvpLastFrame(const Math::Matrix& matrix)          { m_wvp_previous = matrix;}
 
 	private:
 		Math::Matrix GetParentTransformMatrix() const;
+		void RemoveChild(const Transform* child);
 
 		// local
 		Math::Vector3 m_positionLocal;
 		Math::Quaternion m_rotationLocal;
 		Math::Vector3 m_scaleLocal;
 
-		Math::Matrix m_matrix;
-		Math::Matrix m_matrixLocal;
+		// Resolved lazily, hence mutable
+		mutable Math::Matrix m_matrix;
+		mutable Math::Matrix m_matrixLocal;
+		mutable Math::Matrix m_matrix_inverted;
+		mutable bool m_is_dirty             = true; // world matrix is stale (implies that all the descendants are stale too)
+		mutable bool m_is_dirty_local       = true; // local matrix is stale
+		mutable bool m_is_dirty_inverted    = true; // inverted world matrix is stale, children go from world to local space with it
 		Math::Vector3 m_lookAt;
 
 		Transform* m_parent; // the parent of this transform
@@ -63,6 +63,7 @@ namespace Spartan
         m_context               = nullptr;
         m_name.clear();
         m_component_mask = 0;
+        m_component_lookup.fill(nullptr);
 		for (auto it = m_components.begin(); it != m_components.end();)
 		{
 			(*it)->OnRemove();
@@ -121,6 +122,26 @@ namespace Spartan
 		clone_entity_and_descendants(this);
 	}
 
+	void Entity::SetName(const string& name)
+	{
+		if (m_name == name)
+			return;
+
+		const string name_previous = m_name;
+		m_name = name;
+		m_context->GetSubsystem<World>()->EntityReindex(this, m_id, name_previous);
+	}
+
+	void Entity::SetId(const uint32_t id)
+	{
+		if (m_id == id)
+			return;
+
+		const uint32_t id_previous = m_id;
+		m_id = id;
+		m_context->GetSubsystem<World>()->EntityReindex(this, id_previous, m_name);
+	}
+
 	void Entity::Start()
 	{
 		// call component Start()
@@ -147,7 +168,10 @@ namespace Spartan
 		// call component Update()
 		for (const auto& component : m_components)
 		{
-			component->OnTick(delta_time);
+			if (component->IsTickable())
+			{
+				component->OnTick(delta_time);
+			}
 		}
 	}
 
@@ -209,10 +233,15 @@ namespace Spartan
 	{
         // BASIC DATA
         {
+            const uint32_t id_previous      = m_id;
+            const string name_previous      = m_name;
+
             stream->Read(&m_is_active);
             stream->Read(&m_hierarchy_visibility);
             stream->Read(&m_id);
             stream->Read(&m_name);
+
+            m_context->GetSubsystem<World>()->EntityReindex(this, id_previous, name_previous);
         }
 
         // COMPONENTS
@@ -260,15 +289,11 @@ namespace Spartan
             }
 
             // Children
+            // They register themselves with this transform as they get parented
             for (const auto& child : children)
             {
                 child.lock()->Deserialize(stream, GetTransform());
             }
-
-            if (m_transform)
-            {
-                m_transform->AcquireChildren();
-            }
         }
 
 		// Make the scene resolve
@@ -335,6 +360,21 @@ namespace Spartan
             m_component_mask &= ~GetComponentMask(component_type);
         }
 
+        // Point the lookup to the next component of the same type, if any
+        if (component_type != ComponentType::Unknown)
+        {
+            IComponent*& first = m_component_lookup[static_cast<uint32_t>(component_type)];
+            first = nullptr;
+            for (const auto& component : m_components)
+            {
+                if (component->GetType() == component_type)
+                {
+                    first = component.get();
+                    break;
+                }
+            }
+        }
+
 		// Make the scene resolve
 		FIRE_EVENT(EventType::WorldResolve);
 	}
@@ -23,6 +23,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 //= INCLUDES =====================
 #include <vector>
+#include <array>
 #include "../Core/EventSystem.h"
 #include "Components/IComponent.h"
 //================================
@@ -48,7 +49,10 @@ namespace Spartan
 
 		//= PROPERTIES ===================================================================================================
 		const std::string& GetName() const								{ return m_name; }
-		void SetName(const std::string& name)							{ m_name = name; }
+		void SetName(const std::string& name);
+
+		// Hides Spartan_Object::SetId() so that the World can keep its lookup by ID up to date
+		void SetId(uint32_t id);
 
 		bool IsActive() const											{ return m_is_active; }
 		void SetActive(const bool active)								{ m_is_active = active; }
@@ -73,6 +77,10 @@ namespace Spartan
             // Save new component
             m_components.emplace_back(std::static_pointer_cast<IComponent>(component));
             m_component_mask |= GetComponentMask(type);
+            if (!m_component_lookup[static_cast<uint32_t>(type)])
+            {
+                m_component_lookup[static_cast<uint32_t>(type)] = component.get();
+            }
 
             // Caching of rendering performance critical components
             if constexpr (std::is_same<T, Transform>::value)    { m_transform   = static_cast<Transform*>(component.get()); }
@@ -80,6 +88,7 @@ namespace Spartan
 
             // Initialize component
             component->SetType(type);
+            component->SetTickable(!std::is_same<decltype(&T::OnTick), void (IComponent::*)(float)>::value);
             component->OnInitialize();
 
 			// Make the scene resolve
@@ -95,18 +104,13 @@ namespace Spartan
 		template <class T>
         T* GetComponent()
 		{
-            const ComponentType type = IComponent::TypeToEnum<T>();
-
-            if (!HasComponent(type))
-                return nullptr;
-
-			for (const auto& component : m_components)
-			{
-				if (component->GetType() == type)
-					return static_cast<T*>(component.get());
-			}
+            return static_cast<T*>(GetComponent(IComponent::TypeToEnum<T>()));
+		}
 
-			return nullptr;
+		// Returns the first component of a given type (if it exists)
+		IComponent* GetComponent(const ComponentType type) const
+		{
+			return type != ComponentType::Unknown ? m_component_lookup[static_cast<uint32_t>(type)] : nullptr;
 		}
 
 		// Returns any components of type T (if they exist)
@@ -151,6 +155,7 @@ namespace Spartan
 					component->OnRemove();
 					it = m_components.erase(it);
                     m_component_mask &= ~GetComponentMask(type);
+                    m_component_lookup[static_cast<uint32_t>(type)] = nullptr;
 				}
 				else
 				{
@@ -159,7 +164,7 @@ namespace Spartan
 			}
 
 			// Make the scene resolve
-			FIRE_EVENT(Event_World_Resolve_Pending);
+			FIRE_EVENT(EventType::WorldResolve);
 		}
 
 		void RemoveComponentById(uint32_t id);
@@ -186,5 +191,7 @@ namespace Spartan
         // Components
         std::vector<std::shared_ptr<IComponent>> m_components;
         uint32_t m_component_mask = 0;
+        // The first component of each type, indexed by ComponentType
+        std::array<IComponent*, component_type_count> m_component_lookup = {};
 	};
 }
@@ -28,12 +28,14 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Components/Light.h"
 #include "Components/Environment.h"
 #include "Components/AudioListener.h"
+#include "Components/Renderable.h"
 #include "../Resource/ResourceCache.h"
 #include "../Resource/ProgressReport.h"
 #include "../IO/FileStream.h"
 #include "../Profiling/Profiler.h"
 #include "../Rendering/Renderer.h"
 #include "../Input/Input.h"
+#include "../Threading/Threading.h"
 #include "../RHI/RHI_Device.h"
 //=====================================
 
@@ -47,7 +49,7 @@ namespace Spartan
 	World::World(Context* context) : ISubsystem(context)
 	{
 		// Subscribe to events
-		SUBSCRIBE_TO_EVENT(EventType::WorldResolve, [this](Variant) { m_is_dirty = true; });
+		SUBSCRIBE_TO_EVENT(EventType::WorldResolve, [this](Variant) { m_is_dirty = true; m_components_dirty = true; });
 		SUBSCRIBE_TO_EVENT(EventType::WorldStop,	        [this](Variant)	{ m_state = WorldState::Idle; });
 		SUBSCRIBE_TO_EVENT(EventType::WorldStart,	        [this](Variant)	{ m_state = WorldState::Ticking; });
 	}
@@ -63,6 +65,7 @@ namespace Spartan
 	{
 		m_input		= m_context->GetSubsystem<Input>();
 		m_profiler	= m_context->GetSubsystem<Profiler>();
+		m_threading	= m_context->GetSubsystem<Threading>();
 
 		CreateCamera();
 		CreateEnvironment();
@@ -109,33 +112,36 @@ namespace Spartan
                 }
             }
 
-            // Tick
-            for (const auto& entity : m_entities)
+            // Tick, type by type and only the components which actually do something
+            ComponentsResolve();
+            for (IComponent* component : m_components_tickable)
             {
-                entity->Tick(delta_time);
+                if (component->GetEntity()->IsActive())
+                {
+                    component->OnTick(delta_time);
+                }
             }
 		}
 
         if (m_is_dirty)
         {
-            // Update dirty entities
-            {
-                // Make a copy so we can iterate while removing entities
-                auto entities_copy = m_entities;
+            // Remove entities which are pending destruction
+            EntityRemovePending();
 
-                for (const auto& entity : entities_copy)
-                {
-                    if (entity->IsPendingDestruction())
-                    {
-                        _EntityRemove(entity);
-                    }
-                }
-            }
+            // Track new renderables and stop tracking the ones which are gone
+            BvhResolve();
 
             // Notify Renderer
             FIRE_EVENT_DATA(EventType::WorldResolved, m_entities);
-            m_is_dirty = false;
+            m_is_dirty          = false;
+            m_transforms_dirty  = true;
         }
+
+        // Resolve the world matrices of anything that moved this frame
+        TransformsUpdate();
+
+        // Move renderables which have left their fattened bounding box
+        BvhRefit();
 	}
 
 	void World::Unload()
@@ -145,8 +151,16 @@ namespace Spartan
 
         m_entities.clear();
         m_entities.shrink_to_fit();
-
-		m_is_dirty = true;
+        m_entity_index_by_id.clear();
+        m_entity_index_by_name.clear();
+        m_bvh.Clear();
+        m_bvh_proxies.clear();
+        m_transforms.clear();
+        m_transforms_depth_offsets.clear();
+
+		m_is_dirty          = true;
+        m_transforms_dirty  = true;
+        m_components_dirty  = true;
 	}
 
 	bool World::SaveToFile(const string& filePathIn)
@@ -229,6 +243,9 @@ namespace Spartan
 		ProgressReport::Get().SetStatus(g_progress_world, "Loading world...");
 		Stopwatch timer;
 		
+		// Remember the pipelines the current world used, so that they can be created up front next time it's loaded
+		m_context->GetSubsystem<Renderer>()->PipelinesSave(m_name);
+
 		// Unload current entities
 		Unload();
 
@@ -261,6 +278,32 @@ namespace Spartan
 			ProgressReport::Get().IncrementJobsDone(g_progress_world);
 		}
 
+		// Compile the shader permutations the world needs up front, so that nothing pops in once it's displayed
+		{
+			Renderer* renderer = m_context->GetSubsystem<Renderer>();
+			const vector<ShaderPermutation> permutations = renderer->ShaderPermutationsGather(m_entities);
+
+			ProgressReport::Get().SetStatus(g_progress_world, "Compiling shaders...");
+			ProgressReport::Get().SetJobsDone(g_progress_world, 0);
+			ProgressReport::Get().SetJobCount(g_progress_world, static_cast<int>(permutations.size()));
+
+			renderer->ShaderPermutationsCompile(permutations, [](const uint32_t compiled, const uint32_t)
+			{
+				ProgressReport::Get().SetJobsDone(g_progress_world, static_cast<int>(compiled));
+			});
+
+			// Create the pipelines which were used the last time this world was loaded, so that the first frames don't hitch
+			ProgressReport::Get().SetStatus(g_progress_world, "Creating pipelines...");
+			ProgressReport::Get().SetJobsDone(g_progress_world, 0);
+			ProgressReport::Get().SetJobCount(g_progress_world, 0);
+
+			renderer->PipelinesWarmUp(m_name, [](const uint32_t created, const uint32_t count)
+			{
+				ProgressReport::Get().SetJobCount(g_progress_world, static_cast<int>(count));
+				ProgressReport::Get().SetJobsDone(g_progress_world, static_cast<int>(created));
+			});
+		}
+
 		m_is_dirty	= true;
 		m_state		= WorldState::Ticking;
 		ProgressReport::Get().SetIsLoading(g_progress_world, false);	
@@ -274,6 +317,8 @@ namespace Spartan
     {
         auto& entity = m_entities.emplace_back(make_shared<Entity>(m_context));
         entity->SetActive(is_active);
+        EntityIndexAdd(static_cast<uint32_t>(m_entities.size()) - 1);
+        m_transforms_dirty = true;
         return entity;
     }
 
@@ -284,7 +329,11 @@ namespace Spartan
 		if (!entity)
 			return empty;
 
-		return m_entities.emplace_back(entity);
+        m_transforms_dirty = true;
+        m_components_dirty = true;
+		auto& entity_added = m_entities.emplace_back(entity);
+        EntityIndexAdd(static_cast<uint32_t>(m_entities.size()) - 1);
+		return entity_added;
 	}
 
 	bool World::EntityExists(const shared_ptr<Entity>& entity)
@@ -322,11 +371,10 @@ namespace Spartan
 
 	const shared_ptr<Entity>& World::EntityGetByName(const string& name)
 	{
-		for (const auto& entity : m_entities)
-		{
-			if (entity->GetName() == name)
-				return entity;
-		}
+        // If more than one entity has this name, any of them can be returned
+        const auto it = m_entity_index_by_name.find(name);
+        if (it != m_entity_index_by_name.end())
+            return EntityGetById((*it->second.begin())->GetId());
 
         static shared_ptr<Entity> empty;
 		return empty;
@@ -334,45 +382,277 @@ namespace Spartan
 
 	const shared_ptr<Entity>& World::EntityGetById(const uint32_t id)
 	{
-		for (const auto& entity : m_entities)
-		{
-			if (entity->GetId() == id)
-				return entity;
-		}
+        const auto it = m_entity_index_by_id.find(id);
+        if (it != m_entity_index_by_id.end())
+            return m_entities[it->second];
 
         static shared_ptr<Entity> empty;
 		return empty;
 	}
 
-    // Removes an entity and all of it's children
-    void World::_EntityRemove(const std::shared_ptr<Entity>& entity)
+    void World::EntityReindex(Entity* entity, const uint32_t id_previous, const string& name_previous)
     {
-        // Remove any descendants
-        auto children = entity->GetTransform()->GetChildren();
-        for (const auto& child : children)
+        // Entities which are not part of the world (yet) have nothing to update
+        const auto it = m_entity_index_by_id.find(id_previous);
+        if (it == m_entity_index_by_id.end() || m_entities[it->second].get() != entity)
+            return;
+
+        if (entity->GetId() != id_previous)
+        {
+            const uint32_t index = it->second;
+            m_entity_index_by_id.erase(it);
+            m_entity_index_by_id[entity->GetId()] = index;
+        }
+
+        if (entity->GetName() != name_previous)
         {
-            EntityRemove(child->GetEntity()->GetPtrShared());
+            EntityIndexRemoveName(entity, name_previous);
+            m_entity_index_by_name[entity->GetName()].emplace(entity);
         }
+    }
 
-        // Keep a reference to it's parent (in case it has one)
-        auto parent = entity->GetTransform()->GetParent();
+    void World::ComponentsResolve()
+    {
+        if (!m_components_dirty)
+            return;
 
-        // Remove this entity
-        for (auto it = m_entities.begin(); it < m_entities.end();)
+        for (auto& pool : m_component_pools)
         {
-            const auto temp = *it;
-            if (temp->GetId() == entity->GetId())
+            pool.clear();
+        }
+
+        for (const auto& entity : m_entities)
+        {
+            uint32_t entity_mask = 0;
+            for (const auto& component : entity->GetAllComponents())
+            {
+                entity_mask |= 1u << static_cast<uint32_t>(component->GetType());
+            }
+
+            for (const auto& component : entity->GetAllComponents())
+            {
+                const ComponentType type = component->GetType();
+                if (type == ComponentType::Unknown)
+                    continue;
+
+                ComponentSlot& slot = m_component_pools[static_cast<uint32_t>(type)].emplace_back();
+                slot.component      = component.get();
+                slot.entity         = entity.get();
+                slot.entity_mask    = entity_mask;
+                slot.is_first       = entity->GetComponent(type) == component.get();
+            }
+        }
+
+        m_components_tickable.clear();
+        for (const auto& pool : m_component_pools)
+        {
+            for (const ComponentSlot& slot : pool)
+            {
+                if (slot.component->IsTickable())
+                {
+                    m_components_tickable.emplace_back(slot.component);
+                }
+            }
+        }
+
+        m_components_dirty = false;
+    }
+
+    // Removes the entities which are pending destruction along with their descendants, in a single pass
+    void World::EntityRemovePending()
+    {
+        // Propagate the destruction to the descendants
+        vector<Transform*> descendants;
+        for (const auto& entity : m_entities)
+        {
+            if (!entity->IsPendingDestruction())
+                continue;
+
+            // If the parent is going away too, it will take care of this entity
+            Transform* transform    = entity->GetTransform();
+            Transform* parent       = transform->GetParent();
+            if (parent && parent->GetEntity()->IsPendingDestruction())
+                continue;
+
+            descendants.clear();
+            transform->GetDescendants(&descendants);
+            for (Transform* descendant : descendants)
             {
-                it = m_entities.erase(it);
-                break;
+                descendant->GetEntity()->MarkForDestruction();
             }
-            ++it;
+
+            // Detach from the parent, which stays
+            transform->BecomeOrphan();
         }
 
-        // If there was a parent, update it
-        if (parent)
+        // Swap and pop, so the cost doesn't depend on where in the list the entities are
+        for (uint32_t i = 0; i < static_cast<uint32_t>(m_entities.size());)
         {
-            parent->AcquireChildren();
+            Entity* entity = m_entities[i].get();
+            if (!entity->IsPendingDestruction())
+            {
+                i++;
+                continue;
+            }
+
+            BvhRemove(entity);
+            EntityIndexRemove(i);
+
+            const uint32_t index_last = static_cast<uint32_t>(m_entities.size()) - 1;
+            if (i != index_last)
+            {
+                m_entities[i] = move(m_entities[index_last]);
+
+                // Point the moved entity to its new slot
+                const auto it = m_entity_index_by_id.find(m_entities[i]->GetId());
+                if (it != m_entity_index_by_id.end() && it->second == index_last)
+                {
+                    it->second = i;
+                }
+            }
+            m_entities.pop_back();
+
+            m_transforms_dirty = true;
+            m_components_dirty = true;
+        }
+    }
+
+    void World::EntityIndexAdd(const uint32_t index)
+    {
+        Entity* entity = m_entities[index].get();
+        m_entity_index_by_id[entity->GetId()] = index;
+        m_entity_index_by_name[entity->GetName()].emplace(entity);
+    }
+
+    void World::EntityIndexRemove(const uint32_t index)
+    {
+        Entity* entity = m_entities[index].get();
+
+        // Another entity could be sharing the ID, only remove the entry if it's ours
+        const auto it = m_entity_index_by_id.find(entity->GetId());
+        if (it != m_entity_index_by_id.end() && it->second == index)
+        {
+            m_entity_index_by_id.erase(it);
+        }
+
+        EntityIndexRemoveName(entity, entity->GetName());
+    }
+
+    void World::EntityIndexRemoveName(Entity* entity, const string& name)
+    {
+        const auto it = m_entity_index_by_name.find(name);
+        if (it == m_entity_index_by_name.end())
+            return;
+
+        it->second.erase(entity);
+        if (it->second.empty())
+        {
+            m_entity_index_by_name.erase(it);
+        }
+    }
+
+    void World::BvhResolve()
+    {
+        for (const auto& entity : m_entities)
+        {
+            // Renderables without geometry have no bounds to index
+            Renderable* renderable  = entity->HasComponent<Renderable>() ? entity->GetRenderable() : nullptr;
+            const bool indexable    = renderable && renderable->GetBoundingBox().Defined();
+            const auto it           = m_bvh_proxies.find(entity.get());
+
+            if (indexable && it == m_bvh_proxies.end())
+            {
+                m_bvh_proxies[entity.get()] = m_bvh.Insert(entity.get(), renderable->GetAabb());
+            }
+            else if (!indexable && it != m_bvh_proxies.end())
+            {
+                m_bvh.Remove(it->second);
+                m_bvh_proxies.erase(it);
+            }
+        }
+    }
+
+    void World::BvhRefit()
+    {
+        for (const auto& it : m_bvh_proxies)
+        {
+            Entity* entity = it.first;
+            if (!entity->HasComponent<Renderable>())
+                continue;
+
+            // The aabb is only re-computed if the transform has changed
+            m_bvh.Update(it.second, entity->GetRenderable()->GetAabb());
+        }
+    }
+
+    void World::BvhRemove(Entity* entity)
+    {
+        const auto it = m_bvh_proxies.find(entity);
+        if (it == m_bvh_proxies.end())
+            return;
+
+        m_bvh.Remove(it->second);
+        m_bvh_proxies.erase(it);
+    }
+
+    void World::TransformsSort()
+    {
+        m_transforms.clear();
+        m_transforms_depth_offsets.clear();
+
+        // Roots first
+        for (const auto& entity : m_entities)
+        {
+            Transform* transform = entity->GetTransform();
+            if (transform && !transform->HasParent())
+            {
+                m_transforms.emplace_back(transform);
+            }
+        }
+
+        // Then breadth first, one depth level after the other
+        uint32_t depth_start = 0;
+        while (depth_start < static_cast<uint32_t>(m_transforms.size()))
+        {
+            const uint32_t depth_end = static_cast<uint32_t>(m_transforms.size());
+            m_transforms_depth_offsets.emplace_back(depth_start);
+
+            for (uint32_t i = depth_start; i < depth_end; i++)
+            {
+                for (Transform* child : m_transforms[i]->GetChildren())
+                {
+                    m_transforms.emplace_back(child);
+                }
+            }
+
+            depth_start = depth_end;
+        }
+        m_transforms_depth_offsets.emplace_back(static_cast<uint32_t>(m_transforms.size()));
+
+        m_transforms_dirty = false;
+    }
+
+    void World::TransformsUpdate()
+    {
+        if (m_transforms_dirty)
+        {
+            TransformsSort();
+        }
+
+        // Walk the depth levels in order, by the time a level is processed all the parents are resolved,
+        // so every transform in it only touches its own matrices and the level can be split across threads
+        for (uint32_t depth = 0; depth + 1 < static_cast<uint32_t>(m_transforms_depth_offsets.size()); depth++)
+        {
+            const uint32_t offset = m_transforms_depth_offsets[depth];
+            const uint32_t count  = m_transforms_depth_offsets[depth + 1] - offset;
+
+            m_threading->ParallelFor(count, 256, [this, offset](const uint32_t start, const uint32_t end)
+            {
+                for (uint32_t i = offset + start; i < offset + end; i++)
+                {
+                    m_transforms[i]->UpdateTransform();
+                }
+            });
         }
     }
 
@@ -25,6 +25,11 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <vector>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <array>
+#include "BoundingVolumeHierarchy.h"
+#include "Components/IComponent.h"
 #include "../Core/ISubsystem.h"
 #include "../Core/Spartan_Definitions.h"
 //======================================
@@ -35,6 +40,8 @@ namespace Spartan
 	class Light;
 	class Input;
 	class Profiler;
+	class Threading;
+	class Transform;
 
 	enum class WorldState
 	{
@@ -60,6 +67,8 @@ namespace Spartan
 		bool LoadFromFile(const std::string& file_path);
 		const auto& GetName() const { return m_name; }
         void MakeDirty() { m_is_dirty = true; }
+        // Invalidates the depth sorted transform list, call when parent/child relationships change
+        void MakeHierarchyDirty() { m_transforms_dirty = true; }
 
 		//= Entities ===========================================================================
 		std::shared_ptr<Entity>& EntityCreate(bool is_active = true);
@@ -71,10 +80,69 @@ namespace Spartan
 		const std::shared_ptr<Entity>& EntityGetById(uint32_t id);
 		const auto& EntityGetAll() const    { return m_entities; }
 		auto EntityGetCount() const         { return static_cast<uint32_t>(m_entities.size()); }
+		// Called by entities when their ID or name changes, so that the lookups above stay valid
+		void EntityReindex(Entity* entity, uint32_t id_previous, const std::string& name_previous);
 		//======================================================================================
 
+        //= Components ==============================================================================================
+        // Calls function(Entity*) for every entity which has all of the given component types, e.g. { Transform, Renderable }
+        template <typename Function>
+        void EntityForEach(const std::initializer_list<ComponentType> types, Function&& function)
+        {
+            ComponentsResolve();
+
+            // Walk the smallest pool and check for the rest of the types through the entity's mask
+            uint32_t mask                           = 0;
+            const std::vector<ComponentSlot>* pool  = nullptr;
+            for (const ComponentType type : types)
+            {
+                const auto& pool_type = m_component_pools[static_cast<uint32_t>(type)];
+                pool = (!pool || pool_type.size() < pool->size()) ? &pool_type : pool;
+                mask |= 1u << static_cast<uint32_t>(type);
+            }
+
+            if (!pool)
+                return;
+
+            for (const ComponentSlot& slot : *pool)
+            {
+                if (slot.is_first && (slot.entity_mask & mask) == mask)
+                {
+                    function(slot.entity);
+                }
+            }
+        }
+        //===========================================================================================================
+
+        // Spatial index of all the entities which have a renderable, use it for culling and ray/volume queries
+        const auto& GetBvh() const { return m_bvh; }
+
 	private:
-        void _EntityRemove(const std::shared_ptr<Entity>& entity);
+        // A component along with what its entity looked like when the pools were last resolved
+        struct ComponentSlot
+        {
+            IComponent* component   = nullptr;
+            Entity* entity          = nullptr;
+            uint32_t entity_mask    = 0;
+            bool is_first           = true; // first component of this type in the entity (scripts can have many)
+        };
+
+        void ComponentsResolve();
+        void EntityRemovePending();
+        void EntityIndexAdd(uint32_t index);
+        void EntityIndexRemove(uint32_t index);
+        void EntityIndexRemoveName(Entity* entity, const std::string& name);
+
+        //= BVH ==================
+        void BvhResolve();
+        void BvhRefit();
+        void BvhRemove(Entity* entity);
+        //========================
+
+        //= TRANSFORMS ===========
+        void TransformsSort();
+        void TransformsUpdate();
+        //========================
 
 		//= COMMON ENTITY CREATION ========================
 		std::shared_ptr<Entity>& CreateEnvironment();
@@ -88,7 +156,26 @@ namespace Spartan
         WorldState m_state          = WorldState::Ticking;
         Input* m_input              = nullptr;
         Profiler* m_profiler        = nullptr;
+        Threading* m_threading      = nullptr;
 
         std::vector<std::shared_ptr<Entity>> m_entities;
+        std::unordered_map<uint32_t, uint32_t> m_entity_index_by_id;        // id -> index in m_entities
+        std::unordered_map<std::string, std::unordered_set<Entity*>> m_entity_index_by_name; // name -> entities, many can share a name
+
+        // Components grouped by type, rebuilt whenever components or entities are added or removed.
+        // The pools are contiguous but they hold pointers, the components themselves are still allocated one by one and owned by their
+        // entity, as the editor, the scripts and the attributes rely on shared_ptr<IComponent>, so iterating a pool still means a cache miss per component.
+        std::array<std::vector<ComponentSlot>, component_type_count> m_component_pools;
+        // The components which override OnTick(), ordered by type
+        std::vector<IComponent*> m_components_tickable;
+        bool m_components_dirty = true;
+        BoundingVolumeHierarchy m_bvh;
+        std::unordered_map<Entity*, uint32_t> m_bvh_proxies;
+
+        // All the transforms, sorted by hierarchy depth so that parents always come before their children
+        std::vector<Transform*> m_transforms;
+        // Where each depth level starts in m_transforms, plus the end
+        std::vector<uint32_t> m_transforms_depth_offsets;
+        bool m_transforms_dirty = true;
 	};
 }
@@ -19,10 +19,12 @@
 
 SOLUTION_NAME		= "Spartan"
 EDITOR_NAME			= "Editor"
+HEADLESS_NAME		= "Headless"
 RUNTIME_NAME		= "Runtime"
 TARGET_NAME			= "Spartan" -- Name of executable
 DEBUG_FORMAT		= "c7"
 EDITOR_DIR			= "../" .. EDITOR_NAME
+HEADLESS_DIR		= "../" .. HEADLESS_NAME
 RUNTIME_DIR			= "../" .. RUNTIME_NAME
 IGNORE_FILES		= {}
 LIBRARY_DIR			= "../ThirdParty/libraries"
@@ -30,6 +32,7 @@ INTERMEDIATE_DIR	= "../Binaries/Intermediate"
 TARGET_DIR_RELEASE  = "../Binaries/Release"
 TARGET_DIR_DEBUG    = "../Binaries/Debug"
 API_GRAPHICS		= _ARGS[1]
+API_INPUT			= "API_INPUT_WINDOWS"
 
 -- Compute graphics api specific variables
 if API_GRAPHICS == "d3d11" then
@@ -37,16 +40,30 @@ if API_GRAPHICS == "d3d11" then
 	TARGET_NAME		= "Spartan_d3d11"
 	IGNORE_FILES[0]	= RUNTIME_DIR .. "/RHI/D3D12/**"
 	IGNORE_FILES[1]	= RUNTIME_DIR .. "/RHI/Vulkan/**"
+	IGNORE_FILES[2]	= RUNTIME_DIR .. "/RHI/Null/**"
+	IGNORE_FILES[3]	= RUNTIME_DIR .. "/Input/Null/**"
 elseif API_GRAPHICS == "d3d12" then
 	API_GRAPHICS	= "API_GRAPHICS_D3D12"
 	TARGET_NAME		= "Spartan_d3d12"
 	IGNORE_FILES[0]	= RUNTIME_DIR .. "/RHI/D3D11/**"
 	IGNORE_FILES[1]	= RUNTIME_DIR .. "/RHI/Vulkan/**"
+	IGNORE_FILES[2]	= RUNTIME_DIR .. "/RHI/Null/**"
+	IGNORE_FILES[3]	= RUNTIME_DIR .. "/Input/Null/**"
 elseif API_GRAPHICS == "vulkan" then
 	API_GRAPHICS	= "API_GRAPHICS_VULKAN"
 	TARGET_NAME		= "Spartan_vk"
 	IGNORE_FILES[0]	= RUNTIME_DIR .. "/RHI/D3D11/**"
 	IGNORE_FILES[1]	= RUNTIME_DIR .. "/RHI/D3D12/**"
+	IGNORE_FILES[2]	= RUNTIME_DIR .. "/RHI/Null/**"
+	IGNORE_FILES[3]	= RUNTIME_DIR .. "/Input/Null/**"
+elseif API_GRAPHICS == "null" then
+	API_GRAPHICS	= "API_GRAPHICS_NULL"
+	API_INPUT		= "API_INPUT_NULL" -- nothing is displayed, so there is no window to take input from
+	TARGET_NAME		= "Spartan_null"
+	IGNORE_FILES[0]	= RUNTIME_DIR .. "/RHI/D3D11/**"
+	IGNORE_FILES[1]	= RUNTIME_DIR .. "/RHI/D3D12/**"
+	IGNORE_FILES[2]	= RUNTIME_DIR .. "/RHI/Vulkan/**"
+	IGNORE_FILES[3]	= RUNTIME_DIR .. "/Input/Windows/**"
 end
 
 -- Solution
@@ -88,7 +105,7 @@ project (RUNTIME_NAME)
 	objdir (INTERMEDIATE_DIR)
 	kind "StaticLib"
 	staticruntime "On"
-	defines{ "SPARTAN_RUNTIME", API_GRAPHICS }
+	defines{ "SPARTAN_RUNTIME", API_GRAPHICS, API_INPUT }
 	
 	-- Procompiled headers
 	pchheader "Spartan.h"
@@ -104,7 +121,7 @@ project (RUNTIME_NAME)
 	}
 	
 	-- Source to ignore
-	removefiles { IGNORE_FILES[0], IGNORE_FILES[1] }
+	removefiles { IGNORE_FILES[0], IGNORE_FILES[1], IGNORE_FILES[2], IGNORE_FILES[3] }
 
 	-- Includes
 	includedirs { "../ThirdParty/DirectXShaderCompiler" }
@@ -151,6 +168,8 @@ project (RUNTIME_NAME)
 		links { "IrrXML" }
 
 -- Editor --------------------------------------------------------------------------------------------------
+-- The null backend displays nothing, so it gets the headless executable instead
+if API_GRAPHICS ~= "API_GRAPHICS_NULL" then
 project (EDITOR_NAME)
 	location (EDITOR_DIR)
 	links { RUNTIME_NAME }
@@ -159,7 +178,7 @@ project (EDITOR_NAME)
 	objdir (INTERMEDIATE_DIR)
 	kind "WindowedApp"
 	staticruntime "On"
-	defines{ "SPARTAN_EDITOR", API_GRAPHICS }
+	defines{ "SPARTAN_EDITOR", API_GRAPHICS, API_INPUT }
 	
 	-- Files
 	files 
@@ -177,6 +196,50 @@ project (EDITOR_NAME)
 	-- Libraries
 	libdirs (LIBRARY_DIR)
 
+	-- "Debug"
+	filter "configurations:Debug"
+		targetdir (TARGET_DIR_DEBUG)	
+		debugdir (TARGET_DIR_DEBUG)
+		debugformat (DEBUG_FORMAT)		
+				
+	-- "Release"
+	filter "configurations:Release"
+		targetdir (TARGET_DIR_RELEASE)
+		debugdir (TARGET_DIR_RELEASE)
+end
+
+-- Headless ------------------------------------------------------------------------------------------------
+-- Runs the verifications and benchmarks (see Headless/main.cpp), with the null backend it needs no window or GPU
+project (HEADLESS_NAME)
+	location (HEADLESS_DIR)
+	links { RUNTIME_NAME }
+	dependson { RUNTIME_NAME }
+	objdir (INTERMEDIATE_DIR)
+	kind "ConsoleApp"
+	staticruntime "On"
+	defines{ API_GRAPHICS, API_INPUT }
+	
+	-- Files
+	files 
+	{ 
+		HEADLESS_DIR .. "/**.h",
+		HEADLESS_DIR .. "/**.cpp"
+	}
+	
+	-- Includes
+	includedirs { "../" .. RUNTIME_NAME }
+	
+	-- The other backends need a (hidden) window to create a device with, the editor's is reused
+	if API_GRAPHICS == "API_GRAPHICS_NULL" then
+		targetname ( TARGET_NAME )
+	else
+		targetname ( TARGET_NAME .. "_headless" )
+		includedirs { EDITOR_DIR }
+	end
+	
+	-- Libraries
+	libdirs (LIBRARY_DIR)
+
 	-- "Debug"
 	filter "configurations:Debug"
 		targetdir (TARGET_DIR_DEBUG)	